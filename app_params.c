@@ -0,0 +1,205 @@
+#include "sdk_common.h"
+#include "app_params.h"
+#include <string.h>
+#include "ble_gap.h"
+#include "fds.h"
+#include "fds_maint.h"
+#include "nrf_log.h"
+
+/**@brief Range and default of a parameter. */
+typedef struct
+{
+    uint32_t min;
+    uint32_t max;
+    uint32_t def;
+} param_desc_t;
+
+static const param_desc_t m_desc_table[APP_PARAM_COUNT] =
+{
+    [APP_PARAM_TICK_INTERVAL]     = {5,                                1000,                             100},
+    [APP_PARAM_INACTIVE_TIME]     = {30,                               3600,                             300},
+    [APP_PARAM_PAIR_HOLD_TIME]    = {200,                              10000,                            400},
+    [APP_PARAM_MIN_CONN_INTERVAL] = {BLE_GAP_CP_MIN_CONN_INTVL_MIN,    BLE_GAP_CP_MIN_CONN_INTVL_MAX,    MSEC_TO_UNITS(100, UNIT_1_25_MS)},
+    [APP_PARAM_MAX_CONN_INTERVAL] = {BLE_GAP_CP_MAX_CONN_INTVL_MIN,    BLE_GAP_CP_MAX_CONN_INTVL_MAX,    MSEC_TO_UNITS(200, UNIT_1_25_MS)},
+    [APP_PARAM_SLAVE_LATENCY]     = {0,                                BLE_GAP_CP_SLAVE_LATENCY_MAX,     0},
+    [APP_PARAM_CONN_SUP_TIMEOUT]  = {BLE_GAP_CP_CONN_SUP_TIMEOUT_MIN,  BLE_GAP_CP_CONN_SUP_TIMEOUT_MAX,  MSEC_TO_UNITS(4000, UNIT_10_MS)},
+    [APP_PARAM_ADV_INTERVAL]      = {BLE_GAP_ADV_INTERVAL_MIN,         0x4000,                           300},
+    [APP_PARAM_SCAN_FAST_INTERVAL]= {1,                                10,                               2},
+    [APP_PARAM_SCAN_HOLD_TIME]    = {10,                               5000,                             500},
+    [APP_PARAM_DEBOUNCE_TIME]     = {0,                                30,                               5},
+    [APP_PARAM_ROLLOVER_TIME]     = {0,                                500,                              0},
+};
+
+static uint32_t             m_values[APP_PARAM_COUNT];  /**< Source of the FDS record, must stay valid while a write is queued. */
+static app_params_handler_t m_handler;
+static fds_record_desc_t    m_desc;
+static bool                 m_stored;                   /**< m_desc refers to the stored record. */
+static bool                 m_save_pending;             /**< A save could not be queued and is retried on the next FDS event. */
+
+/**@brief Function for checking a set of values against the ranges and each other.
+ */
+static bool values_valid(uint32_t const * p_values)
+{
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; i++)
+    {
+        if ((p_values[i] < m_desc_table[i].min) || (p_values[i] > m_desc_table[i].max))
+        {
+            return false;
+        }
+    }
+
+    // Core spec: the supervision timeout exceeds (1 + latency) * max interval * 2.
+    return (p_values[APP_PARAM_MIN_CONN_INTERVAL] <= p_values[APP_PARAM_MAX_CONN_INTERVAL])
+           && (p_values[APP_PARAM_CONN_SUP_TIMEOUT] * 4
+               > (1 + p_values[APP_PARAM_SLAVE_LATENCY]) * p_values[APP_PARAM_MAX_CONN_INTERVAL]);
+}
+
+static void params_save(void)
+{
+    ret_code_t   err_code;
+    fds_record_t record;
+
+    record.file_id           = APP_PARAMS_FILE_ID;
+    record.key               = APP_PARAMS_RECORD_KEY;
+    record.data.p_data       = m_values;
+    record.data.length_words = BYTES_TO_WORDS(sizeof(m_values));
+
+    if (m_stored)
+    {
+        err_code = fds_record_update(&m_desc, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(&m_desc, &record);
+    }
+
+    m_save_pending = (err_code != NRF_SUCCESS);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_stored = true;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        fds_maint_gc_request();
+    }
+    else if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        NRF_LOG_WARNING("Parameters save failed: %x", err_code);
+    }
+}
+
+static void params_load(void)
+{
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+    uint32_t           stored[APP_PARAM_COUNT];
+    bool               found = false;
+
+    memset(&token, 0, sizeof(token));
+
+    if ((fds_record_find(APP_PARAMS_FILE_ID, APP_PARAMS_RECORD_KEY, &m_desc, &token) == NRF_SUCCESS)
+        && (fds_record_open(&m_desc, &record) == NRF_SUCCESS))
+    {
+        if (record.p_header->length_words == BYTES_TO_WORDS(sizeof(stored)))
+        {
+            memcpy(stored, record.p_data, sizeof(stored));
+            found = true;
+        }
+        UNUSED_RETURN_VALUE(fds_record_close(&m_desc));
+        m_stored = true;
+    }
+
+    // A record of another layout, or with values no longer allowed, is replaced on the next change.
+    if (!found || !values_valid(stored))
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; i++)
+    {
+        if (stored[i] != m_values[i])
+        {
+            m_values[i] = stored[i];
+            m_handler((app_param_id_t)i, m_values[i]);
+        }
+    }
+}
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    if (p_evt->id == FDS_EVT_INIT)
+    {
+        if (p_evt->result == NRF_SUCCESS)
+        {
+            params_load();
+        }
+        return;
+    }
+
+    // Any completed operation frees queue space, and a GC frees flash.
+    if (m_save_pending)
+    {
+        params_save();
+    }
+}
+
+ret_code_t app_params_init(app_params_handler_t handler)
+{
+    VERIFY_PARAM_NOT_NULL(handler);
+
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; i++)
+    {
+        m_values[i] = m_desc_table[i].def;
+    }
+    m_handler      = handler;
+    m_stored       = false;
+    m_save_pending = false;
+
+    return fds_register(fds_evt_handler);
+}
+
+uint32_t app_params_get(app_param_id_t id)
+{
+    return m_values[id];
+}
+
+ret_code_t app_params_set(app_param_id_t id, uint32_t value)
+{
+    uint32_t values[APP_PARAM_COUNT];
+
+    if (id >= APP_PARAM_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(values, m_values, sizeof(values));
+    values[id] = value;
+
+    if (!values_valid(values))
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (value == m_values[id])
+    {
+        return NRF_SUCCESS;
+    }
+
+    m_values[id] = value;
+    params_save();
+    m_handler(id, value);
+
+    return NRF_SUCCESS;
+}
+
+void app_params_encode(uint8_t * p_table)
+{
+    for (uint8_t i = 0; i < APP_PARAM_COUNT; i++)
+    {
+        p_table[0] = i;
+        UNUSED_RETURN_VALUE(uint32_encode(m_values[i], &p_table[1]));
+        UNUSED_RETURN_VALUE(uint32_encode(m_desc_table[i].min, &p_table[5]));
+        UNUSED_RETURN_VALUE(uint32_encode(m_desc_table[i].max, &p_table[9]));
+        p_table += APP_PARAMS_ENTRY_LEN;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef APP_PARAMS_H__
+#define APP_PARAMS_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+/**@brief Runtime parameters.
+ *
+ * @details Timing values that trade latency against battery life, tunable without reflashing.
+ *          Each parameter is an unsigned integer with a range and a default. A value outside its
+ *          range, or one that makes the connection parameters inconsistent, is rejected. Changed
+ *          values are stored in one FDS record and reported to the application, which applies
+ *          them right away. Stored values are loaded once FDS is initialized and reported the
+ *          same way, until then the defaults apply.
+ *
+ *          Table layout, little endian, per parameter in id order: id (u8), value (u32),
+ *          minimum (u32), maximum (u32).
+ */
+
+#define APP_PARAMS_FILE_ID              0x1003
+#define APP_PARAMS_RECORD_KEY           0x0001
+#define APP_PARAMS_ENTRY_LEN            13
+
+/**@brief Parameters, with their units. */
+typedef enum
+{
+    APP_PARAM_TICK_INTERVAL,                                        /**< Button polling interval while no key is down, ms. */
+    APP_PARAM_INACTIVE_TIME,                                        /**< Time without key activity before sleep, s. */
+    APP_PARAM_PAIR_HOLD_TIME,                                       /**< Power button hold that enters pairing mode, ms. */
+    APP_PARAM_MIN_CONN_INTERVAL,                                    /**< Preferred minimum connection interval, 1.25 ms units. */
+    APP_PARAM_MAX_CONN_INTERVAL,                                    /**< Preferred maximum connection interval, 1.25 ms units. */
+    APP_PARAM_SLAVE_LATENCY,                                        /**< Preferred slave latency, connection events. */
+    APP_PARAM_CONN_SUP_TIMEOUT,                                     /**< Preferred supervision timeout, 10 ms units. */
+    APP_PARAM_ADV_INTERVAL,                                         /**< Fast advertising interval, 0.625 ms units. */
+    APP_PARAM_SCAN_FAST_INTERVAL,                                   /**< Button polling interval while typing, ms. */
+    APP_PARAM_SCAN_HOLD_TIME,                                       /**< Time the fast polling continues after the last key is released, ms. */
+    APP_PARAM_DEBOUNCE_TIME,                                        /**< Time a key reading must be stable to count, ms. */
+    APP_PARAM_ROLLOVER_TIME,                                        /**< Longest overlap of two chords that still splits them, ms, 0 for no rollover. */
+    APP_PARAM_COUNT
+} app_param_id_t;
+
+#define APP_PARAMS_TABLE_LEN            (APP_PARAM_COUNT * APP_PARAMS_ENTRY_LEN)
+
+/**@brief Called when a parameter has changed. */
+typedef void (*app_params_handler_t) (app_param_id_t id, uint32_t value);
+
+/**@brief Function for initializing the parameters to their defaults. Must be called before fds_init().
+ *
+ * @param[in]   handler  Handler applying changed parameters.
+ */
+ret_code_t app_params_init(app_params_handler_t handler);
+
+/**@brief Function for getting a parameter.
+ */
+uint32_t app_params_get(app_param_id_t id);
+
+/**@brief Function for changing and storing a parameter.
+ *
+ * @return NRF_ERROR_INVALID_PARAM if the id is unknown or the value is not allowed.
+ */
+ret_code_t app_params_set(app_param_id_t id, uint32_t value);
+
+/**@brief Function for encoding the parameter table.
+ *
+ * @param[out]  p_table  Buffer of APP_PARAMS_TABLE_LEN bytes.
+ */
+void app_params_encode(uint8_t * p_table);
+
+#endif // APP_PARAMS_H__
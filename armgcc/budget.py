@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""Size and stack budget report for the firmware, run by `make budget`.
+
+Sums the input sections of the linker map per object: the project modules one
+by one, the SDK objects and the toolchain libraries as groups. Flash counts
+code, read-only data and the load image of .data; RAM counts .data, .bss and
+the heap and stack reservations. Stack frames come from the .su files that
+-fstack-usage writes next to the objects. Exits non-zero when a budget is
+exceeded.
+
+Under LTO the map only names the partitions the link generated, *.ltrans*.o,
+so their sections are split by symbol instead: each symbol counts for the
+source file its debug information names, and what no symbol covers is shown
+as unattributed. Their stack frames come from the .su files the link writes
+next to the ELF.
+"""
+
+import argparse
+import bisect
+import glob
+import os
+import re
+import subprocess
+import sys
+
+RAM_START = 0x20000000
+LTO = 'link time optimized'
+UNATTRIBUTED = 'unattributed (LTO)'
+
+SECTION_RE = re.compile(r'^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+NAME_RE = re.compile(r'^ (\S+)$')
+CONT_RE = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+
+
+def module_of(path, project):
+    """Returns the report row of an input file."""
+    if re.match(r'.*\.a\(', path):
+        return 'toolchain libraries'
+    name = os.path.basename(path)
+    if '.ltrans' in name:
+        return LTO
+    if name.endswith('.o'):
+        name = name[:-2]
+    if name in project:
+        return name
+    if path.startswith('linker stubs') or not name:
+        return 'other'
+    return 'SDK libraries'
+
+
+def map_usage(map_file, project):
+    """Returns {module: [flash, ram]} from the input sections of a GNU ld map, and the sections of
+    the LTO partitions as [(address, size, flash, ram)], left out of the modules."""
+    usage = {}
+    lto = []
+    in_map = False
+    pending = None
+
+    with open(map_file) as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if line.startswith('Linker script and memory map'):
+                in_map = True
+                continue
+            if not in_map:
+                continue
+
+            # Long section names put the address, size and file on the next line.
+            match = SECTION_RE.match(line)
+            if match:
+                section, addr, size, path = match.groups()
+            elif pending is not None and CONT_RE.match(line):
+                section = pending
+                addr, size, path = CONT_RE.match(line).groups()
+            else:
+                name = NAME_RE.match(line)
+                pending = name.group(1) if name else None
+                continue
+            pending = None
+
+            addr = int(addr, 16)
+            size = int(size, 16)
+            if size == 0 or addr == 0 or path.startswith('0x'):
+                continue
+
+            module = module_of(path.strip(), project)
+            if addr >= RAM_START:
+                flash, ram = (size if section.startswith('.data') else 0), size
+            else:
+                flash, ram = size, 0
+            if module == LTO:
+                lto.append((addr, size, flash, ram))
+                continue
+            row = usage.setdefault(module, [0, 0])
+            row[0] += flash
+            row[1] += ram
+    return usage, sorted(lto)
+
+
+def symbol_usage(nm_tool, elf, sections, project):
+    """Returns {module: [flash, ram]} of the LTO partition sections, by the symbols in them."""
+    out = subprocess.check_output([nm_tool, '--print-size', '--line-numbers', '--defined-only', elf],
+                                  universal_newlines=True)
+    starts = [s[0] for s in sections]
+    seen = set()
+    usage = {}
+    for line in out.splitlines():
+        fields = line.split('\t')
+        head = fields[0].split()
+        if len(head) != 4:
+            continue
+        addr, size = int(head[0], 16), int(head[1], 16)
+        i = bisect.bisect_right(starts, addr) - 1
+        if i < 0 or addr >= starts[i] + sections[i][1] or addr in seen:
+            continue
+        seen.add(addr)
+        source = os.path.basename(fields[1].rsplit(':', 1)[0]) if len(fields) > 1 else ''
+        if source in project:
+            module = source
+        else:
+            module = 'SDK libraries' if source else UNATTRIBUTED
+        section_size = sections[i][1]
+        row = usage.setdefault(module, [0, 0])
+        row[0] += size if sections[i][2] == section_size else 0
+        row[1] += size if sections[i][3] == section_size else 0
+
+    # padding, literal pools and symbols without a size or a source file
+    rest = [sum(s[2] for s in sections) - sum(r[0] for r in usage.values()),
+            sum(s[3] for s in sections) - sum(r[1] for r in usage.values())]
+    row = usage.setdefault(UNATTRIBUTED, [0, 0])
+    row[0] += rest[0]
+    row[1] += rest[1]
+    return usage
+
+
+def elf_totals(size_tool, elf):
+    """Returns (flash, ram) from the Berkeley format of size."""
+    out = subprocess.check_output([size_tool, elf], universal_newlines=True)
+    text, data, bss = (int(v) for v in out.splitlines()[1].split()[:3])
+    return text + data, data + bss
+
+
+def stack_frames(su_files):
+    """Returns [(bytes, qualifier, function, module)] from .su files. A line names the source file
+    of its function, which is the module also in the .su files of an LTO link."""
+    frames = []
+    for su in su_files:
+        with open(su) as f:
+            for line in f:
+                fields = line.rstrip('\n').split('\t')
+                if len(fields) != 3:
+                    continue
+                function = fields[0].rsplit(':', 1)[-1]
+                module = os.path.basename(fields[0].split(':', 1)[0])
+                frames.append((int(fields[1]), fields[2], function, module))
+    frames.sort(reverse=True)
+    return frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--map', required=True)
+    parser.add_argument('--elf', required=True)
+    parser.add_argument('--size-tool', default='arm-none-eabi-size')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    parser.add_argument('--obj-dir', required=True)
+    parser.add_argument('--project', nargs='*', default=[], help='project source file names')
+    parser.add_argument('--flash', type=int, required=True, help='flash budget, bytes')
+    parser.add_argument('--ram', type=int, required=True, help='RAM budget, bytes')
+    parser.add_argument('--stack-frame', type=int, required=True, help='largest stack frame of a project function, bytes')
+    parser.add_argument('--module', nargs='*', default=[], metavar='NAME=BYTES',
+                        help='flash budget of a single module')
+    args = parser.parse_args()
+
+    project = {os.path.basename(p) for p in args.project}
+    usage, lto = map_usage(args.map, project)
+    if lto:
+        for name, (flash, ram) in symbol_usage(args.nm, args.elf, lto, project).items():
+            row = usage.setdefault(name, [0, 0])
+            row[0] += flash
+            row[1] += ram
+        su_files = glob.glob(args.elf + '.ltrans*.su')
+        su_dir = os.path.dirname(args.elf)
+    else:
+        su_files = glob.glob(os.path.join(args.obj_dir, '*.su'))
+        su_dir = args.obj_dir
+    flash, ram = elf_totals(args.size_tool, args.elf)
+    frames = stack_frames(su_files)
+    failures = []
+
+    print('%-24s %10s %10s' % ('module', 'flash', 'ram'))
+    for name in sorted(usage, key=lambda n: (n not in project, n)):
+        print('%-24s %10d %10d' % (name, usage[name][0], usage[name][1]))
+    print('%-24s %10d %10d' % ('total', flash, ram))
+    print('%-24s %10d %10d' % ('budget', args.flash, args.ram))
+
+    print('\nlargest stack frames:')
+    for size, qualifier, function, module in frames[:10]:
+        print('%6d  %-8s %s (%s)' % (size, qualifier, function, module))
+
+    if flash > args.flash:
+        failures.append('flash %d > %d' % (flash, args.flash))
+    if ram > args.ram:
+        failures.append('RAM %d > %d' % (ram, args.ram))
+    for module_budget in args.module:
+        name, limit = module_budget.split('=')
+        if name not in usage:
+            failures.append('%s has a flash budget but is not in the map' % name)
+            continue
+        used = usage[name][0]
+        if used > int(limit, 0):
+            failures.append('%s flash %d > %s' % (name, used, limit))
+    for size, qualifier, function, module in frames:
+        if module not in project:
+            continue
+        if size > args.stack_frame:
+            failures.append('%s (%s) stack frame %d > %d' % (function, module, size, args.stack_frame))
+        elif qualifier == 'dynamic':
+            failures.append('%s (%s) has an unbounded stack frame' % (function, module))
+
+    if not frames:
+        failures.append('no .su files in %s, rebuild with -fstack-usage%s'
+                        % (su_dir, ' at link time, with GCC 11 or later' if lto else ''))
+
+    for failure in failures:
+        print('budget exceeded: ' + failure, file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Key edge to air latency sweep of the chord path, run by `make latency`.
+
+Needs a board flashed with LATENCY_BENCH=1, a J-Link on its SWD port and a
+Bluetooth adapter on the host. The host acts as the central: it connects,
+subscribes to chord notifications and sets the debounce time, the typing scan
+interval and the connection interval through the configuration service. For
+every combination a scripted run is started over RTT, the board replaces its
+keys with the script and timestamps each chord at the release edge, when it is
+debounced, when the SoftDevice takes the notification and when the central
+acknowledges it (see latency_bench.h). One CSV row is written per chord and a
+summary per combination is printed.
+
+test/bench_latency.c runs the same script and writes the same rows on the host,
+over the SoftDevice stand-in; this sweep is the check on a radio.
+
+Requires the bleak and pylink-square packages.
+"""
+
+import argparse
+import asyncio
+import csv
+import statistics
+import struct
+import sys
+import time
+
+import bleak
+import pylink
+
+UUID_BASE = '5ed0%04x-eb89-51a7-694d-6141b6a34e44'
+CHORD_CHAR = UUID_BASE % 0x1401
+CONFIG_CHAR = UUID_BASE % 0x1601
+
+# app_param_id_t
+PARAM_MIN_CONN_INTERVAL = 3
+PARAM_MAX_CONN_INTERVAL = 4
+PARAM_SCAN_FAST_INTERVAL = 8
+PARAM_DEBOUNCE_TIME = 10
+
+RTT_CHANNEL = 2
+CMD_RUN = b'r'
+MAGIC = 0x434E424C
+HEADER = struct.Struct('<IHHHH')
+RECORD = struct.Struct('<HBBI')
+MARK_EDGE, MARK_DEBOUNCED, MARK_HVX, MARK_AIR, MARK_END = range(5)
+
+SETTLE_S = 2.0
+RUN_TIMEOUT_S = 60.0
+
+COLUMNS = ['debounce_ms', 'scan_ms', 'conn_ms_requested', 'conn_ms', 'seq', 'chord',
+           'debounced_us', 'hvx_us', 'air_us']
+
+
+async def param_table(client):
+    """Returns {id: value} read from the configuration service."""
+    table = await client.read_gatt_char(CONFIG_CHAR)
+    return {table[i]: struct.unpack_from('<I', table, i + 1)[0] for i in range(0, len(table), 13)}
+
+
+async def param_set(client, param, value):
+    await client.write_gatt_char(CONFIG_CHAR, struct.pack('<BI', param, value), response=True)
+
+
+async def conn_interval_set(client, ms):
+    """Sets both connection interval bounds, in the order that keeps minimum <= maximum."""
+    units = int(round(ms / 1.25))
+    table = await param_table(client)
+    if units > table[PARAM_MAX_CONN_INTERVAL]:
+        await param_set(client, PARAM_MAX_CONN_INTERVAL, units)
+        await param_set(client, PARAM_MIN_CONN_INTERVAL, units)
+    else:
+        await param_set(client, PARAM_MIN_CONN_INTERVAL, units)
+        await param_set(client, PARAM_MAX_CONN_INTERVAL, units)
+
+
+def rtt_run(jlink):
+    """Starts a run and returns (header, records) once the board reports its end."""
+    data = bytearray()
+    while jlink.rtt_read(RTT_CHANNEL, 1024):
+        pass
+    jlink.rtt_write(RTT_CHANNEL, list(CMD_RUN))
+
+    deadline = time.monotonic() + RUN_TIMEOUT_S
+    while time.monotonic() < deadline:
+        data += bytes(jlink.rtt_read(RTT_CHANNEL, 1024))
+        if len(data) >= HEADER.size:
+            header = HEADER.unpack_from(data)
+            if header[0] != MAGIC:
+                raise SystemExit('latency stream out of sync, is the board built with LATENCY_BENCH=1?')
+            body = data[HEADER.size:]
+            records = [RECORD.unpack_from(body, i) for i in range(0, len(body) - RECORD.size + 1, RECORD.size)]
+            if records and records[-1][1] == MARK_END:
+                return header, records
+        time.sleep(0.05)
+    raise SystemExit('no end of run within %d s' % RUN_TIMEOUT_S)
+
+
+def chords_of(records):
+    """Returns {seq: {mark: time_us}}."""
+    chords = {}
+    for seq, mark, chord, time_us in records:
+        if mark != MARK_END:
+            chords.setdefault(seq, {'chord': chord})[mark] = time_us
+    return chords
+
+
+def since_edge(marks, mark):
+    if MARK_EDGE not in marks or mark not in marks:
+        return ''
+    return marks[mark] - marks[MARK_EDGE]
+
+
+async def sweep(args, jlink, writer):
+    device = await bleak.BleakScanner.find_device_by_name(args.name, timeout=20.0)
+    if device is None:
+        raise SystemExit('%s not advertising' % args.name)
+
+    async with bleak.BleakClient(device) as client:
+        await client.start_notify(CHORD_CHAR, lambda _handle, _data: None)
+        print('%-9s %-7s %-8s %-8s %6s %8s %8s %8s %8s' % ('debounce', 'scan', 'conn', 'in use', 'chords',
+                                                          'p50 ms', 'p95 ms', 'max ms', 'missing'))
+        for conn_ms in args.conn:
+            await conn_interval_set(client, conn_ms)
+            for debounce in args.debounce:
+                await param_set(client, PARAM_DEBOUNCE_TIME, debounce)
+                for scan in args.scan:
+                    await param_set(client, PARAM_SCAN_FAST_INTERVAL, scan)
+                    await asyncio.sleep(SETTLE_S)
+
+                    header, records = rtt_run(jlink)
+                    conn_in_use = header[3] * 1.25
+                    chords = chords_of(records)
+                    air = []
+                    for seq in sorted(chords):
+                        marks = chords[seq]
+                        writer.writerow([debounce, scan, conn_ms, conn_in_use, seq, marks['chord'],
+                                         since_edge(marks, MARK_DEBOUNCED), since_edge(marks, MARK_HVX),
+                                         since_edge(marks, MARK_AIR)])
+                        if MARK_EDGE in marks and MARK_AIR in marks:
+                            air.append((marks[MARK_AIR] - marks[MARK_EDGE]) / 1000.0)
+
+                    missing = header[4] - len(air)
+                    if air:
+                        air.sort()
+                        print('%-9d %-7d %-8g %-8g %6d %8.1f %8.1f %8.1f %8d' % (
+                            debounce, scan, conn_ms, conn_in_use, len(air), statistics.median(air),
+                            air[int(0.95 * (len(air) - 1))], air[-1], missing))
+                    else:
+                        print('%-9d %-7d %-8g %-8g %6d %8s %8s %8s %8d' % (
+                            debounce, scan, conn_ms, conn_in_use, 0, '-', '-', '-', missing))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--debounce', type=int, nargs='+', required=True, help='debounce times, ms')
+    parser.add_argument('--scan', type=int, nargs='+', required=True, help='scan intervals while typing, ms')
+    parser.add_argument('--conn', type=float, nargs='+', required=True, help='connection intervals, ms')
+    parser.add_argument('--device', required=True, help='J-Link device name, for example NRF52840_XXAA')
+    parser.add_argument('--name', default='Chorded Keys', help='advertised name of the board')
+    parser.add_argument('--csv', required=True)
+    args = parser.parse_args()
+
+    jlink = pylink.JLink()
+    jlink.open()
+    jlink.set_tif(pylink.enums.JLinkInterfaces.SWD)
+    jlink.connect(args.device)
+    jlink.rtt_start()
+    try:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.writer(f)
+            writer.writerow(COLUMNS)
+            asyncio.run(sweep(args, jlink, writer))
+    finally:
+        jlink.rtt_stop()
+        jlink.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Code size and notify path cycles of the build profiles, run by `make profiles`.
+
+Builds the debug, release and size profiles and compares their flash and RAM.
+With --cycles each profile is also built with NOTIFY_CYCLES=1 and flashed to the
+connected board; after chords have been typed with a central subscribed, the
+cycle counters of ble_chord_chord_value_update() are read back over the
+debugger. Cycle counts need a board, the size comparison does not.
+"""
+
+import argparse
+import re
+import shlex
+import subprocess
+import sys
+
+PROFILES = ['debug', 'release', 'size']
+COUNTERS = 'ble_chord_notify_cycles'
+
+
+def build(args, profile, cycles):
+    """Builds a profile and returns the path of its ELF file."""
+    subprocess.check_call(shlex.split(args.make) + ['PROFILE=' + profile, 'NOTIFY_CYCLES=%s' % ('1' if cycles else ''),
+                                                    'flash' if cycles else 'default'])
+    return '%s/%s%s/%s.out' % (args.build_dir, profile, '_cycles' if cycles else '', args.target)
+
+
+def elf_totals(size_tool, elf):
+    """Returns (flash, ram) from the Berkeley format of size."""
+    out = subprocess.check_output([size_tool, elf], universal_newlines=True)
+    text, data, bss = (int(v) for v in out.splitlines()[1].split()[:3])
+    return text + data, data + bss
+
+
+def read_cycles(nm_tool, elf):
+    """Returns (count, min, max, total) read from the running board."""
+    out = subprocess.check_output([nm_tool, elf], universal_newlines=True)
+    addr = None
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 3 and fields[2] == COUNTERS:
+            addr = int(fields[0], 16)
+    if addr is None:
+        raise SystemExit('%s not in %s, was it built with NOTIFY_CYCLES=1?' % (COUNTERS, elf))
+
+    out = subprocess.check_output(['nrfjprog', '-f', 'nrf52', '--memrd', hex(addr), '--w', '32', '--n', '16'],
+                                  universal_newlines=True)
+    words = []
+    for line in out.splitlines():
+        match = re.match(r'^0x[0-9a-fA-F]+:\s+((?:[0-9a-fA-F]{8}\s*)+)', line)
+        if match:
+            words += [int(w, 16) for w in match.group(1).split()]
+    return tuple(words[:4])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--make', default='make')
+    parser.add_argument('--build-dir', required=True, help='output directory of the board, without the profile')
+    parser.add_argument('--target', required=True)
+    parser.add_argument('--size-tool', default='arm-none-eabi-size')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    parser.add_argument('--cycles', action='store_true', help='also measure the notify path on a connected board')
+    args = parser.parse_args()
+
+    sizes = {}
+    for profile in PROFILES:
+        sizes[profile] = elf_totals(args.size_tool, build(args, profile, False))
+
+    cycles = {}
+    if args.cycles:
+        for profile in PROFILES:
+            elf = build(args, profile, True)
+            input('%s flashed: connect a central, enable chord notifications, type some chords, '
+                  'then press Enter ' % profile)
+            cycles[profile] = read_cycles(args.nm, elf)
+
+    base_flash, base_ram = sizes[PROFILES[0]]
+    print('%-8s %10s %8s %10s %8s %8s %8s %8s' % ('profile', 'flash', 'delta', 'ram', 'delta',
+                                                 'cyc min', 'cyc avg', 'cyc max'))
+    for profile in PROFILES:
+        flash, ram = sizes[profile]
+        row = '%-8s %10d %+8d %10d %+8d' % (profile, flash, flash - base_flash, ram, ram - base_ram)
+        if profile in cycles and cycles[profile][0] != 0:
+            count, low, high, total = cycles[profile]
+            row += ' %8d %8d %8d' % (low, total // count, high)
+        else:
+            row += ' %8s %8s %8s' % ('-', '-', '-')
+        print(row)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,474 @@
+#include "sdk_common.h"
+#include "ble_bulk.h"
+#include <string.h>
+#include "ble_srv_common.h"
+#include "crc16.h"
+#include "nrf_log.h"
+
+#define BULK_CTRL_MAX_LEN       8
+
+/**@brief Function for computing the CRC of a block, covering the seq and len bytes and the payload.
+ */
+static uint16_t block_crc(uint8_t const * p_block, uint8_t len)
+{
+    uint16_t crc = crc16_compute(p_block, 2, NULL);
+    return crc16_compute(&p_block[BLE_BULK_HEADER_LEN], len, &crc);
+}
+
+/**@brief Function for sending a notification on the control point.
+ */
+static void ctrl_send(ble_bulk_t * p_bulk, uint8_t const * p_data, uint16_t len)
+{
+    ble_gatts_hvx_params_t hvx_params;
+    uint32_t               err_code;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle = p_bulk->ctrl_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = p_data;
+
+    // A lost control notification is recovered by the peer timing out and resending.
+    err_code = sd_ble_gatts_hvx(p_bulk->conn_handle, &hvx_params);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("Bulk control notification failed: %x", err_code);
+    }
+}
+
+static void ctrl_respond(ble_bulk_t * p_bulk, uint8_t opcode, uint8_t status)
+{
+    uint8_t rsp[] = {BLE_BULK_OP_RESPONSE, opcode, status};
+    ctrl_send(p_bulk, rsp, sizeof(rsp));
+}
+
+static void ctrl_ack(ble_bulk_t * p_bulk, uint8_t opcode, uint8_t seq)
+{
+    uint8_t ack[] = {opcode, seq};
+    ctrl_send(p_bulk, ack, sizeof(ack));
+}
+
+/**@brief Function for ending the transfer in progress.
+ */
+static void transfer_end(ble_bulk_t * p_bulk, bool success)
+{
+    ble_bulk_stream_t const * p_stream = p_bulk->p_active;
+
+    p_bulk->p_active = NULL;
+    p_bulk->pending  = false;
+
+    if (!p_bulk->reading && (p_stream != NULL) && (p_stream->done != NULL))
+    {
+        p_stream->done(success);
+    }
+}
+
+/**@brief Function for sending stream blocks until the window is full or the SoftDevice queue is.
+ */
+static void read_pump(ble_bulk_t * p_bulk)
+{
+    uint32_t err_code;
+
+    while (p_bulk->p_active != NULL && p_bulk->reading)
+    {
+        if (!p_bulk->pending)
+        {
+            if (p_bulk->eof || ((uint8_t)(p_bulk->seq - p_bulk->acked_seq) >= BLE_BULK_WINDOW))
+            {
+                return;
+            }
+
+            uint8_t  * p_block = p_bulk->tx_block;
+            uint16_t   len     = p_bulk->p_active->read(p_bulk->offset,
+                                                        &p_block[BLE_BULK_HEADER_LEN],
+                                                        p_bulk->payload_len);
+
+            p_bulk->block_offset[p_bulk->seq % BLE_BULK_WINDOW] = p_bulk->offset;
+
+            p_block[0] = p_bulk->seq;
+            p_block[1] = (uint8_t)len;
+            uint16_encode(block_crc(p_block, len), &p_block[2]);
+
+            p_bulk->tx_block_len = BLE_BULK_HEADER_LEN + len;
+            p_bulk->offset      += len;
+            p_bulk->eof          = (len == 0);
+            p_bulk->seq++;
+            p_bulk->pending      = true;
+        }
+
+        ble_gatts_hvx_params_t hvx_params;
+
+        memset(&hvx_params, 0, sizeof(hvx_params));
+
+        hvx_params.handle = p_bulk->tx_handles.value_handle;
+        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+        hvx_params.p_len  = &p_bulk->tx_block_len;
+        hvx_params.p_data = p_bulk->tx_block;
+
+        err_code = sd_ble_gatts_hvx(p_bulk->conn_handle, &hvx_params);
+        if (err_code == NRF_ERROR_RESOURCES)
+        {
+            // Resumed on BLE_GATTS_EVT_HVN_TX_COMPLETE.
+            return;
+        }
+        if (err_code != NRF_SUCCESS)
+        {
+            NRF_LOG_INFO("Bulk read aborted: %x", err_code);
+            transfer_end(p_bulk, false);
+            return;
+        }
+        p_bulk->pending = false;
+    }
+}
+
+static void on_open(ble_bulk_t * p_bulk, uint8_t const * p_data, uint16_t len)
+{
+    uint8_t opcode = p_data[0];
+    bool    read   = (opcode == BLE_BULK_OP_OPEN_READ);
+
+    if ((read && len != 2) || (!read && len != 6))
+    {
+        ctrl_respond(p_bulk, opcode, BLE_BULK_STATUS_INVALID);
+        return;
+    }
+    if (p_bulk->p_active != NULL)
+    {
+        ctrl_respond(p_bulk, opcode, BLE_BULK_STATUS_BUSY);
+        return;
+    }
+
+    uint8_t                   stream_id = p_data[1];
+    ble_bulk_stream_t const * p_stream  = NULL;
+
+    if (stream_id < BLE_BULK_MAX_STREAMS)
+    {
+        p_stream = p_bulk->streams[stream_id];
+    }
+    if ((p_stream == NULL) || (read ? p_stream->read == NULL : p_stream->write == NULL))
+    {
+        ctrl_respond(p_bulk, opcode, BLE_BULK_STATUS_NO_STREAM);
+        return;
+    }
+
+    p_bulk->reading   = read;
+    p_bulk->seq       = 0;
+    p_bulk->acked_seq = 0;
+    p_bulk->offset    = 0;
+    p_bulk->eof       = false;
+    p_bulk->pending   = false;
+
+    if (!read)
+    {
+        p_bulk->total_len = uint32_decode(&p_data[2]);
+        if (p_stream->write(0, NULL, 0) != NRF_SUCCESS)
+        {
+            ctrl_respond(p_bulk, opcode, BLE_BULK_STATUS_FAILED);
+            return;
+        }
+    }
+
+    p_bulk->p_active = p_stream;
+    ctrl_respond(p_bulk, opcode, BLE_BULK_STATUS_SUCCESS);
+
+    read_pump(p_bulk);
+}
+
+/**@brief Function for handling an ACK or NAK of a read transfer.
+ */
+static void on_read_ack(ble_bulk_t * p_bulk, bool nak, uint8_t seq)
+{
+    uint8_t acked    = (uint8_t)(seq - p_bulk->acked_seq);
+    uint8_t in_flight = (uint8_t)(p_bulk->seq - p_bulk->acked_seq);
+
+    if (acked > in_flight)
+    {
+        // Stale or bogus sequence number.
+        return;
+    }
+
+    if (nak)
+    {
+        if (acked == in_flight)
+        {
+            return;
+        }
+        // Rewind to the block the peer is missing.
+        p_bulk->offset  = p_bulk->block_offset[seq % BLE_BULK_WINDOW];
+        p_bulk->seq     = seq;
+        p_bulk->eof     = false;
+        p_bulk->pending = false;
+    }
+    p_bulk->acked_seq = seq;
+
+    if (p_bulk->eof && (p_bulk->acked_seq == p_bulk->seq))
+    {
+        NRF_LOG_INFO("Bulk read complete, %d bytes", p_bulk->offset);
+        transfer_end(p_bulk, true);
+        return;
+    }
+
+    read_pump(p_bulk);
+}
+
+/**@brief Function for handling a write to the control point.
+ */
+static void on_ctrl_write(ble_bulk_t * p_bulk, uint8_t const * p_data, uint16_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+
+    switch (p_data[0])
+    {
+        case BLE_BULK_OP_OPEN_READ:
+        case BLE_BULK_OP_OPEN_WRITE:
+            on_open(p_bulk, p_data, len);
+            break;
+
+        case BLE_BULK_OP_ACK:
+        case BLE_BULK_OP_NAK:
+            if ((len == 2) && (p_bulk->p_active != NULL) && p_bulk->reading)
+            {
+                on_read_ack(p_bulk, p_data[0] == BLE_BULK_OP_NAK, p_data[1]);
+            }
+            break;
+
+        case BLE_BULK_OP_ABORT:
+            if (p_bulk->p_active != NULL)
+            {
+                transfer_end(p_bulk, false);
+            }
+            ctrl_respond(p_bulk, BLE_BULK_OP_ABORT, BLE_BULK_STATUS_SUCCESS);
+            break;
+
+        default:
+            ctrl_respond(p_bulk, p_data[0], BLE_BULK_STATUS_INVALID);
+            break;
+    }
+}
+
+/**@brief Function for handling a block written to the RX characteristic.
+ */
+static void on_rx_write(ble_bulk_t * p_bulk, uint8_t const * p_block, uint16_t len)
+{
+    if ((p_bulk->p_active == NULL) || p_bulk->reading || (len < BLE_BULK_HEADER_LEN))
+    {
+        return;
+    }
+
+    uint8_t seq         = p_block[0];
+    uint8_t payload_len = p_block[1];
+
+    if ((uint8_t)(seq - p_bulk->seq) >= BLE_BULK_WINDOW)
+    {
+        // Duplicate of a block that was already accepted.
+        return;
+    }
+    if ((seq != p_bulk->seq)
+        || (payload_len != len - BLE_BULK_HEADER_LEN)
+        || (uint16_decode(&p_block[2]) != block_crc(p_block, payload_len))
+        || (p_bulk->offset + payload_len > p_bulk->total_len))
+    {
+        ctrl_ack(p_bulk, BLE_BULK_OP_NAK, p_bulk->seq);
+        return;
+    }
+
+    if (p_bulk->p_active->write(p_bulk->offset, &p_block[BLE_BULK_HEADER_LEN], payload_len) != NRF_SUCCESS)
+    {
+        ctrl_ack(p_bulk, BLE_BULK_OP_NAK, p_bulk->seq);
+        return;
+    }
+
+    p_bulk->offset += payload_len;
+    p_bulk->seq++;
+
+    if (p_bulk->offset == p_bulk->total_len)
+    {
+        ctrl_ack(p_bulk, BLE_BULK_OP_ACK, p_bulk->seq);
+        NRF_LOG_INFO("Bulk write complete, %d bytes", p_bulk->offset);
+        transfer_end(p_bulk, true);
+    }
+    else if ((p_bulk->seq % (BLE_BULK_WINDOW / 2)) == 0)
+    {
+        ctrl_ack(p_bulk, BLE_BULK_OP_ACK, p_bulk->seq);
+    }
+}
+
+static void on_write(ble_bulk_t * p_bulk, ble_evt_t const * p_ble_evt)
+{
+    ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+
+    // Blocks and commands are whole writes, a prepared write would hand over a fragment.
+    if (((p_evt_write->op != BLE_GATTS_OP_WRITE_REQ) && (p_evt_write->op != BLE_GATTS_OP_WRITE_CMD))
+        || (p_evt_write->offset != 0))
+    {
+        return;
+    }
+
+    if (p_evt_write->handle == p_bulk->rx_handles.value_handle)
+    {
+        on_rx_write(p_bulk, p_evt_write->data, p_evt_write->len);
+    }
+    else if (p_evt_write->handle == p_bulk->ctrl_handles.value_handle)
+    {
+        on_ctrl_write(p_bulk, p_evt_write->data, p_evt_write->len);
+    }
+}
+
+void ble_bulk_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ble_bulk_t * p_bulk = (ble_bulk_t *) p_context;
+
+    if (p_bulk == NULL || p_ble_evt == NULL)
+    {
+        return;
+    }
+
+    // The service serves one link, the first to connect; the others only see its characteristics.
+    if ((p_ble_evt->header.evt_id != BLE_GAP_EVT_CONNECTED)
+        && (p_ble_evt->evt.common_evt.conn_handle != p_bulk->conn_handle))
+    {
+        return;
+    }
+
+    switch (p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            if (p_bulk->conn_handle == BLE_CONN_HANDLE_INVALID)
+            {
+                p_bulk->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+                p_bulk->payload_len = BLE_GATT_ATT_MTU_DEFAULT - 3 - BLE_BULK_HEADER_LEN;
+            }
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_bulk->p_active != NULL)
+            {
+                transfer_end(p_bulk, false);
+            }
+            p_bulk->conn_handle = BLE_CONN_HANDLE_INVALID;
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+            on_write(p_bulk, p_ble_evt);
+            break;
+
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            read_pump(p_bulk);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**@brief Function for adding a bulk characteristic.
+ */
+static uint32_t bulk_char_add(ble_bulk_t             * p_bulk,
+                              const ble_bulk_init_t  * p_bulk_init,
+                              uint16_t                 uuid,
+                              ble_gatt_char_props_t    props,
+                              uint16_t                 max_len,
+                              ble_gatts_char_handles_t * p_handles)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    cccd_md.write_perm = p_bulk_init->bulk_char_attr_md.cccd_write_perm;
+    cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props = props;
+    char_md.p_cccd_md  = props.notify ? &cccd_md : NULL;
+
+    ble_uuid.type = p_bulk->uuid_type;
+    ble_uuid.uuid = uuid;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = p_bulk_init->bulk_char_attr_md.read_perm;
+    attr_md.write_perm = p_bulk_init->bulk_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen       = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = 0;
+    attr_char_value.max_len   = max_len;
+
+    return sd_ble_gatts_characteristic_add(p_bulk->service_handle, &char_md,
+                                           &attr_char_value, p_handles);
+}
+
+uint32_t ble_bulk_init(ble_bulk_t * p_bulk, const ble_bulk_init_t * p_bulk_init)
+{
+    if (p_bulk == NULL || p_bulk_init == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    uint32_t              err_code;
+    ble_uuid_t            ble_uuid;
+    ble_gatt_char_props_t props;
+
+    memset(p_bulk, 0, sizeof(*p_bulk));
+    p_bulk->conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_bulk->uuid_type   = p_bulk_init->uuid_type;
+    p_bulk->payload_len = BLE_GATT_ATT_MTU_DEFAULT - 3 - BLE_BULK_HEADER_LEN;
+
+    ble_uuid.type = p_bulk->uuid_type;
+    ble_uuid.uuid = BULK_SERVICE_UUID;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_bulk->service_handle);
+    VERIFY_SUCCESS(err_code);
+
+    memset(&props, 0, sizeof(props));
+    props.notify = 1;
+    err_code = bulk_char_add(p_bulk, p_bulk_init, BULK_TX_CHAR_UUID, props,
+                             BLE_BULK_MAX_BLOCK_LEN, &p_bulk->tx_handles);
+    VERIFY_SUCCESS(err_code);
+
+    memset(&props, 0, sizeof(props));
+    props.write_wo_resp = 1;
+    err_code = bulk_char_add(p_bulk, p_bulk_init, BULK_RX_CHAR_UUID, props,
+                             BLE_BULK_MAX_BLOCK_LEN, &p_bulk->rx_handles);
+    VERIFY_SUCCESS(err_code);
+
+    memset(&props, 0, sizeof(props));
+    props.write  = 1;
+    props.notify = 1;
+    return bulk_char_add(p_bulk, p_bulk_init, BULK_CTRL_CHAR_UUID, props,
+                         BULK_CTRL_MAX_LEN, &p_bulk->ctrl_handles);
+}
+
+uint32_t ble_bulk_stream_register(ble_bulk_t * p_bulk, uint8_t stream_id, ble_bulk_stream_t const * p_stream)
+{
+    VERIFY_PARAM_NOT_NULL(p_bulk);
+
+    if (stream_id >= BLE_BULK_MAX_STREAMS)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_bulk->streams[stream_id] = p_stream;
+    return NRF_SUCCESS;
+}
+
+void ble_bulk_att_mtu_set(ble_bulk_t * p_bulk, uint16_t att_mtu)
+{
+    uint16_t block_len = MIN(att_mtu - 3, BLE_BULK_MAX_BLOCK_LEN);
+
+    // The block length byte limits a payload to 255 bytes.
+    p_bulk->payload_len = MIN(block_len - BLE_BULK_HEADER_LEN, UINT8_MAX);
+}
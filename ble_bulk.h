@@ -0,0 +1,144 @@
+#ifndef BLE_BULK_H__
+#define BLE_BULK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+
+/**@brief   Macro for defining a ble_bulk instance.
+ *
+ * @param   _name   Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_BULK_DEF(_name)                                                                          \
+static ble_bulk_t _name;                                                                             \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                                 \
+                     BLE_HRS_BLE_OBSERVER_PRIO,                                                     \
+                     ble_bulk_on_ble_evt, &_name)
+
+// The bulk service shares the vendor specific base UUID of the chord service.
+#define BULK_SERVICE_UUID                0x1500
+#define BULK_TX_CHAR_UUID                0x1501
+#define BULK_RX_CHAR_UUID                0x1502
+#define BULK_CTRL_CHAR_UUID              0x1503
+
+#define BLE_BULK_HEADER_LEN              4                                  /**< seq (1), len (1), crc16 (2). */
+#define BLE_BULK_MAX_BLOCK_LEN           (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3) /**< Largest block that fits a notification at the maximum ATT MTU. */
+#define BLE_BULK_MAX_PAYLOAD_LEN         (BLE_BULK_MAX_BLOCK_LEN - BLE_BULK_HEADER_LEN)
+#define BLE_BULK_WINDOW                  4                                  /**< Blocks that may be in flight before an ACK is required. */
+#define BLE_BULK_MAX_STREAMS             4
+
+/**@brief Control point opcodes, written by the peer and notified back by the device. */
+typedef enum
+{
+    BLE_BULK_OP_OPEN_READ  = 0x01,                                  /**< [stream]: device streams the stream contents on the TX characteristic. */
+    BLE_BULK_OP_OPEN_WRITE = 0x02,                                  /**< [stream][total length u32]: peer streams blocks on the RX characteristic. */
+    BLE_BULK_OP_ACK        = 0x03,                                  /**< [next expected seq]: cumulative acknowledgement, opens the window. */
+    BLE_BULK_OP_NAK        = 0x04,                                  /**< [next expected seq]: block lost or corrupted, resend from seq. */
+    BLE_BULK_OP_ABORT      = 0x05,                                  /**< Abort the transfer in progress. */
+    BLE_BULK_OP_RESPONSE   = 0x10                                   /**< [request opcode][status]: device response to an OPEN or ABORT. */
+} ble_bulk_op_t;
+
+/**@brief Control point response status codes. */
+typedef enum
+{
+    BLE_BULK_STATUS_SUCCESS     = 0x00,
+    BLE_BULK_STATUS_BUSY        = 0x01,
+    BLE_BULK_STATUS_NO_STREAM   = 0x02,
+    BLE_BULK_STATUS_INVALID     = 0x03,
+    BLE_BULK_STATUS_FAILED      = 0x04
+} ble_bulk_status_t;
+
+/**@brief Stream read handler. Copies up to max_len bytes starting at offset into p_data.
+ *
+ * @return Number of bytes copied, 0 at the end of the stream.
+ */
+typedef uint16_t (*ble_bulk_read_t) (uint32_t offset, uint8_t * p_data, uint16_t max_len);
+
+/**@brief Stream write handler. Called with consecutive, CRC-checked blocks.
+ *
+ * @details A write with len 0 marks the start (offset 0, before any data) and a call to the
+ *          done handler marks the end of a transfer.
+ *
+ * @return NRF_SUCCESS to accept the block, otherwise the block is NAK'ed and resent by the peer.
+ */
+typedef uint32_t (*ble_bulk_write_t) (uint32_t offset, uint8_t const * p_data, uint16_t len);
+
+/**@brief Called when a write transfer has completed or was aborted. */
+typedef void (*ble_bulk_done_t) (bool success);
+
+/**@brief Data stream exposed over the bulk service. Unused handlers may be NULL. */
+typedef struct
+{
+    ble_bulk_read_t  read;
+    ble_bulk_write_t write;
+    ble_bulk_done_t  done;
+} ble_bulk_stream_t;
+
+/**@brief Bulk Service init structure. */
+typedef struct
+{
+    uint8_t                       uuid_type;                        /**< Vendor UUID type of the chord service base. */
+    ble_srv_cccd_security_mode_t  bulk_char_attr_md;                /**< Security level for the bulk characteristics. */
+} ble_bulk_init_t;
+
+/**@brief Bulk Service structure. */
+typedef struct
+{
+    uint16_t                      service_handle;
+    ble_gatts_char_handles_t      tx_handles;
+    ble_gatts_char_handles_t      rx_handles;
+    ble_gatts_char_handles_t      ctrl_handles;
+    uint16_t                      conn_handle;
+    uint8_t                       uuid_type;
+    uint16_t                      payload_len;                      /**< Usable payload per block for the current ATT MTU. */
+    ble_bulk_stream_t const     * streams[BLE_BULK_MAX_STREAMS];
+    ble_bulk_stream_t const     * p_active;                         /**< Stream of the transfer in progress, NULL if idle. */
+    bool                          reading;                          /**< Direction of the transfer in progress. */
+    uint8_t                       seq;                              /**< Next sequence number to send (read) or expected (write). */
+    uint8_t                       acked_seq;                        /**< Oldest unacknowledged block (read). */
+    uint32_t                      offset;                           /**< Stream offset of the next block. */
+    uint32_t                      total_len;                        /**< Announced length of a write transfer. */
+    uint32_t                      block_offset[BLE_BULK_WINDOW];    /**< Stream offset of each block in the window, for resends. */
+    bool                          eof;                              /**< The end of stream block has been sent (read). */
+    bool                          pending;                          /**< tx_block is built but could not be queued yet. */
+    uint8_t                       tx_block[BLE_BULK_MAX_BLOCK_LEN];
+    uint16_t                      tx_block_len;
+} ble_bulk_t;
+
+/**@brief Function for initializing the Bulk Service.
+ *
+ * @param[out]  p_bulk       Bulk Service structure.
+ * @param[in]   p_bulk_init  Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+uint32_t ble_bulk_init(ble_bulk_t * p_bulk, const ble_bulk_init_t * p_bulk_init);
+
+/**@brief Function for registering a data stream under a stream id.
+ *
+ * @param[in]   p_bulk     Bulk Service structure.
+ * @param[in]   stream_id  Identifier the peer uses to open the stream.
+ * @param[in]   p_stream   Stream handlers, must stay valid.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_bulk_stream_register(ble_bulk_t * p_bulk, uint8_t stream_id, ble_bulk_stream_t const * p_stream);
+
+/**@brief Function for updating the block size after an ATT MTU exchange.
+ *
+ * @param[in]   p_bulk     Bulk Service structure.
+ * @param[in]   att_mtu    Effective ATT MTU of the link.
+ */
+void ble_bulk_att_mtu_set(ble_bulk_t * p_bulk, uint16_t att_mtu);
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ * @param[in]   p_context  Bulk Service structure.
+ */
+void ble_bulk_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+#endif // BLE_BULK_H__
@@ -2,8 +2,162 @@
 #include "ble_chord.h"
 #include <string.h>
 #include "ble_srv_common.h"
-#include "boards.h"
 #include "nrf_log.h"
+#include "latency_bench.h"
+
+#if NOTIFY_CYCLES_ENABLED
+ble_chord_notify_cycles_t ble_chord_notify_cycles = {.min = UINT32_MAX};
+#endif
+
+/**@brief Function for finding the state of a link.
+ *
+ * @param[in]   p_chord       Chord Service structure.
+ * @param[in]   conn_handle   Connection handle, BLE_CONN_HANDLE_INVALID finds a free slot.
+ *
+ * @return      NULL if not found.
+ */
+static ble_chord_link_t * link_find(ble_chord_t * p_chord, uint16_t conn_handle)
+{
+    for (uint8_t i = 0; i < BLE_CHORD_MAX_LINKS; i++)
+    {
+        if (p_chord->links[i].conn_handle == conn_handle)
+        {
+            return &p_chord->links[i];
+        }
+    }
+    return NULL;
+}
+
+/**@brief Function for getting the link of a connection.
+ *
+ * @return NULL for BLE_CONN_HANDLE_INVALID, which would otherwise match a free slot.
+ */
+static ble_chord_link_t * link_get(ble_chord_t * p_chord, uint16_t conn_handle)
+{
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return NULL;
+    }
+    return link_find(p_chord, conn_handle);
+}
+
+static void link_reset(ble_chord_t * p_chord, ble_chord_link_t * p_link, uint16_t conn_handle)
+{
+    p_link->conn_handle         = conn_handle;
+    p_link->notify_enabled      = false;
+    p_link->text_notify_enabled = false;
+    p_link->keys_notify_enabled = false;
+    p_link->hvx_count           = 0;
+    p_link->hvx_done            = 0;
+    p_link->keys_hvx            = 0;
+    p_link->keys_len            = 0;
+}
+
+/**@brief Function for checking whether a link has notification of a characteristic enabled.
+ */
+static bool link_is_subscribed(ble_chord_t const * p_chord, ble_chord_link_t const * p_link, uint16_t value_handle)
+{
+    if (p_link->conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return false;
+    }
+    if (value_handle == p_chord->text_handles.value_handle)
+    {
+        return p_link->text_notify_enabled;
+    }
+    return p_link->notify_enabled;
+}
+
+/**@brief Function for sending the key state changes waiting on a link, unless its previous key
+ *        state notification has not completed yet.
+ *
+ * @param[in]   p_chord       Chord Service structure.
+ * @param[in]   p_link        Link to send on.
+ */
+static void link_keys_flush(ble_chord_t * p_chord, ble_chord_link_t * p_link)
+{
+    ble_gatts_hvx_params_t hvx_params;
+    uint16_t               len = p_link->keys_len;
+    uint32_t               err_code;
+
+    // Notifications complete in order, so the last one is out once the count passes it. Other
+    // services notifying on the link add to hvx_done too, which can only end the wait early.
+    if ((len == 0) || ((int16_t)(p_link->hvx_done - p_link->keys_hvx) < 0))
+    {
+        return;
+    }
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle = p_chord->keys_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = p_link->keys_buf;
+
+    err_code = sd_ble_gatts_hvx(p_link->conn_handle, &hvx_params);
+    if (err_code == NRF_ERROR_RESOURCES)
+    {
+        // Retried on BLE_GATTS_EVT_HVN_TX_COMPLETE.
+        return;
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("Key state hvx result: %x", err_code);
+    }
+    else
+    {
+        p_link->hvx_count++;
+        p_link->keys_hvx = p_link->hvx_count;
+    }
+    p_link->keys_len = 0;
+}
+
+/**@brief Function for sending a notification on one link.
+ *
+ * @return      NRF_ERROR_INVALID_STATE if the link is not subscribed, NRF_ERROR_BUSY if its queue is
+ *              full, otherwise NRF_SUCCESS.
+ */
+static uint32_t notify_link(ble_chord_t * p_chord, uint8_t link, uint16_t value_handle, uint8_t const * p_data, uint8_t len)
+{
+    ble_chord_link_t     * p_link;
+    ble_gatts_hvx_params_t hvx_params;
+    uint16_t               hvx_len = len;
+    uint32_t               err_code;
+
+    if ((link >= BLE_CHORD_MAX_LINKS) || !link_is_subscribed(p_chord, &p_chord->links[link], value_handle))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    p_link = &p_chord->links[link];
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+
+    hvx_params.handle = value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &hvx_len;
+    hvx_params.p_data = p_data;
+
+    // The SoftDevice copies the value when it queues the notification.
+    err_code = sd_ble_gatts_hvx(p_link->conn_handle, &hvx_params);
+    if (err_code == NRF_ERROR_RESOURCES)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("sd_ble_gatts_hvx result: %x. \r\n", err_code); 
+    }
+    else
+    {
+        p_link->hvx_count++;
+#if LATENCY_BENCH_ENABLED
+        latency_bench_hvx(value_handle == p_chord->chord_value_handles.value_handle);
+#endif
+    }
+    return NRF_SUCCESS;
+}
 
 /**@brief Function for handling the Connect event.
  *
@@ -12,13 +166,35 @@
  */
 static void on_connect(ble_chord_t * p_chord, ble_evt_t const * p_ble_evt)
 {
-    p_chord->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    uint16_t           conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    ble_chord_link_t * p_link;
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    // A repeated connect reuses the slot rather than taking a second one for the same link.
+    p_link = link_get(p_chord, conn_handle);
+    if (p_link == NULL)
+    {
+        p_link = link_find(p_chord, BLE_CONN_HANDLE_INVALID);
+    }
+    if (p_link == NULL)
+    {
+        return;
+    }
+    link_reset(p_chord, p_link, conn_handle);
 
-    ble_chord_evt_t evt;
+    if (p_chord->evt_handler != NULL)
+    {
+        ble_chord_evt_t evt;
 
-    evt.evt_type = BLE_CHORD_EVT_CONNECTED;
+        evt.evt_type    = BLE_CHORD_EVT_CONNECTED;
+        evt.conn_handle = conn_handle;
+        evt.link        = (uint8_t)(p_link - p_chord->links);
 
-    p_chord->evt_handler(p_chord, &evt);
+        p_chord->evt_handler(p_chord, &evt);
+    }
 }
 
 /**@brief Function for handling the Disconnect event.
@@ -28,14 +204,25 @@ static void on_connect(ble_chord_t * p_chord, ble_evt_t const * p_ble_evt)
  */
 static void on_disconnect(ble_chord_t * p_chord, ble_evt_t const * p_ble_evt)
 {
-    UNUSED_PARAMETER(p_ble_evt);
-    p_chord->conn_handle = BLE_CONN_HANDLE_INVALID;
-    
-    ble_chord_evt_t evt;
+    uint16_t           conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    ble_chord_link_t * p_link      = link_get(p_chord, conn_handle);
+
+    if (p_link == NULL)
+    {
+        return;
+    }
+    link_reset(p_chord, p_link, BLE_CONN_HANDLE_INVALID);
+
+    if (p_chord->evt_handler != NULL)
+    {
+        ble_chord_evt_t evt;
 
-    evt.evt_type = BLE_CHORD_EVT_DISCONNECTED;
+        evt.evt_type    = BLE_CHORD_EVT_DISCONNECTED;
+        evt.conn_handle = conn_handle;
+        evt.link        = (uint8_t)(p_link - p_chord->links);
 
-    p_chord->evt_handler(p_chord, &evt);
+        p_chord->evt_handler(p_chord, &evt);
+    }
 }
 
 /**@brief Function for handling the Write event.
@@ -46,18 +233,44 @@ static void on_disconnect(ble_chord_t * p_chord, ble_evt_t const * p_ble_evt)
 static void on_write(ble_chord_t * p_chord, ble_evt_t const * p_ble_evt)
 {
     ble_gatts_evt_write_t const * p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
+    ble_chord_link_t            * p_link      = link_get(p_chord, p_ble_evt->evt.gatts_evt.conn_handle);
+
+    // Only whole plain writes reach the CCCDs, the data of anything else is not a CCCD value.
+    if ((p_link == NULL)
+        || ((p_evt_write->op != BLE_GATTS_OP_WRITE_REQ) && (p_evt_write->op != BLE_GATTS_OP_WRITE_CMD))
+        || (p_evt_write->offset != 0))
+    {
+        return;
+    }
+
+    if ((p_evt_write->handle == p_chord->text_handles.cccd_handle) && (p_evt_write->len == 2))
+    {
+        p_link->text_notify_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
+        return;
+    }
+
+    if ((p_evt_write->handle == p_chord->keys_handles.cccd_handle) && (p_evt_write->len == 2))
+    {
+        p_link->keys_notify_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
+        p_link->keys_len            = 0;
+        return;
+    }
 
     // Check if the Chord value CCCD is written to and that the value is the appropriate length, i.e 2 bytes.
     if ((p_evt_write->handle == p_chord->chord_value_handles.cccd_handle)
         && (p_evt_write->len == 2)
        )
     {
+        p_link->notify_enabled = ble_srv_is_notification_enabled(p_evt_write->data);
+
         // CCCD written, call application event handler
         if (p_chord->evt_handler != NULL)
         {
             ble_chord_evt_t evt;
 
-            if (ble_srv_is_notification_enabled(p_evt_write->data))
+            evt.conn_handle = p_link->conn_handle;
+            evt.link        = (uint8_t)(p_link - p_chord->links);
+            if (p_link->notify_enabled)
             {
                 evt.evt_type = BLE_CHORD_EVT_NOTIFICATION_ENABLED;
             }
@@ -75,12 +288,12 @@ static void on_write(ble_chord_t * p_chord, ble_evt_t const * p_ble_evt)
 void ble_chord_on_ble_evt( ble_evt_t const * p_ble_evt, void * p_context)
 {
     ble_chord_t * p_chord = (ble_chord_t *) p_context;
-    
-    NRF_LOG_INFO("BLE event received. Event type = %d\r\n", p_ble_evt->header.evt_id); 
+
     if (p_chord == NULL || p_ble_evt == NULL)
     {
         return;
     }
+    NRF_LOG_DEBUG("BLE event received. Event type = %d", p_ble_evt->header.evt_id);
     
     switch (p_ble_evt->header.evt_id)
     {
@@ -96,6 +309,29 @@ void ble_chord_on_ble_evt( ble_evt_t const * p_ble_evt, void * p_context)
             on_write(p_chord, p_ble_evt);
             break;
 
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+        {
+            ble_chord_link_t * p_link = link_get(p_chord, p_ble_evt->evt.gatts_evt.conn_handle);
+#if LATENCY_BENCH_ENABLED
+            latency_bench_tx_complete(p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count);
+#endif
+            if (p_link != NULL)
+            {
+                p_link->hvx_done += p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count;
+                if (p_chord->evt_handler != NULL)
+                {
+                    ble_chord_evt_t evt;
+
+                    evt.evt_type    = BLE_CHORD_EVT_TX_COMPLETE;
+                    evt.conn_handle = p_link->conn_handle;
+                    evt.link        = (uint8_t)(p_link - p_chord->links);
+
+                    p_chord->evt_handler(p_chord, &evt);
+                }
+                link_keys_flush(p_chord, p_link);
+            }
+        } break;
+
         default:
             break;
     }
@@ -145,7 +381,7 @@ static uint32_t chord_value_char_add(ble_chord_t * p_chord, const ble_chord_init
 
     attr_md.read_perm  = p_chord_init->chord_value_char_attr_md.read_perm;
     attr_md.write_perm = p_chord_init->chord_value_char_attr_md.write_perm;
-    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
     attr_md.rd_auth    = 0;
     attr_md.wr_auth    = 0;
     attr_md.vlen       = 0;
@@ -157,6 +393,7 @@ static uint32_t chord_value_char_add(ble_chord_t * p_chord, const ble_chord_init
     attr_char_value.init_len  = sizeof(uint8_t);
     attr_char_value.init_offs = 0;
     attr_char_value.max_len   = sizeof(uint8_t);
+    attr_char_value.p_value   = &p_chord->chord_value;
 
     err_code = sd_ble_gatts_characteristic_add(p_chord->service_handle, &char_md,
                                                &attr_char_value,
@@ -169,6 +406,104 @@ static uint32_t chord_value_char_add(ble_chord_t * p_chord, const ble_chord_init
     return NRF_SUCCESS;
 }
 
+/**@brief Function for adding the text characteristic.
+ *
+ * @param[in]   p_chord        Chord Service structure.
+ * @param[in]   p_chord_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t text_char_add(ble_chord_t * p_chord, const ble_chord_init_t * p_chord_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    cccd_md.write_perm = p_chord_init->chord_value_char_attr_md.cccd_write_perm;
+    cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.notify = 1;
+    char_md.p_cccd_md         = &cccd_md;
+
+    ble_uuid.type = p_chord->uuid_type;
+    ble_uuid.uuid = CHORD_TEXT_CHAR_UUID;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = p_chord_init->chord_value_char_attr_md.read_perm;
+    attr_md.write_perm = p_chord_init->chord_value_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.vlen       = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = 0;
+    attr_char_value.max_len   = BLE_CHORD_TEXT_MAX_LEN;
+    attr_char_value.p_value   = p_chord->text_value;
+
+    return sd_ble_gatts_characteristic_add(p_chord->service_handle, &char_md,
+                                           &attr_char_value,
+                                           &p_chord->text_handles);
+}
+
+/**@brief Function for adding the key state characteristic.
+ *
+ * @param[in]   p_chord        Chord Service structure.
+ * @param[in]   p_chord_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t keys_char_add(ble_chord_t * p_chord, const ble_chord_init_t * p_chord_init)
+{
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    cccd_md.write_perm = p_chord_init->chord_value_char_attr_md.cccd_write_perm;
+    cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.notify = 1;
+    char_md.p_cccd_md         = &cccd_md;
+
+    ble_uuid.type = p_chord->uuid_type;
+    ble_uuid.uuid = CHORD_KEYS_CHAR_UUID;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    attr_md.read_perm  = p_chord_init->chord_value_char_attr_md.read_perm;
+    attr_md.write_perm = p_chord_init->chord_value_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.vlen       = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = 0;
+    attr_char_value.max_len   = BLE_CHORD_KEYS_MAX_LEN;
+    attr_char_value.p_value   = p_chord->keys_value;
+
+    return sd_ble_gatts_characteristic_add(p_chord->service_handle, &char_md,
+                                           &attr_char_value,
+                                           &p_chord->keys_handles);
+}
+
 uint32_t ble_chord_init(ble_chord_t * p_chord, const ble_chord_init_t * p_chord_init)
 {
     if (p_chord == NULL || p_chord_init == NULL)
@@ -179,9 +514,20 @@ uint32_t ble_chord_init(ble_chord_t * p_chord, const ble_chord_init_t * p_chord_
     uint32_t   err_code;
     ble_uuid_t ble_uuid;
 
+#if NOTIFY_CYCLES_ENABLED
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
     // Initialize service structure
     p_chord->evt_handler               = p_chord_init->evt_handler;
-    p_chord->conn_handle               = BLE_CONN_HANDLE_INVALID;
+    p_chord->chord_value               = p_chord_init->initial_chord_value;
+    p_chord->keys_time                 = 0;
+    for (uint8_t i = 0; i < BLE_CHORD_MAX_LINKS; i++)
+    {
+        link_reset(p_chord, &p_chord->links[i], BLE_CONN_HANDLE_INVALID);
+    }
 
     // Add Chord Service UUID
     ble_uuid128_t base_uuid = {CHORD_SERVICE_UUID_BASE};
@@ -199,10 +545,18 @@ uint32_t ble_chord_init(ble_chord_t * p_chord, const ble_chord_init_t * p_chord_
     }
 
     // Add Chord Value characteristic
-    return chord_value_char_add(p_chord, p_chord_init);
+    err_code = chord_value_char_add(p_chord, p_chord_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add text characteristic
+    err_code = text_char_add(p_chord, p_chord_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Add key state characteristic
+    return keys_char_add(p_chord, p_chord_init);
 }
 
-uint32_t ble_chord_chord_value_update(ble_chord_t * p_chord, uint8_t chord_value)
+static uint32_t chord_value_notify(ble_chord_t * p_chord, uint8_t link, uint8_t chord_value)
 {
     NRF_LOG_INFO("In ble_chord_chord_value_update. \r\n"); 
     if (p_chord == NULL)
@@ -210,47 +564,94 @@ uint32_t ble_chord_chord_value_update(ble_chord_t * p_chord, uint8_t chord_value
         return NRF_ERROR_NULL;
     }
 
-    uint32_t err_code = NRF_SUCCESS;
-    ble_gatts_value_t gatts_value;
+    uint32_t err_code;
+
+    // The characteristic is notify-only, each notification carries the value and nothing reads
+    // the attribute, so it is not stored.
+    err_code = notify_link(p_chord, link, p_chord->chord_value_handles.value_handle, &chord_value, sizeof(chord_value));
+    if (err_code == NRF_ERROR_INVALID_STATE)
+    {
+        NRF_LOG_INFO("sd_ble_gatts_hvx result: NRF_ERROR_INVALID_STATE. \r\n"); 
+    }
 
-    // Initialize value struct.
-    memset(&gatts_value, 0, sizeof(gatts_value));
+    return err_code;
+}
 
-    gatts_value.len     = sizeof(uint8_t);
-    gatts_value.offset  = 0;
-    gatts_value.p_value = &chord_value;
+uint32_t ble_chord_chord_value_update(ble_chord_t * p_chord, uint8_t link, uint8_t chord_value)
+{
+#if NOTIFY_CYCLES_ENABLED
+    uint32_t start    = DWT->CYCCNT;
+    uint32_t err_code = chord_value_notify(p_chord, link, chord_value);
+    uint32_t cycles   = DWT->CYCCNT - start;
 
-    // Update database.
-    err_code = sd_ble_gatts_value_set(p_chord->conn_handle,
-                                      p_chord->chord_value_handles.value_handle,
-                                      &gatts_value);
-    if (err_code != NRF_SUCCESS)
+    // Includes the SoftDevice interrupts taken meanwhile, the minimum is the undisturbed path.
+    ble_chord_notify_cycles.count++;
+    ble_chord_notify_cycles.total += cycles;
+    ble_chord_notify_cycles.min    = MIN(ble_chord_notify_cycles.min, cycles);
+    ble_chord_notify_cycles.max    = MAX(ble_chord_notify_cycles.max, cycles);
+
+    return err_code;
+#else
+    return chord_value_notify(p_chord, link, chord_value);
+#endif
+}
+
+uint32_t ble_chord_text_value_send(ble_chord_t * p_chord, uint8_t link, uint8_t const * p_value, uint8_t len)
+{
+    if ((p_chord == NULL) || (p_value == NULL))
     {
-        return err_code;
+        return NRF_ERROR_NULL;
     }
+    if ((len == 0) || (len > BLE_CHORD_TEXT_MAX_LEN))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+    return notify_link(p_chord, link, p_chord->text_handles.value_handle, p_value, len);
+}
 
-    // Send value if connected and notifying.
-    if ((p_chord->conn_handle != BLE_CONN_HANDLE_INVALID)) 
+void ble_chord_keys_update(ble_chord_t * p_chord, uint8_t keys, uint32_t now)
+{
+    uint16_t entry = (keys & CHORD_KEYS_MASK)
+                   | (MIN(now - p_chord->keys_time, BLE_CHORD_KEYS_DELTA_MAX) << BLE_CHORD_KEYS_MASK_BITS);
+
+    p_chord->keys_time = now;
+
+    for (uint8_t i = 0; i < BLE_CHORD_MAX_LINKS; i++)
     {
-        ble_gatts_hvx_params_t hvx_params;
+        ble_chord_link_t * p_link = &p_chord->links[i];
 
-        memset(&hvx_params, 0, sizeof(hvx_params));
+        if ((p_link->conn_handle == BLE_CONN_HANDLE_INVALID) || !p_link->keys_notify_enabled)
+        {
+            continue;
+        }
 
-        hvx_params.handle = p_chord->chord_value_handles.value_handle;
-        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset = gatts_value.offset;
-        hvx_params.p_len  = &gatts_value.len;
-        hvx_params.p_data = gatts_value.p_value;
+        if (p_link->keys_len == BLE_CHORD_KEYS_MAX_LEN)
+        {
+            // The oldest change goes, its time is added to the next so the later ones stay in place.
+            uint16_t oldest = uint16_decode(&p_link->keys_buf[0]);
+            uint16_t next   = uint16_decode(&p_link->keys_buf[2]);
+            uint16_t delta  = MIN((oldest >> BLE_CHORD_KEYS_MASK_BITS) + (next >> BLE_CHORD_KEYS_MASK_BITS),
+                                  BLE_CHORD_KEYS_DELTA_MAX);
+
+            next = (next & CHORD_KEYS_MASK) | (delta << BLE_CHORD_KEYS_MASK_BITS);
+            UNUSED_RETURN_VALUE(uint16_encode(next, &p_link->keys_buf[2]));
+            memmove(p_link->keys_buf, &p_link->keys_buf[2], BLE_CHORD_KEYS_MAX_LEN - 2);
+            p_link->keys_len -= 2;
+        }
+        p_link->keys_len += uint16_encode(entry, &p_link->keys_buf[p_link->keys_len]);
 
-        err_code = sd_ble_gatts_hvx(p_chord->conn_handle, &hvx_params);
-        NRF_LOG_INFO("sd_ble_gatts_hvx result: %x. \r\n", err_code); 
+        link_keys_flush(p_chord, p_link);
     }
-    else
+}
+
+bool ble_chord_is_subscribed(ble_chord_t const * p_chord)
+{
+    for (uint8_t i = 0; i < BLE_CHORD_MAX_LINKS; i++)
     {
-        err_code = NRF_ERROR_INVALID_STATE;
-        NRF_LOG_INFO("sd_ble_gatts_hvx result: NRF_ERROR_INVALID_STATE. \r\n"); 
+        if ((p_chord->links[i].conn_handle != BLE_CONN_HANDLE_INVALID) && p_chord->links[i].notify_enabled)
+        {
+            return true;
+        }
     }
-
-
-    return err_code;
+    return false;
 }
@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include "ble.h"
 #include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+#include "chord_keys.h"
 
 /**@brief   Macro for defining a ble_hrs instance.
  *
@@ -22,6 +24,15 @@ NRF_SDH_BLE_OBSERVER(_name ## _obs,
 
 #define CHORD_SERVICE_UUID               0x1400
 #define CHORD_VALUE_CHAR_UUID            0x1401
+#define CHORD_TEXT_CHAR_UUID             0x1402
+#define CHORD_KEYS_CHAR_UUID             0x1403
+
+#define BLE_CHORD_MAX_LINKS              NRF_SDH_BLE_PERIPHERAL_LINK_COUNT  /**< Centrals that can subscribe at the same time. */
+#define BLE_CHORD_TEXT_MAX_LEN           (BLE_GATT_ATT_MTU_DEFAULT - 3)     /**< Longest text notification, fits any ATT MTU. */
+#define BLE_CHORD_TEXT_SUGGESTION        0xFF                               /**< Delete count of a suggestion, which the host shows but does not insert. */
+#define BLE_CHORD_KEYS_MAX_LEN           (BLE_CHORD_TEXT_MAX_LEN & ~1)      /**< Longest key state notification, whole 2 byte entries. */
+#define BLE_CHORD_KEYS_MASK_BITS         CHORD_KEY_COUNT                    /**< Key bits at the bottom of a key state entry, the delta time above. */
+#define BLE_CHORD_KEYS_DELTA_MAX         ((1 << (16 - BLE_CHORD_KEYS_MASK_BITS)) - 1) /**< Delta times saturate here, in ms. */
 																					
 /**@brief Custom Service event type. */
 typedef enum
@@ -29,13 +40,16 @@ typedef enum
     BLE_CHORD_EVT_NOTIFICATION_ENABLED,                             /**< Chord value notification enabled event. */
     BLE_CHORD_EVT_NOTIFICATION_DISABLED,                             /**< Chord value notification disabled event. */
     BLE_CHORD_EVT_DISCONNECTED,
-    BLE_CHORD_EVT_CONNECTED
+    BLE_CHORD_EVT_CONNECTED,
+    BLE_CHORD_EVT_TX_COMPLETE                                       /**< Notifications completed on a link, a send that returned NRF_ERROR_BUSY can be retried. */
 } ble_chord_evt_type_t;
 
 /**@brief Chord Service event. */
 typedef struct
 {
     ble_chord_evt_type_t evt_type;                                  /**< Type of event. */
+    uint16_t             conn_handle;                               /**< Link the event relates to. */
+    uint8_t              link;                                      /**< Index of the link in links. */
 } ble_chord_evt_t;
 
 // Forward declaration of the ble_chord_t type.
@@ -54,16 +68,49 @@ typedef struct
     ble_srv_cccd_security_mode_t  chord_value_char_attr_md;     /**< Initial security level for Chord characteristics attribute */
 } ble_chord_init_t;
 
+/**@brief Per connection state. */
+typedef struct
+{
+    uint16_t                      conn_handle;                    /**< BLE_CONN_HANDLE_INVALID if the slot is free. */
+    bool                          notify_enabled;                 /**< CCCD state of the chord value characteristic on this link. */
+    bool                          text_notify_enabled;            /**< CCCD state of the text characteristic on this link. */
+    bool                          keys_notify_enabled;            /**< CCCD state of the key state characteristic on this link. */
+    uint16_t                      hvx_count;                      /**< Notifications taken by the SoftDevice on this link. */
+    uint16_t                      hvx_done;                       /**< Notifications completed on this link. */
+    uint16_t                      keys_hvx;                       /**< hvx_count once the last key state notification was taken. */
+    uint8_t                       keys_len;                       /**< Bytes waiting in keys_buf. */
+    uint8_t                       keys_buf[BLE_CHORD_KEYS_MAX_LEN]; /**< Key state changes since the last key state notification went out. */
+} ble_chord_link_t;
+
 /**@brief Custom Service structure. This contains various status information for the service. */
 struct ble_chord_s
 {
     ble_chord_evt_handler_t         evt_handler;                    /**< Event handler to be called for handling events in the Custom Service. */
     uint16_t                      service_handle;                 /**< Handle of Custom Service (as provided by the BLE stack). */
     ble_gatts_char_handles_t      chord_value_handles;           /**< Handles related to the Custom Value characteristic. */
-    uint16_t                      conn_handle;                    /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection). */
+    ble_gatts_char_handles_t      text_handles;                   /**< Handles related to the text characteristic, used for calculator results. */
+    ble_gatts_char_handles_t      keys_handles;                   /**< Handles related to the key state characteristic. */
+    ble_chord_link_t              links[BLE_CHORD_MAX_LINKS];     /**< State of each connected central. */
+    uint8_t                       chord_value;                    /**< Chord value characteristic value, BLE_GATTS_VLOC_USER, only the initial value. */
+    uint8_t                       text_value[BLE_CHORD_TEXT_MAX_LEN]; /**< Text characteristic value, BLE_GATTS_VLOC_USER. */
+    uint8_t                       keys_value[BLE_CHORD_KEYS_MAX_LEN]; /**< Key state characteristic value, BLE_GATTS_VLOC_USER. */
+    uint32_t                      keys_time;                      /**< Time of the last key state change, ms. */
     uint8_t                       uuid_type; 
 };
 
+#if NOTIFY_CYCLES_ENABLED
+/**@brief CPU cycles spent in ble_chord_chord_value_update(), read over the debugger by make profiles. */
+typedef struct
+{
+    uint32_t                      count;
+    uint32_t                      min;
+    uint32_t                      max;
+    uint32_t                      total;
+} ble_chord_notify_cycles_t;
+
+extern ble_chord_notify_cycles_t ble_chord_notify_cycles;
+#endif
+
 /**@brief Function for initializing the Custom Service.
  *
  * @param[out]  p_chord       Custom Service structure. This structure will have to be supplied by
@@ -88,17 +135,59 @@ void ble_chord_on_ble_evt( ble_evt_t const * p_ble_evt, void * p_context);
 
 /**@brief Function for updating the custom value.
  *
- * @details The application calls this function when the cutom value should be updated. If
- *          notification has been enabled, the custom value characteristic is sent to the client.
+ * @details The application calls this function when the cutom value should be updated. The chord
+ *          is passed to the SoftDevice on one link, nothing is buffered here, so each link is fed
+ *          at its own pace.
  *
- * @note 
+ * @note    A link with a full SoftDevice queue makes the call return NRF_ERROR_BUSY. Pass the same
+ *          chord again after BLE_CHORD_EVT_TX_COMPLETE on that link.
  *       
  * @param[in]   p_bas          Chord Service structure.
+ * @param[in]   link           Index of the link in links.
  * @param[in]   Chord value 
  *
- * @return      NRF_SUCCESS on success, otherwise an error code.
+ * @return      NRF_SUCCESS if the link took the chord, NRF_ERROR_BUSY if it has to be retried,
+ *              NRF_ERROR_INVALID_STATE if the link has notification disabled.
  */
 
-uint32_t ble_chord_chord_value_update(ble_chord_t * p_chord, uint8_t chord_value);
+uint32_t ble_chord_chord_value_update(ble_chord_t * p_chord, uint8_t link, uint8_t chord_value);
+
+/**@brief Function for sending one text notification value, as built by the caller, on one link.
+ *
+ * @details The SoftDevice copies the value, it is sent from the caller's memory. A link with a full
+ *          queue is retried as for ble_chord_chord_value_update().
+ *
+ * @param[in]   p_chord        Chord Service structure.
+ * @param[in]   link           Index of the link in links.
+ * @param[in]   p_value        [characters to delete (u8)][text], at most BLE_CHORD_TEXT_MAX_LEN.
+ * @param[in]   len            Length of the value.
+ *
+ * @return      NRF_ERROR_INVALID_STATE if the link has notification of the text characteristic
+ *              disabled, NRF_ERROR_BUSY if it has to be retried.
+ */
+uint32_t ble_chord_text_value_send(ble_chord_t * p_chord, uint8_t link, uint8_t const * p_value, uint8_t len);
+
+/**@brief Function for streaming a debounced key state change, for hosts that recognize chords
+ *        themselves.
+ *
+ * @details Only links that have notification of the key state characteristic enabled receive it.
+ *          Each change is a little endian u16: the keys down in the low BLE_CHORD_KEYS_MASK_BITS
+ *          bits and the time since the previous change above, in ms, saturating at
+ *          BLE_CHORD_KEYS_DELTA_MAX. A link has at most one key state notification in flight; the
+ *          changes made meanwhile go out together once it completes, so a burst of changes costs
+ *          one notification per connection event. If more changes wait than fit in one
+ *          notification, the oldest is merged into the next, which keeps its keys and adds its time.
+ *
+ * @param[in]   p_chord        Chord Service structure.
+ * @param[in]   keys           Keys down, a set bit per key.
+ * @param[in]   now            Time of the change, ms.
+ */
+void ble_chord_keys_update(ble_chord_t * p_chord, uint8_t keys, uint32_t now);
+
+/**@brief Function for checking whether any central has notification enabled.
+ *
+ * @param[in]   p_chord        Chord Service structure.
+ */
+bool ble_chord_is_subscribed(ble_chord_t const * p_chord);
 
 #endif // BLE_CHORD_H__
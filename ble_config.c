@@ -0,0 +1,116 @@
+#include "sdk_common.h"
+#include "ble_config.h"
+#include <string.h>
+#include "ble_srv_common.h"
+#include "nrf_log.h"
+
+/**@brief Function for handling a write to the parameters characteristic.
+ *
+ * @details Writes are authorized, so a rejected value fails the write request, and the written
+ *          bytes never replace the table.
+ */
+static void on_params_write(uint16_t conn_handle, ble_gatts_evt_write_t const * p_evt_write)
+{
+    ble_gatts_rw_authorize_reply_params_t reply;
+    uint32_t                              err_code;
+
+    memset(&reply, 0, sizeof(reply));
+
+    reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    reply.params.write.update      = 0;
+
+    if (p_evt_write->len != BLE_CONFIG_WRITE_LEN)
+    {
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+    }
+    else if (app_params_set((app_param_id_t)p_evt_write->data[0], uint32_decode(&p_evt_write->data[1])) != NRF_SUCCESS)
+    {
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE;
+    }
+
+    err_code = sd_ble_gatts_rw_authorize_reply(conn_handle, &reply);
+    if (err_code != NRF_SUCCESS)
+    {
+        NRF_LOG_INFO("Config write reply failed: %x", err_code);
+    }
+}
+
+void ble_config_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context)
+{
+    ble_config_t * p_config = (ble_config_t *) p_context;
+
+    if (p_config == NULL || p_ble_evt == NULL)
+    {
+        return;
+    }
+
+    if (p_ble_evt->header.evt_id == BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST)
+    {
+        ble_gatts_evt_rw_authorize_request_t const * p_auth = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+
+        // Prepared writes are left to the Queued Write module.
+        if ((p_auth->type == BLE_GATTS_AUTHORIZE_TYPE_WRITE)
+            && (p_auth->request.write.op == BLE_GATTS_OP_WRITE_REQ)
+            && (p_auth->request.write.handle == p_config->params_handles.value_handle))
+        {
+            on_params_write(p_ble_evt->evt.gatts_evt.conn_handle, &p_auth->request.write);
+        }
+    }
+}
+
+uint32_t ble_config_init(ble_config_t * p_config, const ble_config_init_t * p_config_init)
+{
+    if (p_config == NULL || p_config_init == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    uint32_t            err_code;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(p_config, 0, sizeof(*p_config));
+    p_config->uuid_type = p_config_init->uuid_type;
+    app_params_encode(p_config->table);
+
+    ble_uuid.type = p_config->uuid_type;
+    ble_uuid.uuid = CONFIG_SERVICE_UUID;
+
+    err_code = sd_ble_gatts_service_add(BLE_GATTS_SRVC_TYPE_PRIMARY, &ble_uuid, &p_config->service_handle);
+    VERIFY_SUCCESS(err_code);
+
+    memset(&char_md, 0, sizeof(char_md));
+
+    char_md.char_props.read  = 1;
+    char_md.char_props.write = 1;
+
+    ble_uuid.uuid = CONFIG_PARAMS_CHAR_UUID;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+
+    // The table lives in the service structure rather than in the attribute table.
+    attr_md.read_perm  = p_config_init->config_char_attr_md.read_perm;
+    attr_md.write_perm = p_config_init->config_char_attr_md.write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.wr_auth    = 1;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = sizeof(p_config->table);
+    attr_char_value.max_len   = sizeof(p_config->table);
+    attr_char_value.p_value   = p_config->table;
+
+    return sd_ble_gatts_characteristic_add(p_config->service_handle, &char_md,
+                                           &attr_char_value, &p_config->params_handles);
+}
+
+void ble_config_table_update(ble_config_t * p_config)
+{
+    // Read in place by the SoftDevice, no sd_ble_gatts_value_set() needed.
+    app_params_encode(p_config->table);
+}
@@ -0,0 +1,68 @@
+#ifndef BLE_CONFIG_H__
+#define BLE_CONFIG_H__
+
+#include <stdint.h>
+#include "ble.h"
+#include "ble_srv_common.h"
+#include "nrf_sdh_ble.h"
+#include "app_params.h"
+
+/**@brief   Macro for defining a ble_config instance.
+ *
+ * @param   _name   Name of the instance.
+ * @hideinitializer
+ */
+#define BLE_CONFIG_DEF(_name)                                                                        \
+static ble_config_t _name;                                                                           \
+NRF_SDH_BLE_OBSERVER(_name ## _obs,                                                                 \
+                     BLE_HRS_BLE_OBSERVER_PRIO,                                                     \
+                     ble_config_on_ble_evt, &_name)
+
+// The configuration service shares the vendor specific base UUID of the chord service.
+#define CONFIG_SERVICE_UUID              0x1600
+#define CONFIG_PARAMS_CHAR_UUID          0x1601
+
+#define BLE_CONFIG_WRITE_LEN             5                                  /**< id (u8), value (u32). */
+
+/**@brief Configuration Service init structure. */
+typedef struct
+{
+    uint8_t                       uuid_type;                        /**< Vendor UUID type of the chord service base. */
+    ble_srv_cccd_security_mode_t  config_char_attr_md;              /**< Security level for the parameters characteristic. */
+} ble_config_init_t;
+
+/**@brief Configuration Service structure.
+ *
+ * @details Reading the parameters characteristic returns the app_params table. Writing
+ *          [id][value u32] changes a parameter; a rejected value fails the write with
+ *          BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE.
+ */
+typedef struct
+{
+    uint16_t                      service_handle;
+    ble_gatts_char_handles_t      params_handles;
+    uint8_t                       uuid_type;
+    uint8_t                       table[APP_PARAMS_TABLE_LEN];      /**< Characteristic value, read by the SoftDevice in place. */
+} ble_config_t;
+
+/**@brief Function for initializing the Configuration Service.
+ *
+ * @param[out]  p_config       Configuration Service structure.
+ * @param[in]   p_config_init  Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on successful initialization of service, otherwise an error code.
+ */
+uint32_t ble_config_init(ble_config_t * p_config, const ble_config_init_t * p_config_init);
+
+/**@brief Function for refreshing the characteristic value after a parameter has changed.
+ */
+void ble_config_table_update(ble_config_t * p_config);
+
+/**@brief Function for handling the Application's BLE Stack events.
+ *
+ * @param[in]   p_ble_evt  Event received from the BLE stack.
+ * @param[in]   p_context  Configuration Service structure.
+ */
+void ble_config_on_ble_evt(ble_evt_t const * p_ble_evt, void * p_context);
+
+#endif // BLE_CONFIG_H__
@@ -0,0 +1,43 @@
+#ifndef BOARD_PINS_H__
+#define BOARD_PINS_H__
+
+#include "nrf_gpio.h"
+
+/**@brief Key, power button and status LED pins of each board, selected by the BOARD_ define
+ *        that the Makefile passes.
+ *
+ * @details KEY_PINS lists the chord key pins in bit order, of which the first CHORD_KEY_COUNT are
+ *          used, and PWR_BTN_PIN is the power button. Keys connect their pin to ground, the
+ *          internal pull-ups are used. On the development kits the board buttons are the first
+ *          keys and the rest go on the Arduino header.
+ */
+
+#if defined(BOARD_FEATHER_NRF52840)
+
+// Adafruit Feather nRF52840 Express, wired as in README.md.
+#define KEY_PINS        { 4, 5, 30, 28, 2, 6, 27, 26 }
+#define PWR_BTN_PIN     3
+#define LED_PIN         NRF_GPIO_PIN_MAP(0, 7)
+#define LED_ON_LEVEL    1
+
+#elif defined(BOARD_PCA10056)
+
+// nRF52840 DK: Button 1 to 4, P0.03, P0.04, P0.29, P0.30, power on P0.28, LED 1.
+#define KEY_PINS        { 11, 12, 24, 25, 3, 4, 29, 30 }
+#define PWR_BTN_PIN     28
+#define LED_PIN         NRF_GPIO_PIN_MAP(0, 13)
+#define LED_ON_LEVEL    0
+
+#elif defined(BOARD_PCA10040)
+
+// nRF52 DK: Button 1 to 4, P0.03, P0.04, P0.29, P0.30, power on P0.28, LED 1.
+#define KEY_PINS        { 13, 14, 15, 16, 3, 4, 29, 30 }
+#define PWR_BTN_PIN     28
+#define LED_PIN         NRF_GPIO_PIN_MAP(0, 17)
+#define LED_ON_LEVEL    0
+
+#else
+#error "No pin map for this board"
+#endif
+
+#endif // BOARD_PINS_H__
@@ -0,0 +1,572 @@
+#include "chord_calc.h"
+#include <string.h>
+
+#define CALC_UNIT_FIRST     'a'                                 /**< Unit conversions are written 'a' + chord_calc_unit_t. */
+
+#define PREC_FORMAT         0                                   /**< HDG and TIME, apply to everything to their left. */
+#define PREC_ADD            1
+#define PREC_MUL            2
+#define PREC_UNARY          3                                   /**< Unary minus, and unit conversions which take it along. */
+
+#define OP_NEGATE           'n'
+
+/**@brief How a value is shown. */
+typedef enum
+{
+    FMT_NUMBER,
+    FMT_TIME,                                           /**< Hours shown as h:mm. */
+    FMT_HEADING                                         /**< Whole degrees shown as three digits. */
+} calc_fmt_t;
+
+typedef struct
+{
+    int64_t    value;                                   /**< Fixed point, CHORD_CALC_SCALE per unit. */
+    calc_fmt_t fmt;
+} calc_value_t;
+
+/**@brief Unit conversion: result = (value + pre) * num / den + post, offsets in whole units. */
+typedef struct
+{
+    int32_t num;
+    int32_t den;
+    int8_t  pre;
+    int8_t  post;
+} calc_unit_t;
+
+static const calc_unit_t m_units[CHORD_CALC_UNIT_COUNT] =
+{
+    [CHORD_CALC_UNIT_NM_KM] = {1852,      1000,      0,   0},
+    [CHORD_CALC_UNIT_KM_NM] = {1000,      1852,      0,   0},
+    [CHORD_CALC_UNIT_FT_M]  = {3048,      10000,     0,   0},
+    [CHORD_CALC_UNIT_M_FT]  = {10000,     3048,      0,   0},
+    [CHORD_CALC_UNIT_USG_L] = {3785412,   1000000,   0,   0},
+    [CHORD_CALC_UNIT_L_USG] = {1000000,   3785412,   0,   0},
+    [CHORD_CALC_UNIT_LB_KG] = {45359237,  100000000, 0,   0},
+    [CHORD_CALC_UNIT_KG_LB] = {100000000, 45359237,  0,   0},
+    [CHORD_CALC_UNIT_C_F]   = {9,         5,         0,   32},
+    [CHORD_CALC_UNIT_F_C]   = {5,         9,         -32, 0},
+};
+
+/**@brief Calculator layer, indexed by chord. Key 1 is bit 0.
+ *
+ * @details Single keys are 1 to 5 and neighbouring pairs 6 to 9, with the outer pair 0.
+ */
+static const char m_keymap[32] =
+{
+    [1]  = '1',  [2]  = '2',  [4]  = '3',  [8]  = '4',  [16] = '5',
+    [3]  = '6',  [6]  = '7',  [12] = '8',  [24] = '9',  [17] = '0',
+    [5]  = '.',  [10] = ':',
+    [20] = '+',  [9]  = '-',  [18] = '*',  [7]  = '/',
+    [14] = '(',  [28] = ')',
+    [15] = CHORD_CALC_SYM_EQUALS,
+    [30] = CHORD_CALC_SYM_BACKSPACE,
+    [31] = CHORD_CALC_SYM_CLEAR,
+    [11] = CHORD_CALC_SYM_HEADING,
+    [13] = CHORD_CALC_SYM_TIME,
+    [19] = CHORD_CALC_SYM_UNIT,
+    [25] = CHORD_CALC_SYM_EXIT,
+};
+
+// Expression being typed.
+static char    m_expr[CHORD_CALC_MAX_LEN + 1];
+static uint8_t m_len;
+static bool    m_unit_pending;
+
+// Evaluation arena, an expression of n symbols never needs more than n entries.
+static calc_value_t m_values[CHORD_CALC_MAX_LEN];
+static char         m_ops[CHORD_CALC_MAX_LEN];
+static uint8_t      m_value_count;
+static uint8_t      m_op_count;
+
+/**@brief Function for dividing with rounding half away from zero. */
+static int64_t div_round(int64_t n, int64_t d)
+{
+    int64_t q = n / d;
+    int64_t r = n % d;
+
+    if (r < 0)
+    {
+        r = -r;
+    }
+    if (r >= ((d < 0) ? -d : d) - r)
+    {
+        q += ((n < 0) != (d < 0)) ? -1 : 1;
+    }
+    return q;
+}
+
+/**@brief Function for computing value * num / den without losing precision.
+ *
+ * @return false on overflow.
+ */
+static bool mul_div(int64_t value, int64_t num, int64_t den, int64_t * p_result)
+{
+    int64_t product;
+
+    if (__builtin_mul_overflow(value, num, &product))
+    {
+        return false;
+    }
+    *p_result = div_round(product, den);
+    return true;
+}
+
+static int prec(char op)
+{
+    switch (op)
+    {
+        case '+':
+        case '-':
+            return PREC_ADD;
+        case '*':
+        case '/':
+            return PREC_MUL;
+        case OP_NEGATE:
+            return PREC_UNARY;
+        default:
+            return -1;
+    }
+}
+
+static bool value_push(int64_t value, calc_fmt_t fmt)
+{
+    if (m_value_count == CHORD_CALC_MAX_LEN)
+    {
+        return false;
+    }
+    m_values[m_value_count].value = value;
+    m_values[m_value_count].fmt   = fmt;
+    m_value_count++;
+    return true;
+}
+
+/**@brief Function for applying the operator on top of the operator stack. */
+static bool reduce(void)
+{
+    char op = m_ops[--m_op_count];
+
+    if (op == OP_NEGATE)
+    {
+        if (m_value_count < 1)
+        {
+            return false;
+        }
+        // The one value without a negative is INT64_MIN.
+        return !__builtin_sub_overflow(0, m_values[m_value_count - 1].value, &m_values[m_value_count - 1].value);
+    }
+
+    if (m_value_count < 2)
+    {
+        return false;
+    }
+
+    calc_value_t * p_a = &m_values[m_value_count - 2];
+    calc_value_t * p_b = &m_values[m_value_count - 1];
+    bool           ok;
+
+    m_value_count--;
+
+    switch (op)
+    {
+        case '+':
+            ok = !__builtin_add_overflow(p_a->value, p_b->value, &p_a->value);
+            p_a->fmt = ((p_a->fmt == FMT_TIME) && (p_b->fmt == FMT_TIME)) ? FMT_TIME : FMT_NUMBER;
+            return ok;
+
+        case '-':
+            ok = !__builtin_sub_overflow(p_a->value, p_b->value, &p_a->value);
+            p_a->fmt = ((p_a->fmt == FMT_TIME) && (p_b->fmt == FMT_TIME)) ? FMT_TIME : FMT_NUMBER;
+            return ok;
+
+        case '*':
+            p_a->fmt = FMT_NUMBER;
+            return mul_div(p_a->value, p_b->value, CHORD_CALC_SCALE, &p_a->value);
+
+        case '/':
+            p_a->fmt = FMT_NUMBER;
+            return (p_b->value != 0) && mul_div(p_a->value, CHORD_CALC_SCALE, p_b->value, &p_a->value);
+
+        default:
+            return false;
+    }
+}
+
+/**@brief Function for reducing operators down to a precedence, or to an open parenthesis. */
+static bool reduce_to(int min_prec)
+{
+    while ((m_op_count != 0) && (m_ops[m_op_count - 1] != '(') && (prec(m_ops[m_op_count - 1]) >= min_prec))
+    {
+        if (!reduce())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**@brief Function for applying a postfix operator to the value on top of the stack. */
+static bool postfix_apply(char op)
+{
+    calc_value_t * p_v = &m_values[m_value_count - 1];
+
+    if (op == CHORD_CALC_SYM_HEADING)
+    {
+        int64_t deg = div_round(p_v->value, CHORD_CALC_SCALE) % 360;
+
+        p_v->value = ((deg <= 0) ? deg + 360 : deg) * CHORD_CALC_SCALE;
+        p_v->fmt   = FMT_HEADING;
+        return true;
+    }
+    if (op == CHORD_CALC_SYM_TIME)
+    {
+        p_v->fmt = FMT_TIME;
+        return true;
+    }
+
+    calc_unit_t const * p_unit = &m_units[op - CALC_UNIT_FIRST];
+    int64_t             value;
+
+    if (__builtin_add_overflow(p_v->value, (int64_t)p_unit->pre * CHORD_CALC_SCALE, &value)
+        || !mul_div(value, p_unit->num, p_unit->den, &value)
+        || __builtin_add_overflow(value, (int64_t)p_unit->post * CHORD_CALC_SCALE, &value))
+    {
+        return false;
+    }
+    p_v->value = value;
+    p_v->fmt   = FMT_NUMBER;
+    return true;
+}
+
+/**@brief Function for parsing a number or an h:mm time.
+ *
+ * @return Pointer past the number, NULL if it is malformed or too large.
+ */
+static char const * number_parse(char const * p, calc_value_t * p_value)
+{
+    int64_t whole = 0;
+    int64_t frac  = 0;
+    int64_t scale = CHORD_CALC_SCALE;
+
+    p_value->fmt = FMT_NUMBER;
+
+    while ((*p >= '0') && (*p <= '9'))
+    {
+        if (whole > (INT64_MAX / CHORD_CALC_SCALE - 9) / 10)
+        {
+            return NULL;
+        }
+        whole = whole * 10 + (*p++ - '0');
+    }
+
+    if (*p == ':')
+    {
+        int64_t minutes = 0;
+        uint8_t digits  = 0;
+
+        p++;
+        while ((*p >= '0') && (*p <= '9') && (digits < 2))
+        {
+            minutes = minutes * 10 + (*p++ - '0');
+            digits++;
+        }
+        if ((digits == 0) || (minutes >= 60))
+        {
+            return NULL;
+        }
+        p_value->value = whole * CHORD_CALC_SCALE + div_round(minutes * CHORD_CALC_SCALE, 60);
+        p_value->fmt   = FMT_TIME;
+        return p;
+    }
+
+    if (*p == '.')
+    {
+        p++;
+        while ((*p >= '0') && (*p <= '9'))
+        {
+            // Digits beyond the precision are ignored.
+            if (scale > 1)
+            {
+                scale /= 10;
+                frac  += (*p - '0') * scale;
+            }
+            p++;
+        }
+    }
+
+    p_value->value = whole * CHORD_CALC_SCALE + frac;
+    return p;
+}
+
+/**@brief Function for writing an unsigned number, returns its length. */
+static size_t u64_format(uint64_t v, char * p_buf)
+{
+    char   digits[20];
+    size_t n = 0;
+
+    do
+    {
+        digits[n++] = (char)('0' + (v % 10));
+        v /= 10;
+    } while (v != 0);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        p_buf[i] = digits[n - 1 - i];
+    }
+    return n;
+}
+
+/**@brief Function for formatting a result, p_text must hold at least 32 characters. */
+static void value_format(calc_value_t const * p_v, char * p_text)
+{
+    uint64_t mag = (p_v->value < 0) ? -(uint64_t)p_v->value : (uint64_t)p_v->value;
+    size_t   n   = 0;
+
+    if (p_v->fmt == FMT_HEADING)
+    {
+        uint64_t deg = mag / CHORD_CALC_SCALE;
+
+        p_text[n++] = (char)('0' + deg / 100);
+        p_text[n++] = (char)('0' + (deg / 10) % 10);
+        p_text[n++] = (char)('0' + deg % 10);
+        p_text[n]   = '\0';
+        return;
+    }
+
+    if (p_v->value < 0)
+    {
+        p_text[n++] = '-';
+    }
+
+    if (p_v->fmt == FMT_TIME)
+    {
+        // Hours and the minutes of the fraction apart, mag * 60 overflows for the largest values.
+        uint64_t hours   = mag / CHORD_CALC_SCALE;
+        uint64_t minutes = ((mag % CHORD_CALC_SCALE) * 60 + CHORD_CALC_SCALE / 2) / CHORD_CALC_SCALE;
+
+        hours   += minutes / 60;
+        minutes %= 60;
+        n += u64_format(hours, &p_text[n]);
+        p_text[n++] = ':';
+        p_text[n++] = (char)('0' + minutes / 10);
+        p_text[n++] = (char)('0' + minutes % 10);
+        p_text[n]   = '\0';
+        return;
+    }
+
+    n += u64_format(mag / CHORD_CALC_SCALE, &p_text[n]);
+
+    uint32_t frac = (uint32_t)(mag % CHORD_CALC_SCALE);
+    if (frac != 0)
+    {
+        p_text[n++] = '.';
+        for (uint32_t scale = CHORD_CALC_SCALE / 10; (scale != 0) && (frac != 0); scale /= 10)
+        {
+            p_text[n++] = (char)('0' + frac / scale);
+            frac %= scale;
+        }
+    }
+    p_text[n] = '\0';
+}
+
+/**@brief Function for running the shunting-yard evaluation. */
+static bool evaluate(char const * p, calc_value_t * p_result)
+{
+    bool expect_operand = true;
+
+    m_value_count = 0;
+    m_op_count    = 0;
+
+    while (*p != '\0')
+    {
+        char c = *p;
+
+        if (expect_operand)
+        {
+            if (((c >= '0') && (c <= '9')) || (c == '.'))
+            {
+                calc_value_t value;
+
+                p = number_parse(p, &value);
+                if ((p == NULL) || !value_push(value.value, value.fmt))
+                {
+                    return false;
+                }
+                expect_operand = false;
+                continue;
+            }
+            if ((c != '(') && (c != '-') && (c != '+'))
+            {
+                return false;
+            }
+            if (c != '+')
+            {
+                // A unary plus changes nothing.
+                m_ops[m_op_count++] = (c == '-') ? OP_NEGATE : '(';
+            }
+        }
+        else if (c == ')')
+        {
+            if (!reduce_to(PREC_FORMAT))
+            {
+                return false;
+            }
+            if (m_op_count == 0)
+            {
+                return false;
+            }
+            m_op_count--;
+        }
+        else if ((c == CHORD_CALC_SYM_HEADING) || (c == CHORD_CALC_SYM_TIME))
+        {
+            if (!reduce_to(PREC_FORMAT) || !postfix_apply(c))
+            {
+                return false;
+            }
+        }
+        else if ((c >= CALC_UNIT_FIRST) && (c < CALC_UNIT_FIRST + CHORD_CALC_UNIT_COUNT))
+        {
+            if (!reduce_to(PREC_UNARY) || !postfix_apply(c))
+            {
+                return false;
+            }
+        }
+        else if (prec(c) >= PREC_ADD)
+        {
+            // All binary operators are left associative.
+            if (!reduce_to(prec(c)))
+            {
+                return false;
+            }
+            m_ops[m_op_count++] = c;
+            expect_operand = true;
+        }
+        else
+        {
+            return false;
+        }
+        p++;
+    }
+
+    if (expect_operand)
+    {
+        return false;
+    }
+
+    // Parentheses still open are closed at the end.
+    while (m_op_count != 0)
+    {
+        if (m_ops[m_op_count - 1] == '(')
+        {
+            m_op_count--;
+        }
+        else if (!reduce())
+        {
+            return false;
+        }
+    }
+
+    if (m_value_count != 1)
+    {
+        return false;
+    }
+    *p_result = m_values[0];
+    return true;
+}
+
+char chord_calc_symbol(uint8_t chord)
+{
+    return (chord < sizeof(m_keymap)) ? m_keymap[chord] : CHORD_CALC_SYM_NONE;
+}
+
+void chord_calc_reset(void)
+{
+    m_len          = 0;
+    m_expr[0]      = '\0';
+    m_unit_pending = false;
+}
+
+bool chord_calc_eval(char const * p_expr, char * p_text, size_t size)
+{
+    calc_value_t result;
+    char         text[32];
+
+    if ((strlen(p_expr) > CHORD_CALC_MAX_LEN) || !evaluate(p_expr, &result))
+    {
+        strncpy(p_text, "ERR", size);
+        p_text[size - 1] = '\0';
+        return false;
+    }
+
+    value_format(&result, text);
+    if (strlen(text) >= size)
+    {
+        strncpy(p_text, "ERR", size);
+        p_text[size - 1] = '\0';
+        return false;
+    }
+    strcpy(p_text, text);
+    return true;
+}
+
+chord_calc_action_t chord_calc_input(char symbol, char * p_text, size_t size)
+{
+    if (symbol == CHORD_CALC_SYM_NONE)
+    {
+        return CHORD_CALC_ACTION_NONE;
+    }
+
+    if (m_unit_pending)
+    {
+        m_unit_pending = false;
+        if ((symbol >= '0') && (symbol <= '9'))
+        {
+            symbol = (char)(CALC_UNIT_FIRST + (symbol - '0'));
+        }
+    }
+
+    switch (symbol)
+    {
+        case CHORD_CALC_SYM_EQUALS:
+        {
+            bool ok = chord_calc_eval(m_expr, p_text, size);
+
+            chord_calc_reset();
+            if (ok && (strlen(p_text) <= CHORD_CALC_MAX_LEN))
+            {
+                // Carry on from the result.
+                strcpy(m_expr, p_text);
+                m_len = (uint8_t)strlen(m_expr);
+            }
+            return CHORD_CALC_ACTION_RESULT;
+        }
+
+        case CHORD_CALC_SYM_BACKSPACE:
+            if (m_len != 0)
+            {
+                m_expr[--m_len] = '\0';
+            }
+            break;
+
+        case CHORD_CALC_SYM_CLEAR:
+            chord_calc_reset();
+            break;
+
+        case CHORD_CALC_SYM_UNIT:
+            m_unit_pending = true;
+            break;
+
+        case CHORD_CALC_SYM_EXIT:
+            chord_calc_reset();
+            return CHORD_CALC_ACTION_EXIT;
+
+        default:
+            if (m_len < CHORD_CALC_MAX_LEN)
+            {
+                m_expr[m_len++] = symbol;
+                m_expr[m_len]   = '\0';
+            }
+            break;
+    }
+    return CHORD_CALC_ACTION_NONE;
+}
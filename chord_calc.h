@@ -0,0 +1,96 @@
+#ifndef CHORD_CALC_H__
+#define CHORD_CALC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**@brief Cockpit calculator.
+ *
+ * @details While the calculator layer is active, chords are mapped to calculator symbols and
+ *          collected into an expression. '=' evaluates it and only the result text is sent to the
+ *          host. Evaluation is a shunting-yard parser over fixed-point numbers with
+ *          CHORD_CALC_DECIMALS decimal places. It works in a static arena sized for
+ *          CHORD_CALC_MAX_LEN symbols, so run time and memory are bounded by that length. The
+ *          module only uses the C library, so it can be built and tested on a host.
+ *
+ *          Besides + - * / and parentheses it has aviation helpers:
+ *          - h:mm entry, for example 1:30 is 1.5 hours, so 9.5*1:30 is the fuel for 90 minutes.
+ *          - HDG wraps everything to its left to a heading between 001 and 360, for example
+ *            350+20 HDG is 010.
+ *          - TIME shows everything to its left, in hours, as h:mm, for example 120/95 TIME is 1:16.
+ *          - UNIT followed by a digit converts the number before it, see chord_calc_unit_t.
+ *
+ *          The result replaces the expression, so the next operator continues from it.
+ */
+
+#define CHORD_CALC_MAX_LEN              48                                  /**< Symbols in an expression. */
+#define CHORD_CALC_DECIMALS             3
+#define CHORD_CALC_SCALE                1000                                /**< 10^CHORD_CALC_DECIMALS. */
+
+/**@brief Calculator symbols. Operators are their ASCII character. */
+#define CHORD_CALC_SYM_NONE             '\0'
+#define CHORD_CALC_SYM_EQUALS           '='
+#define CHORD_CALC_SYM_BACKSPACE        '<'
+#define CHORD_CALC_SYM_CLEAR            'C'
+#define CHORD_CALC_SYM_HEADING          'H'
+#define CHORD_CALC_SYM_TIME             'T'
+#define CHORD_CALC_SYM_UNIT             'U'                                 /**< Next digit selects a chord_calc_unit_t. */
+#define CHORD_CALC_SYM_EXIT             'X'
+
+/**@brief Unit conversions, selected by UNIT and a digit. */
+typedef enum
+{
+    CHORD_CALC_UNIT_NM_KM,
+    CHORD_CALC_UNIT_KM_NM,
+    CHORD_CALC_UNIT_FT_M,
+    CHORD_CALC_UNIT_M_FT,
+    CHORD_CALC_UNIT_USG_L,
+    CHORD_CALC_UNIT_L_USG,
+    CHORD_CALC_UNIT_LB_KG,
+    CHORD_CALC_UNIT_KG_LB,
+    CHORD_CALC_UNIT_C_F,
+    CHORD_CALC_UNIT_F_C,
+    CHORD_CALC_UNIT_COUNT
+} chord_calc_unit_t;
+
+/**@brief Result of feeding a symbol to the calculator. */
+typedef enum
+{
+    CHORD_CALC_ACTION_NONE,                                         /**< Symbol taken, nothing to send. */
+    CHORD_CALC_ACTION_RESULT,                                       /**< Result text is ready. */
+    CHORD_CALC_ACTION_EXIT                                          /**< The calculator layer was left. */
+} chord_calc_action_t;
+
+/**@brief Function for getting the calculator symbol of a chord.
+ *
+ * @return CHORD_CALC_SYM_NONE if the chord has no symbol in the calculator layer.
+ */
+char chord_calc_symbol(uint8_t chord);
+
+/**@brief Function for clearing the expression.
+ */
+void chord_calc_reset(void);
+
+/**@brief Function for feeding a symbol to the calculator.
+ *
+ * @param[in]   symbol    Calculator symbol.
+ * @param[out]  p_text    Result text, NUL terminated, "ERR" if the expression is invalid.
+ * @param[in]   size      Size of p_text.
+ */
+chord_calc_action_t chord_calc_input(char symbol, char * p_text, size_t size);
+
+/**@brief Function for evaluating an expression.
+ *
+ * @details Operands are numbers with up to CHORD_CALC_DECIMALS decimals or h:mm times. Unit
+ *          conversions are written as 'a' + chord_calc_unit_t after the number.
+ *
+ * @param[in]   p_expr    Expression, NUL terminated.
+ * @param[out]  p_text    Result text, NUL terminated.
+ * @param[in]   size      Size of p_text.
+ *
+ * @return false if the expression is invalid or overflows, p_text is then "ERR".
+ */
+bool chord_calc_eval(char const * p_expr, char * p_text, size_t size);
+
+#endif // CHORD_CALC_H__
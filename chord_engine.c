@@ -0,0 +1,75 @@
+#include "sdk_common.h"
+#include "chord_engine.h"
+#include "nrf_log.h"
+
+static uint8_t  m_keys;                     /**< Keys down at the last update. */
+static uint8_t  m_chord;                    /**< Keys of the chord being typed. */
+static uint8_t  m_next;                     /**< Keys pressed while it is being released. */
+static bool     m_releasing;                /**< A key of m_chord has been released. */
+static uint32_t m_next_time;                /**< First press of m_next. */
+
+void chord_engine_seed(uint8_t keys)
+{
+    m_chord |= keys;
+}
+
+uint8_t chord_engine_update(uint8_t keys, uint32_t now, uint32_t rollover_ms, uint8_t * p_chords)
+{
+    uint8_t pressed  = keys & ~m_keys;
+    uint8_t released = m_keys & ~keys;
+    uint8_t count    = 0;
+
+    m_keys = keys;
+
+    if (released & m_chord)
+    {
+        m_releasing = true;
+    }
+    if (pressed)
+    {
+        if (m_releasing && (rollover_ms != 0))
+        {
+            if (m_next == 0)
+            {
+                m_next_time = now;
+            }
+            m_next |= pressed;
+        }
+        else
+        {
+            m_chord |= pressed;
+        }
+    }
+
+    if ((m_chord == 0) || ((m_chord & keys) != 0))
+    {
+        return 0;
+    }
+
+    // The chord is up. An overlap longer than the rollover time was one chord after all, which
+    // is complete only once the keys it takes over are up too.
+    if ((m_next != 0) && (now - m_next_time > rollover_ms))
+    {
+        NRF_LOG_DEBUG("Overlap of %d ms, chords merged", now - m_next_time);
+        m_chord |= m_next;
+        m_next   = 0;
+        if ((m_chord & keys) != 0)
+        {
+            return 0;
+        }
+    }
+
+    p_chords[count++] = m_chord;
+
+    // The next chord goes on from where it is, its keys may be up already.
+    m_chord     = m_next;
+    m_next      = 0;
+    m_releasing = (m_chord & ~keys) != 0;
+    if ((m_chord != 0) && ((m_chord & keys) == 0))
+    {
+        p_chords[count++] = m_chord;
+        m_chord           = 0;
+        m_releasing       = false;
+    }
+    return count;
+}
@@ -0,0 +1,37 @@
+#ifndef CHORD_ENGINE_H__
+#define CHORD_ENGINE_H__
+
+#include <stdint.h>
+
+/**@brief Turns debounced key states into chords, with rollover between chords.
+ *
+ * @details A chord is the set of keys pressed before its keys start to be released, and it is
+ *          complete once all of them are up. With a rollover time set, a key pressed while the
+ *          chord is being released starts the next chord instead of joining this one, provided the
+ *          chord is finished within the rollover time of that press. A longer overlap is not
+ *          rollover, and the keys merge into one chord as they do with rollover off.
+ *
+ *          Both chords can complete on the same update, the earlier one first.
+ */
+
+#define CHORD_ENGINE_MAX_CHORDS         2                                   /**< Chords completed by one update at most. */
+
+/**@brief Function for adding keys to the chord being typed, such as the keys latched while
+ *        waking up. They count as pressed, whether they are still down or not.
+ *
+ * @param[in]   keys          Keys, a set bit per key.
+ */
+void chord_engine_seed(uint8_t keys);
+
+/**@brief Function for passing a change of the debounced keys.
+ *
+ * @param[in]   keys          Keys down, a set bit per key.
+ * @param[in]   now           Time of the change, ms.
+ * @param[in]   rollover_ms   Longest overlap of two chords that still splits them, 0 for none.
+ * @param[out]  p_chords      Chords completed, CHORD_ENGINE_MAX_CHORDS entries.
+ *
+ * @return      Number of chords completed.
+ */
+uint8_t chord_engine_update(uint8_t keys, uint32_t now, uint32_t rollover_ms, uint8_t * p_chords);
+
+#endif // CHORD_ENGINE_H__
@@ -0,0 +1,31 @@
+#ifndef CHORD_KEYS_H__
+#define CHORD_KEYS_H__
+
+/**@brief Number of chord keys, which sizes the chord values, tables and formats at compile time.
+ *
+ * @details Set with make CHORD_KEYS=n. Key 1 is bit 0 of a chord, so the chords are 1 to
+ *          CHORD_COUNT. The layers built on the first five keys (the calculator, the USB keymap,
+ *          the system chords) need at least five; a chord fits a byte up to eight.
+ */
+
+#ifndef CHORD_KEY_COUNT
+#define CHORD_KEY_COUNT                 6
+#endif
+
+#if (CHORD_KEY_COUNT < 5) || (CHORD_KEY_COUNT > 8)
+#error "CHORD_KEY_COUNT must be 5 to 8"
+#endif
+
+#define CHORD_KEYS_MASK                 ((1 << CHORD_KEY_COUNT) - 1)        /**< All keys down. */
+#define CHORD_COUNT                     CHORD_KEYS_MASK                     /**< Chords 1 to CHORD_COUNT. */
+
+/**@brief Separator bitmask at the start of the dictionary and phrase model blobs, in u32 words.
+ *        At least the 64 chords of the original layout, so blobs of up to six keys are unchanged. */
+#define CHORD_SEPARATOR_WORDS           ((CHORD_KEY_COUNT <= 6) ? 2 : ((1 << CHORD_KEY_COUNT) / 32))
+#define CHORD_SEPARATOR_LEN             (CHORD_SEPARATOR_WORDS * 4)
+
+/**@brief Added to the format of blobs whose layout depends on the key count, so a blob built for
+ *        another count is rejected. 0 up to six keys, for the original layout. */
+#define CHORD_BLOB_FORMAT_KEYS          ((CHORD_KEY_COUNT <= 6) ? 0 : (CHORD_KEY_COUNT << 8))
+
+#endif // CHORD_KEYS_H__
@@ -0,0 +1,346 @@
+#include "sdk_common.h"
+#include "chord_log.h"
+#include <stddef.h>
+#include <string.h>
+#include "fds.h"
+#include "fds_maint.h"
+#include "nrf_log.h"
+#include "chord_keys.h"
+
+#define CHORD_BITS          CHORD_KEY_COUNT
+#define CHORD_MASK          ((1 << CHORD_BITS) - 1)
+#define DELTA_BITS          (16 - CHORD_BITS)
+#define DELTA_MAX           ((1 << DELTA_BITS) - 1)
+
+/**@brief Journal record, also the layout of the RAM buffers. */
+typedef struct
+{
+    uint16_t seq;
+    uint8_t  count;
+    uint8_t  key_count;                                 /**< CHORD_BITS, 0 in records of five key builds. */
+    uint32_t base_time;
+    uint16_t entries[CHORD_LOG_RECORD_ENTRIES];
+} chord_log_record_t;
+
+STATIC_ASSERT(CHORD_LOG_RECORD_ENTRIES <= UINT8_MAX);
+
+typedef enum
+{
+    BUF_FREE,
+    BUF_PENDING,                                        /**< Waiting to be handed to FDS. */
+    BUF_WRITING                                         /**< Owned by FDS until FDS_EVT_WRITE. */
+} buf_state_t;
+
+static chord_log_record_t m_buf[2];                     /**< Double buffer, one fills while the other is written. */
+static buf_state_t        m_standby_state;              /**< State of the buffer that is not being filled. */
+static uint8_t            m_active;                     /**< Index of the buffer being filled. */
+static bool               m_ready;                      /**< FDS initialized and the journal scanned. */
+static bool               m_delete_pending;             /**< More than CHORD_LOG_MAX_RECORDS are stored. */
+static uint16_t           m_next_seq;
+static uint16_t           m_record_count;
+static uint32_t           m_last_time;                  /**< Time of the last chord, in CHORD_LOG_TIME_UNIT_MS. */
+static uint32_t           m_last_add_ms;
+static uint32_t           m_dropped;                    /**< Chords lost because both buffers were full. */
+
+static struct
+{
+    fds_find_token_t  token;
+    fds_record_desc_t desc;
+    uint32_t          start;                            /**< Stream offset of the current record. */
+    uint32_t          len;                              /**< Length of the current record, 0 if none. */
+} m_cursor;
+
+/**@brief Function for handing the filled buffer to the writer and switching to the standby one.
+ *
+ * @return false if the standby buffer is still in use.
+ */
+static bool buffer_swap(void)
+{
+    if (m_standby_state != BUF_FREE)
+    {
+        return false;
+    }
+
+    m_standby_state = BUF_PENDING;
+    m_active ^= 1;
+
+    memset(&m_buf[m_active], 0, sizeof(m_buf[m_active]));
+    return true;
+}
+
+/**@brief Function for deleting the record with the oldest sequence number.
+ */
+static void oldest_record_delete(void)
+{
+    fds_record_desc_t  desc;
+    fds_record_desc_t  oldest_desc;
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+    uint16_t           oldest_age = 0;
+    bool               found      = false;
+
+    memset(&token, 0, sizeof(token));
+
+    while (fds_record_find(CHORD_LOG_FILE_ID, CHORD_LOG_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        if (fds_record_open(&desc, &record) != NRF_SUCCESS)
+        {
+            continue;
+        }
+        uint16_t age = m_next_seq - ((chord_log_record_t const *)record.p_data)->seq;
+        UNUSED_RETURN_VALUE(fds_record_close(&desc));
+
+        if (!found || (age > oldest_age))
+        {
+            oldest_age  = age;
+            oldest_desc = desc;
+            found       = true;
+        }
+    }
+
+    if (found && (fds_record_delete(&oldest_desc) == NRF_SUCCESS))
+    {
+        m_delete_pending = false;
+    }
+}
+
+/**@brief Function for writing the pending buffer to flash.
+ */
+static void pending_write(void)
+{
+    ret_code_t          err_code;
+    fds_record_t        record;
+    chord_log_record_t * p_rec = &m_buf[m_active ^ 1];
+
+    if (!m_ready || (m_standby_state != BUF_PENDING))
+    {
+        return;
+    }
+
+    p_rec->seq       = m_next_seq;
+    p_rec->key_count = CHORD_BITS;
+
+    record.file_id           = CHORD_LOG_FILE_ID;
+    record.key               = CHORD_LOG_RECORD_KEY;
+    record.data.p_data       = p_rec;
+    record.data.length_words = BYTES_TO_WORDS(offsetof(chord_log_record_t, entries)
+                                              + p_rec->count * sizeof(p_rec->entries[0]));
+
+    // Owned by FDS from here on, FDS_EVT_WRITE may arrive before fds_record_write() returns.
+    m_standby_state = BUF_WRITING;
+    fds_maint_write_begin();
+
+    err_code = fds_record_write(NULL, &record);
+    if (err_code == NRF_SUCCESS)
+    {
+        m_next_seq++;
+        return;
+    }
+
+    m_standby_state = BUF_PENDING;
+    fds_maint_write_end();
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        // Make room, the write is retried on the next call.
+        m_delete_pending = true;
+        fds_maint_gc_request();
+    }
+    else if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        NRF_LOG_WARNING("Chord log write failed: %x", err_code);
+    }
+}
+
+/**@brief Function for finding the next sequence number and record count after boot.
+ */
+static void journal_scan(void)
+{
+    fds_record_desc_t  desc;
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+    uint16_t           newest = 0;
+
+    memset(&token, 0, sizeof(token));
+    m_record_count = 0;
+
+    while (fds_record_find(CHORD_LOG_FILE_ID, CHORD_LOG_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        if (fds_record_open(&desc, &record) != NRF_SUCCESS)
+        {
+            continue;
+        }
+        uint16_t seq = ((chord_log_record_t const *)record.p_data)->seq;
+        UNUSED_RETURN_VALUE(fds_record_close(&desc));
+
+        // Sequence numbers wrap; the stored ones always span less than half the range.
+        if ((m_record_count == 0) || ((int16_t)(seq - newest) > 0))
+        {
+            newest = seq;
+        }
+        m_record_count++;
+    }
+
+    m_next_seq       = (m_record_count == 0) ? 0 : newest + 1;
+    m_delete_pending = (m_record_count > CHORD_LOG_MAX_RECORDS);
+}
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            if (p_evt->result == NRF_SUCCESS)
+            {
+                journal_scan();
+                m_ready = true;
+                NRF_LOG_INFO("Chord log: %d records", m_record_count);
+            }
+            break;
+
+        case FDS_EVT_WRITE:
+            if (p_evt->write.file_id == CHORD_LOG_FILE_ID)
+            {
+                m_standby_state = BUF_FREE;
+                if (p_evt->result == NRF_SUCCESS)
+                {
+                    m_record_count++;
+                    m_delete_pending = (m_record_count > CHORD_LOG_MAX_RECORDS);
+                }
+                fds_maint_write_end();
+            }
+            break;
+
+        case FDS_EVT_DEL_RECORD:
+            if ((p_evt->del.file_id == CHORD_LOG_FILE_ID) && (p_evt->result == NRF_SUCCESS))
+            {
+                m_record_count--;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+ret_code_t chord_log_init(void)
+{
+    memset(m_buf, 0, sizeof(m_buf));
+    m_active        = 0;
+    m_standby_state = BUF_FREE;
+    m_ready         = false;
+    m_last_time     = 0;
+    m_dropped       = 0;
+
+    return fds_register(fds_evt_handler);
+}
+
+void chord_log_add(uint8_t chord, uint32_t now_ms)
+{
+    chord_log_record_t * p_rec  = &m_buf[m_active];
+    uint32_t             now    = now_ms / CHORD_LOG_TIME_UNIT_MS;
+    uint32_t             delta  = now - m_last_time;
+    uint16_t             needed = (delta > DELTA_MAX) ? 2 : 1;
+
+    if (p_rec->count + needed > CHORD_LOG_RECORD_ENTRIES)
+    {
+        if (!buffer_swap())
+        {
+            m_dropped++;
+            return;
+        }
+        p_rec = &m_buf[m_active];
+    }
+
+    if (p_rec->count == 0)
+    {
+        p_rec->base_time = m_last_time;
+    }
+
+    if (delta > DELTA_MAX)
+    {
+        uint32_t high = delta >> DELTA_BITS;
+
+        if (high > DELTA_MAX)
+        {
+            high  = DELTA_MAX;
+            delta = DELTA_MAX;
+        }
+        p_rec->entries[p_rec->count++] = (uint16_t)(high << CHORD_BITS);
+        delta &= DELTA_MAX;
+    }
+    p_rec->entries[p_rec->count++] = (uint16_t)((delta << CHORD_BITS) | (chord & CHORD_MASK));
+
+    m_last_time   = now;
+    m_last_add_ms = now_ms;
+}
+
+void chord_log_process(uint32_t now_ms)
+{
+    if (!m_ready)
+    {
+        return;
+    }
+
+    if ((m_buf[m_active].count != 0) && (now_ms - m_last_add_ms >= CHORD_LOG_IDLE_FLUSH_MS))
+    {
+        UNUSED_RETURN_VALUE(buffer_swap());
+    }
+
+    if (m_delete_pending)
+    {
+        oldest_record_delete();
+    }
+
+    pending_write();
+
+    if (m_dropped != 0)
+    {
+        NRF_LOG_WARNING("Chord log dropped %d chords", m_dropped);
+        m_dropped = 0;
+    }
+}
+
+void chord_log_flush(void)
+{
+    if (m_buf[m_active].count != 0)
+    {
+        UNUSED_RETURN_VALUE(buffer_swap());
+    }
+    pending_write();
+}
+
+uint16_t chord_log_read(uint32_t offset, uint8_t * p_data, uint16_t max_len)
+{
+    fds_flash_record_t record;
+
+    if ((offset == 0) || (offset < m_cursor.start))
+    {
+        memset(&m_cursor, 0, sizeof(m_cursor));
+    }
+
+    // Advance to the record holding offset.
+    while (offset >= m_cursor.start + m_cursor.len)
+    {
+        m_cursor.start += m_cursor.len;
+        m_cursor.len    = 0;
+
+        if ((fds_record_find(CHORD_LOG_FILE_ID, CHORD_LOG_RECORD_KEY, &m_cursor.desc, &m_cursor.token) != NRF_SUCCESS)
+            || (fds_record_open(&m_cursor.desc, &record) != NRF_SUCCESS))
+        {
+            return 0;
+        }
+        m_cursor.len = record.p_header->length_words * sizeof(uint32_t);
+        UNUSED_RETURN_VALUE(fds_record_close(&m_cursor.desc));
+    }
+
+    if (fds_record_open(&m_cursor.desc, &record) != NRF_SUCCESS)
+    {
+        return 0;
+    }
+
+    uint16_t len = (uint16_t)MIN(max_len, m_cursor.start + m_cursor.len - offset);
+    memcpy(p_data, (uint8_t const *)record.p_data + (offset - m_cursor.start), len);
+    UNUSED_RETURN_VALUE(fds_record_close(&m_cursor.desc));
+
+    return len;
+}
@@ -0,0 +1,54 @@
+#ifndef CHORD_LOG_H__
+#define CHORD_LOG_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+/**@brief Chord journal.
+ *
+ * @details Every chord is appended to a RAM buffer as one 16-bit entry: the chord in the low
+ *          CHORD_KEY_COUNT bits and the time since the previous chord, in units of
+ *          CHORD_LOG_TIME_UNIT_MS, in the upper bits. Longer gaps are preceded by an escape entry with chord 0 carrying
+ *          the upper bits of the delta. Full buffers are written to FDS as one record, so flash
+ *          is only touched once every CHORD_LOG_RECORD_ENTRIES chords, or when typing pauses.
+ *
+ *          Record layout: seq (u16), entry count (u8), key count (u8, the chord bits of the
+ *          entries, 0 in records of the original five key layout), base time (u32, time units
+ *          since boot of the reference the first delta is relative to), followed by the entries. The oldest
+ *          record is deleted once CHORD_LOG_MAX_RECORDS are stored; FDS spreads the writes and
+ *          garbage collection over its pages.
+ */
+
+#define CHORD_LOG_FILE_ID               0x1000
+#define CHORD_LOG_RECORD_KEY            0x0001
+#define CHORD_LOG_RECORD_ENTRIES        32                                  /**< Entries per flash record (and per RAM buffer). */
+#define CHORD_LOG_MAX_RECORDS           128                                 /**< Records kept before the oldest is deleted. */
+#define CHORD_LOG_TIME_UNIT_MS          10
+#define CHORD_LOG_IDLE_FLUSH_MS         10000                               /**< Write a partial buffer after typing paused this long. */
+
+/**@brief Function for initializing the chord journal. Must be called before fds_init().
+ */
+ret_code_t chord_log_init(void);
+
+/**@brief Function for appending a chord to the journal. Only touches RAM.
+ *
+ * @param[in]   chord   Chord value, non-zero.
+ * @param[in]   now_ms  Milliseconds since boot.
+ */
+void chord_log_add(uint8_t chord, uint32_t now_ms);
+
+/**@brief Function for writing out full or idle buffers. Call periodically outside the chord path.
+ *
+ * @param[in]   now_ms  Milliseconds since boot.
+ */
+void chord_log_process(uint32_t now_ms);
+
+/**@brief Function for writing out the current buffer regardless of its fill level.
+ */
+void chord_log_flush(void);
+
+/**@brief Bulk stream read handler, returns the stored records back to back.
+ */
+uint16_t chord_log_read(uint32_t offset, uint8_t * p_data, uint16_t max_len);
+
+#endif // CHORD_LOG_H__
@@ -0,0 +1,215 @@
+#include "sdk_common.h"
+#include "chord_stats.h"
+#include <string.h>
+#include "fds.h"
+#include "fds_maint.h"
+#include "nrf_log.h"
+
+#define BIN_NONE            CHORD_STATS_BINS
+
+/**@brief Counters, also the layout of the FDS record and of the readout. */
+typedef struct
+{
+    uint8_t  bins;
+    uint8_t  bigram_bins;
+    uint8_t  reserved[2];
+    uint16_t histogram[CHORD_STATS_BINS];
+    uint16_t bigram[CHORD_STATS_BIGRAM_BINS][CHORD_STATS_BIGRAM_BINS];
+} chord_stats_data_t;
+
+// FDS records take at most a virtual page, less its 2 word tag and a 3 word record header.
+STATIC_ASSERT(BYTES_TO_WORDS(sizeof(chord_stats_data_t)) <= FDS_VIRTUAL_PAGE_SIZE - 5);
+
+// Counting goes on while FDS writes the record from here, so a record can mix counts of the few
+// chords typed during the write, which the statistics tolerate.
+static chord_stats_data_t m_stats;
+static fds_record_desc_t  m_desc;
+static bool               m_stored;                     /**< m_desc refers to the stored record. */
+static bool               m_loaded;
+static bool               m_dirty;                      /**< Counters changed since the last write. */
+static bool               m_writing;                    /**< A write is queued in FDS. */
+static uint8_t            m_prev = BIN_NONE;            /**< Bin of the previous chord. */
+static uint32_t           m_last_save_ms;
+
+static void counter_inc(uint16_t * p_counter)
+{
+    if (*p_counter != UINT16_MAX)
+    {
+        (*p_counter)++;
+    }
+}
+
+/**@brief Function for writing the counters to flash.
+ *
+ * @return true if the write was queued.
+ */
+static bool stats_save(void)
+{
+    ret_code_t   err_code;
+    fds_record_t record;
+
+    if (!m_loaded || m_writing || !m_dirty)
+    {
+        return false;
+    }
+
+    record.file_id           = CHORD_STATS_FILE_ID;
+    record.key               = CHORD_STATS_RECORD_KEY;
+    record.data.p_data       = &m_stats;
+    record.data.length_words = BYTES_TO_WORDS(sizeof(m_stats));
+
+    // Before queueing, FDS_EVT_UPDATE may arrive before fds_record_update() returns.
+    m_writing = true;
+    fds_maint_write_begin();
+
+    if (m_stored)
+    {
+        err_code = fds_record_update(&m_desc, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(&m_desc, &record);
+    }
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_stored = true;
+        m_dirty  = false;
+        return true;
+    }
+
+    m_writing = false;
+    fds_maint_write_end();
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        fds_maint_gc_request();
+    }
+    else if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        NRF_LOG_WARNING("Chord stats save failed: %x", err_code);
+    }
+    return false;
+}
+
+static void stats_load(void)
+{
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+
+    memset(&token, 0, sizeof(token));
+
+    if ((fds_record_find(CHORD_STATS_FILE_ID, CHORD_STATS_RECORD_KEY, &m_desc, &token) == NRF_SUCCESS)
+        && (fds_record_open(&m_desc, &record) == NRF_SUCCESS))
+    {
+        chord_stats_data_t const * p_data = record.p_data;
+
+        // A record of another layout is replaced on the next write.
+        if ((record.p_header->length_words == BYTES_TO_WORDS(sizeof(m_stats)))
+            && (p_data->bins == CHORD_STATS_BINS)
+            && (p_data->bigram_bins == m_stats.bigram_bins))
+        {
+            memcpy(&m_stats, p_data, sizeof(m_stats));
+        }
+        UNUSED_RETURN_VALUE(fds_record_close(&m_desc));
+        m_stored = true;
+    }
+
+    m_loaded = true;
+}
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    switch (p_evt->id)
+    {
+        case FDS_EVT_INIT:
+            if (p_evt->result == NRF_SUCCESS)
+            {
+                stats_load();
+            }
+            break;
+
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            if (p_evt->write.file_id == CHORD_STATS_FILE_ID)
+            {
+                m_writing = false;
+                if (p_evt->result != NRF_SUCCESS)
+                {
+                    m_dirty = true;
+                }
+                fds_maint_write_end();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+ret_code_t chord_stats_init(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.bins        = CHORD_STATS_BINS;
+    // 0 as in the records written before the count was stored, when the matrix was always full.
+    m_stats.bigram_bins = (CHORD_STATS_BIGRAM_BINS == CHORD_STATS_BINS) ? 0 : CHORD_STATS_BIGRAM_BINS;
+    m_stored       = false;
+    m_loaded       = false;
+    m_dirty        = false;
+    m_writing      = false;
+    m_prev         = BIN_NONE;
+    m_last_save_ms = 0;
+
+    return fds_register(fds_evt_handler);
+}
+
+void chord_stats_add(uint8_t chord)
+{
+    uint8_t bin = chord - 1;
+
+    // Until the stored counters are loaded, counts would be overwritten.
+    if (!m_loaded)
+    {
+        return;
+    }
+
+    if (bin >= CHORD_STATS_BINS)
+    {
+        m_prev = BIN_NONE;
+        return;
+    }
+
+    counter_inc(&m_stats.histogram[bin]);
+    if ((m_prev < CHORD_STATS_BIGRAM_BINS) && (bin < CHORD_STATS_BIGRAM_BINS))
+    {
+        counter_inc(&m_stats.bigram[m_prev][bin]);
+    }
+    m_prev  = bin;
+    m_dirty = true;
+}
+
+void chord_stats_process(uint32_t now_ms)
+{
+    if (m_dirty && (now_ms - m_last_save_ms >= CHORD_STATS_SAVE_INTERVAL_MS) && stats_save())
+    {
+        m_last_save_ms = now_ms;
+    }
+}
+
+void chord_stats_flush(void)
+{
+    UNUSED_RETURN_VALUE(stats_save());
+}
+
+uint16_t chord_stats_read(uint32_t offset, uint8_t * p_data, uint16_t max_len)
+{
+    if (offset >= sizeof(m_stats))
+    {
+        return 0;
+    }
+
+    uint16_t len = (uint16_t)MIN(max_len, sizeof(m_stats) - offset);
+    memcpy(p_data, (uint8_t const *)&m_stats + offset, len);
+
+    return len;
+}
@@ -0,0 +1,50 @@
+#ifndef CHORD_STATS_H__
+#define CHORD_STATS_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+#include "chord_keys.h"
+
+/**@brief Chord frequency statistics, for optimizing the chord layout.
+ *
+ * @details A histogram of the chords and a matrix of the chord pairs typed back to back are
+ *          counted in RAM with saturating 16-bit counters, two increments per chord. The counters
+ *          are kept in one FDS record, written back every CHORD_STATS_SAVE_INTERVAL_MS while they
+ *          change and before sleep, and can be read out over the bulk service.
+ *
+ *          Record and readout layout, little endian: bin count (u8), bigram bin count (u8, 0 when
+ *          it equals the bin count, as with five keys), 2 reserved bytes, histogram (u16 per chord,
+ *          chord 1 first), bigram matrix (u16, row of the previous chord, column of the next one).
+ */
+
+#define CHORD_STATS_FILE_ID             0x1002
+#define CHORD_STATS_RECORD_KEY          0x0001
+#define CHORD_STATS_BINS                CHORD_COUNT                         /**< Chords 1 to CHORD_COUNT. */
+#define CHORD_STATS_BIGRAM_BINS         31                                  /**< Pairs of the chords of the first five keys, a matrix of every chord of six keys would not fit an FDS record. */
+#define CHORD_STATS_SAVE_INTERVAL_MS    600000                              /**< Shortest time between two writes of the record. */
+
+/**@brief Function for initializing the statistics. Must be called before fds_init().
+ */
+ret_code_t chord_stats_init(void);
+
+/**@brief Function for counting a chord. Only touches RAM, in constant time.
+ *
+ * @param[in]   chord   Chord value.
+ */
+void chord_stats_add(uint8_t chord);
+
+/**@brief Function for writing the counters back when due. Call periodically outside the chord path.
+ *
+ * @param[in]   now_ms  Milliseconds since boot.
+ */
+void chord_stats_process(uint32_t now_ms);
+
+/**@brief Function for writing the counters back if they changed, for example before sleep.
+ */
+void chord_stats_flush(void);
+
+/**@brief Bulk stream read handler, returns the record layout of the current counters.
+ */
+uint16_t chord_stats_read(uint32_t offset, uint8_t * p_data, uint16_t max_len);
+
+#endif // CHORD_STATS_H__
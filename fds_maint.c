@@ -0,0 +1,165 @@
+#include "sdk_common.h"
+#include "fds_maint.h"
+#include "fds.h"
+#include "nrf_log.h"
+
+static fds_maint_sleep_ready_t m_sleep_ready;
+static bool     m_gc_requested;
+static bool     m_gc_running;
+static bool     m_sleep_waiting;                        /**< m_sleep_ready is due when the GC and writes complete. */
+static uint8_t  m_writes;                               /**< Writes begun and not yet ended. */
+static uint32_t m_request_ms;                           /**< Time of the oldest unserved request. */
+static uint32_t m_activity_ms;
+static uint32_t m_stat_ms;
+static uint32_t m_now_ms;
+
+/**@brief Function for starting garbage collection.
+ *
+ * @return true if the GC was queued.
+ */
+static bool gc_start(void)
+{
+    ret_code_t err_code = fds_gc();
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_gc_requested = false;
+        m_gc_running   = true;
+        return true;
+    }
+    if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        NRF_LOG_WARNING("fds_gc failed: %x", err_code);
+    }
+    // Otherwise retried on the next call to fds_maint_process().
+    return false;
+}
+
+/**@brief Function for checking whether enough space is freeable to make a GC worthwhile.
+ */
+static bool fragmented(void)
+{
+    fds_stat_t stat;
+
+    if (fds_stat(&stat) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    return (stat.freeable_words >= FDS_MAINT_DIRTY_WORDS);
+}
+
+/**@brief Function for resuming sleep once nothing is left to wait for.
+ */
+static void sleep_ready_check(void)
+{
+    if (m_sleep_waiting && !m_gc_running && (m_writes == 0))
+    {
+        m_sleep_waiting = false;
+        m_sleep_ready();
+    }
+}
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    if (p_evt->id != FDS_EVT_GC)
+    {
+        return;
+    }
+
+    m_gc_running = false;
+    NRF_LOG_INFO("Flash garbage collection done: %x", p_evt->result);
+
+    sleep_ready_check();
+}
+
+ret_code_t fds_maint_init(fds_maint_sleep_ready_t sleep_ready)
+{
+    m_sleep_ready   = sleep_ready;
+    m_gc_requested  = false;
+    m_gc_running    = false;
+    m_sleep_waiting = false;
+    m_writes        = 0;
+
+    return fds_register(fds_evt_handler);
+}
+
+void fds_maint_gc_request(void)
+{
+    if (!m_gc_requested)
+    {
+        m_gc_requested = true;
+        m_request_ms   = m_now_ms;
+    }
+}
+
+void fds_maint_write_begin(void)
+{
+    m_writes++;
+}
+
+void fds_maint_write_end(void)
+{
+    if (m_writes > 0)
+    {
+        m_writes--;
+    }
+    sleep_ready_check();
+}
+
+void fds_maint_activity(uint32_t now_ms)
+{
+    m_activity_ms   = now_ms;
+    m_sleep_waiting = false;
+}
+
+void fds_maint_process(uint32_t now_ms)
+{
+    m_now_ms = now_ms;
+
+    if (m_gc_running)
+    {
+        return;
+    }
+
+    bool idle = (now_ms - m_activity_ms >= FDS_MAINT_IDLE_MS);
+
+    if (m_gc_requested)
+    {
+        if (idle || (now_ms - m_request_ms >= FDS_MAINT_MAX_DEFER_MS))
+        {
+            UNUSED_RETURN_VALUE(gc_start());
+        }
+        return;
+    }
+
+    if (idle && (now_ms - m_stat_ms >= FDS_MAINT_STAT_INTERVAL_MS))
+    {
+        m_stat_ms = now_ms;
+        if (fragmented())
+        {
+            UNUSED_RETURN_VALUE(gc_start());
+        }
+    }
+}
+
+bool fds_maint_sleep_prepare(void)
+{
+    fds_stat_t stat;
+
+    // Nobody is typing, so less garbage is worth a GC than while awake, but not the few words of
+    // each flush: every GC erases a page. FDS runs it after the writes queued.
+    if (!m_gc_running
+        && (fds_stat(&stat) == NRF_SUCCESS)
+        && ((stat.freeable_words >= FDS_MAINT_SLEEP_DIRTY_WORDS) || m_gc_requested))
+    {
+        UNUSED_RETURN_VALUE(gc_start());
+    }
+
+    if (!m_gc_running && (m_writes == 0))
+    {
+        return false;
+    }
+
+    m_sleep_waiting = true;
+    return true;
+}
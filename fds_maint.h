@@ -0,0 +1,70 @@
+#ifndef FDS_MAINT_H__
+#define FDS_MAINT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+/**@brief Flash storage maintenance.
+ *
+ * @details Garbage collection erases flash pages, which blocks the CPU and the radio for tens of
+ *          milliseconds. Instead of running fds_gc() where the need is detected, users request it
+ *          here and it runs once typing has paused for FDS_MAINT_IDLE_MS, or after
+ *          FDS_MAINT_MAX_DEFER_MS at the latest. Requests that cannot be queued are retried.
+ *          Fragmentation is sampled while idle, and collected early before the device sleeps.
+ *          Sleep also waits for the records users are writing, which they report with
+ *          fds_maint_write_begin() and fds_maint_write_end().
+ */
+
+#define FDS_MAINT_IDLE_MS               3000                                /**< Typing pause before GC may run. */
+#define FDS_MAINT_MAX_DEFER_MS          60000                               /**< Longest a requested GC waits for a pause. */
+#define FDS_MAINT_STAT_INTERVAL_MS      30000                               /**< Fragmentation sampling interval while idle. */
+#define FDS_MAINT_DIRTY_WORDS           512                                 /**< Freeable words that make GC worthwhile without a request. */
+#define FDS_MAINT_SLEEP_DIRTY_WORDS     (FDS_MAINT_DIRTY_WORDS / 2)         /**< Freeable words that make GC worthwhile before sleep. */
+
+/**@brief Called when maintenance started by fds_maint_sleep_prepare() has finished. */
+typedef void (*fds_maint_sleep_ready_t) (void);
+
+/**@brief Function for initializing storage maintenance. Must be called before fds_init().
+ *
+ * @param[in]   sleep_ready  Handler to resume going to sleep.
+ */
+ret_code_t fds_maint_init(fds_maint_sleep_ready_t sleep_ready);
+
+/**@brief Function for requesting garbage collection, for example on PM_EVT_STORAGE_FULL.
+ */
+void fds_maint_gc_request(void);
+
+/**@brief Function for reporting key activity, which postpones garbage collection.
+ *
+ * @param[in]   now_ms  Milliseconds since boot.
+ */
+void fds_maint_activity(uint32_t now_ms);
+
+/**@brief Function for running due maintenance. Call periodically.
+ *
+ * @param[in]   now_ms  Milliseconds since boot.
+ */
+void fds_maint_process(uint32_t now_ms);
+
+/**@brief Function for reporting a record write or update about to be queued.
+ *
+ * @details Must come before fds_record_write() or fds_record_update(), as their event may arrive
+ *          before they return.
+ */
+void fds_maint_write_begin(void);
+
+/**@brief Function for reporting the FDS_EVT_WRITE or FDS_EVT_UPDATE of a record write, or that
+ *        queueing it failed.
+ */
+void fds_maint_write_end(void);
+
+/**@brief Function for finishing writes before going to sleep, and collecting garbage if
+ *        FDS_MAINT_SLEEP_DIRTY_WORDS are freeable or garbage collection was requested.
+ *
+ * @return true if garbage collection or writes are under way, sleep must then wait for the
+ *         sleep_ready handler. Key activity in the meantime cancels the handler call.
+ */
+bool fds_maint_sleep_prepare(void);
+
+#endif // FDS_MAINT_H__
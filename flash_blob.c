@@ -0,0 +1,326 @@
+#include "sdk_common.h"
+#include "flash_blob.h"
+#include <string.h>
+#include "nrf_fstorage.h"
+#include "nrf_fstorage_sd.h"
+#include "crc16.h"
+#include "nrf_log.h"
+
+#define STAGE_SIZE          256                         /**< Bytes programmed at a time, two stages alternate. */
+
+static void fstorage_evt_handler(nrf_fstorage_evt_t * p_evt);
+
+NRF_FSTORAGE_DEF(nrf_fstorage_t m_fs) =
+{
+    .evt_handler = fstorage_evt_handler,                // Bounds are set in flash_blob_init().
+};
+
+static const uint8_t m_pages[FLASH_BLOB_COUNT] =
+{
+    [FLASH_BLOB_TEXT_DICT]    = FLASH_BLOB_TEXT_DICT_PAGES,
+    [FLASH_BLOB_PHRASE_MODEL] = FLASH_BLOB_PHRASE_MODEL_PAGES,
+};
+
+static uint32_t m_start[FLASH_BLOB_COUNT];              /**< Region address of each blob. */
+static bool     m_valid[FLASH_BLOB_COUNT];
+
+/**@brief Upload in progress. The bulk service runs one transfer at a time. */
+static struct
+{
+    flash_blob_id_t     id;
+    bool                active;                         /**< Between the start of the upload and its done call. */
+    bool                commit;                         /**< Upload complete, the header is due once the stages are programmed. */
+    bool                failed;
+    bool                busy;                           /**< Flash operation in flight. */
+    uint8_t             busy_stage;                     /**< Stage being programmed, 2 for an erase or the header. */
+    flash_blob_header_t header;                         /**< Received header, programmed last. */
+    uint32_t            end;                            /**< Stream offset after the last byte received. */
+    uint8_t             fill;                           /**< Stage being filled. */
+    uint32_t            stage_addr[2];
+    uint16_t            stage_len[2];
+    bool                stage_queued[2];                /**< Full, waiting to be programmed. */
+    uint8_t             stage[2][STAGE_SIZE] __ALIGN(4);
+} m_up;
+
+static uint32_t region_size(flash_blob_id_t id)
+{
+    return m_pages[id] * NRF_FICR->CODEPAGESIZE;
+}
+
+/**@brief Function for checking the header and the payload CRC of a blob in flash.
+ */
+static bool blob_check(flash_blob_id_t id)
+{
+    flash_blob_header_t const * p_header = (flash_blob_header_t const *)m_start[id];
+
+    return (p_header->magic == FLASH_BLOB_MAGIC)
+           && (p_header->len <= region_size(id) - sizeof(flash_blob_header_t))
+           && (crc16_compute((uint8_t const *)(p_header + 1), p_header->len, NULL) == p_header->crc);
+}
+
+static void stage_program(uint8_t i)
+{
+    // Programming is in words, the last stage is padded with erased bytes.
+    uint16_t len = (uint16_t)ALIGN_NUM(sizeof(uint32_t), m_up.stage_len[i]);
+
+    memset(&m_up.stage[i][m_up.stage_len[i]], 0xFF, len - m_up.stage_len[i]);
+
+    if (nrf_fstorage_write(&m_fs, m_up.stage_addr[i], m_up.stage[i], len, NULL) == NRF_SUCCESS)
+    {
+        m_up.busy       = true;
+        m_up.busy_stage = i;
+    }
+    else
+    {
+        m_up.failed = true;
+    }
+}
+
+/**@brief Function for starting the next flash operation of the upload.
+ */
+static void upload_pump(void)
+{
+    if (m_up.busy)
+    {
+        return;
+    }
+
+    if (!m_up.failed)
+    {
+        for (uint8_t i = 0; i < 2; i++)
+        {
+            if (m_up.stage_queued[i])
+            {
+                stage_program(i);
+                if (m_up.busy)
+                {
+                    return;
+                }
+            }
+        }
+        if (m_up.commit && (m_up.stage_len[m_up.fill] != 0))
+        {
+            m_up.stage_queued[m_up.fill] = true;
+            stage_program(m_up.fill);
+            if (m_up.busy)
+            {
+                return;
+            }
+        }
+    }
+
+    if (!m_up.commit)
+    {
+        return;
+    }
+    m_up.commit = false;
+
+    if (!m_up.failed
+        && (m_up.header.magic == FLASH_BLOB_MAGIC)
+        && (m_up.header.len == m_up.end - sizeof(flash_blob_header_t))
+        && (crc16_compute((uint8_t const *)(m_start[m_up.id] + sizeof(flash_blob_header_t)),
+                          m_up.header.len, NULL) == m_up.header.crc))
+    {
+        if (nrf_fstorage_write(&m_fs, m_start[m_up.id], &m_up.header, sizeof(m_up.header), NULL) == NRF_SUCCESS)
+        {
+            m_up.busy       = true;
+            m_up.busy_stage = 2;
+            m_up.commit     = true;                     // Completed by the header write.
+            return;
+        }
+    }
+    NRF_LOG_WARNING("Blob %d upload rejected", m_up.id);
+}
+
+static void fstorage_evt_handler(nrf_fstorage_evt_t * p_evt)
+{
+    m_up.busy = false;
+
+    if (p_evt->result != NRF_SUCCESS)
+    {
+        m_up.failed = true;
+    }
+
+    if (m_up.busy_stage < 2)
+    {
+        m_up.stage_len[m_up.busy_stage]    = 0;
+        m_up.stage_queued[m_up.busy_stage] = false;
+    }
+    else if ((p_evt->id == NRF_FSTORAGE_EVT_WRITE_RESULT) && m_up.commit)
+    {
+        // The header is in place.
+        m_up.commit        = false;
+        m_valid[m_up.id]   = !m_up.failed;
+        NRF_LOG_INFO("Blob %d uploaded, %d bytes", m_up.id, m_up.header.len);
+        return;
+    }
+
+    upload_pump();
+}
+
+/**@brief Function for starting an upload, erasing the region.
+ */
+static uint32_t upload_start(flash_blob_id_t id)
+{
+    if (m_up.busy || m_up.commit)
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    memset(&m_up, 0, sizeof(m_up));
+    m_valid[id] = false;
+
+    uint32_t err_code = nrf_fstorage_erase(&m_fs, m_start[id], m_pages[id], NULL);
+    VERIFY_SUCCESS(err_code);
+
+    m_up.id            = id;
+    m_up.active        = true;
+    m_up.busy          = true;
+    m_up.busy_stage    = 2;
+    m_up.stage_addr[0] = m_start[id] + sizeof(flash_blob_header_t);
+    return NRF_SUCCESS;
+}
+
+static uint32_t blob_write(flash_blob_id_t id, uint32_t offset, uint8_t const * p_data, uint16_t len)
+{
+    if (len == 0)
+    {
+        return upload_start(id);
+    }
+    if (!m_up.active || (m_up.id != id) || m_up.failed || (offset != m_up.end))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (offset + len > region_size(id))
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    // The header is kept in RAM until the payload has been checked.
+    if (offset < sizeof(flash_blob_header_t))
+    {
+        uint16_t n = (uint16_t)MIN(len, sizeof(flash_blob_header_t) - offset);
+
+        memcpy((uint8_t *)&m_up.header + offset, p_data, n);
+        offset += n;
+        p_data += n;
+        len    -= n;
+    }
+
+    uint32_t end      = offset + len;
+    uint8_t  fill     = m_up.fill;
+    uint16_t room     = STAGE_SIZE - m_up.stage_len[fill];
+    uint16_t overflow = (len > room) ? (len - room) : 0;
+    uint8_t  next     = fill ^ 1;
+
+    if ((overflow != 0) && (m_up.stage_queued[next] || (m_up.busy && (m_up.busy_stage == next))))
+    {
+        // Both stages in use, the block is resent.
+        return NRF_ERROR_BUSY;
+    }
+
+    memcpy(&m_up.stage[fill][m_up.stage_len[fill]], p_data, len - overflow);
+    m_up.stage_len[fill] += len - overflow;
+
+    if (m_up.stage_len[fill] == STAGE_SIZE)
+    {
+        m_up.stage_queued[fill] = true;
+        m_up.fill               = next;
+        m_up.stage_addr[next]   = m_up.stage_addr[fill] + STAGE_SIZE;
+
+        memcpy(m_up.stage[next], p_data + (len - overflow), overflow);
+        m_up.stage_len[next] = overflow;
+
+        upload_pump();
+    }
+
+    m_up.end = end;
+    return NRF_SUCCESS;
+}
+
+static void blob_done(flash_blob_id_t id, bool success)
+{
+    if (!m_up.active || (m_up.id != id))
+    {
+        return;
+    }
+    m_up.active = false;
+
+    if (!success)
+    {
+        NRF_LOG_INFO("Blob %d upload aborted", id);
+        return;
+    }
+    m_up.commit = true;
+    upload_pump();
+}
+
+#define BLOB_STREAM_DEF(_id, _name)                                                     \
+static uint32_t _name ## _write(uint32_t offset, uint8_t const * p_data, uint16_t len)  \
+{                                                                                       \
+    return blob_write(_id, offset, p_data, len);                                        \
+}                                                                                       \
+static void _name ## _done(bool success)                                                \
+{                                                                                       \
+    blob_done(_id, success);                                                            \
+}
+
+BLOB_STREAM_DEF(FLASH_BLOB_TEXT_DICT, text_dict)
+BLOB_STREAM_DEF(FLASH_BLOB_PHRASE_MODEL, phrase_model)
+
+static const ble_bulk_stream_t m_streams[FLASH_BLOB_COUNT] =
+{
+    [FLASH_BLOB_TEXT_DICT]    = {.write = text_dict_write,    .done = text_dict_done},
+    [FLASH_BLOB_PHRASE_MODEL] = {.write = phrase_model_write, .done = phrase_model_done},
+};
+
+ret_code_t flash_blob_init(void)
+{
+    uint32_t   page_size = NRF_FICR->CODEPAGESIZE;
+    uint32_t   end;
+    ret_code_t err_code;
+
+    // Same bounds as FDS, which sits at the end of the application area.
+    end = (NRF_UICR->NRFFW[0] != 0xFFFFFFFF) ? NRF_UICR->NRFFW[0] : (NRF_FICR->CODESIZE * page_size);
+    end -= (FDS_VIRTUAL_PAGES + FDS_VIRTUAL_PAGES_RESERVED) * FDS_VIRTUAL_PAGE_SIZE * sizeof(uint32_t);
+
+    m_fs.end_addr = end;
+    for (uint8_t id = 0; id < FLASH_BLOB_COUNT; id++)
+    {
+        end        -= m_pages[id] * page_size;
+        m_start[id] = end;
+    }
+    m_fs.start_addr = end;
+
+    err_code = nrf_fstorage_init(&m_fs, &nrf_fstorage_sd, NULL);
+    VERIFY_SUCCESS(err_code);
+
+    for (uint8_t id = 0; id < FLASH_BLOB_COUNT; id++)
+    {
+        m_valid[id] = blob_check((flash_blob_id_t)id);
+        NRF_LOG_INFO("Blob %d at 0x%x: %s", id, m_start[id], m_valid[id] ? "valid" : "none");
+    }
+    return NRF_SUCCESS;
+}
+
+void const * flash_blob_get(flash_blob_id_t id, uint16_t format, uint32_t * p_len)
+{
+    if ((id >= FLASH_BLOB_COUNT) || !m_valid[id])
+    {
+        return NULL;
+    }
+
+    flash_blob_header_t const * p_header = (flash_blob_header_t const *)m_start[id];
+
+    if (p_header->format != format)
+    {
+        return NULL;
+    }
+    *p_len = p_header->len;
+    return p_header + 1;
+}
+
+ble_bulk_stream_t const * flash_blob_stream(flash_blob_id_t id)
+{
+    return &m_streams[id];
+}
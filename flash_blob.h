@@ -0,0 +1,59 @@
+#ifndef FLASH_BLOB_H__
+#define FLASH_BLOB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "ble_bulk.h"
+
+/**@brief Read-only data blobs in flash, uploaded over the bulk service.
+ *
+ * @details Each blob has its own pages just below the FDS area and is used in place, memory
+ *          mapped, without a RAM copy. An upload streams a flash_blob_header_t followed by the
+ *          payload. The payload is programmed while it arrives; the header is programmed last,
+ *          after the payload CRC has been checked, so an interrupted or corrupted upload leaves
+ *          no valid blob behind. Blocks that arrive while flash is busy are NAK'ed and resent.
+ */
+
+#define FLASH_BLOB_MAGIC                0x424f4c42                          /**< "BLOB". */
+
+/**@brief Blobs, each with a fixed region. */
+typedef enum
+{
+    FLASH_BLOB_TEXT_DICT,                                           /**< Abbreviation dictionary, see text_dict.h. */
+    FLASH_BLOB_PHRASE_MODEL,                                        /**< Word prediction model, see phrase_predict.h. */
+    FLASH_BLOB_COUNT
+} flash_blob_id_t;
+
+#define FLASH_BLOB_TEXT_DICT_PAGES      2
+#define FLASH_BLOB_PHRASE_MODEL_PAGES   4
+
+/**@brief Header at the start of a blob region, and of an upload. */
+typedef struct
+{
+    uint32_t magic;                                                 /**< FLASH_BLOB_MAGIC. */
+    uint32_t len;                                                   /**< Payload length in bytes. */
+    uint16_t crc;                                                   /**< CRC16 of the payload. */
+    uint16_t format;                                                /**< Payload format, checked by the blob's user. */
+} flash_blob_header_t;
+
+/**@brief Function for initializing the blob regions. Call after the SoftDevice is enabled.
+ */
+ret_code_t flash_blob_init(void);
+
+/**@brief Function for getting a blob.
+ *
+ * @param[in]   id       Blob.
+ * @param[in]   format   Expected payload format.
+ * @param[out]  p_len    Payload length.
+ *
+ * @return Pointer to the payload in flash, NULL if the blob is missing, has another format, or
+ *         is being uploaded.
+ */
+void const * flash_blob_get(flash_blob_id_t id, uint16_t format, uint32_t * p_len);
+
+/**@brief Function for getting the bulk stream that uploads a blob.
+ */
+ble_bulk_stream_t const * flash_blob_stream(flash_blob_id_t id);
+
+#endif // FLASH_BLOB_H__
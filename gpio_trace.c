@@ -0,0 +1,135 @@
+#include "sdk_common.h"
+#include "gpio_trace.h"
+
+#if GPIO_TRACE_ENABLED
+
+#include "nrf.h"
+#include "app_util_platform.h"
+#include "SEGGER_RTT.h"
+
+#define RING_MASK           (GPIO_TRACE_RING_SIZE - 1)
+
+STATIC_ASSERT((GPIO_TRACE_RING_SIZE & RING_MASK) == 0);
+
+static gpio_trace_record_t m_ring[GPIO_TRACE_RING_SIZE];
+static volatile uint32_t   m_head;                      /**< Written by the timer interrupt only. */
+static volatile uint32_t   m_tail;                      /**< Written by the main context only. */
+static gpio_trace_record_t m_run;                       /**< Run being sampled. */
+static uint32_t            m_gap;                       /**< Samples lost since the ring filled up. */
+static uint32_t            m_pin_mask;
+static bool                m_header_sent;
+static uint8_t             m_rtt_buf[GPIO_TRACE_RTT_BUF_SIZE];
+
+static void ring_put(uint32_t pins, uint32_t samples)
+{
+    m_ring[m_head & RING_MASK].pins    = pins;
+    m_ring[m_head & RING_MASK].samples = samples;
+    m_head++;
+}
+
+/**@brief Function for queuing a finished run, or counting it as lost if the ring is full.
+ */
+static void run_push(void)
+{
+    uint32_t free = GPIO_TRACE_RING_SIZE - (m_head - m_tail);
+
+    if (m_run.samples == 0)
+    {
+        return;
+    }
+
+    // The gap record goes first, so the timeline stays intact.
+    if (free < ((m_gap != 0) ? 2 : 1))
+    {
+        m_gap += m_run.samples;
+        return;
+    }
+    if (m_gap != 0)
+    {
+        ring_put(GPIO_TRACE_GAP, m_gap);
+        m_gap = 0;
+    }
+    ring_put(m_run.pins, m_run.samples);
+}
+
+void TIMER1_IRQHandler(void)
+{
+    uint32_t pins = NRF_P0->IN & m_pin_mask;
+
+    NRF_TIMER1->EVENTS_COMPARE[0] = 0;
+    (void)NRF_TIMER1->EVENTS_COMPARE[0];
+
+    if ((pins == m_run.pins) && (m_run.samples != UINT32_MAX))
+    {
+        m_run.samples++;
+        return;
+    }
+
+    run_push();
+    m_run.pins    = pins;
+    m_run.samples = 1;
+}
+
+ret_code_t gpio_trace_init(uint32_t pin_mask)
+{
+    if (SEGGER_RTT_ConfigUpBuffer(GPIO_TRACE_RTT_CHANNEL, "gpio_trace", m_rtt_buf, sizeof(m_rtt_buf),
+                                  SEGGER_RTT_MODE_NO_BLOCK_SKIP) < 0)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    m_pin_mask    = pin_mask;
+    m_head        = 0;
+    m_tail        = 0;
+    m_run.pins    = 0;
+    m_run.samples = 0;
+    m_gap         = 0;
+    m_header_sent = false;
+
+    NRF_TIMER1->MODE      = TIMER_MODE_MODE_Timer;
+    NRF_TIMER1->BITMODE   = TIMER_BITMODE_BITMODE_32Bit;
+    NRF_TIMER1->PRESCALER = 4;                                          // 1 MHz
+    NRF_TIMER1->CC[0]     = GPIO_TRACE_PERIOD_US;
+    NRF_TIMER1->SHORTS    = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+    NRF_TIMER1->INTENSET  = TIMER_INTENSET_COMPARE0_Msk;
+
+    NVIC_SetPriority(TIMER1_IRQn, APP_IRQ_PRIORITY_HIGH);
+    NVIC_ClearPendingIRQ(TIMER1_IRQn);
+    NVIC_EnableIRQ(TIMER1_IRQn);
+
+    NRF_TIMER1->TASKS_CLEAR = 1;
+    NRF_TIMER1->TASKS_START = 1;
+
+    return NRF_SUCCESS;
+}
+
+void gpio_trace_process(void)
+{
+    // Skip mode writes all or nothing, what does not fit is retried on the next call.
+    if (!m_header_sent)
+    {
+        gpio_trace_header_t header =
+        {
+            .magic     = GPIO_TRACE_MAGIC,
+            .period_us = GPIO_TRACE_PERIOD_US,
+            .pin_mask  = m_pin_mask
+        };
+
+        if (SEGGER_RTT_Write(GPIO_TRACE_RTT_CHANNEL, &header, sizeof(header)) == 0)
+        {
+            return;
+        }
+        m_header_sent = true;
+    }
+
+    while (m_tail != m_head)
+    {
+        if (SEGGER_RTT_Write(GPIO_TRACE_RTT_CHANNEL, &m_ring[m_tail & RING_MASK], sizeof(gpio_trace_record_t)) == 0)
+        {
+            return;
+        }
+        m_tail++;
+    }
+}
+
+#endif // GPIO_TRACE_ENABLED
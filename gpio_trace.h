@@ -0,0 +1,59 @@
+#ifndef GPIO_TRACE_H__
+#define GPIO_TRACE_H__
+
+#include <stdint.h>
+#include "sdk_errors.h"
+
+/**@brief Key input capture, for replaying real typing through the scanner.
+ *
+ * @details Built with GPIO_TRACE_ENABLED (make GPIO_TRACE=1). TIMER1 samples the masked port 0
+ *          input every GPIO_TRACE_PERIOD_US in its interrupt, independent of the button polling.
+ *          Runs of equal samples are queued in a RAM ring as one record and sent on RTT up buffer
+ *          GPIO_TRACE_RTT_CHANNEL from the main context, so the capture is a complete trace at
+ *          sample resolution, a few bytes per key edge.
+ *
+ *          RTT stream, little endian: a gpio_trace_header_t, then gpio_trace_record_t records
+ *          in order. A record with pins GPIO_TRACE_GAP counts samples lost because the ring was
+ *          full. The capture starts at boot and continues until the device sleeps.
+ *
+ *          test/gpio_trace.py converts a saved stream to a trace, which test/bench_gpio_trace.c
+ *          replays through poll_buttons().
+ */
+
+#ifndef GPIO_TRACE_ENABLED
+#define GPIO_TRACE_ENABLED              0
+#endif
+
+#define GPIO_TRACE_MAGIC                0x43525447                          /**< "GTRC". */
+#define GPIO_TRACE_PERIOD_US            1000
+#define GPIO_TRACE_RING_SIZE            256                                 /**< Records, a power of two. */
+#define GPIO_TRACE_RTT_CHANNEL          1
+#define GPIO_TRACE_RTT_BUF_SIZE         1024
+#define GPIO_TRACE_GAP                  0xFFFFFFFF                          /**< Pins of a record of lost samples. */
+
+/**@brief Start of the RTT stream. */
+typedef struct
+{
+    uint32_t magic;                                                 /**< GPIO_TRACE_MAGIC. */
+    uint32_t period_us;                                             /**< Sample period. */
+    uint32_t pin_mask;                                              /**< Port 0 pins sampled, a set bit per pin. */
+} gpio_trace_header_t;
+
+/**@brief Run of equal samples. */
+typedef struct
+{
+    uint32_t pins;                                                  /**< Masked NRF_P0->IN, or GPIO_TRACE_GAP. */
+    uint32_t samples;                                               /**< Run length. */
+} gpio_trace_record_t;
+
+/**@brief Function for starting the capture.
+ *
+ * @param[in]   pin_mask  Port 0 pins to sample, a set bit per pin.
+ */
+ret_code_t gpio_trace_init(uint32_t pin_mask);
+
+/**@brief Function for sending the queued records over RTT. Call periodically.
+ */
+void gpio_trace_process(void);
+
+#endif // GPIO_TRACE_H__
@@ -0,0 +1,273 @@
+#include "sdk_common.h"
+#include "host_slots.h"
+#include <string.h>
+#include "fds.h"
+#include "fds_maint.h"
+#include "nrf_log.h"
+
+/**@brief Slot table, also the layout of the FDS record. */
+typedef struct
+{
+    uint8_t      current;
+    uint8_t      reserved;
+    pm_peer_id_t peers[HOST_SLOT_COUNT];
+} host_slots_data_t;
+
+static host_slots_data_t m_slots;                       /**< Source of the FDS record, must stay valid while a write is queued. */
+static fds_record_desc_t m_desc;
+static bool              m_stored;                      /**< m_desc refers to the stored record. */
+static bool              m_loaded;
+static bool              m_save_pending;                /**< A save could not be queued and is retried on the next FDS event. */
+
+static void slots_save(void)
+{
+    ret_code_t   err_code;
+    fds_record_t record;
+
+    record.file_id           = HOST_SLOTS_FILE_ID;
+    record.key               = HOST_SLOTS_RECORD_KEY;
+    record.data.p_data       = &m_slots;
+    record.data.length_words = BYTES_TO_WORDS(sizeof(m_slots));
+
+    if (m_stored)
+    {
+        err_code = fds_record_update(&m_desc, &record);
+    }
+    else
+    {
+        err_code = fds_record_write(&m_desc, &record);
+    }
+
+    m_save_pending = (err_code != NRF_SUCCESS);
+
+    if (err_code == NRF_SUCCESS)
+    {
+        m_stored = true;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH)
+    {
+        fds_maint_gc_request();
+    }
+    else if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES)
+    {
+        NRF_LOG_WARNING("Host slots save failed: %x", err_code);
+    }
+}
+
+static void slots_load(void)
+{
+    fds_find_token_t   token;
+    fds_flash_record_t record;
+
+    memset(&token, 0, sizeof(token));
+
+    if ((fds_record_find(HOST_SLOTS_FILE_ID, HOST_SLOTS_RECORD_KEY, &m_desc, &token) == NRF_SUCCESS)
+        && (fds_record_open(&m_desc, &record) == NRF_SUCCESS))
+    {
+        host_slots_data_t const * p_data = record.p_data;
+
+        if ((record.p_header->length_words == BYTES_TO_WORDS(sizeof(m_slots)))
+            && (p_data->current < HOST_SLOT_COUNT))
+        {
+            memcpy(&m_slots, p_data, sizeof(m_slots));
+        }
+        UNUSED_RETURN_VALUE(fds_record_close(&m_desc));
+        m_stored = true;
+    }
+
+    m_loaded = true;
+    NRF_LOG_INFO("Host slot %d", m_slots.current + 1);
+}
+
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    if (p_evt->id == FDS_EVT_INIT)
+    {
+        if (p_evt->result == NRF_SUCCESS)
+        {
+            slots_load();
+        }
+        return;
+    }
+
+    // Any completed operation frees queue space, and a GC frees flash.
+    if (m_save_pending)
+    {
+        slots_save();
+    }
+}
+
+static bool peer_in_slots(pm_peer_id_t peer_id)
+{
+    for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++)
+    {
+        if (m_slots.peers[i] == peer_id)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool peer_connected(pm_peer_id_t peer_id)
+{
+    uint16_t conn_handle;
+
+    return (peer_id != PM_PEER_ID_INVALID)
+           && (pm_conn_handle_get(peer_id, &conn_handle) == NRF_SUCCESS)
+           && (conn_handle != BLE_CONN_HANDLE_INVALID);
+}
+
+/**@brief Function for choosing the slot of a new bond.
+ *
+ * @details The current slot, unless its host is connected on another link. Then the first empty
+ *          slot, or the first whose host is not connected.
+ */
+static uint8_t new_bond_slot(void)
+{
+    if (!peer_connected(m_slots.peers[m_slots.current]))
+    {
+        return m_slots.current;
+    }
+    for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++)
+    {
+        if (m_slots.peers[i] == PM_PEER_ID_INVALID)
+        {
+            return i;
+        }
+    }
+    for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++)
+    {
+        if (!peer_connected(m_slots.peers[i]))
+        {
+            return i;
+        }
+    }
+    return m_slots.current;
+}
+
+ret_code_t host_slots_init(void)
+{
+    m_slots.current = 0;
+    for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++)
+    {
+        m_slots.peers[i] = PM_PEER_ID_INVALID;
+    }
+    m_stored       = false;
+    m_loaded       = false;
+    m_save_pending = false;
+
+    return fds_register(fds_evt_handler);
+}
+
+void host_slots_prune(void)
+{
+    if (!m_loaded)
+    {
+        // Without the slot table every bond would look orphaned.
+        return;
+    }
+
+    pm_peer_id_t peer_id = pm_next_peer_id_get(PM_PEER_ID_INVALID);
+    while (peer_id != PM_PEER_ID_INVALID)
+    {
+        if (!peer_in_slots(peer_id))
+        {
+            NRF_LOG_INFO("Deleting bond %d, not in a host slot", peer_id);
+            UNUSED_RETURN_VALUE(pm_peer_delete(peer_id));
+        }
+        peer_id = pm_next_peer_id_get(peer_id);
+    }
+}
+
+uint8_t host_slots_current(void)
+{
+    return m_slots.current;
+}
+
+pm_peer_id_t host_slots_current_peer(void)
+{
+    return m_slots.peers[m_slots.current];
+}
+
+pm_peer_id_t host_slots_peer(uint8_t slot)
+{
+    return (slot < HOST_SLOT_COUNT) ? m_slots.peers[slot] : PM_PEER_ID_INVALID;
+}
+
+ret_code_t host_slots_select(uint8_t slot)
+{
+    if (slot >= HOST_SLOT_COUNT)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (slot != m_slots.current)
+    {
+        m_slots.current = slot;
+        slots_save();
+    }
+    return NRF_SUCCESS;
+}
+
+void host_slots_on_conn_secured(pm_peer_id_t peer_id, bool new_bond)
+{
+    pm_peer_id_t old_peer;
+
+    if (peer_id == m_slots.peers[m_slots.current])
+    {
+        return;
+    }
+
+    if (!new_bond)
+    {
+        for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++)
+        {
+            if (m_slots.peers[i] == peer_id)
+            {
+                m_slots.current = i;
+                slots_save();
+                return;
+            }
+        }
+    }
+
+    // A host connected on another link keeps its slot.
+    m_slots.current = new_bond_slot();
+    old_peer        = m_slots.peers[m_slots.current];
+
+    // Re-pairing a host that is in another slot moves it here.
+    for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++)
+    {
+        if (m_slots.peers[i] == peer_id)
+        {
+            m_slots.peers[i] = PM_PEER_ID_INVALID;
+        }
+    }
+
+    m_slots.peers[m_slots.current] = peer_id;
+    slots_save();
+
+    if ((old_peer != PM_PEER_ID_INVALID) && !peer_in_slots(old_peer))
+    {
+        NRF_LOG_INFO("Replacing bond %d in host slot %d", old_peer, m_slots.current + 1);
+        UNUSED_RETURN_VALUE(pm_peer_delete(old_peer));
+    }
+}
+
+void host_slots_on_peer_deleted(pm_peer_id_t peer_id)
+{
+    bool changed = false;
+
+    for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++)
+    {
+        if (m_slots.peers[i] == peer_id)
+        {
+            m_slots.peers[i] = PM_PEER_ID_INVALID;
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        slots_save();
+    }
+}
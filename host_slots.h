@@ -0,0 +1,66 @@
+#ifndef HOST_SLOTS_H__
+#define HOST_SLOTS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "peer_manager.h"
+
+/**@brief Numbered host slots.
+ *
+ * @details Each slot holds the bond of one host (for example the cockpit tablet and the phone).
+ *          Only the host of the current slot is advertised to, first with directed advertising and
+ *          then through the whitelist, so switching slots reconnects without re-pairing. A new bond
+ *          replaces the bond of the current slot, and bonds that are in no slot are deleted. The
+ *          slot table is kept in FDS.
+ */
+
+#define HOST_SLOT_COUNT                 3
+#define HOST_SLOTS_FILE_ID              0x1001
+#define HOST_SLOTS_RECORD_KEY           0x0001
+
+/**@brief Function for initializing the host slots. Must be called before fds_init().
+ */
+ret_code_t host_slots_init(void);
+
+/**@brief Function for deleting bonds that do not belong to any slot. Call after pm_init().
+ */
+void host_slots_prune(void);
+
+/**@brief Function for getting the current slot.
+ */
+uint8_t host_slots_current(void);
+
+/**@brief Function for getting the peer bonded in the current slot.
+ *
+ * @return PM_PEER_ID_INVALID if the slot is empty.
+ */
+pm_peer_id_t host_slots_current_peer(void);
+
+/**@brief Function for getting the peer bonded in a slot.
+ *
+ * @return PM_PEER_ID_INVALID if the slot is empty or does not exist.
+ */
+pm_peer_id_t host_slots_peer(uint8_t slot);
+
+/**@brief Function for switching to a slot.
+ *
+ * @return NRF_ERROR_INVALID_PARAM if the slot does not exist.
+ */
+ret_code_t host_slots_select(uint8_t slot);
+
+/**@brief Function for handling a secured connection.
+ *
+ * @details A new bond is stored in the current slot, or in a free slot if the current slot's host
+ *          is connected on another link. A host bonded in another slot makes its slot current.
+ *
+ * @param[in]   peer_id   Peer of the connection.
+ * @param[in]   new_bond  true if the peer was bonded by this connection.
+ */
+void host_slots_on_conn_secured(pm_peer_id_t peer_id, bool new_bond);
+
+/**@brief Function for clearing the slot of a peer whose bond was deleted.
+ */
+void host_slots_on_peer_deleted(pm_peer_id_t peer_id);
+
+#endif // HOST_SLOTS_H__
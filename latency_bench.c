@@ -0,0 +1,237 @@
+#include "sdk_common.h"
+#include "latency_bench.h"
+
+#if LATENCY_BENCH_ENABLED
+
+#include "app_timer.h"
+#include "SEGGER_RTT.h"
+#include "nrf_log.h"
+
+#define RING_MASK           (LATENCY_BENCH_RING_SIZE - 1)
+#define START_US            100000                              /**< First press after the run command. */
+#define TAIL_US             1000000                             /**< Time the last chord has to reach the air. */
+#define CHORD_OF(seq)       (((seq) % CHORD_COUNT) + 1)
+
+STATIC_ASSERT((LATENCY_BENCH_RING_SIZE & RING_MASK) == 0);
+STATIC_ASSERT(LATENCY_BENCH_HOLD_US + 2 * LATENCY_BENCH_BOUNCE_US < LATENCY_BENCH_PERIOD_US);
+
+static latency_bench_record_t m_ring[LATENCY_BENCH_RING_SIZE];
+static uint32_t               m_head;
+static uint32_t               m_tail;
+static uint8_t                m_rtt_up_buf[LATENCY_BENCH_RTT_BUF_SIZE];
+static uint8_t                m_rtt_down_buf[16];
+
+static bool                   m_running;
+static bool                   m_header_pending;
+static uint16_t               m_conn_interval;
+static uint32_t               m_last_cnt;
+static uint64_t               m_ticks;                          /**< RTC ticks since the run started. */
+
+static uint16_t               m_edge_seq;                       /**< Chords released so far. */
+static uint16_t               m_debounced_seq;
+static uint16_t               m_hvx_seq;
+static uint16_t               m_air_seq;
+static uint32_t               m_hvx_count;                      /**< Notifications taken, chords and text. */
+static uint32_t               m_air_count;                      /**< Notifications acknowledged. */
+static uint32_t               m_chord_hvx[LATENCY_BENCH_CHORDS]; /**< Notification number of each chord. */
+
+/**@brief Function for getting the time since the run started, at RTC resolution.
+ *
+ * @details Must be called at least once per RTC overflow, latency_bench_process() does.
+ */
+static uint32_t now_us(void)
+{
+    uint32_t cnt = app_timer_cnt_get();
+
+    m_ticks   += app_timer_cnt_diff_compute(cnt, m_last_cnt);
+    m_last_cnt = cnt;
+    return (uint32_t)((m_ticks * 1000000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1)) / APP_TIMER_CLOCK_FREQ);
+}
+
+static uint32_t press_us(uint16_t seq)
+{
+    return START_US + (uint32_t)seq * LATENCY_BENCH_PERIOD_US;
+}
+
+static void record_put(latency_bench_mark_t mark, uint16_t seq, uint32_t time_us)
+{
+    latency_bench_record_t * p_record;
+
+    if (m_head - m_tail == LATENCY_BENCH_RING_SIZE)
+    {
+        NRF_LOG_WARNING("Latency record dropped");
+        return;
+    }
+    p_record          = &m_ring[m_head & RING_MASK];
+    p_record->seq     = seq;
+    p_record->mark    = mark;
+    p_record->chord   = CHORD_OF(seq);
+    p_record->time_us = time_us;
+    m_head++;
+}
+
+static void run_start(void)
+{
+    m_ticks          = 0;
+    m_last_cnt       = app_timer_cnt_get();
+    m_edge_seq       = 0;
+    m_debounced_seq  = 0;
+    m_hvx_seq        = 0;
+    m_air_seq        = 0;
+    m_hvx_count      = 0;
+    m_air_count      = 0;
+    m_header_pending = true;
+    m_running        = true;
+}
+
+ret_code_t latency_bench_init(void)
+{
+    if ((SEGGER_RTT_ConfigUpBuffer(LATENCY_BENCH_RTT_CHANNEL, "latency", m_rtt_up_buf, sizeof(m_rtt_up_buf),
+                                   SEGGER_RTT_MODE_NO_BLOCK_SKIP) < 0) ||
+        (SEGGER_RTT_ConfigDownBuffer(LATENCY_BENCH_RTT_CHANNEL, "latency", m_rtt_down_buf, sizeof(m_rtt_down_buf),
+                                     SEGGER_RTT_MODE_NO_BLOCK_SKIP) < 0))
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+    return NRF_SUCCESS;
+}
+
+bool latency_bench_reading(uint8_t * p_reading)
+{
+    uint32_t t;
+    uint32_t d;
+    uint16_t seq;
+
+    if (!m_running)
+    {
+        return false;
+    }
+
+    *p_reading = 0;
+    t          = now_us();
+    if (t < START_US)
+    {
+        return true;
+    }
+    seq = (t - START_US) / LATENCY_BENCH_PERIOD_US;
+    if (seq >= LATENCY_BENCH_CHORDS)
+    {
+        return true;
+    }
+    d = t - press_us(seq);
+
+    // Closed first when pressing, open first when releasing, LATENCY_BENCH_BOUNCE_STEP_US apart.
+    if (d < LATENCY_BENCH_BOUNCE_US)
+    {
+        *p_reading = ((d / LATENCY_BENCH_BOUNCE_STEP_US) % 2 == 0) ? CHORD_OF(seq) : 0;
+    }
+    else if (d < LATENCY_BENCH_HOLD_US)
+    {
+        *p_reading = CHORD_OF(seq);
+    }
+    else
+    {
+        d -= LATENCY_BENCH_HOLD_US;
+        if (d < LATENCY_BENCH_BOUNCE_US)
+        {
+            *p_reading = ((d / LATENCY_BENCH_BOUNCE_STEP_US) % 2 == 0) ? 0 : CHORD_OF(seq);
+        }
+        // The edge is the first opening, seen by the first poll after it.
+        if (m_edge_seq == seq)
+        {
+            record_put(LATENCY_BENCH_MARK_EDGE, seq, press_us(seq) + LATENCY_BENCH_HOLD_US);
+            m_edge_seq++;
+        }
+    }
+    return true;
+}
+
+void latency_bench_debounced(void)
+{
+    if (m_running && (m_debounced_seq < m_edge_seq))
+    {
+        record_put(LATENCY_BENCH_MARK_DEBOUNCED, m_debounced_seq, now_us());
+        m_debounced_seq++;
+    }
+}
+
+void latency_bench_hvx(bool chord)
+{
+    if (!m_running)
+    {
+        return;
+    }
+    if (chord && (m_hvx_seq < m_debounced_seq))
+    {
+        m_chord_hvx[m_hvx_seq] = m_hvx_count;
+        record_put(LATENCY_BENCH_MARK_HVX, m_hvx_seq, now_us());
+        m_hvx_seq++;
+    }
+    m_hvx_count++;
+}
+
+void latency_bench_tx_complete(uint8_t count)
+{
+    if (!m_running)
+    {
+        return;
+    }
+    m_air_count += count;
+    while ((m_air_seq < m_hvx_seq) && (m_chord_hvx[m_air_seq] < m_air_count))
+    {
+        record_put(LATENCY_BENCH_MARK_AIR, m_air_seq, now_us());
+        m_air_seq++;
+    }
+}
+
+void latency_bench_conn_interval_set(uint16_t conn_interval)
+{
+    m_conn_interval = conn_interval;
+}
+
+void latency_bench_process(uint16_t debounce_ms, uint16_t scan_interval_ms)
+{
+    char cmd;
+
+    if (!m_running && (SEGGER_RTT_Read(LATENCY_BENCH_RTT_CHANNEL, &cmd, 1) == 1) && (cmd == LATENCY_BENCH_CMD_RUN))
+    {
+        NRF_LOG_INFO("Latency run started");
+        run_start();
+    }
+
+    if (m_running && (now_us() >= press_us(LATENCY_BENCH_CHORDS) + TAIL_US))
+    {
+        record_put(LATENCY_BENCH_MARK_END, m_edge_seq, now_us());
+        m_running = false;
+    }
+
+    // Skip mode writes all or nothing, what does not fit is retried on the next call.
+    if (m_header_pending)
+    {
+        latency_bench_header_t header =
+        {
+            .magic            = LATENCY_BENCH_MAGIC,
+            .debounce_ms      = debounce_ms,
+            .scan_interval_ms = scan_interval_ms,
+            .conn_interval    = m_conn_interval,
+            .chords           = LATENCY_BENCH_CHORDS
+        };
+
+        if (SEGGER_RTT_Write(LATENCY_BENCH_RTT_CHANNEL, &header, sizeof(header)) == 0)
+        {
+            return;
+        }
+        m_header_pending = false;
+    }
+
+    while (m_tail != m_head)
+    {
+        if (SEGGER_RTT_Write(LATENCY_BENCH_RTT_CHANNEL, &m_ring[m_tail & RING_MASK], sizeof(latency_bench_record_t)) == 0)
+        {
+            return;
+        }
+        m_tail++;
+    }
+}
+
+#endif // LATENCY_BENCH_ENABLED
@@ -0,0 +1,110 @@
+#ifndef LATENCY_BENCH_H__
+#define LATENCY_BENCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "chord_keys.h"
+
+/**@brief Input-to-air latency benchmark, run by armgcc/latency.py.
+ *
+ * @details Built with LATENCY_BENCH_ENABLED (make LATENCY_BENCH=1). A run replaces the key pins
+ *          with a scripted stand-in: LATENCY_BENCH_CHORDS chords, each held for
+ *          LATENCY_BENCH_HOLD_US with LATENCY_BENCH_BOUNCE_US of contact bounce on both edges,
+ *          one every LATENCY_BENCH_PERIOD_US. The period is not a multiple of any scan interval,
+ *          so the release edges fall at every phase of the polling.
+ *
+ *          Each chord is timestamped at its release edge, when the scanner accepts it, when the
+ *          SoftDevice takes the notification and when the central acknowledges it. With one
+ *          central connected the stages happen in chord order, which is how marks are matched to
+ *          chords.
+ *
+ *          A run starts when LATENCY_BENCH_CMD_RUN arrives on RTT down buffer
+ *          LATENCY_BENCH_RTT_CHANNEL. The up buffer of the same channel carries, little endian,
+ *          a latency_bench_header_t and then latency_bench_record_t records, ending with a
+ *          LATENCY_BENCH_MARK_END record.
+ */
+
+#ifndef LATENCY_BENCH_ENABLED
+#define LATENCY_BENCH_ENABLED           0
+#endif
+
+#define LATENCY_BENCH_MAGIC             0x434E424C                          /**< "LBNC". */
+#define LATENCY_BENCH_RTT_CHANNEL       2
+#define LATENCY_BENCH_RTT_BUF_SIZE      1024
+#define LATENCY_BENCH_RING_SIZE         64                                  /**< Records, a power of two. */
+#define LATENCY_BENCH_CMD_RUN           'r'
+
+#define LATENCY_BENCH_CHORDS            (2 * CHORD_COUNT)                   /**< Chords per run, every chord twice. */
+#define LATENCY_BENCH_PERIOD_US         293000
+#define LATENCY_BENCH_HOLD_US           80000
+#define LATENCY_BENCH_BOUNCE_US         2000
+#define LATENCY_BENCH_BOUNCE_STEP_US    500                                 /**< Contacts open and close this often while bouncing. */
+
+/**@brief Stages of a chord. */
+typedef enum
+{
+    LATENCY_BENCH_MARK_EDGE,                                        /**< Last key released, by the script. */
+    LATENCY_BENCH_MARK_DEBOUNCED,                                   /**< Chord accepted by the scanner. */
+    LATENCY_BENCH_MARK_HVX,                                         /**< Notification taken by the SoftDevice. */
+    LATENCY_BENCH_MARK_AIR,                                         /**< Notification acknowledged by the central. */
+    LATENCY_BENCH_MARK_END,                                         /**< Run finished, seq is the chord count. */
+} latency_bench_mark_t;
+
+/**@brief Start of a run, with the settings it ran at. */
+typedef struct
+{
+    uint32_t magic;                                                 /**< LATENCY_BENCH_MAGIC. */
+    uint16_t debounce_ms;
+    uint16_t scan_interval_ms;
+    uint16_t conn_interval;                                         /**< In use, 1.25 ms units, 0 if not connected. */
+    uint16_t chords;
+} latency_bench_header_t;
+
+/**@brief Stage of one chord. */
+typedef struct
+{
+    uint16_t seq;                                                   /**< Chord number in the run. */
+    uint8_t  mark;                                                  /**< latency_bench_mark_t. */
+    uint8_t  chord;
+    uint32_t time_us;                                               /**< Since the start of the run. */
+} latency_bench_record_t;
+
+/**@brief Function for setting up the RTT buffers.
+ */
+ret_code_t latency_bench_init(void);
+
+/**@brief Function for getting the scripted key reading while a run is active.
+ *
+ * @param[out]  p_reading  Keys down, a set bit per key.
+ *
+ * @return true if a run replaces the key pins.
+ */
+bool latency_bench_reading(uint8_t * p_reading);
+
+/**@brief Function for marking that the scanner accepted a chord. */
+void latency_bench_debounced(void);
+
+/**@brief Function for marking that the SoftDevice took a notification.
+ *
+ * @param[in]   chord  The notification is a chord, rather than text.
+ */
+void latency_bench_hvx(bool chord);
+
+/**@brief Function for marking notifications acknowledged by the central.
+ *
+ * @param[in]   count  Notifications completed, BLE_GATTS_EVT_HVN_TX_COMPLETE.
+ */
+void latency_bench_tx_complete(uint8_t count);
+
+/**@brief Function for recording the connection interval in use, for the run header. */
+void latency_bench_conn_interval_set(uint16_t conn_interval);
+
+/**@brief Function for handling commands and sending records over RTT. Call periodically.
+ *
+ * @param[in]   debounce_ms       Debounce time in use.
+ * @param[in]   scan_interval_ms  Scan interval while typing.
+ */
+void latency_bench_process(uint16_t debounce_ms, uint16_t scan_interval_ms);
+
+#endif // LATENCY_BENCH_H__
@@ -73,43 +73,60 @@
 #include "fds.h"
 #include "ble_conn_state.h"
 #include "ble_dis.h"
-#include "sensorsim.h"
 #include "nrf_ble_bms.h"
 #include "nrf_ble_gatt.h"
 #include "nrf_ble_qwr.h"
 #include "nrf_pwr_mgmt.h"
 #include "nrf_gpio.h"
 #include "nrf_drv_power.h"
-#include "nrf_drv_uart.h"
+#include "nrf_power.h"
+#include "nrf_gpiote.h"
 #include "nrf_delay.h"
+#include "board_pins.h"
 
 #include "nrf_log.h"
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 #include "ble_chord.h"
+#include "ble_bulk.h"
+#include "chord_log.h"
+#include "chord_stats.h"
+#include "fds_maint.h"
+#include "host_slots.h"
+#include "chord_calc.h"
+#include "flash_blob.h"
+#include "text_dict.h"
+#include "phrase_predict.h"
+#include "gpio_trace.h"
+#include "app_params.h"
+#include "ble_config.h"
+#include "transport.h"
+#include "usb_chord.h"
+#include "latency_bench.h"
+#include "chord_engine.h"
+#include "chord_keys.h"
 
 #define DEVICE_NAME                     "Chorded Keys"                       /**< Name of device. Will be included in the advertising data. */
 #define MANUFACTURER_NAME               "NordicSemiconductor"                   /**< Manufacturer. Will be passed to Device Information Service. */
-#define APP_ADV_INTERVAL                300                                     /**< The advertising interval (in units of 0.625 ms. This value corresponds to 187.5 ms). */
-
 #define APP_ADV_DURATION                18000                                   /**< The advertising duration (180 seconds) in units of 10 milliseconds. */
 #define APP_BLE_OBSERVER_PRIO           3                                       /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 #define APP_BLE_CONN_CFG_TAG            1                                       /**< A tag identifying the SoftDevice BLE configuration. */
 
-#define MIN_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)        /**< Minimum acceptable connection interval (0.1 seconds). */
-#define MAX_CONN_INTERVAL               MSEC_TO_UNITS(200, UNIT_1_25_MS)        /**< Maximum acceptable connection interval (0.2 second). */
-#define SLAVE_LATENCY                   0                                       /**< Slave latency. */
-#define CONN_SUP_TIMEOUT                MSEC_TO_UNITS(4000, UNIT_10_MS)         /**< Connection supervisory timeout (4 seconds). */
-
 #define FIRST_CONN_PARAMS_UPDATE_DELAY  APP_TIMER_TICKS(1000)                   /**< Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (5 seconds). */
 #define NEXT_CONN_PARAMS_UPDATE_DELAY   APP_TIMER_TICKS(10000)                  /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
 #define MAX_CONN_PARAMS_UPDATE_COUNT    3                                       /**< Number of attempts before giving up the connection parameter negotiation. */
 
-#define LED_BLINK_ADVERTISING           APP_TIMER_TICKS(700)
-#define LED_BLINK_PAIRING               APP_TIMER_TICKS(100)
-#define INACTIVE_TIME                   APP_TIMER_TICKS(300000)                 // sleep after 5min of inactivity
+#define LED_BLINK_ADVERTISING           700                                     /**< LED toggle interval while advertising, in ms. */
+#define LED_BLINK_PAIRING               100                                     /**< LED toggle interval in pairing mode, in ms. */
+#define WAKE_CHORD_TIMEOUT              10000                                   /**< Time the chord that woke the device waits for a host, in ms. */
+
+// the advertising and connection intervals, the tick interval, the inactivity time and the pairing
+// button hold time are runtime parameters, see app_params.h
 
-#define NOTIFICATION_INTERVAL           APP_TIMER_TICKS(10)     
+#define BULK_STREAM_CHORD_LOG           0                                       /**< Bulk stream id of the chord journal. */
+#define BULK_STREAM_CHORD_STATS         1                                       /**< Bulk stream id of the chord statistics. */
+#define BULK_STREAM_TEXT_DICT           2                                       /**< Bulk stream id of the abbreviation dictionary upload. */
+#define BULK_STREAM_PHRASE_MODEL        3                                       /**< Bulk stream id of the word prediction model upload. */
 
 #define SEC_PARAM_BOND                  1                                       /**< Perform bonding. */
 #define SEC_PARAM_MITM                  0                                       /**< Man In The Middle protection not required. */
@@ -124,22 +141,20 @@
 #define DEAD_BEEF                       0xDEADBEEF                              /**< Value used as error code on stack dump, can be used to identify stack location on stack unwind. */
 #define USE_AUTHORIZATION_CODE 1
 
-#define PAIR_BTN_HOLD_TIME             40
-
-#define LED_PIN NRF_GPIO_PIN_MAP(0, 7)
+#define SYSTEM_CHORD_CALC              0x18                                     /**< Keys 4 and 5 with the power button toggle the calculator layer. */
+#define SYSTEM_CHORD_PREDICT           0x0C                                     /**< Keys 3 and 4 with the power button toggle word prediction. */
 
 NRF_BLE_BMS_DEF(m_bms);                                                         //!< Structure used to identify the Bond Management service.
 NRF_BLE_GATT_DEF(m_gatt);
-NRF_BLE_QWR_DEF(m_qwr);                                                         /**< GATT module instance. */
+NRF_BLE_QWRS_DEF(m_qwr, NRF_SDH_BLE_TOTAL_LINK_COUNT);                          /**< GATT module instance. */
 BLE_CHORD_DEF(m_chord);                                                             /**< Context for the Queued Write module.*/
+BLE_BULK_DEF(m_bulk);                                                           /**< Bulk transfer service instance. */
+BLE_CONFIG_DEF(m_config);                                                       /**< Runtime parameters service instance. */
 BLE_ADVERTISING_DEF(m_advertising);                                             /**< Advertising module instance. */
 
-APP_TIMER_DEF(m_notification_timer_id);
-APP_TIMER_DEF(m_led_blink_timer_id);
-APP_TIMER_DEF(m_inactive_timer_id);
+APP_TIMER_DEF(m_tick_timer_id);                                                 /**< The only application timer, see tick_handler(). */
 
-static uint16_t                      m_conn_handle = BLE_CONN_HANDLE_INVALID;   //!< Handle of the current connection.
-static uint8_t                       m_qwr_mem[MEM_BUFF_SIZE];                  //!< Write buffer for the Queued Write module.
+static uint8_t                       m_qwr_mem[NRF_SDH_BLE_TOTAL_LINK_COUNT][MEM_BUFF_SIZE]; //!< Write buffers for the Queued Write module, one per link.
 static ble_conn_state_user_flag_id_t m_bms_bonds_to_delete;                     //!< Flags used to identify bonds that should be deleted.
 
 static ble_uuid_t m_adv_uuids[] =                                               /**< Universally unique service identifiers. */
@@ -152,18 +167,51 @@ static uint8_t m_auth_code[] = {'A', 'B', 'C', 'D'}; //0x41, 0x42, 0x43, 0x44
 static int m_auth_code_len = sizeof(m_auth_code);
 #endif
 
+static const ble_bulk_stream_t m_chord_log_stream =                              /**< Chord journal readout over the bulk service. */
+{
+    .read = chord_log_read
+};
+
+static const ble_bulk_stream_t m_chord_stats_stream =                            /**< Chord statistics readout over the bulk service. */
+{
+    .read = chord_stats_read
+};
+
 // Chord Button Polling
 uint8_t prev_reading;
 uint8_t debounced_reading;
-uint8_t chord;
-static int btn_pins[] = { 4, 5, 30, 28, 2, 6, 3 };
+static const uint32_t key_pins[] = KEY_PINS;
+STATIC_ASSERT(ARRAY_SIZE(key_pins) >= CHORD_KEY_COUNT);
 bool pwr_btn_prev, pwr_btn_debounced;
-
-int pair_btn_hold_count;
-
-// a device connected and subscribed to updates
+bool pwr_btn_consumed;
+static bool system_keys;              // keys and the power button were down together, the chords are system chords
+static uint32_t key_change_time;      // last change of the raw key reading
+static uint32_t pwr_btn_change_time;
+static uint32_t pwr_btn_press_time;
+
+// the scan rate, fast while typing and slow when idle, see scan_rate_set()
+static bool scan_fast;
+static uint32_t last_key_time;        // last poll with any key down
+
+// the chord that woke the device from system off, typed before any host is back
+static bool wake_capture;             // LATCH holds the keys pressed since waking until the first poll
+static bool wake_held;                // the next chord completed is the wake chord
+static uint8_t wake_chord;            // waiting for a host, 0 if none
+static uint32_t wake_chord_time;
+
+// any connected device subscribed to updates
 bool device_connected;
 bool pairing_mode;
+// chords go to the on-device calculator instead of the host
+static bool calc_active;
+
+// timeouts, checked on each tick against timestamps rather than run as timers
+static uint32_t led_blink_interval;   // 0 while the LED is steady
+static uint32_t led_toggle_time;
+static bool inactive_armed;           // sleeping on inactivity starts with the first connection
+static bool sleep_pwr_btn_only;       // the power button put the device to sleep, only it wakes it
+static uint32_t last_activity_time;
+static bool tick_started;
 
 /**@brief Callback function for asserts in the SoftDevice.
  *
@@ -182,15 +230,103 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
 }
 
 
-/**@brief Function for starting advertising.
+/**@brief Function for setting the whitelist.
+ *
+ * @details Without a connection only the host of the current slot is allowed. While hosts are
+ *          connected, the hosts of the other slots are allowed to join them.
+ *
+ * @return Number of hosts in the whitelist.
+ */
+static uint32_t whitelist_set(void)
+{
+	ret_code_t err_code;
+	pm_peer_id_t peers[HOST_SLOT_COUNT];
+	uint32_t peer_cnt = 0;
+
+	if (ble_conn_state_peripheral_conn_count() == 0) {
+		if (host_slots_current_peer() != PM_PEER_ID_INVALID) {
+			peers[peer_cnt++] = host_slots_current_peer();
+		}
+	}
+	else {
+		for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++) {
+			pm_peer_id_t peer_id = host_slots_peer(i);
+			uint16_t conn_handle;
+
+			if ((peer_id != PM_PEER_ID_INVALID)
+			    && (pm_conn_handle_get(peer_id, &conn_handle) == NRF_SUCCESS)
+			    && (conn_handle == BLE_CONN_HANDLE_INVALID)) {
+				peers[peer_cnt++] = peer_id;
+			}
+		}
+	}
+
+	err_code = pm_whitelist_set(peer_cnt ? peers : NULL, peer_cnt);
+	if (err_code == NRF_ERROR_NOT_FOUND) {
+		// bond deleted behind the slot's back, advertise openly
+		peer_cnt = 0;
+		err_code = pm_whitelist_set(NULL, 0);
+	}
+	APP_ERROR_CHECK(err_code);
+
+	err_code = pm_device_identities_list_set(peer_cnt ? peers : NULL, peer_cnt);
+	if (err_code != NRF_ERROR_NOT_SUPPORTED) {
+		APP_ERROR_CHECK(err_code);
+	}
+	return peer_cnt;
+}
+
+
+/**@brief Function for blinking the LED, toggled by tick_handler().
+ */
+static void led_blink_start(uint32_t interval_ms) {
+	if (interval_ms != led_blink_interval) {
+		led_blink_interval = interval_ms;
+		led_toggle_time = 0;
+	}
+}
+
+static void led_blink_stop(void) {
+	led_blink_interval = 0;
+}
+
+
+/**@brief Function for starting advertising, or restarting it with the current slot and links.
+ *
+ * @details Advertises directly to the host of the current slot first, which reconnects within
+ *          milliseconds, then falls back to whitelisted fast advertising. While a link is free,
+ *          advertising continues so the hosts of other slots can connect at the same time.
  */
 static void advertising_start()
 {
-	ret_code_t err_code = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
+	ble_adv_mode_t mode = BLE_ADV_MODE_FAST;
+	uint32_t links = ble_conn_state_peripheral_conn_count();
+	ret_code_t err_code;
+
+	// the whitelist cannot change while it is in use
+	err_code = sd_ble_gap_adv_stop(m_advertising.adv_handle);
+	if ((err_code != NRF_ERROR_INVALID_STATE) && (err_code != BLE_ERROR_INVALID_ADV_HANDLE)) {
+		APP_ERROR_CHECK(err_code);
+	}
+
+	if (links >= NRF_SDH_BLE_PERIPHERAL_LINK_COUNT) {
+		return;
+	}
+	if ((whitelist_set() == 0) && (links > 0) && !pairing_mode) {
+		// no other host to wait for, and an empty whitelist would let anyone in
+		return;
+	}
+	if ((links == 0) && (host_slots_current_peer() != PM_PEER_ID_INVALID) && !pairing_mode) {
+		mode = BLE_ADV_MODE_DIRECTED_HIGH_DUTY;
+	}
+
+	err_code = ble_advertising_start(&m_advertising, mode);
 	APP_ERROR_CHECK(err_code);
 
-	// start flashing the LED
-	app_timer_start(m_led_blink_timer_id, LED_BLINK_ADVERTISING, NULL);
+	// start flashing the LED, it stays on while a host is connected
+	if (links == 0) {
+		led_blink_start(LED_BLINK_ADVERTISING);
+	}
 }
 
 
@@ -201,8 +337,6 @@ static void advertising_start()
  */
 static void pm_evt_handler(pm_evt_t const * p_evt)
 {
-    ret_code_t err_code;
-
     switch (p_evt->evt_id)
     {
         case PM_EVT_BONDED_PEER_CONNECTED:
@@ -216,6 +350,14 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
                          ble_conn_state_role(p_evt->conn_handle),
                          p_evt->conn_handle,
                          p_evt->params.conn_sec_succeeded.procedure);
+            host_slots_on_conn_secured(p_evt->peer_id,
+                                       p_evt->params.conn_sec_succeeded.procedure == PM_CONN_SEC_PROCEDURE_BONDING);
+
+            // one new host per pairing, advertising for a free link goes back to the whitelist
+            if (pairing_mode && (p_evt->params.conn_sec_succeeded.procedure == PM_CONN_SEC_PROCEDURE_BONDING)) {
+                pairing_mode = false;
+                advertising_start();
+            }
         } break;
 
         case PM_EVT_CONN_SEC_FAILED:
@@ -237,16 +379,8 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
 
         case PM_EVT_STORAGE_FULL:
         {
-            // Run garbage collection on the flash.
-            err_code = fds_gc();
-            if (err_code == FDS_ERR_NO_SPACE_IN_QUEUES)
-            {
-                // Retry.
-            }
-            else
-            {
-                APP_ERROR_CHECK(err_code);
-            }
+            // Garbage collection blocks the radio, run it when typing pauses.
+            fds_maint_gc_request();
         } break;
 
         case PM_EVT_PEERS_DELETE_SUCCEEDED:
@@ -278,9 +412,13 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
             APP_ERROR_CHECK(p_evt->params.error_unexpected.error);
         } break;
 
+        case PM_EVT_PEER_DELETE_SUCCEEDED:
+        {
+            host_slots_on_peer_deleted(p_evt->peer_id);
+        } break;
+
         case PM_EVT_CONN_SEC_START:
         case PM_EVT_PEER_DATA_UPDATE_SUCCEEDED:
-	    case PM_EVT_PEER_DELETE_SUCCEEDED:
         case PM_EVT_LOCAL_DB_CACHE_APPLIED:
         case PM_EVT_LOCAL_DB_CACHE_APPLY_FAILED:
             // This can happen when the local DB has changed.
@@ -291,21 +429,24 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
     }
 }
 
-static void inactive_timeout_handler(void * p_context)
+/**@brief Function for entering system off, waking on any key, or only on the power button if
+ *        it was what put the device to sleep.
+ */
+static void inactive_sleep(void)
 {
     ret_code_t err_code;
-	
-    UNUSED_PARAMETER(p_context);
 
-	NRF_LOG_INFO("Entering sleep from inactivity");
-
-	for (int i = 0; i < 7; i++) {
-		nrf_gpio_cfg_sense_input(btn_pins[i], NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
+	for (int i = 0; i < CHORD_KEY_COUNT; i++) {
+		if (sleep_pwr_btn_only) {
+			nrf_gpio_cfg_input(key_pins[i], NRF_GPIO_PIN_PULLUP);
+		} else {
+			nrf_gpio_cfg_sense_input(key_pins[i], NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
+		}
 	}
+	nrf_gpio_cfg_sense_input(PWR_BTN_PIN, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
 
-	err_code = app_timer_stop(m_led_blink_timer_id);
-	APP_ERROR_CHECK(err_code);
-	nrf_gpio_pin_clear(LED_PIN);
+	led_blink_stop();
+	nrf_gpio_pin_write(LED_PIN, !LED_ON_LEVEL);
 
     // Go to system-off mode (this function will not return; wakeup will cause a reset).
     err_code = sd_power_system_off();
@@ -313,62 +454,363 @@ static void inactive_timeout_handler(void * p_context)
     
 }
 
-void update_inactive_timer() {
-    ret_code_t err_code;
-	
-	err_code = app_timer_stop(m_inactive_timer_id);
-    APP_ERROR_CHECK(err_code);
+/**@brief Function for writing out what is buffered and going to sleep.
+ *
+ * @param[in]   pwr_btn_only   Only the power button wakes the device.
+ */
+static void sleep_enter(bool pwr_btn_only)
+{
+	sleep_pwr_btn_only = pwr_btn_only;
 
-	err_code = app_timer_start(m_inactive_timer_id, INACTIVE_TIME, NULL);
-	APP_ERROR_CHECK(err_code);
+	// the idle flush has normally written everything already
+	chord_log_flush();
+	chord_stats_flush();
+
+	// collect flash garbage now rather than while typing after wake up, sleep
+	// resumes in inactive_sleep() once it and the writes queued above are done
+	if (fds_maint_sleep_prepare()) {
+		return;
+	}
+	inactive_sleep();
+}
+
+/**@brief Function for going to sleep after APP_PARAM_INACTIVE_TIME without key activity.
+ */
+static void inactive_timeout(void)
+{
+	NRF_LOG_INFO("Entering sleep from inactivity");
+	sleep_enter(false);
+}
+
+/**@brief Function for getting the time since boot in milliseconds.
+ *
+ * @details Extends the 24-bit RTC counter, must be called at least once per RTC overflow, which
+ *          the button polling does.
+ */
+static uint32_t uptime_ms(void)
+{
+	static uint32_t last_cnt;
+	static uint64_t ticks;
+	uint32_t cnt = app_timer_cnt_get();
+
+	ticks += app_timer_cnt_diff_compute(cnt, last_cnt);
+	last_cnt = cnt;
+	return (uint32_t)((ticks * 1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1)) / APP_TIMER_CLOCK_FREQ);
 }
 
 void buttons_init() {
-	for (int i = 0; i < 7; i++) {
-		nrf_gpio_cfg_input(btn_pins[i],NRF_GPIO_PIN_PULLUP);
+	// woken from system off: LATCH records the whole chord until the first poll, the keys are
+	// usually released long before then
+	wake_capture = (nrf_power_resetreas_get() & NRF_POWER_RESETREAS_OFF_MASK) != 0;
+	nrf_power_resetreas_clear(NRF_POWER_RESETREAS_OFF_MASK);
+
+	// sensing stays on, a key press raises the GPIOTE PORT event that speeds up the scan
+	for (int i = 0; i < CHORD_KEY_COUNT; i++) {
+		nrf_gpio_cfg_sense_input(key_pins[i], NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
 	}
+	nrf_gpio_cfg_sense_input(PWR_BTN_PIN, NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
 	prev_reading = 0;
 	pwr_btn_prev = 0;
 	pwr_btn_debounced = 0;
-	pair_btn_hold_count = 0;
+	pwr_btn_consumed = false;
+	system_keys = false;
 }
 
 void pwr_btn_sleep() {
-    ret_code_t err_code;
-	
 	NRF_LOG_INFO("Entering sleep from pwr btn press");
 
 	// only wake from power button
-	nrf_gpio_cfg_sense_input(btn_pins[6], NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
+	sleep_enter(true);
+}
 
-	err_code = app_timer_stop(m_led_blink_timer_id);
+void set_pairing_mode() {
+	pairing_mode = true;
+
+	// let any host connect and bond into a slot
+	advertising_start();
+
+	led_blink_start(LED_BLINK_PAIRING);
+}
+
+/**@brief Function for switching to another host slot.
+ *
+ * @details Drops the connections to other hosts, advertising then restarts towards the new slot's host.
+ */
+static void host_slot_switch(uint8_t slot) {
+	ret_code_t err_code;
+	sdk_mapped_flags_key_list_t conn_handles = ble_conn_state_periph_handles();
+	pm_peer_id_t slot_peer;
+	bool disconnecting = false;
+
+	if (host_slots_select(slot) != NRF_SUCCESS) {
+		return;
+	}
+	NRF_LOG_INFO("Switching to host slot %d", slot + 1);
+	pairing_mode = false;
+	text_dict_reset();
+	slot_peer = host_slots_current_peer();
+
+	for (uint32_t i = 0; i < conn_handles.len; i++) {
+		pm_peer_id_t peer_id;
+
+		if ((pm_peer_id_get(conn_handles.flag_keys[i], &peer_id) == NRF_SUCCESS) && (peer_id == slot_peer)) {
+			continue;
+		}
+		err_code = sd_ble_gap_disconnect(conn_handles.flag_keys[i], BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+		if (err_code != NRF_ERROR_INVALID_STATE) {
+			APP_ERROR_CHECK(err_code);
+		}
+		disconnecting = true;
+	}
+
+	// otherwise restarted on disconnect
+	if (!disconnecting) {
+		advertising_start();
+	}
+}
+
+/**@brief Functions of the BLE transport backend, notifications of the chord service with a
+ *        lane per link, so a slow central does not hold up the others.
+ */
+STATIC_ASSERT(TRANSPORT_RECORD_MAX_LEN <= BLE_CHORD_TEXT_MAX_LEN);
+STATIC_ASSERT(BLE_CHORD_MAX_LINKS <= TRANSPORT_LANES_MAX);
+
+static bool ble_transport_is_ready(void) {
+	return device_connected;
+}
+
+static ret_code_t ble_transport_send(uint8_t lane, transport_record_t const * p_record) {
+	ret_code_t err_code;
+
+	if (p_record->type == TRANSPORT_RECORD_CHORD) {
+		err_code = ble_chord_chord_value_update(&m_chord, lane, p_record->data[0]);
+	} else {
+		err_code = ble_chord_text_value_send(&m_chord, lane, p_record->data, p_record->len);
+	}
+
+	// a link that does not subscribe is skipped, NRF_ERROR_BUSY keeps the record queued for the
+	// link and it is sent from there once its SoftDevice queue has room
+	return (err_code == NRF_ERROR_INVALID_STATE) ? NRF_ERROR_NOT_FOUND : err_code;
+}
+
+static const transport_backend_t m_ble_transport = {
+	.p_name   = "BLE",
+	.is_ready = ble_transport_is_ready,
+	.send     = ble_transport_send,
+	.lanes    = BLE_CHORD_MAX_LINKS,
+};
+
+/**@brief Function for sending text to the hosts.
+ */
+static void text_send(uint8_t replace, char const * p_text, uint8_t len) {
+	ret_code_t err_code = transport_text_send(replace, p_text, len);
+
+	// nobody to send to, the text stays typed on the device only
+	if (err_code != NRF_ERROR_INVALID_STATE) {
+		APP_ERROR_CHECK(err_code);
+	}
+}
+
+/**@brief Function for handling a chord typed while the power button is held.
+ *
+ * @details Single keys 1 to HOST_SLOT_COUNT select the host slot, SYSTEM_CHORD_CALC toggles
+ *          the calculator layer and SYSTEM_CHORD_PREDICT word prediction.
+ */
+static void system_chord(uint8_t chord) {
+	for (uint8_t i = 0; i < HOST_SLOT_COUNT; i++) {
+		if (chord == (1 << i)) {
+			host_slot_switch(i);
+			return;
+		}
+	}
+
+	if (chord == SYSTEM_CHORD_PREDICT) {
+		phrase_predict_enable(!phrase_predict_is_enabled());
+		NRF_LOG_INFO("Prediction %s", phrase_predict_is_enabled() ? "on" : "off");
+		if (transport_is_ready()) {
+			// clear the suggestion shown
+			text_send(BLE_CHORD_TEXT_SUGGESTION, "", 0);
+		}
+		return;
+	}
+
+	if (chord == SYSTEM_CHORD_CALC) {
+		calc_active = !calc_active;
+		chord_calc_reset();
+		NRF_LOG_INFO("Calculator %s", calc_active ? "on" : "off");
+	}
+}
+
+/**@brief Function for handling a chord in the calculator layer.
+ *
+ * @details Only the result is sent, the expression stays on the device.
+ */
+static void calc_chord(uint8_t chord) {
+	char text[BLE_CHORD_TEXT_MAX_LEN];
+
+	switch (chord_calc_input(chord_calc_symbol(chord), text, sizeof(text))) {
+		case CHORD_CALC_ACTION_RESULT:
+			NRF_LOG_INFO("Result: %s", nrf_log_push(text));
+			text_send(0, text, (uint8_t)strlen(text));
+			break;
+
+		case CHORD_CALC_ACTION_EXIT:
+			calc_active = false;
+			NRF_LOG_INFO("Calculator off");
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**@brief Function for sending a chord to the hosts, together with the expansion or suggestion
+ *        it triggers.
+ */
+static void chord_send(uint8_t chord) {
+	ret_code_t err_code;
+	text_dict_expansion_t exp;
+	phrase_predict_text_t pred;
+	phrase_predict_action_t action = phrase_predict_chord(chord, &pred);
+	bool expand;
+
+	if (action == PHRASE_PREDICT_ACTION_ACCEPT) {
+		// the accept chord itself is not sent
+		text_dict_reset();
+		if (transport_is_ready()) {
+			text_send(pred.replace, pred.p_text, pred.len);
+		}
+		return;
+	}
+
+	expand = text_dict_chord(chord, &exp);
+
+	if (!transport_is_ready()) {
+		return;
+	}
+
+	// all go through the same queue, so the host sees them in this order
+	if (expand && exp.before_chord) {
+		text_send(exp.replace, exp.p_text, exp.len);
+	}
+	err_code = transport_chord_send(chord);
 	APP_ERROR_CHECK(err_code);
-	nrf_gpio_pin_clear(LED_PIN);
+	if (expand && !exp.before_chord) {
+		text_send(exp.replace, exp.p_text, exp.len);
+	}
+	if (action == PHRASE_PREDICT_ACTION_SUGGEST) {
+		text_send(BLE_CHORD_TEXT_SUGGESTION, pred.p_text, pred.len);
+	}
+}
 
-    // Go to system-off mode (this function will not return; wakeup will cause a reset).
-    err_code = sd_power_system_off();
-    APP_ERROR_CHECK(err_code);
+/**@brief Function for sending the wake chord once a host is back, or sending it right away.
+ */
+static void wake_chord_queue(uint8_t chord, uint32_t now) {
+	if (transport_is_ready()) {
+		chord_send(chord);
+		return;
+	}
+	NRF_LOG_INFO("Wake chord %d waits for a host", chord);
+	wake_chord = chord;
+	wake_chord_time = now;
 }
 
-void set_pairing_mode() {
-	app_timer_stop(m_led_blink_timer_id);
-	app_timer_start(m_led_blink_timer_id, LED_BLINK_PAIRING, NULL);
-	pairing_mode = true;
+/**@brief Function for turning the keys latched since waking up into the first chord.
+ *
+ * @details Keys still held finish as a normal chord, otherwise the latched keys are the chord.
+ *          Either way it waits for the reconnect, see wake_chord_queue().
+ */
+static void wake_chord_capture(uint32_t now) {
+	uint8_t latched = 0;
+	uint8_t held = 0;
+
+	for (int i = 0; i < CHORD_KEY_COUNT; i++) {
+		latched |= (nrf_gpio_pin_latch_get(key_pins[i]) != 0) << i;
+		held |= !nrf_gpio_pin_read(key_pins[i]) << i;
+		nrf_gpio_pin_latch_clear(key_pins[i]);
+	}
+	wake_capture = false;
+
+	if (held) {
+		chord_engine_seed(latched);
+		wake_held = true;
+		return;
+	}
+	if (latched) {
+		NRF_LOG_INFO("Wake Chord: %d", latched);
+		last_activity_time = now;
+		wake_chord_queue(latched, now);
+		chord_log_add(latched, now);
+		chord_stats_add(latched);
+	}
+}
+
+/**@brief Function for sending the wake chord when the host is back, or dropping it once it is stale.
+ */
+static void wake_chord_process(uint32_t now) {
+	if (wake_chord == 0) {
+		return;
+	}
+	if (transport_is_ready()) {
+		chord_send(wake_chord);
+		wake_chord = 0;
+	}
+	else if (now - wake_chord_time >= WAKE_CHORD_TIMEOUT) {
+		NRF_LOG_INFO("Wake chord dropped, no host");
+		wake_chord = 0;
+	}
 }
 
-void poll_buttons(){
+/**@brief Function for handling a chord completed by the chord engine.
+ */
+static void chord_complete(uint8_t chord, uint32_t now) {
+	if (system_keys) {
+		NRF_LOG_INFO("System Chord: %d", chord);
+		system_chord(chord);
+		return;
+	}
+	NRF_LOG_INFO("New Chord: %d", chord);
+#if LATENCY_BENCH_ENABLED
+	latency_bench_debounced();
+#endif
+	if (calc_active) {
+		calc_chord(chord);
+	}
+	else if (wake_held) {
+		wake_held = false;
+		wake_chord_queue(chord, now);
+	}
+	else {
+		chord_send(chord);
+	}
+	chord_log_add(chord, now);
+	chord_stats_add(chord);
+}
+
+void poll_buttons(uint32_t now){
 	uint8_t reading = 0;
-    ret_code_t err_code;
+	uint8_t chords[CHORD_ENGINE_MAX_CHORDS];
+	uint8_t count;
 	bool pwr_btn_reading;
 
-	pwr_btn_reading = !nrf_gpio_pin_read(btn_pins[6]);
-	if ((pwr_btn_reading == pwr_btn_prev) && pwr_btn_reading && pwr_btn_debounced) {
-		pair_btn_hold_count++;
+	if (wake_capture) {
+		wake_chord_capture(now);
 	}
-	if ((pwr_btn_reading != pwr_btn_prev) && (pwr_btn_reading != pwr_btn_debounced)) {
+
+	// a reading counts once stable for APP_PARAM_DEBOUNCE_TIME, whatever the scan rate
+	pwr_btn_reading = !nrf_gpio_pin_read(PWR_BTN_PIN);
+	if (pwr_btn_reading != pwr_btn_prev) {
+		pwr_btn_change_time = now;
+	}
+	if ((pwr_btn_reading != pwr_btn_debounced) && (now - pwr_btn_change_time >= app_params_get(APP_PARAM_DEBOUNCE_TIME))) {
 		// pressed -> released
 		if (!pwr_btn_reading && pwr_btn_debounced) {
-			if (!device_connected && (pair_btn_hold_count > PAIR_BTN_HOLD_TIME)) {
+			if (pwr_btn_consumed) {
+				// used as a modifier for a system chord
+				pwr_btn_consumed = false;
+			}
+			else if ((ble_conn_state_peripheral_conn_count() < NRF_SDH_BLE_PERIPHERAL_LINK_COUNT)
+			         && (now - pwr_btn_press_time > app_params_get(APP_PARAM_PAIR_HOLD_TIME))) {
 				NRF_LOG_INFO("PAIR BUTTON PRESSED");
 				set_pairing_mode();
 			}
@@ -379,29 +821,50 @@ void poll_buttons(){
 		}
 		// released -> pressed
 		else if (pwr_btn_reading && !pwr_btn_debounced) {
-			pair_btn_hold_count = 0;
+			pwr_btn_press_time = now;
+			if (debounced_reading) {
+				pwr_btn_consumed = true;
+				system_keys = true;
+			}
 		}
 		pwr_btn_debounced = pwr_btn_reading;
 	}
 
-	for (int i = 0; i < 6; i++) {
-		reading |= !nrf_gpio_pin_read(btn_pins[i]) << i;
+#if LATENCY_BENCH_ENABLED
+	// a benchmark run replaces the keys, and keeps the scan fast as the PORT event would
+	if (latency_bench_reading(&reading)) {
+		last_key_time = now;
+	}
+	else
+#endif
+	for (int i = 0; i < CHORD_KEY_COUNT; i++) {
+		reading |= !nrf_gpio_pin_read(key_pins[i]) << i;
 	}
 	//NRF_LOG_INFO("New Reading: %d", reading);
 	
-	if ((reading == prev_reading) && (reading != debounced_reading)) {
-		update_inactive_timer();
+	if (reading != prev_reading) {
+		key_change_time = now;
+	}
+	if (reading || pwr_btn_reading) {
+		last_key_time = now;
+	}
+
+	if ((reading != debounced_reading) && (now - key_change_time >= app_params_get(APP_PARAM_DEBOUNCE_TIME))) {
+		// decided when the keys go down, the power button is often let go of before them
+		if ((reading & ~debounced_reading) && pwr_btn_debounced) {
+			pwr_btn_consumed = true;
+			system_keys = true;
+		}
+		last_activity_time = now;
+		fds_maint_activity(now);
 		debounced_reading = reading;
-		if (chord && !reading) {
-			NRF_LOG_INFO("New Chord: %d", chord);
-			if (device_connected) {
-				err_code = ble_chord_chord_value_update(&m_chord, chord);
-				APP_ERROR_CHECK(err_code);
-			}
-			chord = 0;
+		ble_chord_keys_update(&m_chord, reading, now);
+		count = chord_engine_update(reading, now, app_params_get(APP_PARAM_ROLLOVER_TIME), chords);
+		for (uint8_t i = 0; i < count; i++) {
+			chord_complete(chords[i], now);
 		}
-		else {
-			chord |= debounced_reading;
+		if (!reading) {
+			system_keys = false;
 		}
 	}
 		 
@@ -409,21 +872,97 @@ void poll_buttons(){
 	prev_reading = reading;
 }
 
-/**@brief Function for handling the Battery measurement timer timeout.
+/**@brief Function for switching the tick between the typing and the idle scan rate.
+ *
+ * @details APP_PARAM_SCAN_FAST_INTERVAL while a key is down and for APP_PARAM_SCAN_HOLD_TIME
+ *          after, APP_PARAM_TICK_INTERVAL otherwise. A key press while idle raises the GPIOTE PORT
+ *          event, which switches to the fast rate at once, so the idle rate only paces the
+ *          periodic work.
+ */
+static void scan_rate_set(bool fast) {
+	ret_code_t err_code;
+	uint32_t interval = app_params_get(fast ? APP_PARAM_SCAN_FAST_INTERVAL : APP_PARAM_TICK_INTERVAL);
+
+	scan_fast = fast;
+	if (!tick_started) {
+		return;
+	}
+	err_code = app_timer_stop(m_tick_timer_id);
+	APP_ERROR_CHECK(err_code);
+	err_code = app_timer_start(m_tick_timer_id, APP_TIMER_TICKS(interval), NULL);
+	APP_ERROR_CHECK(err_code);
+}
+
+/**@brief Function for handling the GPIOTE PORT event, a key pressed while the scan is idle.
+ */
+void GPIOTE_IRQHandler(void)
+{
+	if (nrf_gpiote_event_is_set(NRF_GPIOTE_EVENTS_PORT)) {
+		nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
+		if (!scan_fast) {
+			last_key_time = uptime_ms();
+			scan_rate_set(true);
+		}
+	}
+}
+
+/**@brief Function for enabling the key press interrupt, at the tick priority so it never
+ *        preempts the button polling.
+ */
+static void scan_wake_init(void) {
+	nrf_gpiote_event_clear(NRF_GPIOTE_EVENTS_PORT);
+	nrf_gpiote_int_enable(NRF_GPIOTE_INT_PORT_MASK);
+	NVIC_SetPriority(GPIOTE_IRQn, APP_TIMER_CONFIG_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+	NVIC_EnableIRQ(GPIOTE_IRQn);
+}
+
+/**@brief Function for handling the tick timer timeout.
  *
- * @details This function will be called each time the battery level measurement timer expires.
+ * @details The only application timer, so the RTC wakes up once per tick interval and no timer
+ *          operations are queued on key edges. Polls the buttons and runs all periodic work;
+ *          the LED blink and the inactivity timeout are timestamps compared here.
  *
- * @param[in] p_context  Pointer used for passing some arbitrary information (context) from the
- *                       app_start_timer() call to the timeout handler.
+ * @param[in] p_context  Unused.
  */
-static void notification_timeout_handler(void * p_context)
+static void tick_handler(void * p_context)
 {
+	uint32_t now = uptime_ms();
+	bool typing;
+
     UNUSED_PARAMETER(p_context);
-	poll_buttons();
-}
+	poll_buttons(now);
+	wake_chord_process(now);
+
+	// keys seen by polling count too, the PORT event only covers presses while idle
+	typing = (now - last_key_time < app_params_get(APP_PARAM_SCAN_HOLD_TIME));
+	if (typing != scan_fast) {
+		scan_rate_set(typing);
+	}
+
+	// flash writes are only queued here, after the chord has been sent
+	chord_log_process(now);
+	chord_stats_process(now);
+	fds_maint_process(now);
+
+#if GPIO_TRACE_ENABLED
+	gpio_trace_process();
+#endif
+#if LATENCY_BENCH_ENABLED
+	latency_bench_process(app_params_get(APP_PARAM_DEBOUNCE_TIME), app_params_get(APP_PARAM_SCAN_FAST_INTERVAL));
+#endif
 
-static void led_blink_timeout_handler(void * p_context) {
-	nrf_gpio_pin_toggle(LED_PIN);
+	if ((led_blink_interval != 0) && (now - led_toggle_time >= led_blink_interval)) {
+		nrf_gpio_pin_toggle(LED_PIN);
+		led_toggle_time = now;
+	}
+
+	// no sleep on USB, the cable powers the device
+	if (inactive_armed && (transport_backend_get() == &m_ble_transport) && (now - last_activity_time >= app_params_get(APP_PARAM_INACTIVE_TIME) * 1000)) {
+		// retried after another inactivity time if sleep is held off
+		last_activity_time = now;
+		inactive_timeout();
+	}
 }
 
 /**@brief Function for the Timer initialization.
@@ -437,15 +976,21 @@ static void timers_init(void)
     APP_ERROR_CHECK(err_code);
 
     // Create timers.
-    //err_code = app_timer_create(&m_notification_timer_id, APP_TIMER_MODE_REPEATED, notification_timeout_handler);
-    err_code = app_timer_create(&m_notification_timer_id, APP_TIMER_MODE_REPEATED, notification_timeout_handler);
+    err_code = app_timer_create(&m_tick_timer_id, APP_TIMER_MODE_REPEATED, tick_handler);
     APP_ERROR_CHECK(err_code);
+}
 
-    err_code = app_timer_create(&m_led_blink_timer_id, APP_TIMER_MODE_REPEATED, led_blink_timeout_handler);
-    APP_ERROR_CHECK(err_code);
 
-	err_code = app_timer_create(&m_inactive_timer_id, APP_TIMER_MODE_REPEATED, inactive_timeout_handler);
-    APP_ERROR_CHECK(err_code);
+/**@brief Function for getting the preferred connection parameters.
+ */
+static void conn_params_get(ble_gap_conn_params_t * p_params)
+{
+    memset(p_params, 0, sizeof(*p_params));
+
+    p_params->min_conn_interval = app_params_get(APP_PARAM_MIN_CONN_INTERVAL);
+    p_params->max_conn_interval = app_params_get(APP_PARAM_MAX_CONN_INTERVAL);
+    p_params->slave_latency     = app_params_get(APP_PARAM_SLAVE_LATENCY);
+    p_params->conn_sup_timeout  = app_params_get(APP_PARAM_CONN_SUP_TIMEOUT);
 }
 
 
@@ -471,23 +1016,29 @@ static void gap_params_init(void)
        err_code = sd_ble_gap_appearance_set(BLE_APPEARANCE_);
        APP_ERROR_CHECK(err_code); */
 
-    memset(&gap_conn_params, 0, sizeof(gap_conn_params));
-
-    gap_conn_params.min_conn_interval = MIN_CONN_INTERVAL;
-    gap_conn_params.max_conn_interval = MAX_CONN_INTERVAL;
-    gap_conn_params.slave_latency     = SLAVE_LATENCY;
-    gap_conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
+    conn_params_get(&gap_conn_params);
 
     err_code = sd_ble_gap_ppcp_set(&gap_conn_params);
     APP_ERROR_CHECK(err_code);
 }
 
 
+/**@brief Function for handling events from the GATT library.
+ */
+static void gatt_evt_handler(nrf_ble_gatt_t * p_gatt, nrf_ble_gatt_evt_t const * p_evt)
+{
+    if ((p_evt->evt_id == NRF_BLE_GATT_EVT_ATT_MTU_UPDATED) && (p_evt->conn_handle == m_bulk.conn_handle))
+    {
+        ble_bulk_att_mtu_set(&m_bulk, p_evt->params.att_mtu_effective);
+    }
+}
+
+
 /**@brief Function for initializing the GATT module.
  */
 static void gatt_init(void)
 {
-    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, NULL);
+    ret_code_t err_code = nrf_ble_gatt_init(&m_gatt, gatt_evt_handler);
     APP_ERROR_CHECK(err_code);
 }
 
@@ -505,6 +1056,28 @@ static void service_error_handler(uint32_t nrf_error)
 }
 
 
+#if USE_AUTHORIZATION_CODE
+/**@brief Function for comparing a received authorization code with m_auth_code.
+ *
+ * @details Every byte is compared whatever the earlier ones were, so the reply time does not tell
+ *          a peer how much of its guess was right.
+ */
+static bool auth_code_matches(uint8_t const * p_code, uint16_t len)
+{
+    uint8_t diff = 0;
+
+    if (len != m_auth_code_len)
+    {
+        return false;
+    }
+    for (uint16_t i = 0; i < len; i++)
+    {
+        diff |= m_auth_code[i] ^ p_code[i];
+    }
+    return diff == 0;
+}
+#endif
+
 /**@brief Function for handling events from bond management service.
  */
 void bms_evt_handler(nrf_ble_bms_t * p_ess, nrf_ble_bms_evt_t * p_evt)
@@ -517,8 +1090,7 @@ void bms_evt_handler(nrf_ble_bms_t * p_ess, nrf_ble_bms_evt_t * p_evt)
         case NRF_BLE_BMS_EVT_AUTH:
             NRF_LOG_DEBUG("Authorization request.");
 #if USE_AUTHORIZATION_CODE
-            if ((p_evt->auth_code.len != m_auth_code_len) ||
-                (memcmp(m_auth_code, p_evt->auth_code.code, m_auth_code_len) != 0))
+            if (!auth_code_matches(p_evt->auth_code.code, p_evt->auth_code.len))
             {
                 is_authorized = false;
             }
@@ -531,6 +1103,11 @@ void bms_evt_handler(nrf_ble_bms_t * p_ess, nrf_ble_bms_evt_t * p_evt)
 
 uint16_t qwr_evt_handler(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_evt_t * p_evt)
 {
+    // The bond management service answers on the link that wrote to it.
+    if (nrf_ble_bms_set_conn_handle(&m_bms, p_qwr->conn_handle) != NRF_SUCCESS)
+    {
+        return BLE_GATT_STATUS_ATTERR_UNLIKELY_ERROR;
+    }
     return nrf_ble_bms_on_qwr_evt(&m_bms, p_qwr, p_evt);
 }
 
@@ -658,20 +1235,28 @@ static void on_chord_evt(ble_chord_t     * p_chord_service,
     {
         case BLE_CHORD_EVT_NOTIFICATION_ENABLED:
             
-			NRF_LOG_INFO("App Timer Started");
+			NRF_LOG_INFO("Link 0x%x subscribed", p_evt->conn_handle);
 			device_connected = true;
              break;
 
         case BLE_CHORD_EVT_NOTIFICATION_DISABLED:
-			device_connected = false;
+			device_connected = ble_chord_is_subscribed(p_chord_service);
+			// the records this link still holds are freed
+			transport_lane_retry(p_evt->link);
             break;
 
         case BLE_CHORD_EVT_CONNECTED:
             break;
 
         case BLE_CHORD_EVT_DISCONNECTED:
+			device_connected = ble_chord_is_subscribed(p_chord_service);
+			transport_lane_retry(p_evt->link);
               break;
 
+        case BLE_CHORD_EVT_TX_COMPLETE:
+			transport_lane_retry(p_evt->link);
+            break;
+
         default:
               // No implementation needed.
               break;
@@ -685,17 +1270,21 @@ static void services_init(void)
         ret_code_t          err_code;
         nrf_ble_qwr_init_t  qwr_init;
         ble_chord_init_t      chord_init = {0};
+        ble_bulk_init_t       bulk_init  = {0};
+        ble_config_init_t     config_init = {0};
 		nrf_ble_bms_init_t   bms_init;
 
-        // Initialize Queued Write Module.
-		memset(&qwr_init, 0, sizeof(qwr_init));
-		qwr_init.mem_buffer.len   = MEM_BUFF_SIZE;
-		qwr_init.mem_buffer.p_mem = m_qwr_mem;
-		qwr_init.callback         = qwr_evt_handler;
-		qwr_init.error_handler    = nrf_qwr_error_handler;
+        // Initialize Queued Write Module, one instance per link.
+		for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++) {
+			memset(&qwr_init, 0, sizeof(qwr_init));
+			qwr_init.mem_buffer.len   = MEM_BUFF_SIZE;
+			qwr_init.mem_buffer.p_mem = m_qwr_mem[i];
+			qwr_init.callback         = qwr_evt_handler;
+			qwr_init.error_handler    = nrf_qwr_error_handler;
 
-		err_code = nrf_ble_qwr_init(&m_qwr, &qwr_init);
-		APP_ERROR_CHECK(err_code);
+			err_code = nrf_ble_qwr_init(&m_qwr[i], &qwr_init);
+			APP_ERROR_CHECK(err_code);
+		}
 
 		// Initialize Bond Management Service
 		memset(&bms_init, 0, sizeof(bms_init));
@@ -715,7 +1304,7 @@ static void services_init(void)
 		bms_init.bms_feature_sec_req = SEC_JUST_WORKS;
 		bms_init.bms_ctrlpt_sec_req  = SEC_JUST_WORKS;
 
-		bms_init.p_qwr                                       = &m_qwr;
+		bms_init.p_qwr                                       = &m_qwr[0];
 		bms_init.bond_callbacks.delete_requesting            = delete_requesting_bond;
 		bms_init.bond_callbacks.delete_all                   = delete_all_bonds;
 		bms_init.bond_callbacks.delete_all_except_requesting = delete_all_except_requesting_bond;
@@ -723,6 +1312,12 @@ static void services_init(void)
 		err_code = nrf_ble_bms_init(&m_bms, &bms_init);
 		APP_ERROR_CHECK(err_code);
 
+		// the control point is registered with the first instance by nrf_ble_bms_init()
+		for (uint32_t i = 1; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++) {
+			err_code = nrf_ble_qwr_attr_register(&m_qwr[i], m_bms.ctrlpt_handles.value_handle);
+			APP_ERROR_CHECK(err_code);
+		}
+
 
          // Initialize CHORD Service init structure to zero.
         chord_init.evt_handler                = on_chord_evt;
@@ -733,6 +1328,35 @@ static void services_init(void)
 
         err_code = ble_chord_init(&m_chord, &chord_init);
         APP_ERROR_CHECK(err_code);
+
+        // Initialize the bulk transfer service, it shares the chord service base UUID. The streams
+        // hold what was typed and replace the dictionaries, so they need an encrypted link.
+        bulk_init.uuid_type = m_chord.uuid_type;
+
+        BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&bulk_init.bulk_char_attr_md.cccd_write_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&bulk_init.bulk_char_attr_md.read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&bulk_init.bulk_char_attr_md.write_perm);
+
+        err_code = ble_bulk_init(&m_bulk, &bulk_init);
+        APP_ERROR_CHECK(err_code);
+
+        err_code = ble_bulk_stream_register(&m_bulk, BULK_STREAM_CHORD_LOG, &m_chord_log_stream);
+        APP_ERROR_CHECK(err_code);
+        err_code = ble_bulk_stream_register(&m_bulk, BULK_STREAM_CHORD_STATS, &m_chord_stats_stream);
+        APP_ERROR_CHECK(err_code);
+        err_code = ble_bulk_stream_register(&m_bulk, BULK_STREAM_TEXT_DICT, flash_blob_stream(FLASH_BLOB_TEXT_DICT));
+        APP_ERROR_CHECK(err_code);
+        err_code = ble_bulk_stream_register(&m_bulk, BULK_STREAM_PHRASE_MODEL, flash_blob_stream(FLASH_BLOB_PHRASE_MODEL));
+        APP_ERROR_CHECK(err_code);
+
+        // Initialize the runtime parameters service, it shares the chord service base UUID.
+        config_init.uuid_type = m_chord.uuid_type;
+
+        BLE_GAP_CONN_SEC_MODE_SET_OPEN(&config_init.config_char_attr_md.read_perm);
+        BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&config_init.config_char_attr_md.write_perm);
+
+        err_code = ble_config_init(&m_config, &config_init);
+        APP_ERROR_CHECK(err_code);
 }
 
 
@@ -752,7 +1376,7 @@ static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
 
     if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
     {
-        err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
+        err_code = sd_ble_gap_disconnect(p_evt->conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
         APP_ERROR_CHECK(err_code);
     }
 }
@@ -795,7 +1419,77 @@ static void conn_params_init(void)
  */
 static void application_timers_start(void)
 {
+    ret_code_t err_code;
+
+    // start polling buttons, fast at first in case a key is already down
+    scan_fast = true;
+    last_key_time = uptime_ms();
+    err_code = app_timer_start(m_tick_timer_id, APP_TIMER_TICKS(app_params_get(APP_PARAM_SCAN_FAST_INTERVAL)), NULL);
+    APP_ERROR_CHECK(err_code);
+    tick_started = true;
+    scan_wake_init();
+}
+
+
+/**@brief Function for applying a changed runtime parameter.
+ *
+ * @details Parameters read where they are used take effect on their next use.
+ */
+static void app_params_handler(app_param_id_t id, uint32_t value)
+{
+    ret_code_t             err_code;
+    ble_gap_conn_params_t  conn_params;
+    ble_adv_modes_config_t adv_config;
+
+    switch (id)
+    {
+        case APP_PARAM_TICK_INTERVAL:
+        case APP_PARAM_SCAN_FAST_INTERVAL:
+            // restarted at the new interval if it is the one in use
+            if (scan_fast == (id == APP_PARAM_SCAN_FAST_INTERVAL))
+            {
+                scan_rate_set(scan_fast);
+            }
+            break;
+
+        case APP_PARAM_MIN_CONN_INTERVAL:
+        case APP_PARAM_MAX_CONN_INTERVAL:
+        case APP_PARAM_SLAVE_LATENCY:
+        case APP_PARAM_CONN_SUP_TIMEOUT:
+        {
+            sdk_mapped_flags_key_list_t conn_handles = ble_conn_state_periph_handles();
+
+            conn_params_get(&conn_params);
+            err_code = sd_ble_gap_ppcp_set(&conn_params);
+            APP_ERROR_CHECK(err_code);
+
+            // renegotiate the links now, the central may still refuse
+            for (uint32_t i = 0; i < conn_handles.len; i++)
+            {
+                err_code = ble_conn_params_change_conn_params(conn_handles.flag_keys[i], &conn_params);
+                if (err_code != NRF_SUCCESS)
+                {
+                    NRF_LOG_INFO("Connection parameter update failed: %x", err_code);
+                }
+            }
+        } break;
+
+        case APP_PARAM_ADV_INTERVAL:
+            adv_config = m_advertising.adv_modes_config;
+            adv_config.ble_adv_fast_interval = value;
+            ble_advertising_modes_config_set(&m_advertising, &adv_config);
+
+            if (m_advertising.adv_mode_current != BLE_ADV_MODE_IDLE)
+            {
+                advertising_start();
+            }
+            break;
+
+        default:
+            break;
+    }
 
+    ble_config_table_update(&m_config);
 }
 
 
@@ -806,7 +1500,7 @@ static void application_timers_start(void)
 static void sleep_mode_enter(void)
 {
 	NRF_LOG_INFO("Entering sleep from advertising");
-	inactive_timeout_handler(NULL);
+	inactive_timeout();
 }
 
 
@@ -818,18 +1512,64 @@ static void sleep_mode_enter(void)
  */
 static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 {
-    //ret_code_t err_code;
+    ret_code_t err_code;
 
     switch (ble_adv_evt)
     {
+        case BLE_ADV_EVT_DIRECTED_HIGH_DUTY:
+            NRF_LOG_INFO("Directed advertising to host slot %d.", host_slots_current() + 1);
+            break;
+
         case BLE_ADV_EVT_FAST:
             NRF_LOG_INFO("Fast advertising.");
-			// start flashing the LED
-			app_timer_start(m_led_blink_timer_id, LED_BLINK_ADVERTISING, NULL);
+			// start flashing the LED, unless a host is already connected
+			if (ble_conn_state_peripheral_conn_count() == 0) {
+				led_blink_start(LED_BLINK_ADVERTISING);
+			}
             break;
 
+        case BLE_ADV_EVT_PEER_ADDR_REQUEST:
+        {
+            pm_peer_data_bonding_t peer_bonding_data;
+            pm_peer_id_t           peer_id = host_slots_current_peer();
+
+            if (peer_id != PM_PEER_ID_INVALID) {
+                err_code = pm_peer_data_bonding_load(peer_id, &peer_bonding_data);
+                if (err_code != NRF_ERROR_NOT_FOUND) {
+                    APP_ERROR_CHECK(err_code);
+                    err_code = ble_advertising_peer_addr_reply(&m_advertising,
+                                                               &peer_bonding_data.peer_ble_id.id_addr_info);
+                    APP_ERROR_CHECK(err_code);
+                }
+            }
+        } break;
+
+        case BLE_ADV_EVT_WHITELIST_REQUEST:
+        {
+            ble_gap_addr_t whitelist_addrs[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+            ble_gap_irk_t  whitelist_irks[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+            uint32_t       addr_cnt = BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
+            uint32_t       irk_cnt  = BLE_GAP_WHITELIST_ADDR_MAX_COUNT;
+
+            err_code = pm_whitelist_get(whitelist_addrs, &addr_cnt, whitelist_irks, &irk_cnt);
+            APP_ERROR_CHECK(err_code);
+
+            // An empty whitelist (empty slot or pairing mode) advertises to everyone.
+            if (pairing_mode) {
+                addr_cnt = 0;
+                irk_cnt  = 0;
+            }
+            err_code = ble_advertising_whitelist_reply(&m_advertising,
+                                                       whitelist_addrs, addr_cnt,
+                                                       whitelist_irks, irk_cnt);
+            APP_ERROR_CHECK(err_code);
+        } break;
+
         case BLE_ADV_EVT_IDLE:
-            sleep_mode_enter();
+            // nobody else came, keep serving the connected hosts
+            if (ble_conn_state_peripheral_conn_count() == 0) {
+                sleep_mode_enter();
+            }
             break;
 
         default:
@@ -838,6 +1578,21 @@ static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 }
 
 
+/**@brief Function for checking the result of a SoftDevice call made for a link from its event.
+ *
+ * @details The peer may have dropped the link, or started tearing it down, since the event was
+ *          queued. That is not worth a reset, anything else still is.
+ */
+static void link_call_check(ret_code_t err_code)
+{
+    if ((err_code == NRF_ERROR_INVALID_STATE) || (err_code == BLE_ERROR_INVALID_CONN_HANDLE))
+    {
+        NRF_LOG_DEBUG("Link gone: %x", err_code);
+        return;
+    }
+    APP_ERROR_CHECK(err_code);
+}
+
 /**@brief Function for handling BLE events.
  *
  * @param[in]   p_ble_evt   Bluetooth stack event.
@@ -854,27 +1609,43 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
         case BLE_GAP_EVT_DISCONNECTED:
             NRF_LOG_INFO("Disconnected.");
 			delete_disconnected_bonds();
-            m_conn_handle = BLE_CONN_HANDLE_INVALID;
-            APP_ERROR_CHECK(err_code);
+
+            // restarted here rather than by the advertising module, to target the current slot
+            advertising_start();
             break;
 
         case BLE_GAP_EVT_CONNECTED:
             NRF_LOG_INFO("Connected.");
-			err_code = app_timer_start(m_inactive_timer_id, INACTIVE_TIME, NULL);
-			APP_ERROR_CHECK(err_code);
+#if LATENCY_BENCH_ENABLED
+			latency_bench_conn_interval_set(p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval);
+#endif
+			inactive_armed = true;
+			last_activity_time = uptime_ms();
 
 			// set LED to on, no flashing anymore
-			err_code = app_timer_stop(m_led_blink_timer_id);
-            APP_ERROR_CHECK(err_code);
-			nrf_gpio_pin_set(LED_PIN);
+			led_blink_stop();
+			nrf_gpio_pin_write(LED_PIN, LED_ON_LEVEL);
 			
-            m_conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
-            err_code = nrf_ble_bms_set_conn_handle(&m_bms, m_conn_handle);
-            APP_ERROR_CHECK(err_code);
-            err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr, m_conn_handle);
+            err_code = nrf_ble_bms_set_conn_handle(&m_bms, p_ble_evt->evt.gap_evt.conn_handle);
             APP_ERROR_CHECK(err_code);
+			for (uint32_t i = 0; i < NRF_SDH_BLE_TOTAL_LINK_COUNT; i++) {
+				if (m_qwr[i].conn_handle == BLE_CONN_HANDLE_INVALID) {
+					err_code = nrf_ble_qwr_conn_handle_assign(&m_qwr[i], p_ble_evt->evt.gap_evt.conn_handle);
+					APP_ERROR_CHECK(err_code);
+					break;
+				}
+			}
+
+			// keep advertising for the other hosts while a link is free
+			advertising_start();
             break;
 
+#if LATENCY_BENCH_ENABLED
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            latency_bench_conn_interval_set(p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval);
+            break;
+#endif
+
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
         {
             NRF_LOG_DEBUG("PHY update request.");
@@ -884,7 +1655,7 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
                 .tx_phys = BLE_GAP_PHY_AUTO,
             };
             err_code = sd_ble_gap_phy_update(p_ble_evt->evt.gap_evt.conn_handle, &phys);
-            APP_ERROR_CHECK(err_code);
+            link_call_check(err_code);
         } break;
 
         case BLE_GATTC_EVT_TIMEOUT:
@@ -892,7 +1663,7 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             NRF_LOG_DEBUG("GATT Client Timeout.");
             err_code = sd_ble_gap_disconnect(p_ble_evt->evt.gattc_evt.conn_handle,
                                              BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
-            APP_ERROR_CHECK(err_code);
+            link_call_check(err_code);
             break;
 
         case BLE_GATTS_EVT_TIMEOUT:
@@ -900,7 +1671,7 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             NRF_LOG_DEBUG("GATT Server Timeout.");
             err_code = sd_ble_gap_disconnect(p_ble_evt->evt.gatts_evt.conn_handle,
                                              BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
-            APP_ERROR_CHECK(err_code);
+            link_call_check(err_code);
             break;
 
         default:
@@ -984,9 +1755,12 @@ static void advertising_init(void)
     init.advdata.uuids_complete.uuid_cnt = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
     init.advdata.uuids_complete.p_uuids  = m_adv_uuids;
 
-    init.config.ble_adv_fast_enabled  = true;
-    init.config.ble_adv_fast_interval = APP_ADV_INTERVAL;
-    init.config.ble_adv_fast_timeout  = APP_ADV_DURATION;
+    init.config.ble_adv_directed_high_duty_enabled = true;
+    init.config.ble_adv_whitelist_enabled          = true;
+    init.config.ble_adv_fast_enabled               = true;
+    init.config.ble_adv_fast_interval              = app_params_get(APP_PARAM_ADV_INTERVAL);
+    init.config.ble_adv_fast_timeout               = APP_ADV_DURATION;
+    init.config.ble_adv_on_disconnect_disabled     = true;
 
     init.evt_handler = on_adv_evt;
 
@@ -1031,6 +1805,19 @@ static void idle_state_handle(void)
 }
 
 
+#if USB_CHORD_ENABLED
+/**@brief Function for switching to USB while it is active, and back to BLE when it stops.
+ */
+static void usb_chord_handler(bool active)
+{
+	transport_backend_set(active ? &usb_chord_transport : &m_ble_transport);
+	// an expansion in progress belongs to the other host
+	text_dict_reset();
+	NRF_LOG_INFO("Typing over %s", active ? "USB" : "BLE");
+}
+#endif
+
+
 /**@brief Function for application main entry.
  */
 int main(void)
@@ -1040,19 +1827,58 @@ int main(void)
 	pairing_mode = false;
 	
 	nrf_gpio_cfg_output(LED_PIN);
+	nrf_gpio_pin_write(LED_PIN, !LED_ON_LEVEL);
 
     // Initialize.
     log_init();
     timers_init();
+    err_code = app_params_init(app_params_handler);
+    APP_ERROR_CHECK(err_code);
 	buttons_init();
+#if GPIO_TRACE_ENABLED
+	uint32_t trace_pins = 1UL << PWR_BTN_PIN;
+	for (uint8_t i = 0; i < CHORD_KEY_COUNT; i++) {
+		trace_pins |= 1UL << key_pins[i];
+	}
+	err_code = gpio_trace_init(trace_pins);
+	APP_ERROR_CHECK(err_code);
+#endif
+#if LATENCY_BENCH_ENABLED
+	err_code = latency_bench_init();
+	APP_ERROR_CHECK(err_code);
+#endif
     power_management_init();
+    // USB takes over from its interrupt once the cable is detected
+    transport_backend_set(&m_ble_transport);
+#if USB_CHORD_ENABLED
+    // before the SoftDevice, which then reports VBUS
+    err_code = usb_chord_init(usb_chord_handler);
+    APP_ERROR_CHECK(err_code);
+#endif
     ble_stack_init();
+#if USB_CHORD_ENABLED
+    err_code = usb_chord_start();
+    APP_ERROR_CHECK(err_code);
+#endif
+    err_code = flash_blob_init();
+    APP_ERROR_CHECK(err_code);
     gap_params_init();
     gatt_init();
     services_init();
     advertising_init();
     conn_params_init();
+
+    // FDS users must register before the peer manager initializes FDS.
+    err_code = chord_log_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = chord_stats_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = fds_maint_init(inactive_sleep);
+    APP_ERROR_CHECK(err_code);
+    err_code = host_slots_init();
+    APP_ERROR_CHECK(err_code);
     peer_manager_init();
+    host_slots_prune();
 
     // Start execution.
     NRF_LOG_INFO("Chorded Keyboard started.");
@@ -1060,10 +1886,6 @@ int main(void)
 
     advertising_start();
 
-	// start polling buttons
-	err_code = app_timer_start(m_notification_timer_id, NOTIFICATION_INTERVAL, NULL);
-	APP_ERROR_CHECK(err_code);
-
     // Enter main loop.
     for (;;)
     {
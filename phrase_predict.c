@@ -0,0 +1,277 @@
+#include "sdk_common.h"
+#include "phrase_predict.h"
+#include "flash_blob.h"
+
+#define HEADER_LEN          (CHORD_SEPARATOR_LEN + 6)
+#define INDEX_ENTRY_LEN     4
+#define ENTRY_LEN           5
+#define WORD_NONE           PHRASE_PREDICT_CTX_ANY
+
+/**@brief Model in flash, decoded from the payload header. */
+typedef struct
+{
+    uint8_t const * p_data;
+    uint32_t        len;
+    uint8_t         accept_chord;
+    uint8_t         min_score;
+    uint16_t        word_count;
+    uint16_t        entry_count;
+    uint8_t const * p_index;
+    uint8_t const * p_entries;
+} model_t;
+
+static bool     m_enabled = true;
+static uint8_t  m_partial[PHRASE_PREDICT_MAX_WORD];     /**< Chords of the word being typed. */
+static uint8_t  m_partial_len;
+static bool     m_overflow;                             /**< The word being typed is too long to predict. */
+static uint16_t m_prev = PHRASE_PREDICT_CTX_ANY;        /**< Word before the one being typed. */
+static uint16_t m_suggestion = WORD_NONE;
+
+static bool model_get(model_t * p_model)
+{
+    p_model->p_data = flash_blob_get(FLASH_BLOB_PHRASE_MODEL, PHRASE_PREDICT_FORMAT, &p_model->len);
+
+    if ((p_model->p_data == NULL) || (p_model->len < HEADER_LEN))
+    {
+        return false;
+    }
+
+    p_model->accept_chord = p_model->p_data[CHORD_SEPARATOR_LEN];
+    p_model->min_score    = p_model->p_data[CHORD_SEPARATOR_LEN + 1];
+    p_model->word_count   = uint16_decode(&p_model->p_data[CHORD_SEPARATOR_LEN + 2]);
+    p_model->entry_count  = uint16_decode(&p_model->p_data[CHORD_SEPARATOR_LEN + 4]);
+    p_model->p_index      = &p_model->p_data[HEADER_LEN];
+    p_model->p_entries    = p_model->p_index + p_model->word_count * INDEX_ENTRY_LEN;
+
+    return (HEADER_LEN + (uint32_t)p_model->word_count * INDEX_ENTRY_LEN
+            + (uint32_t)p_model->entry_count * ENTRY_LEN <= p_model->len);
+}
+
+static uint16_t chords_hash(uint8_t const * p_chords, uint8_t len)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        hash ^= p_chords[i];
+        hash *= 16777619u;
+    }
+    return (uint16_t)((hash >> 16) ^ hash);
+}
+
+/**@brief Function for decoding a word record, checking that it lies within the payload.
+ */
+static bool word_get(model_t const * p_model, uint16_t word,
+                     uint8_t const ** pp_chords, uint8_t * p_chord_len,
+                     char const ** pp_text, uint8_t * p_text_len)
+{
+    if (word >= p_model->word_count)
+    {
+        return false;
+    }
+
+    uint32_t offset = uint16_decode(&p_model->p_index[word * INDEX_ENTRY_LEN + 2]);
+
+    if (offset + 1 > p_model->len)
+    {
+        return false;
+    }
+    *p_chord_len = p_model->p_data[offset];
+    *pp_chords   = &p_model->p_data[offset + 1];
+    offset      += 1 + *p_chord_len;
+
+    if (offset + 1 > p_model->len)
+    {
+        return false;
+    }
+    *p_text_len = p_model->p_data[offset];
+    *pp_text    = (char const *)&p_model->p_data[offset + 1];
+
+    return (offset + 1 + *p_text_len <= p_model->len);
+}
+
+/**@brief Function for finding the word typed, by hash and then by its chords.
+ */
+static uint16_t word_find(model_t const * p_model, uint8_t const * p_chords, uint8_t len)
+{
+    uint16_t hash = chords_hash(p_chords, len);
+    uint16_t lo   = 0;
+    uint16_t hi   = p_model->word_count;
+
+    while (lo < hi)
+    {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+
+        if (uint16_decode(&p_model->p_index[mid * INDEX_ENTRY_LEN]) < hash)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for (uint16_t i = lo; (i < p_model->word_count) && (i < lo + PHRASE_PREDICT_MAX_SCAN); i++)
+    {
+        uint8_t const * p_word_chords;
+        uint8_t         chord_len;
+        char const    * p_text;
+        uint8_t         text_len;
+
+        if (uint16_decode(&p_model->p_index[i * INDEX_ENTRY_LEN]) != hash)
+        {
+            break;
+        }
+        if (word_get(p_model, i, &p_word_chords, &chord_len, &p_text, &text_len)
+            && (chord_len == len) && (memcmp(p_word_chords, p_chords, len) == 0))
+        {
+            return i;
+        }
+    }
+    return WORD_NONE;
+}
+
+/**@brief Function for finding the best word after a context that continues the word being typed.
+ */
+static uint16_t candidate_find(model_t const * p_model, uint16_t context)
+{
+    uint16_t lo = 0;
+    uint16_t hi = p_model->entry_count;
+
+    while (lo < hi)
+    {
+        uint16_t mid = (uint16_t)((lo + hi) / 2);
+
+        if (uint16_decode(&p_model->p_entries[mid * ENTRY_LEN]) < context)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for (uint16_t i = lo; (i < p_model->entry_count) && (i < lo + PHRASE_PREDICT_MAX_SCAN); i++)
+    {
+        uint8_t const * p_entry = &p_model->p_entries[i * ENTRY_LEN];
+        uint8_t const * p_word_chords;
+        uint8_t         chord_len;
+        char const    * p_text;
+        uint8_t         text_len;
+
+        if ((uint16_decode(p_entry) != context) || (p_entry[4] < p_model->min_score))
+        {
+            // End of the list, or of the candidates good enough to show.
+            break;
+        }
+
+        uint16_t word = uint16_decode(&p_entry[2]);
+
+        if (word_get(p_model, word, &p_word_chords, &chord_len, &p_text, &text_len)
+            && (chord_len > m_partial_len) && (memcmp(p_word_chords, m_partial, m_partial_len) == 0))
+        {
+            return word;
+        }
+    }
+    return WORD_NONE;
+}
+
+static bool is_separator(model_t const * p_model, uint8_t chord)
+{
+    if (chord >= CHORD_SEPARATOR_WORDS * 32)
+    {
+        return false;
+    }
+    return (uint32_decode(&p_model->p_data[(chord / 32) * sizeof(uint32_t)]) >> (chord % 32)) & 1;
+}
+
+static void word_start(uint16_t prev)
+{
+    m_prev        = prev;
+    m_partial_len = 0;
+    m_overflow    = false;
+}
+
+phrase_predict_action_t phrase_predict_chord(uint8_t chord, phrase_predict_text_t * p_text)
+{
+    model_t         model;
+    uint8_t const * p_chords;
+    uint8_t         chord_len;
+    uint16_t        suggestion = WORD_NONE;
+
+    if (!m_enabled || !model_get(&model))
+    {
+        word_start(PHRASE_PREDICT_CTX_ANY);
+        m_suggestion = WORD_NONE;
+        return PHRASE_PREDICT_ACTION_NONE;
+    }
+
+    p_text->replace = 0;
+    p_text->p_text  = "";
+    p_text->len     = 0;
+
+    if ((chord == model.accept_chord) && (m_suggestion != WORD_NONE)
+        && word_get(&model, m_suggestion, &p_chords, &chord_len, &p_text->p_text, &p_text->len))
+    {
+        p_text->replace = m_partial_len;
+        word_start(m_suggestion);
+        m_suggestion = WORD_NONE;
+        return PHRASE_PREDICT_ACTION_ACCEPT;
+    }
+
+    if (is_separator(&model, chord))
+    {
+        // Repeated separators keep the previous word as context.
+        if (m_overflow)
+        {
+            word_start(PHRASE_PREDICT_CTX_ANY);
+        }
+        else if (m_partial_len != 0)
+        {
+            word_start(word_find(&model, m_partial, m_partial_len));
+        }
+    }
+    else if (m_partial_len < PHRASE_PREDICT_MAX_WORD)
+    {
+        m_partial[m_partial_len++] = chord;
+    }
+    else
+    {
+        m_overflow = true;
+    }
+
+    if (!m_overflow)
+    {
+        suggestion = candidate_find(&model, m_prev);
+        if ((suggestion == WORD_NONE) && (m_prev != PHRASE_PREDICT_CTX_ANY))
+        {
+            // Back off to the unigrams.
+            suggestion = candidate_find(&model, PHRASE_PREDICT_CTX_ANY);
+        }
+    }
+
+    if (suggestion == m_suggestion)
+    {
+        return PHRASE_PREDICT_ACTION_NONE;
+    }
+    m_suggestion = suggestion;
+
+    if ((suggestion != WORD_NONE)
+        && !word_get(&model, suggestion, &p_chords, &chord_len, &p_text->p_text, &p_text->len))
+    {
+        p_text->len = 0;
+    }
+    return PHRASE_PREDICT_ACTION_SUGGEST;
+}
+
+void phrase_predict_enable(bool enable)
+{
+    m_enabled = enable;
+}
+
+bool phrase_predict_is_enabled(void)
+{
+    return m_enabled;
+}
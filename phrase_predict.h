@@ -0,0 +1,70 @@
+#ifndef PHRASE_PREDICT_H__
+#define PHRASE_PREDICT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chord_keys.h"
+
+/**@brief Next word prediction for ATC phraseology.
+ *
+ * @details Words are chord sequences between separator chords. A bigram model in the
+ *          FLASH_BLOB_PHRASE_MODEL blob, used in place, lists the likely words after each known
+ *          word, best first, with a quantized score. After every chord the first word that
+ *          continues the partly typed word is suggested, taken from the list of the previous word,
+ *          or from the unigram list if that has none. The accept chord of the model replaces the
+ *          partly typed word with the suggestion.
+ *
+ *          Each chord costs two binary searches and at most PHRASE_PREDICT_MAX_SCAN candidates
+ *          per list, each compared over at most PHRASE_PREDICT_MAX_WORD chords, whatever the
+ *          model size, so the time spent per chord is bounded.
+ *
+ *          Blob payload, little endian, offsets in bytes from the start of the payload:
+ *          - separators:   CHORD_SEPARATOR_WORDS u32 bitmasks of separator chords, chords 0 to 31
+ *                          first.
+ *          - accept chord (u8), minimum score to suggest (u8), word count (u16), entry count (u16).
+ *          - word index:   per word, sorted by hash: chord sequence hash (u16), record offset (u16).
+ *          - entries:      context (u16, index of the previous word in the word index, or
+ *                          PHRASE_PREDICT_CTX_ANY for unigrams), word (u16 index), score (u8);
+ *                          sorted by context, then by score from high to low.
+ *          - word record:  chord count (u8), chords, text length (u8), text.
+ *
+ *          The hash is 32-bit FNV-1a over the chords, folded to 16 bits by xoring the halves.
+ */
+
+#define PHRASE_PREDICT_FORMAT           (0x0001 + CHORD_BLOB_FORMAT_KEYS)   /**< flash_blob_header_t format of the model. */
+#define PHRASE_PREDICT_CTX_ANY          0xFFFF
+#define PHRASE_PREDICT_MAX_SCAN         16                                  /**< Candidates examined per list and chord. */
+#define PHRASE_PREDICT_MAX_WORD         16                                  /**< Longest word in chords, longer words are not predicted. */
+
+/**@brief Result of feeding a chord to the predictor. */
+typedef enum
+{
+    PHRASE_PREDICT_ACTION_NONE,                                     /**< Suggestion unchanged. */
+    PHRASE_PREDICT_ACTION_SUGGEST,                                  /**< New suggestion to show, empty text clears it. */
+    PHRASE_PREDICT_ACTION_ACCEPT                                    /**< Accept chord: insert the text instead of the chord. */
+} phrase_predict_action_t;
+
+/**@brief Text for the host. */
+typedef struct
+{
+    uint8_t      replace;                                           /**< Chords of the partly typed word to delete first. */
+    char const * p_text;                                            /**< Word in flash, not NUL terminated. */
+    uint8_t      len;
+} phrase_predict_text_t;
+
+/**@brief Function for feeding a typed chord to the predictor.
+ *
+ * @param[in]   chord    Chord value.
+ * @param[out]  p_text   Suggestion or accepted word, valid unless PHRASE_PREDICT_ACTION_NONE is returned.
+ */
+phrase_predict_action_t phrase_predict_chord(uint8_t chord, phrase_predict_text_t * p_text);
+
+/**@brief Function for switching prediction on or off.
+ */
+void phrase_predict_enable(bool enable);
+
+/**@brief Function for checking whether prediction is on.
+ */
+bool phrase_predict_is_enabled(void);
+
+#endif // PHRASE_PREDICT_H__
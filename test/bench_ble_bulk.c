@@ -0,0 +1,251 @@
+/**@brief Throughput benchmark of the bulk service.
+ *
+ * @details Moves a stream up and down through the service and counts the connection events it
+ *          takes, with the airtime of every link layer packet on the 1M PHY charged to the event it
+ *          goes out in. An event lasts NRF_SDH_BLE_GAP_EVENT_LENGTH or the connection interval,
+ *          whichever is shorter. The SoftDevice sends what is queued at the start of an event and
+ *          reports it at the end, and the central answers in the same event, so a block or ACK
+ *          written in one event is acted on in the next.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ble_bulk.h"
+#include "ble_peer.h"
+#include "check.h"
+#include "crc16.h"
+
+#define CONN            0
+#define STREAM          0
+#define DATA_LEN        65536
+#define HVN_QUEUE_SIZE  1                                           /**< BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT, main.c keeps it. */
+#define ATT_L2CAP_LEN   7                                           /**< ATT opcode and handle, and the L2CAP header. */
+#define LL_OVERHEAD     14                                          /**< Preamble, access address, header, MIC and CRC. */
+#define LL_EMPTY_US     80                                          /**< Empty packet answering a data packet. */
+#define LL_IFS_US       150
+
+typedef struct
+{
+    char const * p_name;
+    uint16_t     att_mtu;
+    uint16_t     data_len;                                          /**< Link layer payload, 27 without DLE. */
+} link_cfg_t;
+
+static const link_cfg_t m_links[] =
+{
+    {"MTU 23, DLE 27",   BLE_GATT_ATT_MTU_DEFAULT,      27},
+    {"MTU 247, DLE 251", NRF_SDH_BLE_GATT_MAX_MTU_SIZE, NRF_SDH_BLE_GAP_DATA_LENGTH},
+};
+
+static const uint32_t m_intervals_us[] = {7500, 15000, 30000};
+
+static ble_bulk_t m_bulk;
+static uint8_t    m_store[DATA_LEN];
+static uint32_t   m_store_len;
+
+static uint16_t store_read(uint32_t offset, uint8_t * p_data, uint16_t max_len)
+{
+    uint16_t len = (offset < m_store_len) ? MIN(max_len, m_store_len - offset) : 0;
+
+    memcpy(p_data, &m_store[offset], len);
+    return len;
+}
+
+static uint32_t store_write(uint32_t offset, uint8_t const * p_data, uint16_t len)
+{
+    if (offset + len > DATA_LEN)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    if (len > 0)
+    {
+        memcpy(&m_store[offset], p_data, len);
+    }
+    m_store_len = offset + len;
+    return NRF_SUCCESS;
+}
+
+static const ble_bulk_stream_t m_store_stream = {store_read, store_write, NULL};
+
+/**@brief Function for the airtime of an ATT PDU, fragmented to the link layer payload. */
+static uint32_t airtime_us(link_cfg_t const * p_link, uint16_t att_len)
+{
+    uint32_t pdu_len = att_len + ATT_L2CAP_LEN;
+    uint32_t time_us = 0;
+
+    while (pdu_len > 0)
+    {
+        uint32_t fragment = MIN(pdu_len, p_link->data_len);
+
+        time_us += (fragment + LL_OVERHEAD) * 8 + LL_EMPTY_US + 2 * LL_IFS_US;
+        pdu_len -= fragment;
+    }
+    return time_us;
+}
+
+static void setup(link_cfg_t const * p_link)
+{
+    ble_bulk_init_t init;
+
+    memset(&init, 0, sizeof(init));
+    init.uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN;
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&init.bulk_char_attr_md.cccd_write_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&init.bulk_char_attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&init.bulk_char_attr_md.write_perm);
+
+    ble_peer_init(HVN_QUEUE_SIZE);
+    CHECK_EQ(ble_bulk_init(&m_bulk, &init), NRF_SUCCESS);
+    CHECK_EQ(ble_bulk_stream_register(&m_bulk, STREAM, &m_store_stream), NRF_SUCCESS);
+    ble_peer_observer_add(ble_bulk_on_ble_evt, &m_bulk);
+
+    ble_peer_connect(CONN);
+    ble_bulk_att_mtu_set(&m_bulk, p_link->att_mtu);
+    ble_peer_subscribe(CONN, m_bulk.tx_handles.cccd_handle);
+    ble_peer_subscribe(CONN, m_bulk.ctrl_handles.cccd_handle);
+}
+
+/**@brief Function for sending the notifications queued at the start of an event, as many as fit.
+ *
+ * @return Notifications sent, into p_sent.
+ */
+static uint32_t event_notify(link_cfg_t const * p_link, uint32_t * p_budget_us, ble_peer_notification_t * p_sent)
+{
+    uint32_t queued = ble_peer_queued(CONN);
+    uint32_t count  = 0;
+
+    while (count < queued)
+    {
+        uint32_t time_us = airtime_us(p_link, ble_peer_queued_get(CONN, count)->len);
+
+        if (time_us > *p_budget_us)
+        {
+            break;
+        }
+        *p_budget_us -= time_us;
+        count++;
+    }
+    return ble_peer_tx_complete(CONN, count, p_sent);
+}
+
+/**@brief Function for counting the events a read of the stream takes. */
+static uint32_t bench_read(link_cfg_t const * p_link, uint32_t event_us)
+{
+    ble_peer_notification_t sent[BLE_PEER_QUEUE_MAX];
+    uint8_t                 open[]   = {BLE_BULK_OP_OPEN_READ, STREAM};
+    uint8_t                 expected = 0;
+    uint32_t                events   = 0;
+    uint32_t                len      = 0;
+
+    ble_peer_write(CONN, m_bulk.ctrl_handles.value_handle, BLE_GATTS_OP_WRITE_REQ, open, sizeof(open));
+    while (m_bulk.p_active != NULL)
+    {
+        uint32_t budget_us = event_us;
+        uint32_t count     = event_notify(p_link, &budget_us, sent);
+
+        events++;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if ((sent[i].handle == m_bulk.tx_handles.value_handle) && (sent[i].data[0] == expected))
+            {
+                len += sent[i].data[1];
+                expected++;
+            }
+        }
+        if (count > 0)
+        {
+            uint8_t ack[] = {BLE_BULK_OP_ACK, expected};
+
+            ble_peer_write(CONN, m_bulk.ctrl_handles.value_handle, BLE_GATTS_OP_WRITE_REQ, ack, sizeof(ack));
+        }
+        CHECK(events < 1000000);
+    }
+    CHECK_EQ(len, DATA_LEN);
+    return events;
+}
+
+/**@brief Function for counting the events a write of the stream takes. */
+static uint32_t bench_write(link_cfg_t const * p_link, uint32_t event_us)
+{
+    ble_peer_notification_t sent[BLE_PEER_QUEUE_MAX];
+    uint8_t                 open[6] = {BLE_BULK_OP_OPEN_WRITE, STREAM};
+    uint8_t                 block[BLE_BULK_MAX_BLOCK_LEN];
+    uint16_t                payload = MIN(p_link->att_mtu - 3 - BLE_BULK_HEADER_LEN, UINT8_MAX);
+    uint32_t                offset  = 0;
+    uint8_t                 seq     = 0;
+    uint8_t                 acked   = 0;
+    uint32_t                events  = 0;
+
+    m_store_len = 0;
+    uint32_encode(DATA_LEN, &open[2]);
+    ble_peer_write(CONN, m_bulk.ctrl_handles.value_handle, BLE_GATTS_OP_WRITE_REQ, open, sizeof(open));
+    while (m_bulk.p_active != NULL)
+    {
+        uint32_t budget_us = event_us;
+        uint32_t count     = event_notify(p_link, &budget_us, sent);
+
+        events++;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (sent[i].data[0] == BLE_BULK_OP_ACK)
+            {
+                acked = sent[i].data[1];
+            }
+        }
+
+        // ACKs are cumulative, so one the SoftDevice queue had no room for is made up by the next
+        while ((offset < DATA_LEN) && ((uint8_t)(seq - acked) < BLE_BULK_WINDOW))
+        {
+            uint8_t n = (uint8_t)MIN(payload, DATA_LEN - offset);
+
+            if (airtime_us(p_link, BLE_BULK_HEADER_LEN + n) > budget_us)
+            {
+                break;
+            }
+            budget_us -= airtime_us(p_link, BLE_BULK_HEADER_LEN + n);
+
+            block[0] = seq;
+            block[1] = n;
+            memcpy(&block[BLE_BULK_HEADER_LEN], &m_store[offset], n);
+            uint16_encode(crc16_compute(&block[BLE_BULK_HEADER_LEN], n, &(uint16_t){crc16_compute(block, 2, NULL)}),
+                          &block[2]);
+            ble_peer_write(CONN, m_bulk.rx_handles.value_handle, BLE_GATTS_OP_WRITE_CMD, block, BLE_BULK_HEADER_LEN + n);
+            offset += n;
+            seq++;
+        }
+        CHECK(events < 1000000);
+    }
+    CHECK_EQ(m_store_len, DATA_LEN);
+    return events;
+}
+
+int main(void)
+{
+    for (uint32_t i = 0; i < DATA_LEN; i++)
+    {
+        m_store[i] = (uint8_t)(i * 13 + i / 509);
+    }
+
+    printf("bench_ble_bulk: %u byte stream, event length %u us, %u notification(s) queued\n",
+           DATA_LEN, NRF_SDH_BLE_GAP_EVENT_LENGTH * 1250, HVN_QUEUE_SIZE);
+    printf("%-18s %10s %12s %12s\n", "link", "interval", "read kB/s", "write kB/s");
+    for (uint32_t l = 0; l < ARRAY_SIZE(m_links); l++)
+    {
+        for (uint32_t i = 0; i < ARRAY_SIZE(m_intervals_us); i++)
+        {
+            uint32_t interval_us = m_intervals_us[i];
+            uint32_t event_us    = MIN(interval_us, NRF_SDH_BLE_GAP_EVENT_LENGTH * 1250);
+            uint32_t read_events;
+            uint32_t write_events;
+
+            m_store_len = DATA_LEN;
+            setup(&m_links[l]);
+            read_events  = bench_read(&m_links[l], event_us);
+            write_events = bench_write(&m_links[l], event_us);
+
+            printf("%-18s %7.1f ms %12.1f %12.1f\n", m_links[l].p_name, interval_us / 1000.0,
+                   DATA_LEN * 1000.0 / ((double)read_events * interval_us),
+                   DATA_LEN * 1000.0 / ((double)write_events * interval_us));
+        }
+    }
+    return 0;
+}
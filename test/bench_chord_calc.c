@@ -0,0 +1,122 @@
+/**@brief Worst-case benchmark of the cockpit calculator.
+ *
+ * @details Evaluates expressions of CHORD_CALC_MAX_LEN symbols that each load one part of the
+ *          evaluator to the limit: the operator stack, reductions, the 64-bit divides of
+ *          conversions and divisions, number parsing and formatting. Reports the time of each, the
+ *          best of several runs, in ns and, on x86, in TSC cycles.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "chord_calc.h"
+#include "sdk_stub.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define ITERATIONS      100000
+#define RUNS            5
+
+typedef struct
+{
+    char const * p_name;
+    char const * p_unit;                                            /**< Repeated to fill the expression. */
+    char const * p_first;                                           /**< Written once in front. */
+} calc_load_t;
+
+static const calc_load_t m_loads[] =
+{
+    {"additions",            "+1",  "1"},
+    {"mixed precedence",     "+7*7", "1"},
+    {"divisions",            "/7",  "9"},
+    {"unit conversions",     "ef",  "9"},
+    {"open parentheses",     "(",   ""},
+    {"negations",            "-",   ""},
+    {"nested products",      "3*(", ""},
+    {"h:mm sums",            "+1:59", "0:01"},
+    {"fraction digits",      "7",   "0."},
+};
+
+static uint64_t ns_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static uint64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**@brief Function for filling an expression to CHORD_CALC_MAX_LEN symbols, ending it with an
+ *        operand so it evaluates. */
+static void expr_build(calc_load_t const * p_load, char * p_expr)
+{
+    size_t len      = strlen(p_load->p_first);
+    size_t unit_len = strlen(p_load->p_unit);
+
+    strcpy(p_expr, p_load->p_first);
+    while (len + unit_len < CHORD_CALC_MAX_LEN)
+    {
+        strcpy(&p_expr[len], p_load->p_unit);
+        len += unit_len;
+    }
+    if ((len == 0) || (strchr("+-*/(", p_expr[len - 1]) != NULL))
+    {
+        p_expr[len++] = '1';
+    }
+    p_expr[len] = '\0';
+    CHECK(len <= CHORD_CALC_MAX_LEN);
+}
+
+int main(void)
+{
+    char     worst_name[32] = "";
+    double   worst_ns       = 0;
+
+    printf("bench_chord_calc: %u symbols, best of %u runs of %u evaluations\n", CHORD_CALC_MAX_LEN, RUNS,
+           ITERATIONS);
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_loads); i++)
+    {
+        char     expr[CHORD_CALC_MAX_LEN + 1];
+        char     text[32];
+        uint64_t best_ns     = UINT64_MAX;
+        uint64_t best_cycles = UINT64_MAX;
+        bool     ok          = false;
+
+        expr_build(&m_loads[i], expr);
+        for (uint32_t run = 0; run < RUNS; run++)
+        {
+            uint64_t start_ns     = ns_now();
+            uint64_t start_cycles = cycles_now();
+
+            for (uint32_t n = 0; n < ITERATIONS; n++)
+            {
+                ok = chord_calc_eval(expr, text, sizeof(text));
+                __asm__ volatile("" ::: "memory");
+            }
+            best_cycles = MIN(best_cycles, cycles_now() - start_cycles);
+            best_ns     = MIN(best_ns, ns_now() - start_ns);
+        }
+
+        // a load that stops at an error would not be the worst case
+        CHECK(ok);
+        printf("  %-18s %6.0f ns %6.0f cycles  %s = %s\n", m_loads[i].p_name, (double)best_ns / ITERATIONS,
+               (double)best_cycles / ITERATIONS, expr, text);
+        if ((double)best_ns / ITERATIONS > worst_ns)
+        {
+            worst_ns = (double)best_ns / ITERATIONS;
+            strcpy(worst_name, m_loads[i].p_name);
+        }
+    }
+    printf("worst case: %s, %.0f ns\n", worst_name, worst_ns);
+    return 0;
+}
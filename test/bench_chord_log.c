@@ -0,0 +1,281 @@
+/**@brief Benchmark of the flash the chord journal and statistics use over hours of typing.
+ *
+ * @details Links chord_log.c, chord_stats.c and fds_maint.c over the FDS stand-in, whose pages
+ *          count the words written and the pages garbage collection erases, and replays the corpus
+ *          of sample clearances as the chords of USB_CHORD_KEYMAP, each line ended by a newline.
+ *          Chords are 150 to 400 ms apart, a little more around a space, and clearances are
+ *          separated by pauses drawn for each profile. The modules run on the idle tick as in
+ *          main.c, and after the inactive time without a chord the device flushes them and sleeps
+ *          as sleep_enter() does, waking on the next chord. The journal is first filled to
+ *          CHORD_LOG_MAX_RECORDS, so each write also deletes the oldest record as on a device in
+ *          use. Reports for each profile the journal bytes in flash per chord, record headers
+ *          included, the chords per record, and the FDS writes and GC page erases per hour.
+ *
+ *          The corpus file is the first argument, corpus/clearances.txt by default.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chord_log.h"
+#include "chord_stats.h"
+#include "check.h"
+#include "fds_maint.h"
+#include "sdk_stub.h"
+#include "usb_chord.h"
+
+#define LINES_MAX       1024
+#define LINE_LEN_MAX    256
+#define HOURS           8                                           /**< Typed for each profile. */
+#define TICK_MS         100                                         /**< APP_PARAM_TICK_INTERVAL by default. */
+#define INACTIVE_MS     300000                                      /**< APP_PARAM_INACTIVE_TIME by default. */
+#define HOUR_MS         3600000
+
+typedef struct
+{
+    char const * p_name;
+    uint32_t     pause_min_ms;                                      /**< Between two clearances. */
+    uint32_t     pause_max_ms;
+} profile_t;
+
+typedef struct
+{
+    uint32_t chords;
+    uint32_t journal_writes;
+    uint32_t journal_words;                                         /**< Record headers included. */
+    uint32_t stats_writes;
+    uint32_t gcs;
+    uint32_t page_erases;
+    uint32_t sleeps;
+} counts_t;
+
+static const profile_t m_profiles[] =
+{
+    {"busy",   5000,   60000},                                      /**< A sector at its peak. */
+    {"steady", 30000,  240000},
+    {"quiet",  120000, 900000},                                     /**< Mostly asleep between clearances. */
+};
+
+static char     m_lines[LINES_MAX][LINE_LEN_MAX];
+static uint32_t m_line_count;
+static uint32_t m_line;                                             /**< Next line to type, the corpus repeats. */
+static uint32_t m_rng = 2463534242;
+
+static uint32_t m_now;                                              /**< ms since start. */
+static uint32_t m_next_tick;
+static uint32_t m_last_chord;
+static bool     m_asleep;
+static counts_t m_counts;
+
+static uint32_t random_ms(uint32_t min, uint32_t max)
+{
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 17;
+    m_rng ^= m_rng << 5;
+    return min + m_rng % (max - min + 1);
+}
+
+/**@brief Function for counting the writes and GCs as they complete. */
+static void fds_evt_handler(fds_evt_t const * p_evt)
+{
+    fds_record_desc_t  desc;
+    fds_flash_record_t record;
+
+    if (p_evt->result != NRF_SUCCESS)
+    {
+        return;
+    }
+    switch (p_evt->id)
+    {
+        case FDS_EVT_WRITE:
+        case FDS_EVT_UPDATE:
+            if (p_evt->write.file_id == CHORD_LOG_FILE_ID)
+            {
+                desc.record_id = p_evt->write.record_id;
+                CHECK_EQ(fds_record_open(&desc, &record), NRF_SUCCESS);
+                m_counts.journal_writes++;
+                m_counts.journal_words += record.p_header->length_words + 3;
+                UNUSED_RETURN_VALUE(fds_record_close(&desc));
+            }
+            else if (p_evt->write.file_id == CHORD_STATS_FILE_ID)
+            {
+                m_counts.stats_writes++;
+            }
+            break;
+
+        case FDS_EVT_GC:
+            m_counts.gcs++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void sleep_ready(void)
+{
+    m_asleep = true;
+}
+
+/**@brief Function for the flush and sleep of sleep_enter() in main.c, FDS completing meanwhile. */
+static void sleep_enter(void)
+{
+    chord_log_flush();
+    chord_stats_flush();
+    if (fds_maint_sleep_prepare())
+    {
+        UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+        CHECK(m_asleep);
+    }
+    else
+    {
+        m_asleep = true;
+    }
+    m_counts.sleeps++;
+}
+
+/**@brief Function for running the idle tick until a time, or until the device sleeps. */
+static void run_until(uint32_t time)
+{
+    while (!m_asleep && (m_next_tick <= time))
+    {
+        m_now = m_next_tick;
+        m_next_tick += TICK_MS;
+        chord_log_process(m_now);
+        chord_stats_process(m_now);
+        fds_maint_process(m_now);
+        UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+        if (m_now - m_last_chord >= INACTIVE_MS)
+        {
+            sleep_enter();
+        }
+    }
+    m_now = time;
+}
+
+/**@brief Function for typing a character, the key press wakes a sleeping device. */
+static void chord_type(char c)
+{
+    char const * p = memchr(USB_CHORD_KEYMAP, c, sizeof(USB_CHORD_KEYMAP) - 1);
+    uint8_t      chord;
+
+    if ((p == NULL) || (c == '\0'))
+    {
+        return;
+    }
+    chord = (uint8_t)(p - USB_CHORD_KEYMAP);
+    if (m_asleep)
+    {
+        m_asleep    = false;
+        m_next_tick = m_now + TICK_MS;
+    }
+    fds_maint_activity(m_now);
+    chord_log_add(chord, m_now);
+    chord_stats_add(chord);
+    m_last_chord = m_now;
+    m_counts.chords++;
+}
+
+/**@brief Function for typing the next clearance and pausing after it. */
+static void clearance_type(profile_t const * p_profile)
+{
+    char const * p_line = m_lines[m_line];
+    char         prev   = '\n';
+
+    m_line = (m_line + 1) % m_line_count;
+    for (char const * p = p_line; ; p++)
+    {
+        char c = (*p == '\0') ? '\n' : *p;
+
+        run_until(m_now + (((c == ' ') || (prev == ' ')) ? random_ms(300, 700) : random_ms(150, 400)));
+        chord_type(c);
+        prev = c;
+        if (*p == '\0')
+        {
+            break;
+        }
+    }
+    run_until(m_now + random_ms(p_profile->pause_min_ms, p_profile->pause_max_ms));
+}
+
+/**@brief Function for counting the journal records in flash. */
+static uint32_t journal_records(void)
+{
+    fds_record_desc_t desc;
+    fds_find_token_t  token;
+    uint32_t          count = 0;
+
+    memset(&token, 0, sizeof(token));
+    while (fds_record_find(CHORD_LOG_FILE_ID, CHORD_LOG_RECORD_KEY, &desc, &token) == NRF_SUCCESS)
+    {
+        count++;
+    }
+    return count;
+}
+
+static void corpus_load(char const * p_path)
+{
+    FILE * p_file = fopen(p_path, "r");
+
+    if (p_file == NULL)
+    {
+        fprintf(stderr, "bench_chord_log: cannot open %s\n", p_path);
+        exit(1);
+    }
+    while ((m_line_count < LINES_MAX) && (fgets(m_lines[m_line_count], LINE_LEN_MAX, p_file) != NULL))
+    {
+        m_lines[m_line_count][strcspn(m_lines[m_line_count], "\n")] = '\0';
+        if (m_lines[m_line_count][0] != '\0')
+        {
+            m_line_count++;
+        }
+    }
+    fclose(p_file);
+    CHECK(m_line_count > 0);
+}
+
+int main(int argc, char * argv[])
+{
+    corpus_load((argc > 1) ? argv[1] : "corpus/clearances.txt");
+
+    sdk_stub_reset();
+    CHECK_EQ(chord_log_init(), NRF_SUCCESS);
+    CHECK_EQ(chord_stats_init(), NRF_SUCCESS);
+    CHECK_EQ(fds_maint_init(sleep_ready), NRF_SUCCESS);
+    CHECK_EQ(fds_register(fds_evt_handler), NRF_SUCCESS);
+    CHECK_EQ(fds_init(), NRF_SUCCESS);
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+
+    while (journal_records() < CHORD_LOG_MAX_RECORDS)
+    {
+        clearance_type(&m_profiles[0]);
+    }
+
+    printf("bench_chord_log: %u clearances, %u h per profile, tick %u ms, sleep after %u s\n", m_line_count, HOURS,
+           TICK_MS, INACTIVE_MS / 1000);
+    printf("  %-8s %9s %8s | %11s %13s | writes/h: %7s %5s | %5s %8s | %8s\n", "profile", "pause s", "chords/h",
+           "bytes/chord", "chords/record", "journal", "stats", "GC/h", "erases/h", "sleeps/h");
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_profiles); i++)
+    {
+        profile_t const * p_profile = &m_profiles[i];
+        uint32_t          end       = m_now + HOURS * HOUR_MS;
+        uint32_t          erases    = sdk_stub_fds_page_erases;
+        char              pause[16];
+
+        memset(&m_counts, 0, sizeof(m_counts));
+        while (m_now < end)
+        {
+            clearance_type(p_profile);
+        }
+        m_counts.page_erases = sdk_stub_fds_page_erases - erases;
+
+        snprintf(pause, sizeof(pause), "%u-%u", p_profile->pause_min_ms / 1000, p_profile->pause_max_ms / 1000);
+        printf("  %-8s %9s %8.0f | %11.2f %13.1f | %17.1f %5.1f | %5.1f %8.1f | %8.1f\n", p_profile->p_name, pause,
+               (double)m_counts.chords / HOURS,
+               (double)m_counts.journal_words * 4 / m_counts.chords,
+               (double)m_counts.chords / m_counts.journal_writes, (double)m_counts.journal_writes / HOURS,
+               (double)m_counts.stats_writes / HOURS, (double)m_counts.gcs / HOURS,
+               (double)m_counts.page_erases / HOURS, (double)m_counts.sleeps / HOURS);
+    }
+    return 0;
+}
@@ -0,0 +1,363 @@
+/**@brief Replay of captured key input through the firmware's scanner.
+ *
+ * @details Builds main.c over the stand-ins in stub/, as the fuzz target does, and plays each
+ *          trace written by gpio_trace.py into the key pins at its sample period, with the tick
+ *          timer and the GPIOTE PORT event in RTC time, so poll_buttons() scans it as on the
+ *          device. For each trace it reports the chords sent, the edit distance to the chords the
+ *          trace expects if it lists them, the latency from the last key change to the chord
+ *          being sent, and the CPU wake ups. Traces come from the arguments, or corpus/gpio.
+ */
+
+#include <dirent.h>
+#include <stdlib.h>
+#include "check.h"
+#include "sdk_stub.h"
+
+#define main firmware_main
+#include "main.c"
+#undef main
+
+#define RTC_HZ              (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+#define US_TO_RTC(us)       ((uint64_t)(us) * RTC_HZ / 1000000)
+#define RTC_TO_MS(ticks)    ((double)(ticks) * 1000 / RTC_HZ)
+
+#define TRACE_DIR           "corpus/gpio"
+#define CHORDS_MAX          8192
+#define PWR_BTN_KEY         0x100                                   /**< Power button in the keys of a trace. */
+
+static uint8_t   m_expected[CHORDS_MAX];
+static uint32_t  m_expected_count;
+static uint8_t   m_sent[CHORDS_MAX];
+static uint32_t  m_latency[CHORDS_MAX];                             /**< RTC ticks, per chord sent. */
+static uint32_t  m_sent_count;
+
+static uint64_t  m_now;                                             /**< RTC ticks, never wraps. */
+static uint64_t  m_next_fire;
+static uint64_t  m_key_change;                                      /**< Last change of the key pins. */
+static uint32_t  m_timer_starts;
+static uint32_t  m_wakes;
+static bool      m_system_off;
+
+static bool bench_is_ready(void)
+{
+    return true;
+}
+
+static ret_code_t bench_send(uint8_t lane, transport_record_t const * p_record)
+{
+    if ((p_record->type == TRANSPORT_RECORD_CHORD) && (m_sent_count < CHORDS_MAX))
+    {
+        m_sent[m_sent_count]    = p_record->data[0];
+        m_latency[m_sent_count] = (uint32_t)(m_now - m_key_change);
+        m_sent_count++;
+    }
+    return NRF_SUCCESS;
+}
+
+static const transport_backend_t m_bench_backend = {"Bench", bench_is_ready, bench_send, 1};
+
+static void bench_system_off(void)
+{
+    m_system_off = true;
+}
+
+/**@brief Function for following the tick timer after a handler ran, it is restarted on a rate change. */
+static void timer_follow(bool fired)
+{
+    if (sdk_stub_timer_starts != m_timer_starts)
+    {
+        m_timer_starts = sdk_stub_timer_starts;
+        m_next_fire    = m_now + sdk_stub_timer_ticks;
+    }
+    else if (fired)
+    {
+        m_next_fire += sdk_stub_timer_ticks;
+    }
+}
+
+/**@brief Function for running the firmware until a time, waking it on each tick. */
+static void run_until(uint64_t time)
+{
+    while (m_next_fire <= time)
+    {
+        m_now        = m_next_fire;
+        sdk_stub_rtc = (uint32_t)m_now;
+        sdk_stub_timer_handler(NULL);
+        m_wakes++;
+        timer_follow(true);
+    }
+    m_now        = time;
+    sdk_stub_rtc = (uint32_t)m_now;
+}
+
+/**@brief Function for setting the pins to the keys of a trace, a press while none is down raises
+ *        the PORT event. */
+static void keys_set(uint32_t keys, uint32_t prev)
+{
+    sdk_stub_gpio_in = 0xFFFFFFFF;
+    for (uint8_t i = 0; i < CHORD_KEY_COUNT; i++)
+    {
+        if (keys & (1 << i))
+        {
+            sdk_stub_gpio_in &= ~(1UL << key_pins[i]);
+        }
+    }
+    if (keys & PWR_BTN_KEY)
+    {
+        sdk_stub_gpio_in &= ~(1UL << PWR_BTN_PIN);
+    }
+    if ((keys ^ prev) & ~PWR_BTN_KEY)
+    {
+        m_key_change = m_now;
+    }
+    if ((prev == 0) && (keys != 0))
+    {
+        sdk_stub_gpiote_port = true;
+        GPIOTE_IRQHandler();
+        m_wakes++;
+        timer_follow(false);
+    }
+}
+
+/**@brief Function for the edit distance between the chords sent and the chords expected. */
+static uint32_t chord_errors(void)
+{
+    static uint32_t row[CHORDS_MAX + 1];
+
+    for (uint32_t j = 0; j <= m_expected_count; j++)
+    {
+        row[j] = j;
+    }
+    for (uint32_t i = 1; i <= m_sent_count; i++)
+    {
+        uint32_t diag = row[0];
+
+        row[0] = i;
+        for (uint32_t j = 1; j <= m_expected_count; j++)
+        {
+            uint32_t up = row[j];
+
+            row[j] = MIN(MIN(row[j] + 1, row[j - 1] + 1), diag + (m_sent[i - 1] != m_expected[j - 1]));
+            diag   = up;
+        }
+    }
+    return row[m_expected_count];
+}
+
+static int latency_compare(void const * p_a, void const * p_b)
+{
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static double latency_ms(double fraction)
+{
+    return (m_sent_count == 0) ? 0 : RTC_TO_MS(m_latency[MIN((uint32_t)(fraction * m_sent_count), m_sent_count - 1)]);
+}
+
+/**@brief Function for replaying a trace, see gpio_trace.py for the format.
+ *
+ * @return false if the file is not a trace.
+ */
+static bool replay(char const * p_path)
+{
+    FILE   * p_file = fopen(p_path, "r");
+    char     line[256];
+    uint32_t period_us = 0;
+    uint32_t keys      = 0;
+    uint32_t changes   = 0;
+    uint64_t samples   = 0;
+    uint64_t gap       = 0;
+    uint64_t start;
+
+    if (p_file == NULL)
+    {
+        return false;
+    }
+
+    // the pins are released and the scan is idle between traces
+    keys_set(0, 0);
+    run_until(m_now + US_TO_RTC(app_params_get(APP_PARAM_SCAN_HOLD_TIME) * 1000 + 1000000));
+    start            = m_now;
+    m_wakes          = 0;
+    m_sent_count     = 0;
+    m_expected_count = 0;
+
+    while (fgets(line, sizeof(line), p_file) != NULL)
+    {
+        char   * p_arg;
+        uint32_t value;
+        uint32_t run;
+
+        if ((line[0] == '#') || (line[0] == '\n'))
+        {
+            continue;
+        }
+        if (sscanf(line, "gpio_trace %u", &value) == 1)
+        {
+            period_us = value;
+        }
+        else if (strncmp(line, "expect ", 7) == 0)
+        {
+            for (p_arg = &line[7]; (sscanf(p_arg, "%x", &value) == 1) && (m_expected_count < CHORDS_MAX);)
+            {
+                m_expected[m_expected_count++] = (uint8_t)value;
+                p_arg                          = strchr(p_arg + 1, ' ');
+                if (p_arg == NULL)
+                {
+                    break;
+                }
+            }
+        }
+        else if ((period_us != 0) && (sscanf(line, "gap %u", &run) == 1))
+        {
+            // the keys stay as they were, nothing is known of them
+            gap     += run;
+            samples += run;
+        }
+        else if ((period_us != 0) && (sscanf(line, "%x %u", &value, &run) == 2))
+        {
+            run_until(start + US_TO_RTC(samples * period_us));
+            keys_set(value, keys);
+            changes += (value != keys);
+            keys     = value;
+            samples += run;
+        }
+        else
+        {
+            fclose(p_file);
+            return false;
+        }
+    }
+    fclose(p_file);
+    if (period_us == 0)
+    {
+        return false;
+    }
+    run_until(start + US_TO_RTC(samples * period_us));
+
+    qsort(m_latency, m_sent_count, sizeof(m_latency[0]), latency_compare);
+    printf("  %-24s %6.1f s %6u %6u ", strrchr(p_path, '/') ? strrchr(p_path, '/') + 1 : p_path,
+           (double)samples * period_us / 1e6, changes, m_sent_count);
+    if (m_expected_count != 0)
+    {
+        printf("%6u", chord_errors());
+    }
+    else
+    {
+        printf("%6s", "-");
+    }
+    printf(" | %5.2f %5.2f %5.2f | %7.1f", latency_ms(0.5), latency_ms(0.99),
+           (m_sent_count == 0) ? 0 : RTC_TO_MS(m_latency[m_sent_count - 1]),
+           m_wakes / ((double)samples * period_us / 1e6));
+    if (gap != 0)
+    {
+        printf("  %llu samples lost", (unsigned long long)gap);
+    }
+    if (m_system_off)
+    {
+        printf("  slept");
+    }
+    printf("\n");
+
+    m_system_off = false;
+    return true;
+}
+
+/**@brief Function for starting the firmware as on power up, with this benchmark as the host. */
+static void firmware_start(void)
+{
+    ret_code_t err_code;
+
+    sdk_stub_reset();
+    sdk_stub_gpio_in            = 0xFFFFFFFF;
+    sdk_stub_system_off_handler = bench_system_off;
+    nrf_gpio_cfg_output(LED_PIN);
+    timers_init();
+    err_code = app_params_init(app_params_handler);
+    APP_ERROR_CHECK(err_code);
+    buttons_init();
+    power_management_init();
+    ble_stack_init();
+    err_code = flash_blob_init();
+    APP_ERROR_CHECK(err_code);
+    gap_params_init();
+    gatt_init();
+    services_init();
+    advertising_init();
+    conn_params_init();
+    err_code = chord_log_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = chord_stats_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = fds_maint_init(inactive_sleep);
+    APP_ERROR_CHECK(err_code);
+    err_code = host_slots_init();
+    APP_ERROR_CHECK(err_code);
+    peer_manager_init();
+    host_slots_prune();
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+    application_timers_start();
+    timer_follow(false);
+    transport_backend_set(&m_bench_backend);
+}
+
+static int path_compare(void const * p_a, void const * p_b)
+{
+    return strcmp(*(char * const *)p_a, *(char * const *)p_b);
+}
+
+int main(int argc, char * argv[])
+{
+    char         * paths[64];
+    int            count = 0;
+    DIR          * p_dir;
+    struct dirent * p_entry;
+
+    if (argc > 1)
+    {
+        for (int i = 1; (i < argc) && (count < (int)ARRAY_SIZE(paths)); i++)
+        {
+            paths[count++] = strdup(argv[i]);
+        }
+    }
+    else
+    {
+        p_dir = opendir(TRACE_DIR);
+        CHECK(p_dir != NULL);
+        while (((p_entry = readdir(p_dir)) != NULL) && (count < (int)ARRAY_SIZE(paths)))
+        {
+            size_t len = strlen(p_entry->d_name);
+
+            if ((len > 6) && (strcmp(&p_entry->d_name[len - 6], ".trace") == 0))
+            {
+                paths[count] = malloc(sizeof(TRACE_DIR) + 1 + len);
+                sprintf(paths[count++], "%s/%s", TRACE_DIR, p_entry->d_name);
+            }
+        }
+        closedir(p_dir);
+    }
+    qsort(paths, count, sizeof(paths[0]), path_compare);
+
+    firmware_start();
+    printf("bench_gpio_trace: scan %u ms, hold %u ms, idle %u ms, debounce %u ms, rollover %u ms\n",
+           app_params_get(APP_PARAM_SCAN_FAST_INTERVAL), app_params_get(APP_PARAM_SCAN_HOLD_TIME),
+           app_params_get(APP_PARAM_TICK_INTERVAL), app_params_get(APP_PARAM_DEBOUNCE_TIME),
+           app_params_get(APP_PARAM_ROLLOVER_TIME));
+    printf("  %-24s %8s %6s %6s %6s | latency ms: p50 p99 max | wakes/s\n", "trace", "length", "edges", "chords",
+           "errors");
+    for (int i = 0; i < count; i++)
+    {
+        if (!replay(paths[i]))
+        {
+            fprintf(stderr, "bench_gpio_trace: %s is not a trace\n", paths[i]);
+            exit(1);
+        }
+        free(paths[i]);
+    }
+    return 0;
+}
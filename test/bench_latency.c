@@ -0,0 +1,328 @@
+/**@brief Key edge to air latency sweep, the host twin of armgcc/latency.py.
+ *
+ * @details Builds main.c with LATENCY_BENCH_ENABLED over the stand-ins in stub/ and links
+ *          latency_bench.c, and plays the debugger and the central latency.py drives on a board:
+ *          each run is started over the RTT stand-in, the firmware replaces its key pins with the
+ *          script of latency_bench.h and timestamps each chord at its release edge, when it is
+ *          debounced, when the SoftDevice takes the notification and when the central of
+ *          ble_peer.c acknowledges it. The tick timer and the connection events, each sending
+ *          every notification queued, run in RTC time.
+ *
+ *          Sweeps APP_PARAM_DEBOUNCE_TIME, APP_PARAM_SCAN_FAST_INTERVAL, the connection interval
+ *          and the notifications the SoftDevice queues per link, which is how many chords go in
+ *          one connection event as the transport sends each as it comes. Writes a CSV row per
+ *          chord with the columns of latency.py and hvn_queue, and prints a summary per setting.
+ *          The CSV goes to the first argument, the executable's path with .csv appended by
+ *          default. Radio retransmissions and the central's own delays are not modelled; a run
+ *          of latency.py on a board is the check of those.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "ble_peer.h"
+#include "sdk_stub.h"
+
+#define main firmware_main
+#include "main.c"
+#undef main
+
+#define RTC_HZ              (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+#define US_TO_RTC(us)       ((uint64_t)(us) * RTC_HZ / 1000000)
+
+#define SETTLE_US           2000000                                 /**< Between runs, as latency.py. */
+#define STEP_US             100000                                  /**< RTT polling period of the debugger. */
+#define RUN_TIMEOUT_US      60000000
+#define STREAM_MAX          (sizeof(latency_bench_header_t) + (4 * LATENCY_BENCH_CHORDS + 1) * sizeof(latency_bench_record_t))
+#define MARK_NONE           UINT32_MAX
+
+static const uint32_t m_debounce_ms[] = {0, 5, 10};                 /**< The sweep of armgcc/Makefile. */
+static const uint32_t m_scan_ms[]     = {1, 2, 5};
+static const uint32_t m_conn_us[]     = {7500, 15000, 30000};
+static const uint32_t m_hvn_queue[]   = {1, 4};                     /**< BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT and more. */
+
+static uint64_t m_now;                                              /**< RTC ticks, never wraps. */
+static uint64_t m_next_fire;
+static uint32_t m_timer_starts;
+static uint64_t m_conn_next_us;                                     /**< Next connection event. */
+static uint32_t m_conn_interval_us;
+
+static uint8_t  m_stream[STREAM_MAX];                               /**< RTT up buffer of a run. */
+static uint32_t m_stream_len;
+static uint32_t m_marks[LATENCY_BENCH_CHORDS][LATENCY_BENCH_MARK_END]; /**< us since the start of the run. */
+static uint8_t  m_chords[LATENCY_BENCH_CHORDS];
+static uint32_t m_air[LATENCY_BENCH_CHORDS];                        /**< Edge to air, us, of the chords that arrived. */
+
+static void bench_system_off(void)
+{
+    fprintf(stderr, "bench_latency: the firmware went to sleep\n");
+    exit(1);
+}
+
+/**@brief Function for following the tick timer after a handler ran, it is restarted on a rate change. */
+static void timer_follow(bool fired)
+{
+    if (sdk_stub_timer_starts != m_timer_starts)
+    {
+        m_timer_starts = sdk_stub_timer_starts;
+        m_next_fire    = m_now + sdk_stub_timer_ticks;
+    }
+    else if (fired)
+    {
+        m_next_fire += sdk_stub_timer_ticks;
+    }
+}
+
+/**@brief Function for running the firmware and the connection events of the link until a time. */
+static void run_until(uint64_t time)
+{
+    for (;;)
+    {
+        uint64_t conn_event = US_TO_RTC(m_conn_next_us);
+
+        if (MIN(m_next_fire, conn_event) > time)
+        {
+            break;
+        }
+        if (conn_event <= m_next_fire)
+        {
+            m_now        = conn_event;
+            sdk_stub_rtc = (uint32_t)m_now;
+            UNUSED_RETURN_VALUE(ble_peer_tx_complete(0, BLE_PEER_QUEUE_MAX, NULL));
+            m_conn_next_us += m_conn_interval_us;
+        }
+        else
+        {
+            m_now        = m_next_fire;
+            sdk_stub_rtc = (uint32_t)m_now;
+            sdk_stub_timer_handler(NULL);
+            timer_follow(true);
+        }
+    }
+    m_now        = time;
+    sdk_stub_rtc = (uint32_t)m_now;
+}
+
+/**@brief Function for setting what latency.py sets through the configuration service, and the
+ *        connection interval and HVN queue the central and the SoftDevice then use.
+ */
+static void setting_apply(uint32_t debounce_ms, uint32_t scan_ms, uint32_t conn_us, uint32_t hvn_queue)
+{
+    uint32_t units = conn_us / 1250;
+
+    // both bounds, in the order that keeps minimum <= maximum
+    if (units > app_params_get(APP_PARAM_MAX_CONN_INTERVAL))
+    {
+        CHECK_EQ(app_params_set(APP_PARAM_MAX_CONN_INTERVAL, units), NRF_SUCCESS);
+        CHECK_EQ(app_params_set(APP_PARAM_MIN_CONN_INTERVAL, units), NRF_SUCCESS);
+    }
+    else
+    {
+        CHECK_EQ(app_params_set(APP_PARAM_MIN_CONN_INTERVAL, units), NRF_SUCCESS);
+        CHECK_EQ(app_params_set(APP_PARAM_MAX_CONN_INTERVAL, units), NRF_SUCCESS);
+    }
+    CHECK_EQ(app_params_set(APP_PARAM_DEBOUNCE_TIME, debounce_ms), NRF_SUCCESS);
+    CHECK_EQ(app_params_set(APP_PARAM_SCAN_FAST_INTERVAL, scan_ms), NRF_SUCCESS);
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+    timer_follow(false);
+
+    // the central accepts the interval asked for, the update reaches the firmware as on a board
+    m_conn_interval_us = conn_us;
+    latency_bench_conn_interval_set((uint16_t)units);
+    ble_peer_queue_size_set(hvn_queue);
+}
+
+/**@brief Function for starting a run and reading its stream until LATENCY_BENCH_MARK_END. */
+static void run_stream(void)
+{
+    static const char cmd = LATENCY_BENCH_CMD_RUN;
+    uint8_t           discard[64];
+    uint64_t          deadline = m_now + US_TO_RTC(RUN_TIMEOUT_US);
+
+    while (sdk_stub_rtt_read(LATENCY_BENCH_RTT_CHANNEL, discard, sizeof(discard)) != 0)
+    {
+    }
+    CHECK_EQ(sdk_stub_rtt_write(LATENCY_BENCH_RTT_CHANNEL, &cmd, 1), 1);
+
+    m_stream_len = 0;
+    while (m_now < deadline)
+    {
+        run_until(m_now + US_TO_RTC(STEP_US));
+        m_stream_len += sdk_stub_rtt_read(LATENCY_BENCH_RTT_CHANNEL, &m_stream[m_stream_len],
+                                          sizeof(m_stream) - m_stream_len);
+        if ((m_stream_len >= sizeof(latency_bench_header_t) + sizeof(latency_bench_record_t))
+            && (((m_stream_len - sizeof(latency_bench_header_t)) % sizeof(latency_bench_record_t)) == 0)
+            && (m_stream[m_stream_len - sizeof(latency_bench_record_t) + offsetof(latency_bench_record_t, mark)]
+                == LATENCY_BENCH_MARK_END))
+        {
+            return;
+        }
+    }
+    fprintf(stderr, "bench_latency: no end of run within %u s\n", RUN_TIMEOUT_US / 1000000);
+    exit(1);
+}
+
+static int cmp_u32(void const * p_a, void const * p_b)
+{
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Function for the time from the edge of a chord to one of its marks, empty if either is missing. */
+static void since_edge_print(FILE * p_csv, uint16_t seq, latency_bench_mark_t mark)
+{
+    if ((m_marks[seq][LATENCY_BENCH_MARK_EDGE] != MARK_NONE) && (m_marks[seq][mark] != MARK_NONE))
+    {
+        fprintf(p_csv, ",%u", m_marks[seq][mark] - m_marks[seq][LATENCY_BENCH_MARK_EDGE]);
+    }
+    else
+    {
+        fprintf(p_csv, ",");
+    }
+}
+
+/**@brief Function for a run at a setting, a CSV row per chord and a summary line. */
+static void run(FILE * p_csv, uint32_t debounce_ms, uint32_t scan_ms, uint32_t conn_us, uint32_t hvn_queue)
+{
+    latency_bench_header_t header;
+    uint32_t               count = 0;
+    double                 conn_ms;
+
+    setting_apply(debounce_ms, scan_ms, conn_us, hvn_queue);
+    run_until(m_now + US_TO_RTC(SETTLE_US));
+    run_stream();
+
+    memcpy(&header, m_stream, sizeof(header));
+    CHECK_EQ(header.magic, LATENCY_BENCH_MAGIC);
+    CHECK_EQ(header.debounce_ms, debounce_ms);
+    CHECK_EQ(header.scan_interval_ms, scan_ms);
+    memset(m_marks, 0xFF, sizeof(m_marks));
+    for (uint32_t pos = sizeof(header); pos < m_stream_len; pos += sizeof(latency_bench_record_t))
+    {
+        latency_bench_record_t record;
+
+        memcpy(&record, &m_stream[pos], sizeof(record));
+        if ((record.mark != LATENCY_BENCH_MARK_END) && (record.seq < LATENCY_BENCH_CHORDS))
+        {
+            m_marks[record.seq][record.mark] = record.time_us;
+            m_chords[record.seq]             = record.chord;
+        }
+    }
+
+    conn_ms = header.conn_interval * 1.25;
+    for (uint16_t seq = 0; seq < LATENCY_BENCH_CHORDS; seq++)
+    {
+        if (m_marks[seq][LATENCY_BENCH_MARK_EDGE] == MARK_NONE)
+        {
+            continue;
+        }
+        fprintf(p_csv, "%u,%u,%g,%g,%u,%u,%u", debounce_ms, scan_ms, conn_us / 1000.0, conn_ms, hvn_queue, seq,
+                m_chords[seq]);
+        since_edge_print(p_csv, seq, LATENCY_BENCH_MARK_DEBOUNCED);
+        since_edge_print(p_csv, seq, LATENCY_BENCH_MARK_HVX);
+        since_edge_print(p_csv, seq, LATENCY_BENCH_MARK_AIR);
+        fprintf(p_csv, "\n");
+        if (m_marks[seq][LATENCY_BENCH_MARK_AIR] != MARK_NONE)
+        {
+            m_air[count++] = m_marks[seq][LATENCY_BENCH_MARK_AIR] - m_marks[seq][LATENCY_BENCH_MARK_EDGE];
+        }
+    }
+
+    printf("  %8u %4u %5g %6g %3u | %6u", debounce_ms, scan_ms, conn_us / 1000.0, conn_ms, hvn_queue, count);
+    if (count != 0)
+    {
+        qsort(m_air, count, sizeof(m_air[0]), cmp_u32);
+        printf(" %6.1f %6.1f %6.1f", m_air[count / 2] / 1000.0, m_air[(count - 1) * 95 / 100] / 1000.0,
+               m_air[count - 1] / 1000.0);
+    }
+    else
+    {
+        printf(" %6s %6s %6s", "-", "-", "-");
+    }
+    printf(" %7u\n", header.chords - count);
+}
+
+/**@brief Function for starting the firmware as on power up, with this benchmark as the debugger
+ *        and a central connected and subscribed to the chords.
+ */
+static void firmware_start(void)
+{
+    ret_code_t err_code;
+
+    ble_peer_init(m_hvn_queue[0]);
+    sdk_stub_gpio_in            = 0xFFFFFFFF;
+    sdk_stub_system_off_handler = bench_system_off;
+    nrf_gpio_cfg_output(LED_PIN);
+    timers_init();
+    err_code = app_params_init(app_params_handler);
+    APP_ERROR_CHECK(err_code);
+    buttons_init();
+    err_code = latency_bench_init();
+    APP_ERROR_CHECK(err_code);
+    power_management_init();
+    transport_backend_set(&m_ble_transport);
+    ble_stack_init();
+    err_code = flash_blob_init();
+    APP_ERROR_CHECK(err_code);
+    gap_params_init();
+    gatt_init();
+    services_init();
+    advertising_init();
+    conn_params_init();
+    err_code = chord_log_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = chord_stats_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = fds_maint_init(inactive_sleep);
+    APP_ERROR_CHECK(err_code);
+    err_code = host_slots_init();
+    APP_ERROR_CHECK(err_code);
+    peer_manager_init();
+    host_slots_prune();
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+    application_timers_start();
+    timer_follow(false);
+
+    // the observers NRF_SDH_BLE_OBSERVER registers on the device
+    ble_peer_observer_add(ble_evt_handler, NULL);
+    ble_peer_observer_add(ble_chord_on_ble_evt, &m_chord);
+    ble_peer_connect(0);
+    ble_peer_subscribe(0, m_chord.chord_value_handles.cccd_handle);
+    CHECK(transport_is_ready());
+}
+
+int main(int argc, char * argv[])
+{
+    char   path[256];
+    FILE * p_csv;
+
+    snprintf(path, sizeof(path), "%s.csv", argv[0]);
+    p_csv = fopen((argc > 1) ? argv[1] : path, "w");
+    CHECK(p_csv != NULL);
+    fprintf(p_csv, "debounce_ms,scan_ms,conn_ms_requested,conn_ms,hvn_queue,seq,chord,debounced_us,hvx_us,air_us\n");
+
+    firmware_start();
+    printf("bench_latency: %u chords per run, one every %u ms, bounce %u us, CSV to %s\n", LATENCY_BENCH_CHORDS,
+           LATENCY_BENCH_PERIOD_US / 1000, LATENCY_BENCH_BOUNCE_US, (argc > 1) ? argv[1] : path);
+    printf("  debounce scan  conn in use hvn | chords  edge to air ms: p50 p95 max missing\n");
+    for (uint32_t c = 0; c < ARRAY_SIZE(m_conn_us); c++)
+    {
+        for (uint32_t q = 0; q < ARRAY_SIZE(m_hvn_queue); q++)
+        {
+            for (uint32_t d = 0; d < ARRAY_SIZE(m_debounce_ms); d++)
+            {
+                for (uint32_t s = 0; s < ARRAY_SIZE(m_scan_ms); s++)
+                {
+                    run(p_csv, m_debounce_ms[d], m_scan_ms[s], m_conn_us[c], m_hvn_queue[q]);
+                }
+            }
+        }
+    }
+    fclose(p_csv);
+    return 0;
+}
@@ -0,0 +1,435 @@
+/**@brief Benchmark of next word prediction on a corpus of sample clearances.
+ *
+ * @details Builds a bigram model from four fifths of the corpus, in the blob format of
+ *          phrase_predict.h, and types the other fifth through phrase_predict_chord(), once for
+ *          each fifth. Letters are the chords of USB_CHORD_KEYMAP. The typist accepts a suggestion
+ *          as soon as it is the word being typed and saves at least one chord. Reports the chords
+ *          saved and the host time of each phrase_predict_chord() call, and checks the text the
+ *          host ends up with is the corpus.
+ *
+ *          The corpus file is the first argument, corpus/clearances.txt by default: one clearance
+ *          per line, lower case words of letters, digits spelt out as they are spoken.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "module_stub.h"
+#include "phrase_predict.h"
+#include "sdk_stub.h"
+#include "usb_chord.h"
+
+#define FOLDS           5
+#define LINES_MAX       1024
+#define WORDS_MAX       8192                                        /**< Words in the corpus. */
+#define VOCAB_MAX       512
+#define WORD_LEN_MAX    PHRASE_PREDICT_MAX_WORD
+#define OUT_MAX         256                                         /**< Text of a line, as the host has it. */
+#define CALLS_MAX       65536                                       /**< Chords timed. */
+#define MODEL_MAX       (FLASH_BLOB_PHRASE_MODEL_PAGES * 4096 - sizeof(flash_blob_header_t))
+
+#define ACCEPT_CHORD    0x20                                        /**< Key 6, outside USB_CHORD_KEYMAP. */
+#define MIN_SCORE       8                                           /**< Of 255, about 3% of what follows a word. */
+
+STATIC_ASSERT(ACCEPT_CHORD <= CHORD_COUNT);
+
+typedef struct
+{
+    char     text[WORD_LEN_MAX + 1];
+    uint16_t hash;
+    uint32_t count;                                                 /**< Times in the training lines. */
+} vocab_word_t;
+
+typedef struct
+{
+    uint16_t word;
+    uint32_t count;
+} follower_t;
+
+static char         m_corpus[1 << 20];
+static uint16_t     m_words[WORDS_MAX];                             /**< Corpus as word numbers of m_corpus_vocab. */
+static uint32_t     m_word_count;
+static uint32_t     m_line_end[LINES_MAX];                          /**< Index in m_words past each line. */
+static uint32_t     m_line_count;
+static vocab_word_t m_corpus_vocab[VOCAB_MAX];
+static uint16_t     m_corpus_vocab_count;
+
+static vocab_word_t m_vocab[VOCAB_MAX];                             /**< Training words, in word index order. */
+static uint16_t     m_vocab_count;
+static uint16_t     m_vocab_of[VOCAB_MAX];                          /**< Corpus word number to m_vocab, WORDS_MAX if not seen. */
+static uint32_t     m_bigrams[VOCAB_MAX + 1][VOCAB_MAX];            /**< Follower counts per context, the unigrams last. */
+static uint8_t      m_model[MODEL_MAX];
+static uint32_t     m_model_len;
+
+// results over all folds
+static uint32_t     m_chords_plain;
+static uint32_t     m_chords_typed;
+static uint32_t     m_accepts;
+static uint32_t     m_call_ns[CALLS_MAX];
+static uint32_t     m_calls;
+
+static uint8_t chord_of(char c)
+{
+    char const * p = memchr(USB_CHORD_KEYMAP, c, sizeof(USB_CHORD_KEYMAP) - 1);
+
+    CHECK((c != '\0') && (p != NULL));
+    return (uint8_t)(p - USB_CHORD_KEYMAP);
+}
+
+/**@brief Function for the word hash of phrase_predict.h, over the chords of a word. */
+static uint16_t word_hash(char const * p_text)
+{
+    uint32_t hash = 2166136261u;
+
+    for (; *p_text != '\0'; p_text++)
+    {
+        hash ^= chord_of(*p_text);
+        hash *= 16777619u;
+    }
+    return (uint16_t)((hash >> 16) ^ hash);
+}
+
+static void corpus_load(char const * p_path)
+{
+    FILE * p_file = fopen(p_path, "r");
+    size_t len;
+    char * p_line;
+    char * p_save;
+
+    CHECK(p_file != NULL);
+    len = fread(m_corpus, 1, sizeof(m_corpus) - 1, p_file);
+    fclose(p_file);
+    m_corpus[len] = '\0';
+
+    for (p_line = strtok_r(m_corpus, "\n", &p_save); p_line != NULL; p_line = strtok_r(NULL, "\n", &p_save))
+    {
+        char * p_word_save;
+
+        for (char * p_word = strtok_r(p_line, " ", &p_word_save); p_word != NULL;
+             p_word = strtok_r(NULL, " ", &p_word_save))
+        {
+            uint16_t w;
+
+            CHECK((strlen(p_word) <= WORD_LEN_MAX) && (m_word_count < WORDS_MAX));
+            for (w = 0; (w < m_corpus_vocab_count) && (strcmp(m_corpus_vocab[w].text, p_word) != 0); w++)
+            {
+            }
+            if (w == m_corpus_vocab_count)
+            {
+                CHECK(m_corpus_vocab_count < VOCAB_MAX);
+                strcpy(m_corpus_vocab[w].text, p_word);
+                m_corpus_vocab[w].hash = word_hash(p_word);
+                m_corpus_vocab_count++;
+            }
+            m_words[m_word_count++] = w;
+        }
+        CHECK(m_line_count < LINES_MAX);
+        m_line_end[m_line_count++] = m_word_count;
+    }
+    CHECK(m_line_count >= FOLDS);
+}
+
+static int cmp_u32(void const * p_a, void const * p_b)
+{
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static int vocab_cmp(void const * p_a, void const * p_b)
+{
+    vocab_word_t const * p_wa = p_a;
+    vocab_word_t const * p_wb = p_b;
+
+    if (p_wa->hash != p_wb->hash)
+    {
+        return (p_wa->hash < p_wb->hash) ? -1 : 1;
+    }
+    return strcmp(p_wa->text, p_wb->text);
+}
+
+static int follower_cmp(void const * p_a, void const * p_b)
+{
+    follower_t const * p_fa = p_a;
+    follower_t const * p_fb = p_b;
+
+    if (p_fa->count != p_fb->count)
+    {
+        return (p_fa->count > p_fb->count) ? -1 : 1;
+    }
+    return (int)p_fa->word - (int)p_fb->word;
+}
+
+static uint32_t line_start(uint32_t line)
+{
+    return (line == 0) ? 0 : m_line_end[line - 1];
+}
+
+/**@brief Function for writing the entries of a context, best first, down to MIN_SCORE. */
+static uint32_t entries_write(uint32_t offset, uint16_t context, uint32_t const * p_counts, uint16_t * p_entry_count)
+{
+    static follower_t followers[VOCAB_MAX];
+    uint32_t          total = 0;
+    uint16_t          n     = 0;
+
+    for (uint16_t w = 0; w < m_vocab_count; w++)
+    {
+        if (p_counts[w] != 0)
+        {
+            followers[n].word  = w;
+            followers[n].count = p_counts[w];
+            total             += p_counts[w];
+            n++;
+        }
+    }
+    qsort(followers, n, sizeof(followers[0]), follower_cmp);
+
+    for (uint16_t i = 0; i < n; i++)
+    {
+        uint32_t score = (followers[i].count * 255 + total / 2) / total;
+
+        if (score < MIN_SCORE)
+        {
+            break;
+        }
+        CHECK(offset + 5 <= MODEL_MAX);
+        offset += uint16_encode(context, &m_model[offset]);
+        offset += uint16_encode(followers[i].word, &m_model[offset]);
+        m_model[offset++] = (uint8_t)score;
+        (*p_entry_count)++;
+    }
+    return offset;
+}
+
+/**@brief Function for building the model of the lines outside a fold. */
+static void model_build(uint32_t fold)
+{
+    uint32_t separators[CHORD_SEPARATOR_WORDS] = {0};
+    uint16_t entry_count = 0;
+    uint32_t index;
+    uint32_t offset;
+    uint16_t prev = VOCAB_MAX;
+
+    // words and their index order
+    m_vocab_count = 0;
+    for (uint16_t w = 0; w < m_corpus_vocab_count; w++)
+    {
+        m_corpus_vocab[w].count = 0;
+    }
+    for (uint32_t line = 0; line < m_line_count; line++)
+    {
+        for (uint32_t i = line_start(line); (line % FOLDS != fold) && (i < m_line_end[line]); i++)
+        {
+            m_corpus_vocab[m_words[i]].count++;
+        }
+    }
+    for (uint16_t w = 0; w < m_corpus_vocab_count; w++)
+    {
+        if (m_corpus_vocab[w].count != 0)
+        {
+            m_vocab[m_vocab_count++] = m_corpus_vocab[w];
+        }
+    }
+    qsort(m_vocab, m_vocab_count, sizeof(m_vocab[0]), vocab_cmp);
+    for (uint16_t w = 0; w < m_corpus_vocab_count; w++)
+    {
+        m_vocab_of[w] = WORDS_MAX;
+        for (uint16_t v = 0; v < m_vocab_count; v++)
+        {
+            if (strcmp(m_vocab[v].text, m_corpus_vocab[w].text) == 0)
+            {
+                m_vocab_of[w] = v;
+            }
+        }
+    }
+
+    // the context runs on across lines, as it does on the device
+    memset(m_bigrams, 0, sizeof(m_bigrams));
+    for (uint32_t line = 0; line < m_line_count; line++)
+    {
+        if (line % FOLDS == fold)
+        {
+            continue;
+        }
+        for (uint32_t i = line_start(line); i < m_line_end[line]; i++)
+        {
+            uint16_t word = m_vocab_of[m_words[i]];
+
+            if (prev != VOCAB_MAX)
+            {
+                m_bigrams[prev][word]++;
+            }
+            m_bigrams[VOCAB_MAX][word]++;
+            prev = word;
+        }
+    }
+
+    // header, then the entries, whose count goes in the header, then the word records
+    for (char const * p = " .,\n"; *p != '\0'; p++)
+    {
+        separators[chord_of(*p) / 32] |= 1u << (chord_of(*p) % 32);
+    }
+    offset = 0;
+    for (uint32_t i = 0; i < CHORD_SEPARATOR_WORDS; i++)
+    {
+        offset += uint32_encode(separators[i], &m_model[offset]);
+    }
+    m_model[offset++] = ACCEPT_CHORD;
+    m_model[offset++] = MIN_SCORE;
+    offset += uint16_encode(m_vocab_count, &m_model[offset]);
+    offset += 2;
+    index   = offset;
+    offset += m_vocab_count * 4;
+
+    for (uint16_t context = 0; context < m_vocab_count; context++)
+    {
+        offset = entries_write(offset, context, m_bigrams[context], &entry_count);
+    }
+    offset = entries_write(offset, PHRASE_PREDICT_CTX_ANY, m_bigrams[VOCAB_MAX], &entry_count);
+    uint16_encode(entry_count, &m_model[CHORD_SEPARATOR_LEN + 4]);
+
+    for (uint16_t w = 0; w < m_vocab_count; w++)
+    {
+        uint8_t len = (uint8_t)strlen(m_vocab[w].text);
+
+        CHECK((offset + 2 + 2 * len <= MODEL_MAX) && (offset <= UINT16_MAX));
+        uint16_encode(m_vocab[w].hash, &m_model[index + w * 4]);
+        uint16_encode((uint16_t)offset, &m_model[index + w * 4 + 2]);
+        m_model[offset++] = len;
+        for (uint8_t i = 0; i < len; i++)
+        {
+            m_model[offset++] = chord_of(m_vocab[w].text[i]);
+        }
+        m_model[offset++] = len;
+        memcpy(&m_model[offset], m_vocab[w].text, len);
+        offset += len;
+    }
+    m_model_len = offset;
+
+    module_stub_blobs[FLASH_BLOB_PHRASE_MODEL].p_data = m_model;
+    module_stub_blobs[FLASH_BLOB_PHRASE_MODEL].len    = m_model_len;
+    module_stub_blobs[FLASH_BLOB_PHRASE_MODEL].format = PHRASE_PREDICT_FORMAT;
+}
+
+typedef struct
+{
+    char    text[OUT_MAX];                                          /**< What the host has. */
+    uint8_t len;
+    char    suggestion[WORD_LEN_MAX + 1];                           /**< Shown, empty for none. */
+} host_t;
+
+/**@brief Function for typing a chord and applying what the predictor sends to the host. */
+static phrase_predict_action_t chord_type(host_t * p_host, uint8_t chord)
+{
+    phrase_predict_text_t   text;
+    phrase_predict_action_t action;
+    struct timespec         start;
+    struct timespec         end;
+    uint64_t                ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    action = phrase_predict_chord(chord, &text);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000u + end.tv_nsec - start.tv_nsec;
+    CHECK(m_calls < CALLS_MAX);
+    m_call_ns[m_calls++] = (uint32_t)MIN(ns, UINT32_MAX);
+    m_chords_typed++;
+
+    switch (action)
+    {
+        case PHRASE_PREDICT_ACTION_ACCEPT:
+            CHECK((text.replace <= p_host->len) && (p_host->len - text.replace + text.len < OUT_MAX));
+            p_host->len -= text.replace;
+            memcpy(&p_host->text[p_host->len], text.p_text, text.len);
+            p_host->len          += text.len;
+            p_host->suggestion[0] = '\0';
+            break;
+
+        case PHRASE_PREDICT_ACTION_SUGGEST:
+            CHECK(text.len <= WORD_LEN_MAX);
+            memcpy(p_host->suggestion, text.p_text, text.len);
+            p_host->suggestion[text.len] = '\0';
+            // fall through
+        default:
+            CHECK(p_host->len + 1 < OUT_MAX);
+            p_host->text[p_host->len++] = USB_CHORD_KEYMAP[chord];
+            break;
+    }
+    return action;
+}
+
+/**@brief Function for typing the lines of a fold, as a typist who takes every useful suggestion. */
+static void fold_type(uint32_t fold)
+{
+    for (uint32_t line = fold; line < m_line_count; line += FOLDS)
+    {
+        host_t host = {.len = 0};
+        char   expected[OUT_MAX];
+        size_t expected_len = 0;
+
+        for (uint32_t i = line_start(line); i < m_line_end[line]; i++)
+        {
+            char const * p_word = m_corpus_vocab[m_words[i]].text;
+            size_t       len    = strlen(p_word);
+
+            for (size_t typed = 0; typed < len; typed++)
+            {
+                if ((len - typed >= 2) && (strcmp(host.suggestion, p_word) == 0))
+                {
+                    CHECK_EQ(chord_type(&host, ACCEPT_CHORD), PHRASE_PREDICT_ACTION_ACCEPT);
+                    m_accepts++;
+                    break;
+                }
+                chord_type(&host, chord_of(p_word[typed]));
+            }
+            chord_type(&host, chord_of((i + 1 < m_line_end[line]) ? ' ' : '\n'));
+
+            CHECK(expected_len + len + 1 < OUT_MAX);
+            memcpy(&expected[expected_len], p_word, len);
+            expected_len += len;
+            expected[expected_len++] = (i + 1 < m_line_end[line]) ? ' ' : '\n';
+            m_chords_plain += len + 1;
+        }
+        CHECK((host.len == expected_len) && (memcmp(host.text, expected, expected_len) == 0));
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    phrase_predict_text_t text;
+    uint32_t              model_max = 0;
+    uint64_t              total_ns  = 0;
+
+    corpus_load((argc > 1) ? argv[1] : "corpus/clearances.txt");
+
+    for (uint32_t fold = 0; fold < FOLDS; fold++)
+    {
+        model_build(fold);
+        model_max = MAX(model_max, m_model_len);
+
+        // forget the context of the previous model
+        phrase_predict_enable(false);
+        phrase_predict_chord(chord_of(' '), &text);
+        phrase_predict_enable(true);
+
+        fold_type(fold);
+    }
+
+    printf("bench_phrase_predict: %u lines, %u words, %u distinct, models up to %u bytes\n", m_line_count,
+           m_word_count, m_corpus_vocab_count, model_max);
+    printf("  chords %u, with prediction %u, %.1f%% saved, %u suggestions accepted\n", m_chords_plain,
+           m_chords_typed, 100.0 * (m_chords_plain - m_chords_typed) / m_chords_plain, m_accepts);
+    // the clock reads are in the times, and the largest ones are the host scheduler
+    qsort(m_call_ns, m_calls, sizeof(m_call_ns[0]), cmp_u32);
+    for (uint32_t i = 0; i < m_calls; i++)
+    {
+        total_ns += m_call_ns[i];
+    }
+    printf("  host time per chord: avg %.0f ns, p99 %u ns, p99.9 %u ns\n", (double)total_ns / m_calls,
+           m_call_ns[m_calls * 99 / 100], m_call_ns[m_calls * 999 / 1000]);
+    return 0;
+}
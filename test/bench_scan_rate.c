@@ -0,0 +1,366 @@
+/**@brief Replay of the adaptive key scan: chord detection latency and current per scan setting.
+ *
+ * @details Builds main.c over the stand-ins in stub/, as the fuzz target does, and types a
+ *          generated session into the key pins: bursts of chords with staggered, bouncing keys
+ *          and idle pauses between them. The tick timer and the GPIOTE PORT event run in RTC time.
+ *          For each setting of APP_PARAM_SCAN_FAST_INTERVAL, APP_PARAM_SCAN_HOLD_TIME and
+ *          APP_PARAM_TICK_INTERVAL it reports the latency from the release of the last key of a
+ *          chord to the chord reaching the transport, and the CPU wake ups as a duty cycle and an
+ *          average current. The current is the product specification's sleep and run figures and
+ *          an assumed time per wake up; the radio is not included.
+ */
+
+#include <stdlib.h>
+#include "check.h"
+#include "sdk_stub.h"
+
+#define main firmware_main
+#include "main.c"
+#undef main
+
+#define RTC_HZ              (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+#define US_TO_RTC(us)       ((uint64_t)(us) * RTC_HZ / 1000000)
+#define RTC_TO_MS(ticks)    ((double)(ticks) * 1000 / RTC_HZ)
+
+#define SESSION_TIME_S      600
+#define SETTLE_TIME_S       5                                       /**< Idle before each replay, past the longest hold. */
+#define CHORDS_MAX          4096
+#define BOUNCES_MAX         3                                       /**< Extra pairs of level changes after an edge. */
+#define EDGES_MAX           (CHORDS_MAX * CHORD_KEY_COUNT * 2 * (1 + 2 * BOUNCES_MAX))
+#define SEED                0x5CA27A7E
+
+#define SLEEP_CURRENT_UA    1.9                                     /**< System ON, RTC running, all RAM retained, nRF52832. */
+#define RUN_CURRENT_UA      3700.0                                  /**< CPU running from flash at 64 MHz, DC/DC on, nRF52832. */
+#define WAKE_TIME_US        30.0                                    /**< Assumed: the tick or PORT handler and going back to sleep. */
+
+/**@brief Level change of a key pin. */
+typedef struct
+{
+    uint64_t time;                                                  /**< RTC ticks from the start of the session. */
+    uint8_t  key;
+    bool     down;
+} edge_t;
+
+/**@brief Chord of the session, complete when its last key is released. */
+typedef struct
+{
+    uint8_t  chord;
+    uint64_t release;                                               /**< First level change of that release. */
+} session_chord_t;
+
+typedef struct
+{
+    uint32_t fast;                                                  /**< APP_PARAM_SCAN_FAST_INTERVAL, ms */
+    uint32_t hold;                                                  /**< APP_PARAM_SCAN_HOLD_TIME, ms */
+    uint32_t idle;                                                  /**< APP_PARAM_TICK_INTERVAL, ms */
+    char const * p_note;
+} scan_setting_t;
+
+static const scan_setting_t m_settings[] =
+{
+    {10,  500,   10, "fixed 10 ms scan"},
+    { 1,  500,  100, ""},
+    { 2,  500,  100, "defaults"},
+    { 5,  500,  100, ""},
+    {10,  500,  100, ""},
+    { 2,   10,  100, ""},
+    { 2,  100,  100, ""},
+    { 2, 2000,  100, ""},
+    { 2, 5000,  100, ""},
+    { 2,  500, 1000, ""},
+    { 1,  100, 1000, ""},
+};
+
+static edge_t          m_edges[EDGES_MAX];
+static uint32_t        m_edge_count;
+static session_chord_t m_session[CHORDS_MAX];
+static uint32_t        m_session_count;
+static uint64_t        m_span;                                      /**< RTC ticks, to a second past the last edge. */
+static uint32_t        m_rng = SEED;
+
+static uint64_t        m_now;                                       /**< RTC ticks, never wraps. */
+static uint64_t        m_base;                                      /**< Start of the replay. */
+static uint64_t        m_next_fire;
+static uint32_t        m_timer_starts;
+static uint32_t        m_wakes;
+static uint32_t        m_latency[CHORDS_MAX];                       /**< RTC ticks, per chord received. */
+static uint32_t        m_received;
+
+static uint32_t rng_next(void)
+{
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 17;
+    m_rng ^= m_rng << 5;
+    return m_rng;
+}
+
+/**@brief Function for a random number from min to max, inclusive. */
+static uint32_t rng_range(uint32_t min, uint32_t max)
+{
+    return min + rng_next() % (max - min + 1);
+}
+
+static void edge_add(uint64_t time_us, uint8_t key, bool down)
+{
+    CHECK(m_edge_count < EDGES_MAX);
+    m_edges[m_edge_count++] = (edge_t){US_TO_RTC(time_us), key, down};
+}
+
+/**@brief Function for a key changing level at a time, with the contact bouncing for up to 2 ms. */
+static void key_edge_add(uint64_t time_us, uint8_t key, bool down)
+{
+    uint32_t bounces = rng_range(0, BOUNCES_MAX);
+
+    edge_add(time_us, key, down);
+    for (uint32_t i = 0; i < bounces; i++)
+    {
+        time_us += rng_range(50, 300);
+        edge_add(time_us, key, !down);
+        time_us += rng_range(50, 300);
+        edge_add(time_us, key, down);
+    }
+}
+
+static int edge_compare(void const * p_a, void const * p_b)
+{
+    edge_t const * p_edge_a = p_a;
+    edge_t const * p_edge_b = p_b;
+
+    return (p_edge_a->time > p_edge_b->time) - (p_edge_a->time < p_edge_b->time);
+}
+
+/**@brief Function for generating SESSION_TIME_S of typing: bursts of 10 to 80 chords at typing
+ *        pace, each followed by a pause of 1 to 30 s, with one of a few minutes now and then.
+ *
+ * @details The keys of a chord go down up to 25 ms apart, are held 50 to 150 ms and come up
+ *          up to 20 ms apart. The next chord starts 40 to 300 ms later, so chords never overlap
+ *          and each completes on the release of its last key.
+ */
+static void session_generate(void)
+{
+    uint64_t t = 1000000;
+
+    while (t < (uint64_t)SESSION_TIME_S * 1000000)
+    {
+        uint32_t burst = rng_range(10, 80);
+
+        for (uint32_t n = 0; (n < burst) && (m_session_count < CHORDS_MAX); n++)
+        {
+            uint8_t  chord = (uint8_t)rng_range(1, 0x1F);
+            uint64_t last_down;
+            uint64_t last_up = 0;
+
+            if ((CHORD_KEY_COUNT >= 6) && (rng_range(0, 9) == 0))
+            {
+                chord |= 0x20;
+            }
+            last_down = t;
+            for (uint8_t key = 0; key < CHORD_KEY_COUNT; key++)
+            {
+                if (chord & (1 << key))
+                {
+                    uint64_t down = t + rng_range(0, 25000);
+
+                    key_edge_add(down, key, true);
+                    last_down = MAX(last_down, down);
+                }
+            }
+            last_down += rng_range(50000, 150000);
+            for (uint8_t key = 0; key < CHORD_KEY_COUNT; key++)
+            {
+                if (chord & (1 << key))
+                {
+                    uint64_t up = last_down + rng_range(0, 20000);
+
+                    key_edge_add(up, key, false);
+                    last_up = MAX(last_up, up);
+                }
+            }
+            m_session[m_session_count++] = (session_chord_t){chord, US_TO_RTC(last_up)};
+            t = last_up + rng_range(40000, 300000);
+        }
+        t += (rng_range(0, 9) == 0) ? rng_range(60, 240) * 1000000ULL : rng_range(1, 30) * 1000000ULL;
+    }
+    qsort(m_edges, m_edge_count, sizeof(m_edges[0]), edge_compare);
+    m_span = m_edges[m_edge_count - 1].time + US_TO_RTC(1000000);
+}
+
+static bool bench_is_ready(void)
+{
+    return true;
+}
+
+static ret_code_t bench_send(uint8_t lane, transport_record_t const * p_record)
+{
+    CHECK_EQ(p_record->type, TRANSPORT_RECORD_CHORD);
+    CHECK(m_received < m_session_count);
+    CHECK_EQ(p_record->data[0], m_session[m_received].chord);
+    m_latency[m_received] = (uint32_t)(m_now - m_base - m_session[m_received].release);
+    m_received++;
+    return NRF_SUCCESS;
+}
+
+static const transport_backend_t m_bench_backend = {"Bench", bench_is_ready, bench_send, 1};
+
+/**@brief Function for following the tick timer after a handler ran, it is restarted on a rate change. */
+static void timer_follow(bool fired)
+{
+    if (sdk_stub_timer_starts != m_timer_starts)
+    {
+        m_timer_starts = sdk_stub_timer_starts;
+        m_next_fire    = m_now + sdk_stub_timer_ticks;
+    }
+    else if (fired)
+    {
+        m_next_fire += sdk_stub_timer_ticks;
+    }
+}
+
+/**@brief Function for running the firmware until a time, waking it on each tick. */
+static void run_until(uint64_t time)
+{
+    while (m_next_fire <= time)
+    {
+        m_now        = m_next_fire;
+        sdk_stub_rtc = (uint32_t)m_now;
+        sdk_stub_timer_handler(NULL);
+        m_wakes++;
+        timer_follow(true);
+    }
+    m_now        = time;
+    sdk_stub_rtc = (uint32_t)m_now;
+}
+
+static void setting_apply(scan_setting_t const * p_setting)
+{
+    CHECK_EQ(app_params_set(APP_PARAM_SCAN_FAST_INTERVAL, p_setting->fast), NRF_SUCCESS);
+    CHECK_EQ(app_params_set(APP_PARAM_SCAN_HOLD_TIME, p_setting->hold), NRF_SUCCESS);
+    CHECK_EQ(app_params_set(APP_PARAM_TICK_INTERVAL, p_setting->idle), NRF_SUCCESS);
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+    timer_follow(false);
+}
+
+/**@brief Function for typing the session, a key press while no key is down raises the PORT event. */
+static void replay(void)
+{
+    uint8_t keys = 0;
+
+    m_base     = m_now;
+    m_wakes    = 0;
+    m_received = 0;
+    for (uint32_t i = 0; i < m_edge_count; i++)
+    {
+        edge_t const * p_edge = &m_edges[i];
+        uint8_t        prev   = keys;
+
+        run_until(m_base + p_edge->time);
+        keys = p_edge->down ? (keys | (1 << p_edge->key)) : (keys & ~(1 << p_edge->key));
+        if (p_edge->down)
+        {
+            sdk_stub_gpio_in &= ~(1UL << key_pins[p_edge->key]);
+        }
+        else
+        {
+            sdk_stub_gpio_in |= 1UL << key_pins[p_edge->key];
+        }
+        if ((prev == 0) && (keys != 0))
+        {
+            sdk_stub_gpiote_port = true;
+            GPIOTE_IRQHandler();
+            m_wakes++;
+            timer_follow(false);
+        }
+    }
+    run_until(m_base + m_span);
+    CHECK_EQ(m_received, m_session_count);
+}
+
+static int latency_compare(void const * p_a, void const * p_b)
+{
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static double latency_ms(double fraction)
+{
+    return RTC_TO_MS(m_latency[MIN((uint32_t)(fraction * m_received), m_received - 1)]);
+}
+
+/**@brief Function for starting the firmware as on power up, with this benchmark as the host. */
+static void firmware_start(void)
+{
+    ret_code_t err_code;
+
+    sdk_stub_reset();
+    sdk_stub_gpio_in = 0xFFFFFFFF;
+    nrf_gpio_cfg_output(LED_PIN);
+    timers_init();
+    err_code = app_params_init(app_params_handler);
+    APP_ERROR_CHECK(err_code);
+    buttons_init();
+    power_management_init();
+    ble_stack_init();
+    err_code = flash_blob_init();
+    APP_ERROR_CHECK(err_code);
+    gap_params_init();
+    gatt_init();
+    services_init();
+    advertising_init();
+    conn_params_init();
+    err_code = chord_log_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = chord_stats_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = fds_maint_init(inactive_sleep);
+    APP_ERROR_CHECK(err_code);
+    err_code = host_slots_init();
+    APP_ERROR_CHECK(err_code);
+    peer_manager_init();
+    host_slots_prune();
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+    application_timers_start();
+    timer_follow(false);
+    transport_backend_set(&m_bench_backend);
+}
+
+int main(void)
+{
+    uint64_t typing = 0;
+
+    session_generate();
+    for (uint32_t i = 0; i < m_session_count; i++)
+    {
+        // release to release, a gap of more than 500 ms is a pause
+        typing += (i == 0) ? 0 : MIN(m_session[i].release - m_session[i - 1].release, US_TO_RTC(500000));
+    }
+    firmware_start();
+
+    printf("bench_scan_rate: %u chords in %.0f s, about %.0f s of typing, debounce %u ms\n", m_session_count,
+           RTC_TO_MS(m_span) / 1000, RTC_TO_MS(typing) / 1000, app_params_get(APP_PARAM_DEBOUNCE_TIME));
+    printf("  fast  hold  idle | latency ms: p50   p90   p99   max | wakes/s  duty    avg uA\n");
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_settings); i++)
+    {
+        scan_setting_t const * p_setting = &m_settings[i];
+        double                 wakes_per_s;
+        double                 duty;
+
+        setting_apply(p_setting);
+        run_until(m_now + US_TO_RTC(SETTLE_TIME_S * 1000000));
+        replay();
+
+        qsort(m_latency, m_received, sizeof(m_latency[0]), latency_compare);
+        wakes_per_s = (double)m_wakes * 1000 / RTC_TO_MS(m_span);
+        duty        = wakes_per_s * WAKE_TIME_US / 1e6;
+        printf("  %4u  %4u  %4u |          %5.2f %5.2f %5.2f %5.2f | %7.1f  %5.3f%%  %6.1f  %s\n", p_setting->fast,
+               p_setting->hold, p_setting->idle, latency_ms(0.5), latency_ms(0.9), latency_ms(0.99),
+               RTC_TO_MS(m_latency[m_received - 1]), wakes_per_s, duty * 100,
+               SLEEP_CURRENT_UA + duty * (RUN_CURRENT_UA - SLEEP_CURRENT_UA), p_setting->p_note);
+    }
+    printf("avg uA: %.1f uA asleep, %.0f uA running for %.0f us per wake up, radio not included\n",
+           SLEEP_CURRENT_UA, RUN_CURRENT_UA, WAKE_TIME_US);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/**@brief Benchmark of the path from the chord engine to the centrals.
+ *
+ * @details Builds main.c over the stand-ins in stub/ and types a minute of chords, with rollover
+ *          bursts and text expansions, through the transport queue and the firmware's BLE backend
+ *          to the centrals of ble_peer.c, stepping the connection events of each link. Reports how
+ *          long chords wait to go on air on each link, what the queue did, and the host time a
+ *          chord takes from transport_chord_send() to the SoftDevice.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "check.h"
+#include "ble_peer.h"
+#include "sdk_stub.h"
+
+#define main firmware_main
+#include "main.c"
+#undef main
+
+#define TICK_US         250
+#define RUN_US          60000000
+#define HVN_QUEUE_SIZE  1                                           /**< BLE_GATTS_HVN_TX_QUEUE_SIZE_DEFAULT, main.c keeps it. */
+#define LINKS_MAX       2
+#define LATENCIES_MAX   4096
+#define TIMED_CHORDS    1000000
+
+typedef struct
+{
+    char const * p_name;
+    uint8_t      links;
+    uint32_t     interval_us[LINKS_MAX];
+} sim_cfg_t;
+
+static const sim_cfg_t m_cfgs[] =
+{
+    {"1 link, 7.5 ms",        1, {7500}},
+    {"1 link, 30 ms",         1, {30000}},
+    {"2 links, 7.5 + 30 ms",  2, {7500, 30000}},
+    {"2 links, 30 + 30 ms",   2, {30000, 30000}},
+};
+
+static uint32_t m_rand = 1;
+static uint32_t m_sent_us[256];                                     /**< Time each chord value was sent, by value. */
+static uint32_t m_latency_us[LINKS_MAX][LATENCIES_MAX];
+static uint32_t m_latency_count[LINKS_MAX];
+
+static uint32_t rand_next(uint32_t range)
+{
+    m_rand = m_rand * 1103515245 + 12345;
+    return (m_rand >> 8) % range;
+}
+
+static int cmp_u32(void const * p_a, void const * p_b)
+{
+    uint32_t a = *(uint32_t const *)p_a;
+    uint32_t b = *(uint32_t const *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Function for starting the chord service and the BLE transport backend of the firmware
+ *        over the central stand-in, with centrals subscribed to the chord value and text.
+ */
+static void ble_start(uint32_t queue_size, uint8_t links)
+{
+    ble_peer_init(queue_size);
+    device_connected = false;
+    transport_backend_set(NULL);
+    services_init();
+    ble_peer_observer_add(ble_chord_on_ble_evt, &m_chord);
+    transport_backend_set(&m_ble_transport);
+
+    for (uint16_t conn_handle = 0; conn_handle < links; conn_handle++)
+    {
+        ble_peer_connect(conn_handle);
+        ble_peer_subscribe(conn_handle, m_chord.chord_value_handles.cccd_handle);
+        ble_peer_subscribe(conn_handle, m_chord.text_handles.cccd_handle);
+    }
+}
+
+static void chord_type(uint8_t * p_value, uint32_t now_us)
+{
+    // 0 is not a chord, values run 1 to 255 and a value is long gone when it comes round again
+    *p_value = (*p_value == 255) ? 1 : *p_value + 1;
+    m_sent_us[*p_value] = now_us;
+    CHECK_EQ(transport_chord_send(*p_value), NRF_SUCCESS);
+}
+
+static void run(sim_cfg_t const * p_cfg)
+{
+    static const char expansion[] = "with kind regards, and see you next week";
+    ble_peer_notification_t sent[BLE_PEER_QUEUE_MAX];
+    transport_stats_t       before;
+    transport_stats_t       after;
+    uint32_t                next_us[LINKS_MAX];
+    uint32_t                next_chord_us = 0;
+    uint32_t                burst         = 0;
+    uint32_t                chords        = 0;
+    uint8_t                 value         = 0;
+
+    m_rand = 1;
+    memset(m_latency_count, 0, sizeof(m_latency_count));
+    ble_start(HVN_QUEUE_SIZE, p_cfg->links);
+    transport_stats_get(&before);
+    for (uint8_t l = 0; l < p_cfg->links; l++)
+    {
+        // links are not in step
+        next_us[l] = (l + 1) * 1250;
+    }
+
+    for (uint32_t now_us = 0; now_us < RUN_US; now_us += TICK_US)
+    {
+        if (now_us >= next_chord_us)
+        {
+            chord_type(&value, now_us);
+            chords++;
+            if ((chords % 15) == 0)
+            {
+                CHECK_EQ(transport_text_send(4, expansion, sizeof(expansion) - 1), NRF_SUCCESS);
+            }
+            // a rollover of three chords now and then, otherwise 40 to 250 ms apart
+            if (burst == 0 && rand_next(5) == 0)
+            {
+                burst = 2;
+            }
+            if (burst > 0)
+            {
+                burst--;
+                next_chord_us = now_us + 5000;
+            }
+            else
+            {
+                next_chord_us = now_us + 40000 + rand_next(210) * 1000;
+            }
+        }
+
+        for (uint8_t l = 0; l < p_cfg->links; l++)
+        {
+            uint32_t count;
+
+            if (now_us < next_us[l])
+            {
+                continue;
+            }
+            next_us[l] += p_cfg->interval_us[l];
+
+            count = ble_peer_tx_complete(l, BLE_PEER_QUEUE_MAX, sent);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if ((sent[i].handle == m_chord.chord_value_handles.value_handle)
+                    && (m_latency_count[l] < LATENCIES_MAX))
+                {
+                    m_latency_us[l][m_latency_count[l]++] = now_us - m_sent_us[sent[i].data[0]];
+                }
+            }
+        }
+    }
+    transport_stats_get(&after);
+
+    printf("%-22s %6u chords, %5u sent, %5u busy, %3u dropped\n", p_cfg->p_name, chords,
+           after.sent - before.sent, after.busy - before.busy, after.dropped - before.dropped);
+    for (uint8_t l = 0; l < p_cfg->links; l++)
+    {
+        uint32_t n     = m_latency_count[l];
+        uint64_t total = 0;
+
+        CHECK(n > 0);
+        qsort(m_latency_us[l], n, sizeof(m_latency_us[l][0]), cmp_u32);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            total += m_latency_us[l][i];
+        }
+        printf("  link %u, %4.1f ms: chord to air avg %5.1f ms, p99 %5.1f ms, max %5.1f ms\n", l,
+               p_cfg->interval_us[l] / 1000.0, total / 1000.0 / n, m_latency_us[l][n * 99 / 100] / 1000.0,
+               m_latency_us[l][n - 1] / 1000.0);
+    }
+}
+
+/**@brief Function for timing transport_chord_send() through the backend, with room in the queue. */
+static void time_send(void)
+{
+    struct timespec start;
+    struct timespec end;
+    double          ns;
+
+    ble_start(BLE_PEER_QUEUE_MAX, 1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < TIMED_CHORDS; i++)
+    {
+        CHECK_EQ(transport_chord_send((uint8_t)(i | 1)), NRF_SUCCESS);
+        if (ble_peer_queued(0) == BLE_PEER_QUEUE_MAX)
+        {
+            ble_peer_tx_complete(0, BLE_PEER_QUEUE_MAX, NULL);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("host time per chord, transport to SoftDevice: %.0f ns\n", ns / TIMED_CHORDS);
+}
+
+int main(void)
+{
+    printf("bench_transport: %u s of typing, %u notification(s) queued per link\n",
+           RUN_US / 1000000, HVN_QUEUE_SIZE);
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_cfgs); i++)
+    {
+        run(&m_cfgs[i]);
+    }
+    time_send();
+    return 0;
+}
@@ -0,0 +1,220 @@
+#include "ble_peer.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    uint16_t                conn_handle;
+    uint32_t                head;
+    uint32_t                count;
+    ble_peer_notification_t queue[BLE_PEER_QUEUE_MAX];
+} peer_link_t;
+
+static struct
+{
+    ble_peer_observer_t handler;
+    void              * p_context;
+} m_observers[BLE_PEER_OBSERVERS_MAX];
+
+static uint32_t    m_observer_count;
+static uint32_t    m_queue_size;
+static peer_link_t m_links[NRF_SDH_BLE_TOTAL_LINK_COUNT];
+
+static peer_link_t * link_find(uint16_t conn_handle)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_links); i++)
+    {
+        if (m_links[i].conn_handle == conn_handle)
+        {
+            return &m_links[i];
+        }
+    }
+    return NULL;
+}
+
+static void dispatch(ble_evt_t const * p_ble_evt)
+{
+    for (uint32_t i = 0; i < m_observer_count; i++)
+    {
+        m_observers[i].handler(p_ble_evt, m_observers[i].p_context);
+    }
+}
+
+static uint32_t hvx_handler(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+    peer_link_t             * p_link = link_find(conn_handle);
+    ble_peer_notification_t * p_notification;
+
+    if (p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (*p_hvx_params->p_len > BLE_PEER_NOTIFY_MAX_LEN)
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    if (p_link->count == m_queue_size)
+    {
+        return NRF_ERROR_RESOURCES;
+    }
+
+    // the SoftDevice copies the value when it queues the notification
+    p_notification = &p_link->queue[(p_link->head + p_link->count++) % BLE_PEER_QUEUE_MAX];
+    p_notification->conn_handle = conn_handle;
+    p_notification->handle      = p_hvx_params->handle;
+    p_notification->len         = *p_hvx_params->p_len;
+    memcpy(p_notification->data, p_hvx_params->p_data, p_notification->len);
+    return NRF_SUCCESS;
+}
+
+void ble_peer_init(uint32_t queue_size)
+{
+    sdk_stub_reset();
+    sdk_stub_hvx_handler = hvx_handler;
+    m_observer_count     = 0;
+    m_queue_size         = MIN(queue_size, BLE_PEER_QUEUE_MAX);
+    memset(m_links, 0, sizeof(m_links));
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_links); i++)
+    {
+        m_links[i].conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+}
+
+void ble_peer_queue_size_set(uint32_t queue_size)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_links); i++)
+    {
+        if (m_links[i].count != 0)
+        {
+            abort();
+        }
+    }
+    m_queue_size = MIN(queue_size, BLE_PEER_QUEUE_MAX);
+}
+
+void ble_peer_observer_add(ble_peer_observer_t handler, void * p_context)
+{
+    if (m_observer_count == BLE_PEER_OBSERVERS_MAX)
+    {
+        abort();
+    }
+    m_observers[m_observer_count].handler   = handler;
+    m_observers[m_observer_count].p_context = p_context;
+    m_observer_count++;
+}
+
+void ble_peer_connect(uint16_t conn_handle)
+{
+    peer_link_t * p_link = link_find(BLE_CONN_HANDLE_INVALID);
+    ble_evt_t     evt;
+
+    if ((p_link == NULL) || (link_find(conn_handle) != NULL))
+    {
+        abort();
+    }
+    memset(p_link, 0, sizeof(*p_link));
+    p_link->conn_handle = conn_handle;
+    sdk_stub_conn_handles[sdk_stub_conn_count++] = conn_handle;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id           = BLE_GAP_EVT_CONNECTED;
+    evt.evt.gap_evt.conn_handle = conn_handle;
+    dispatch(&evt);
+}
+
+void ble_peer_disconnect(uint16_t conn_handle)
+{
+    peer_link_t * p_link = link_find(conn_handle);
+    ble_evt_t     evt;
+
+    if (p_link == NULL)
+    {
+        abort();
+    }
+    p_link->conn_handle = BLE_CONN_HANDLE_INVALID;
+    for (uint32_t i = 0; i < sdk_stub_conn_count; i++)
+    {
+        if (sdk_stub_conn_handles[i] == conn_handle)
+        {
+            sdk_stub_conn_handles[i] = sdk_stub_conn_handles[--sdk_stub_conn_count];
+            break;
+        }
+    }
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id                          = BLE_GAP_EVT_DISCONNECTED;
+    evt.evt.gap_evt.conn_handle                = conn_handle;
+    evt.evt.gap_evt.params.disconnected.reason = BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION;
+    dispatch(&evt);
+}
+
+void ble_peer_write(uint16_t conn_handle, uint16_t handle, uint8_t op, void const * p_data, uint16_t len)
+{
+    // a whole event at least, the fuzz target checks writes at their exact length
+    size_t      size  = MAX(offsetof(ble_evt_t, evt.gatts_evt.params.write.data) + len, sizeof(ble_evt_t));
+    ble_evt_t * p_evt = calloc(1, size);
+
+    p_evt->header.evt_id                  = BLE_GATTS_EVT_WRITE;
+    p_evt->evt.gatts_evt.conn_handle      = conn_handle;
+    p_evt->evt.gatts_evt.params.write.handle = handle;
+    p_evt->evt.gatts_evt.params.write.op  = op;
+    p_evt->evt.gatts_evt.params.write.len = len;
+    memcpy(p_evt->evt.gatts_evt.params.write.data, p_data, len);
+    dispatch(p_evt);
+    free(p_evt);
+}
+
+void ble_peer_subscribe(uint16_t conn_handle, uint16_t cccd_handle)
+{
+    static const uint8_t notify[] = {BLE_GATT_HVX_NOTIFICATION, 0};
+
+    ble_peer_write(conn_handle, cccd_handle, BLE_GATTS_OP_WRITE_REQ, notify, sizeof(notify));
+}
+
+uint32_t ble_peer_queued(uint16_t conn_handle)
+{
+    peer_link_t const * p_link = link_find(conn_handle);
+
+    return (p_link != NULL) ? p_link->count : 0;
+}
+
+ble_peer_notification_t const * ble_peer_queued_get(uint16_t conn_handle, uint32_t index)
+{
+    peer_link_t const * p_link = link_find(conn_handle);
+
+    if ((p_link == NULL) || (index >= p_link->count))
+    {
+        return NULL;
+    }
+    return &p_link->queue[(p_link->head + index) % BLE_PEER_QUEUE_MAX];
+}
+
+uint32_t ble_peer_tx_complete(uint16_t conn_handle, uint32_t count, ble_peer_notification_t * p_sent)
+{
+    peer_link_t * p_link = link_find(conn_handle);
+    ble_evt_t     evt;
+    uint32_t      sent;
+
+    if (p_link == NULL)
+    {
+        return 0;
+    }
+    sent = MIN(count, p_link->count);
+    for (uint32_t i = 0; (i < sent) && (p_sent != NULL); i++)
+    {
+        p_sent[i] = p_link->queue[(p_link->head + i) % BLE_PEER_QUEUE_MAX];
+    }
+    p_link->head   = (p_link->head + sent) % BLE_PEER_QUEUE_MAX;
+    p_link->count -= sent;
+    if (sent == 0)
+    {
+        return 0;
+    }
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id                              = BLE_GATTS_EVT_HVN_TX_COMPLETE;
+    evt.evt.gatts_evt.conn_handle                  = conn_handle;
+    evt.evt.gatts_evt.params.hvn_tx_complete.count = (uint8_t)sent;
+    dispatch(&evt);
+    return sent;
+}
@@ -0,0 +1,76 @@
+#ifndef BLE_PEER_H__
+#define BLE_PEER_H__
+
+/**@brief A central for host tests of the BLE services, over the SoftDevice stand-in.
+ *
+ * @details The central connects, writes and subscribes by delivering the events the SoftDevice
+ *          would to the observers added. Notifications the service sends are queued on their
+ *          link, as in the SoftDevice, until ble_peer_tx_complete() takes them off the air; a
+ *          link holds at most the queue size given to ble_peer_init(), past which
+ *          sd_ble_gatts_hvx() fails with NRF_ERROR_RESOURCES.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_stub.h"
+
+#define BLE_PEER_OBSERVERS_MAX      4
+#define BLE_PEER_QUEUE_MAX          32                              /**< Notifications a link can queue at most. */
+#define BLE_PEER_NOTIFY_MAX_LEN     (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3)
+
+typedef void (*ble_peer_observer_t) (ble_evt_t const * p_ble_evt, void * p_context);
+
+/**@brief Notification sent by the service. */
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t handle;
+    uint16_t len;
+    uint8_t  data[BLE_PEER_NOTIFY_MAX_LEN];
+} ble_peer_notification_t;
+
+/**@brief Function for resetting the SoftDevice stand-in and the central.
+ *
+ * @param[in]   queue_size   Notifications a link queues before NRF_ERROR_RESOURCES, at most
+ *                           BLE_PEER_QUEUE_MAX.
+ */
+void ble_peer_init(uint32_t queue_size);
+
+/**@brief Function for changing the notifications a link queues, at most BLE_PEER_QUEUE_MAX. The
+ *        links must have nothing queued.
+ */
+void ble_peer_queue_size_set(uint32_t queue_size);
+
+/**@brief Function for adding an observer, called in the order added. */
+void ble_peer_observer_add(ble_peer_observer_t handler, void * p_context);
+
+void ble_peer_connect(uint16_t conn_handle);
+void ble_peer_disconnect(uint16_t conn_handle);
+
+/**@brief Function for writing an attribute, as a Write Request or Write Command (op). */
+void ble_peer_write(uint16_t conn_handle, uint16_t handle, uint8_t op, void const * p_data, uint16_t len);
+
+/**@brief Function for enabling notification through a CCCD. */
+void ble_peer_subscribe(uint16_t conn_handle, uint16_t cccd_handle);
+
+/**@brief Function for counting the notifications queued on a link. */
+uint32_t ble_peer_queued(uint16_t conn_handle);
+
+/**@brief Function for looking at a notification queued on a link, 0 for the oldest.
+ *
+ * @return NULL if fewer are queued.
+ */
+ble_peer_notification_t const * ble_peer_queued_get(uint16_t conn_handle, uint32_t index);
+
+/**@brief Function for sending the oldest notifications of a link, as a connection event does,
+ *        and reporting them with BLE_GATTS_EVT_HVN_TX_COMPLETE.
+ *
+ * @param[in]   conn_handle  Link.
+ * @param[in]   count        Notifications to send, fewer if fewer are queued.
+ * @param[out]  p_sent       Notifications sent, in order, count entries. May be NULL.
+ *
+ * @return Number of notifications sent.
+ */
+uint32_t ble_peer_tx_complete(uint16_t conn_handle, uint32_t count, ble_peer_notification_t * p_sent);
+
+#endif // BLE_PEER_H__
@@ -0,0 +1,34 @@
+#ifndef CHECK_H__
+#define CHECK_H__
+
+/**@brief Assertions of the host tests. A failed check reports where and exits, so the test
+ *        stops at the first one, as under a debugger.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(cond)                                                                     \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(cond))                                                                    \
+        {                                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                                  \
+    do                                                                                  \
+    {                                                                                   \
+        long long check_a = (long long)(a);                                             \
+        long long check_b = (long long)(b);                                             \
+        if (check_a != check_b)                                                         \
+        {                                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n",           \
+                    __FILE__, __LINE__, #a, #b, check_a, check_b);                      \
+            exit(1);                                                                    \
+        }                                                                               \
+    } while (0)
+
+#endif // CHECK_H__
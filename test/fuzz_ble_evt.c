@@ -0,0 +1,414 @@
+/**@brief Fuzz target for the BLE event handlers.
+ *
+ * @details Builds main.c with the real services over the stand-ins in stub/ and reads each input
+ *          as a sequence of steps: a BLE event, delivered to the observers in priority order as
+ *          the SoftDevice handler does, or an application call such as a tick with keys down or
+ *          a chord sent. The SoftDevice's own rules hold (a link connects once, events name a
+ *          connected link); what a peer controls is free: write handles, operations, offsets,
+ *          lengths and data. Write events are allocated at their exact length, so a read past
+ *          the written data is caught by the address sanitizer.
+ *
+ *          With clang this is a libFuzzer target. fuzz_main.c is the driver for compilers
+ *          without libFuzzer.
+ */
+
+#include <stdlib.h>
+#include "sdk_stub.h"
+
+#define main firmware_main
+#include "main.c"
+#undef main
+
+#define FUZZ_WRITE_MAX      600                                     /**< Longest write, past any ATT MTU and long write. */
+
+typedef struct
+{
+    uint8_t const * p_data;
+    size_t          size;
+} fuzz_input_t;
+
+typedef enum
+{
+    FUZZ_STEP_CONNECT,
+    FUZZ_STEP_DISCONNECT,
+    FUZZ_STEP_WRITE,
+    FUZZ_STEP_AUTHORIZE,
+    FUZZ_STEP_TX_COMPLETE,
+    FUZZ_STEP_LINK_EVT,
+    FUZZ_STEP_MTU,
+    FUZZ_STEP_HVX_BUDGET,
+    FUZZ_STEP_TICK,
+    FUZZ_STEP_CHORD,
+    FUZZ_STEP_TEXT,
+    FUZZ_STEP_KEYS,
+    FUZZ_STEP_COUNT
+} fuzz_step_t;
+
+static uint32_t m_hvx_budget;                                       /**< Notifications the SoftDevice takes before it is full. */
+
+static uint8_t fuzz_u8(fuzz_input_t * p_in)
+{
+    if (p_in->size == 0)
+    {
+        return 0;
+    }
+    p_in->size--;
+    return *p_in->p_data++;
+}
+
+static uint16_t fuzz_u16(fuzz_input_t * p_in)
+{
+    uint16_t value = fuzz_u8(p_in);
+
+    return value | (uint16_t)(fuzz_u8(p_in) << 8);
+}
+
+static uint32_t fuzz_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+    (void)conn_handle;
+    (void)p_hvx_params;
+    if (m_hvx_budget == 0)
+    {
+        return NRF_ERROR_RESOURCES;
+    }
+    m_hvx_budget--;
+    return NRF_SUCCESS;
+}
+
+static void fuzz_system_off(void)
+{
+}
+
+/**@brief Function for picking a connected link, BLE_CONN_HANDLE_INVALID if there is none. */
+static uint16_t fuzz_link(fuzz_input_t * p_in)
+{
+    uint8_t pick = fuzz_u8(p_in);
+
+    return (sdk_stub_conn_count == 0) ? BLE_CONN_HANDLE_INVALID
+                                      : sdk_stub_conn_handles[pick % sdk_stub_conn_count];
+}
+
+/**@brief Function for delivering an event to the observers, in the order of their priorities. */
+static void fuzz_dispatch(ble_evt_t const * p_ble_evt)
+{
+    ble_chord_on_ble_evt(p_ble_evt, &m_chord);
+    ble_bulk_on_ble_evt(p_ble_evt, &m_bulk);
+    ble_config_on_ble_evt(p_ble_evt, &m_config);
+    ble_evt_handler(p_ble_evt, NULL);
+}
+
+static void fuzz_connect(fuzz_input_t * p_in)
+{
+    ble_evt_t evt;
+    uint16_t  conn_handle = fuzz_u8(p_in) % 8;
+
+    if ((sdk_stub_conn_count == NRF_SDH_BLE_TOTAL_LINK_COUNT) || (ble_conn_state_status(conn_handle) == BLE_CONN_STATUS_CONNECTED))
+    {
+        return;
+    }
+    sdk_stub_conn_handles[sdk_stub_conn_count++] = conn_handle;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id                                     = BLE_GAP_EVT_CONNECTED;
+    evt.evt.gap_evt.conn_handle                           = conn_handle;
+    evt.evt.gap_evt.params.connected.conn_params.max_conn_interval = fuzz_u16(p_in);
+    fuzz_dispatch(&evt);
+}
+
+static void fuzz_disconnect(fuzz_input_t * p_in)
+{
+    ble_evt_t evt;
+    uint16_t  conn_handle = fuzz_link(p_in);
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < sdk_stub_conn_count; i++)
+    {
+        if (sdk_stub_conn_handles[i] == conn_handle)
+        {
+            sdk_stub_conn_handles[i] = sdk_stub_conn_handles[--sdk_stub_conn_count];
+            break;
+        }
+    }
+
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id                          = BLE_GAP_EVT_DISCONNECTED;
+    evt.evt.gap_evt.conn_handle                = conn_handle;
+    evt.evt.gap_evt.params.disconnected.reason = fuzz_u8(p_in);
+    fuzz_dispatch(&evt);
+}
+
+/**@brief Function for filling a write, which the caller allocated for len bytes of data. */
+static void fuzz_write_fill(fuzz_input_t * p_in, ble_gatts_evt_write_t * p_write, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        p_write->data[i] = fuzz_u8(p_in);
+    }
+    p_write->len = len;
+}
+
+static void fuzz_write(fuzz_input_t * p_in, bool authorize)
+{
+    uint16_t        conn_handle = fuzz_link(p_in);
+    uint16_t        handle      = fuzz_u8(p_in) & 0x1F;             // every handle the stand-in gives out
+    uint8_t         op          = fuzz_u8(p_in) % 8;
+    uint16_t        offset      = fuzz_u8(p_in);
+    uint16_t        len         = fuzz_u16(p_in) % (FUZZ_WRITE_MAX + 1);
+    size_t          size;
+    ble_evt_t     * p_evt;
+    ble_gatts_evt_write_t * p_write;
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    if (len > p_in->size)
+    {
+        len = (uint16_t)p_in->size;
+    }
+    size = authorize ? offsetof(ble_evt_t, evt.gatts_evt.params.authorize_request.request.write.data)
+                     : offsetof(ble_evt_t, evt.gatts_evt.params.write.data);
+    p_evt = malloc(size + len);
+    memset(p_evt, 0, size);
+    p_write = authorize ? &p_evt->evt.gatts_evt.params.authorize_request.request.write
+                        : &p_evt->evt.gatts_evt.params.write;
+
+    p_evt->header.evt_id            = authorize ? BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST : BLE_GATTS_EVT_WRITE;
+    p_evt->header.evt_len           = (uint16_t)(size + len - sizeof(p_evt->header));
+    p_evt->evt.gatts_evt.conn_handle = conn_handle;
+    if (authorize)
+    {
+        p_evt->evt.gatts_evt.params.authorize_request.type = (op & 4) ? BLE_GATTS_AUTHORIZE_TYPE_READ
+                                                                      : BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    }
+    p_write->handle = handle;
+    p_write->op     = op;
+    p_write->offset = offset;
+    fuzz_write_fill(p_in, p_write, len);
+
+    fuzz_dispatch(p_evt);
+    free(p_evt);
+}
+
+/**@brief Function for the events of a link that carry no data a peer sets. */
+static void fuzz_link_evt(fuzz_input_t * p_in)
+{
+    static const uint16_t evt_ids[] =
+    {
+        BLE_GAP_EVT_CONN_PARAM_UPDATE,
+        BLE_GAP_EVT_PHY_UPDATE_REQUEST,
+        BLE_GAP_EVT_CONN_SEC_UPDATE,
+        BLE_GAP_EVT_DATA_LENGTH_UPDATE,
+        BLE_GATTC_EVT_TIMEOUT,
+        BLE_GATTS_EVT_TIMEOUT,
+        BLE_GATTS_EVT_SYS_ATTR_MISSING,
+        BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST,
+    };
+    ble_evt_t evt;
+    uint16_t  evt_id      = evt_ids[fuzz_u8(p_in) % ARRAY_SIZE(evt_ids)];
+    uint16_t  conn_handle = fuzz_link(p_in);
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id = evt_id;
+    if (evt_id == BLE_GATTC_EVT_TIMEOUT)
+    {
+        evt.evt.gattc_evt.conn_handle = conn_handle;
+    }
+    else if (evt_id >= BLE_GATTS_EVT_WRITE)
+    {
+        evt.evt.gatts_evt.conn_handle = conn_handle;
+    }
+    else
+    {
+        evt.evt.gap_evt.conn_handle = conn_handle;
+        evt.evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval = fuzz_u16(p_in);
+    }
+    fuzz_dispatch(&evt);
+}
+
+static void fuzz_tx_complete(fuzz_input_t * p_in)
+{
+    ble_evt_t evt;
+    uint16_t  conn_handle = fuzz_link(p_in);
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return;
+    }
+    memset(&evt, 0, sizeof(evt));
+    evt.header.evt_id                             = BLE_GATTS_EVT_HVN_TX_COMPLETE;
+    evt.evt.gatts_evt.conn_handle                 = conn_handle;
+    evt.evt.gatts_evt.params.hvn_tx_complete.count = 1 + fuzz_u8(p_in) % 4;
+    m_hvx_budget += evt.evt.gatts_evt.params.hvn_tx_complete.count;
+    fuzz_dispatch(&evt);
+}
+
+/**@brief Function for a tick with the keys of a byte down, after the time of another. */
+static void fuzz_tick(fuzz_input_t * p_in)
+{
+    uint8_t keys = fuzz_u8(p_in);
+
+    sdk_stub_gpio_in = 0xFFFFFFFF;
+    for (uint8_t i = 0; i < CHORD_KEY_COUNT; i++)
+    {
+        if (keys & (1 << i))
+        {
+            sdk_stub_gpio_in &= ~(1UL << key_pins[i]);
+        }
+    }
+    sdk_stub_rtc += 1 + fuzz_u8(p_in) * 4;
+    if (sdk_stub_timer_handler != NULL)
+    {
+        sdk_stub_timer_handler(NULL);
+    }
+}
+
+static void fuzz_text(fuzz_input_t * p_in)
+{
+    char     text[64];
+    uint8_t  replace = fuzz_u8(p_in);
+    uint16_t len     = fuzz_u8(p_in) % sizeof(text);
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        text[i] = (char)fuzz_u8(p_in);
+    }
+    UNUSED_RETURN_VALUE(transport_text_send(replace, text, len));
+}
+
+/**@brief Function for starting the firmware, once per process: FDS keeps its users. */
+static void fuzz_init(void)
+{
+    ret_code_t err_code;
+
+    sdk_stub_reset();
+    nrf_gpio_cfg_output(LED_PIN);
+    timers_init();
+    err_code = app_params_init(app_params_handler);
+    APP_ERROR_CHECK(err_code);
+    buttons_init();
+    power_management_init();
+    transport_backend_set(&m_ble_transport);
+    ble_stack_init();
+    err_code = flash_blob_init();
+    APP_ERROR_CHECK(err_code);
+    gap_params_init();
+    gatt_init();
+    services_init();
+    advertising_init();
+    conn_params_init();
+    err_code = chord_log_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = chord_stats_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = fds_maint_init(inactive_sleep);
+    APP_ERROR_CHECK(err_code);
+    err_code = host_slots_init();
+    APP_ERROR_CHECK(err_code);
+    peer_manager_init();
+    host_slots_prune();
+    err_code = fds_init();
+    APP_ERROR_CHECK(err_code);
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+    application_timers_start();
+    advertising_start();
+}
+
+/**@brief Function for starting an input with no links, as after a reset. The services are added
+ *        again, which resets their state. */
+static void fuzz_reset(void)
+{
+    sdk_stub_reset();
+    sdk_stub_hvx_handler        = fuzz_hvx;
+    sdk_stub_system_off_handler = fuzz_system_off;
+    m_hvx_budget                = 0;
+    device_connected            = false;
+    pairing_mode                = false;
+    inactive_armed              = false;
+    calc_active                 = false;
+    transport_backend_set(NULL);
+    transport_backend_set(&m_ble_transport);
+    services_init();
+}
+
+int LLVMFuzzerTestOneInput(uint8_t const * p_data, size_t size)
+{
+    static bool  initialized;
+    fuzz_input_t in = {p_data, size};
+
+    if (!initialized)
+    {
+        fuzz_init();
+        initialized = true;
+    }
+    fuzz_reset();
+
+    while (in.size != 0)
+    {
+        switch ((fuzz_step_t)(fuzz_u8(&in) % FUZZ_STEP_COUNT))
+        {
+            case FUZZ_STEP_CONNECT:
+                fuzz_connect(&in);
+                break;
+
+            case FUZZ_STEP_DISCONNECT:
+                fuzz_disconnect(&in);
+                break;
+
+            case FUZZ_STEP_WRITE:
+                fuzz_write(&in, false);
+                break;
+
+            case FUZZ_STEP_AUTHORIZE:
+                fuzz_write(&in, true);
+                break;
+
+            case FUZZ_STEP_TX_COMPLETE:
+                fuzz_tx_complete(&in);
+                break;
+
+            case FUZZ_STEP_LINK_EVT:
+                fuzz_link_evt(&in);
+                break;
+
+            case FUZZ_STEP_MTU:
+                ble_bulk_att_mtu_set(&m_bulk, BLE_GATT_ATT_MTU_DEFAULT
+                                     + fuzz_u8(&in) % (NRF_SDH_BLE_GATT_MAX_MTU_SIZE - BLE_GATT_ATT_MTU_DEFAULT + 1));
+                break;
+
+            case FUZZ_STEP_HVX_BUDGET:
+                m_hvx_budget = fuzz_u8(&in) % 8;
+                break;
+
+            case FUZZ_STEP_TICK:
+                fuzz_tick(&in);
+                break;
+
+            case FUZZ_STEP_CHORD:
+                UNUSED_RETURN_VALUE(transport_chord_send(fuzz_u8(&in)));
+                break;
+
+            case FUZZ_STEP_TEXT:
+                fuzz_text(&in);
+                break;
+
+            case FUZZ_STEP_KEYS:
+                ble_chord_keys_update(&m_chord, fuzz_u8(&in), uptime_ms());
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    // flash writes queued by the input complete before the next one starts
+    UNUSED_RETURN_VALUE(sdk_stub_fds_process());
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**@brief Driver for libFuzzer targets where libFuzzer is not available (gcc).
+ *
+ * @details Runs the files and directories given, then random inputs mutated from them and from
+ *          each other until -runs or -max_total_time is reached, and reports executions per
+ *          second. Without coverage feedback it finds less than libFuzzer, but every run is
+ *          checked by the sanitizers the target is built with. An input that fails is written to
+ *          crash-<run> in the current directory and can be run again as an argument.
+ *
+ *          Options, as libFuzzer spells them: -runs=N, -max_total_time=S, -max_len=N, -seed=N.
+ */
+
+#include <dirent.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sanitizer/common_interface_defs.h>
+
+#define POOL_SIZE       64                                          /**< Inputs kept to mutate. */
+
+int LLVMFuzzerTestOneInput(uint8_t const * p_data, size_t size);
+
+typedef struct
+{
+    uint8_t * p_data;
+    size_t    size;
+} input_t;
+
+static input_t        m_pool[POOL_SIZE];
+static size_t         m_pool_count;
+static uint8_t      * m_current;
+static size_t         m_current_size;
+static unsigned long  m_runs;
+
+/**@brief Function for saving the input being run, from the sanitizer's death callback or a signal. */
+static void crash_save(void)
+{
+    char   name[32];
+    FILE * p_file;
+
+    snprintf(name, sizeof(name), "crash-%lu", m_runs);
+    p_file = fopen(name, "wb");
+    if (p_file != NULL)
+    {
+        fwrite(m_current, 1, m_current_size, p_file);
+        fclose(p_file);
+        fprintf(stderr, "input written to %s\n", name);
+    }
+}
+
+static void crash_signal(int sig)
+{
+    crash_save();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(uint8_t * p_data, size_t size)
+{
+    m_current      = p_data;
+    m_current_size = size;
+    LLVMFuzzerTestOneInput(p_data, size);
+    m_runs++;
+}
+
+static void pool_add(uint8_t const * p_data, size_t size)
+{
+    input_t * p_slot = &m_pool[(m_pool_count < POOL_SIZE) ? m_pool_count++ : (size_t)rand() % POOL_SIZE];
+
+    free(p_slot->p_data);
+    p_slot->p_data = malloc(size + 1);
+    memcpy(p_slot->p_data, p_data, size);
+    p_slot->size = size;
+}
+
+static void run_file(char const * p_path)
+{
+    FILE    * p_file = fopen(p_path, "rb");
+    uint8_t * p_data;
+    long      size;
+
+    if (p_file == NULL)
+    {
+        perror(p_path);
+        return;
+    }
+    fseek(p_file, 0, SEEK_END);
+    size = ftell(p_file);
+    rewind(p_file);
+    p_data = malloc(size + 1);
+    if (fread(p_data, 1, size, p_file) != (size_t)size)
+    {
+        size = 0;
+    }
+    fclose(p_file);
+
+    run(p_data, size);
+    pool_add(p_data, size);
+    free(p_data);
+}
+
+static void run_path(char const * p_path)
+{
+    DIR           * p_dir = opendir(p_path);
+    struct dirent * p_entry;
+    char            path[4096];
+
+    if (p_dir == NULL)
+    {
+        run_file(p_path);
+        return;
+    }
+    while ((p_entry = readdir(p_dir)) != NULL)
+    {
+        if (p_entry->d_name[0] != '.')
+        {
+            snprintf(path, sizeof(path), "%s/%s", p_path, p_entry->d_name);
+            run_file(path);
+        }
+    }
+    closedir(p_dir);
+}
+
+/**@brief Function for making the next input: random, or a pool entry with a few random edits. */
+static size_t mutate(uint8_t * p_data, size_t max_len)
+{
+    size_t size;
+
+    if ((m_pool_count == 0) || (rand() % 8 == 0))
+    {
+        size = (size_t)rand() % (max_len + 1);
+        for (size_t i = 0; i < size; i++)
+        {
+            p_data[i] = (uint8_t)rand();
+        }
+        return size;
+    }
+
+    input_t const * p_src = &m_pool[(size_t)rand() % m_pool_count];
+
+    size = (p_src->size < max_len) ? p_src->size : max_len;
+    memcpy(p_data, p_src->p_data, size);
+    for (int edits = 1 + rand() % 4; edits > 0; edits--)
+    {
+        size_t pos = (size != 0) ? (size_t)rand() % size : 0;
+
+        switch (rand() % 5)
+        {
+            case 0:
+                if (size != 0)
+                {
+                    p_data[pos] ^= (uint8_t)(1 << (rand() % 8));
+                }
+                break;
+
+            case 1:
+                if (size != 0)
+                {
+                    p_data[pos] = (uint8_t)rand();
+                }
+                break;
+
+            case 2:
+                if (size < max_len)
+                {
+                    memmove(&p_data[pos + 1], &p_data[pos], size - pos);
+                    p_data[pos] = (uint8_t)rand();
+                    size++;
+                }
+                break;
+
+            case 3:
+                if (size != 0)
+                {
+                    memmove(&p_data[pos], &p_data[pos + 1], size - pos - 1);
+                    size--;
+                }
+                break;
+
+            default:
+            {
+                input_t const * p_other = &m_pool[(size_t)rand() % m_pool_count];
+                size_t          len     = (p_other->size < max_len - pos) ? p_other->size : max_len - pos;
+
+                memcpy(&p_data[pos], p_other->p_data, len);
+                size = (pos + len > size) ? pos + len : size;
+            } break;
+        }
+    }
+    return size;
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned long max_runs  = 0;
+    double        max_time  = 0;
+    size_t        max_len   = 4096;
+    unsigned      seed      = (unsigned)time(NULL);
+    uint8_t     * p_data;
+    double        start;
+    double        elapsed;
+
+    __sanitizer_set_death_callback(crash_save);
+    signal(SIGABRT, crash_signal);
+    signal(SIGSEGV, crash_signal);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (sscanf(argv[i], "-runs=%lu", &max_runs) == 1) continue;
+        if (sscanf(argv[i], "-max_total_time=%lf", &max_time) == 1) continue;
+        if (sscanf(argv[i], "-max_len=%zu", &max_len) == 1) continue;
+        if (sscanf(argv[i], "-seed=%u", &seed) == 1) continue;
+        if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    srand(seed);
+    fprintf(stderr, "seed %u\n", seed);
+
+    start = now_s();
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            run_path(argv[i]);
+        }
+    }
+    if ((m_runs != 0) && (max_runs == 0) && (max_time == 0))
+    {
+        // only inputs given, run them as libFuzzer does
+        fprintf(stderr, "%lu inputs run\n", m_runs);
+        return 0;
+    }
+
+    p_data = malloc(max_len + 1);
+    while (((max_runs == 0) || (m_runs < max_runs)) && ((max_time == 0) || (now_s() - start < max_time)))
+    {
+        size_t size = mutate(p_data, max_len);
+
+        run(p_data, size);
+        if (rand() % 16 == 0)
+        {
+            pool_add(p_data, size);
+        }
+    }
+    free(p_data);
+
+    elapsed = now_s() - start;
+    fprintf(stderr, "#%lu runs in %.1f s, %.0f exec/s\n", m_runs, elapsed, m_runs / ((elapsed > 0) ? elapsed : 1));
+    return 0;
+}
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Writes the seed inputs of fuzz_ble_evt.c to corpus/ble_evt.
+
+Random bytes rarely enable a CCCD or build a bulk block with a valid CRC, so the seeds walk through
+the chord, text, key state, bulk and configuration paths once each; the fuzzer mutates from there.
+The handles are the ones the SoftDevice stand-in gives out, see stub/sdk_stub.h.
+"""
+
+import os
+import struct
+import sys
+
+CONNECT, DISCONNECT, WRITE, AUTHORIZE, TX_COMPLETE, LINK_EVT, MTU, HVX_BUDGET, TICK, CHORD, TEXT, KEYS = range(12)
+
+CHORD_CCCD, TEXT_CCCD, KEYS_CCCD = 3, 5, 7
+BULK_TX_CCCD, BULK_RX, BULK_CTRL, BULK_CTRL_CCCD = 10, 11, 12, 13
+CONFIG = 15
+WRITE_REQ, WRITE_CMD = 1, 2
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc = ((crc >> 8) | (crc << 8)) & 0xFFFF
+        crc ^= b
+        crc ^= (crc & 0xFF) >> 4
+        crc ^= (crc << 12) & 0xFFFF
+        crc ^= ((crc & 0xFF) << 5) & 0xFFFF
+    return crc
+
+
+def connect(link=0):
+    return bytes([CONNECT, link]) + struct.pack('<H', 24)
+
+
+def write(handle, data, op=WRITE_REQ, link=0, step=WRITE):
+    return bytes([step, link, handle, op, 0]) + struct.pack('<H', len(data)) + bytes(data)
+
+
+def subscribe(*cccds, link=0):
+    return b''.join(write(h, [1, 0], link=link) for h in cccds)
+
+
+def block(seq, payload):
+    header = bytes([seq, len(payload)])
+    return header + struct.pack('<H', crc16(bytes(payload), crc16(header))) + bytes(payload)
+
+
+def seeds():
+    yield 'chords', (connect() + subscribe(CHORD_CCCD, TEXT_CCCD, KEYS_CCCD) + bytes([HVX_BUDGET, 3])
+                     + b''.join(bytes([CHORD, c]) for c in (1, 3, 7, 15, 31, 2))
+                     + bytes([TEXT, 2, 5]) + b'hello' + bytes([KEYS, 1, KEYS, 3, KEYS, 0])
+                     + bytes([TX_COMPLETE, 0, 2, TX_COMPLETE, 0, 3])
+                     + bytes([TICK, 0x03, 10, TICK, 0x03, 10, TICK, 0, 10, TICK, 0, 10])
+                     + bytes([DISCONNECT, 0, 0x13]))
+
+    yield 'two_links', (connect(0) + connect(1) + subscribe(CHORD_CCCD, TEXT_CCCD, link=0)
+                        + subscribe(CHORD_CCCD, TEXT_CCCD, link=1) + bytes([HVX_BUDGET, 1])
+                        + b''.join(bytes([CHORD, c]) for c in range(1, 24))
+                        + bytes([TX_COMPLETE, 1, 1, TX_COMPLETE, 0, 4, DISCONNECT, 1, 0x08])
+                        + bytes([CHORD, 9, TX_COMPLETE, 0, 1]))
+
+    yield 'bulk_read', (connect() + bytes([MTU, 224, HVX_BUDGET, 7]) + subscribe(BULK_TX_CCCD, BULK_CTRL_CCCD)
+                        + bytes([CHORD, 5, CHORD, 6])
+                        + write(BULK_CTRL, [0x01, 0]) + bytes([TX_COMPLETE, 0, 4])
+                        + write(BULK_CTRL, [0x04, 1]) + write(BULK_CTRL, [0x03, 2]) + bytes([TX_COMPLETE, 0, 4])
+                        + write(BULK_CTRL, [0x03, 4]) + write(BULK_CTRL, [0x05])
+                        + write(BULK_CTRL, [0x01, 1]) + write(BULK_CTRL, [0x03, 1]))
+
+    payload = bytes(range(40))
+    yield 'bulk_write', (connect() + bytes([HVX_BUDGET, 7]) + subscribe(BULK_CTRL_CCCD)
+                         + write(BULK_CTRL, [0x02, 2] + list(struct.pack('<I', len(payload))))
+                         + write(BULK_RX, block(0, payload[:16]), op=WRITE_CMD)
+                         + write(BULK_RX, block(2, payload[16:32]), op=WRITE_CMD)
+                         + write(BULK_RX, block(1, payload[16:32]), op=WRITE_CMD)
+                         + write(BULK_RX, block(2, payload[32:]), op=WRITE_CMD))
+
+    yield 'config', (connect() + b''.join(write(CONFIG, [i] + list(struct.pack('<I', v)), step=AUTHORIZE)
+                                          for i, v in ((0, 50), (3, 30), (9, 7), (1, 0xFFFFFFFF)))
+                     + write(CONFIG, [1, 2], step=AUTHORIZE))
+
+
+def main():
+    out = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'corpus', 'ble_evt')
+    os.makedirs(out, exist_ok=True)
+    for name, data in seeds():
+        with open(os.path.join(out, name), 'wb') as f:
+            f.write(data)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
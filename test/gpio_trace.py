@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""Converts GPIO captures to the trace files bench_gpio_trace.c replays, see gpio_trace.h.
+
+  gpio_trace.py convert [--board BOARD] capture.bin out.trace
+      A capture is the RTT stream of up buffer GPIO_TRACE_RTT_CHANNEL saved to a file, for example
+      with JLinkRTTLogger -RTTChannel 1. Bytes before the first header are skipped and a trailing
+      partial record is dropped. A capture with several headers, the device having reset, is
+      written as out-1.trace, out-2.trace and so on.
+
+  gpio_trace.py seed [DIR]
+      Writes the seed traces to DIR, corpus/gpio by default. They are generated typing converted
+      from a capture of the same format, each with the chords it was typed from; recorded traces
+      go next to them.
+
+A trace is text. Pins are turned into keys with the pin map of the board in board_pins.h, so a
+trace replays on any board:
+
+  # comment
+  gpio_trace PERIOD_US
+  expect CHORD...               chords typed, hex, optional and repeated
+  KEYS SAMPLES                  run of equal samples, hex keys: bit n for key n + 1, 0x100 for the
+                                power button, set while pressed
+  gap SAMPLES                   samples lost on the device
+"""
+
+import os
+import random
+import re
+import struct
+import sys
+
+MAGIC = 0x43525447
+GAP = 0xFFFFFFFF
+PWR_BTN = 0x100
+HEADER = struct.Struct('<III')
+RECORD = struct.Struct('<II')
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+
+def board_pins(board):
+    """Returns the key pins and the power button pin of a board, from board_pins.h."""
+    with open(os.path.join(ROOT, 'board_pins.h')) as f:
+        text = f.read()
+    m = re.search(r'defined\(BOARD_%s\)(.*?)#(?:el|endif)' % board.upper(), text, re.S)
+    if m is None:
+        sys.exit('gpio_trace: no pin map for board %s in board_pins.h' % board)
+    keys = [int(p) for p in re.search(r'KEY_PINS\s+\{([^}]*)\}', m.group(1)).group(1).split(',')]
+    pwr = int(re.search(r'PWR_BTN_PIN\s+(\d+)', m.group(1)).group(1))
+    return keys, pwr
+
+
+def captures(data):
+    """Yields (period_us, pin_mask, records) for each header in a capture."""
+    start = data.find(struct.pack('<I', MAGIC))
+    if start < 0:
+        sys.exit('gpio_trace: no header in the capture')
+    while start >= 0:
+        _, period_us, pin_mask = HEADER.unpack_from(data, start)
+        pos = start + HEADER.size
+        nxt = data.find(struct.pack('<I', MAGIC), pos)
+        end = len(data) if nxt < 0 else nxt
+        if (end - pos) % RECORD.size:
+            print('gpio_trace: %d bytes of a partial record dropped' % ((end - pos) % RECORD.size), file=sys.stderr)
+        records = [RECORD.unpack_from(data, p) for p in range(pos, end - RECORD.size + 1, RECORD.size)]
+        yield period_us, pin_mask, records
+        start = nxt
+
+
+def keys_of(pins, pin_mask, key_pins, pwr_pin):
+    keys = 0
+    for i, pin in enumerate(key_pins):
+        if (pin_mask >> pin) & 1 and not (pins >> pin) & 1:
+            keys |= 1 << i
+    if (pin_mask >> pwr_pin) & 1 and not (pins >> pwr_pin) & 1:
+        keys |= PWR_BTN
+    return keys
+
+
+def trace_lines(period_us, pin_mask, records, key_pins, pwr_pin, comments=(), expect=()):
+    """Returns the lines of a trace, equal runs after the pin mapping merged."""
+    runs = []
+    for pins, samples in records:
+        item = ('gap', samples) if pins == GAP else (keys_of(pins, pin_mask, key_pins, pwr_pin), samples)
+        if runs and runs[-1][0] == item[0]:
+            runs[-1] = (item[0], runs[-1][1] + samples)
+        else:
+            runs.append(item)
+    lines = ['# ' + c for c in comments] + ['gpio_trace %d' % period_us]
+    for i in range(0, len(expect), 16):
+        lines.append('expect ' + ' '.join('%02x' % c for c in expect[i:i + 16]))
+    lines += ['gap %d' % n if k == 'gap' else '%03x %d' % (k, n) for k, n in runs]
+    return lines
+
+
+def convert(path, out, board):
+    key_pins, pwr_pin = board_pins(board)
+    with open(path, 'rb') as f:
+        found = list(captures(f.read()))
+    stem, ext = os.path.splitext(out)
+    for n, (period_us, pin_mask, records) in enumerate(found, 1):
+        name = out if len(found) == 1 else '%s-%d%s' % (stem, n, ext)
+        comments = ['%s, capture %d of %d, board %s' % (os.path.basename(path), n, len(found), board)]
+        with open(name, 'w') as f:
+            f.write('\n'.join(trace_lines(period_us, pin_mask, records, key_pins, pwr_pin, comments)) + '\n')
+        print('gpio_trace: %s, %d records' % (name, len(records)))
+
+
+def typing(rng, seconds, pace, bounce_ms):
+    """Returns key changes [(ms, key, down)] and the chords of generated typing.
+
+    pace is the gap between chords, ms; bounce_ms the longest contact bounce after an edge.
+    """
+    edges, chords, t = [], [], 500.0
+    while t < seconds * 1000:
+        for _ in range(rng.randint(5, 40)):
+            chord = rng.randint(1, 0x1F) | (0x20 if rng.random() < 0.1 else 0)
+            keys = [k for k in range(6) if chord >> k & 1]
+            downs = {k: t + rng.uniform(0, 25) for k in keys}
+            hold = max(downs.values()) + rng.uniform(50, 150)
+            ups = {k: hold + rng.uniform(0, 20) for k in keys}
+            for k in keys:
+                for at, down in ((downs[k], True), (ups[k], False)):
+                    edges.append((at, k, down))
+                    b = at
+                    for _ in range(rng.randint(0, 3)):
+                        b += rng.uniform(0.05, bounce_ms / 6)
+                        edges.append((b, k, not down))
+                        b += rng.uniform(0.05, bounce_ms / 6)
+                        edges.append((b, k, down))
+            chords.append(chord)
+            t = max(ups.values()) + rng.uniform(*pace)
+        t += rng.uniform(1000, 8000)
+    return sorted(edges), chords
+
+
+def capture_of(edges, seconds, period_us, key_pins, pwr_pin):
+    """Samples key changes as the device does, returns the RTT stream."""
+    pin_mask = (1 << pwr_pin) | sum(1 << p for p in key_pins[:6])
+    records, level, pins, run, i = [], 0, pin_mask, 0, 0
+    for sample in range(int(seconds * 1000000 / period_us)):
+        now_ms = sample * period_us / 1000
+        while i < len(edges) and edges[i][0] <= now_ms:
+            _, k, down = edges[i]
+            level = level | (1 << k) if down else level & ~(1 << k)
+            i += 1
+        sample_pins = pin_mask & ~sum(1 << key_pins[k] for k in range(6) if level >> k & 1)
+        if sample_pins != pins and run:
+            records.append((pins, run))
+            run = 0
+        pins, run = sample_pins, run + 1
+    records.append((pins, run))
+    return HEADER.pack(MAGIC, period_us, pin_mask) + b''.join(RECORD.pack(*r) for r in records)
+
+
+def seed(directory):
+    """Writes the seed traces: steady typing, fast typing, and switches bouncing past the debounce time."""
+    key_pins, pwr_pin = board_pins('pca10040')
+    os.makedirs(directory, exist_ok=True)
+    for name, seconds, pace, bounce_ms, note in (
+            ('steady', 120, (150, 400), 2, 'generated, steady typing with bounce up to 2 ms'),
+            ('fast', 90, (30, 120), 2, 'generated, fast typing with bounce up to 2 ms'),
+            ('worn', 90, (150, 400), 8, 'generated, worn switches bouncing up to 8 ms')):
+        rng = random.Random(name)
+        edges, chords = typing(rng, seconds, pace, bounce_ms)
+        data = capture_of(edges, edges[-1][0] / 1000 + 1, 1000, key_pins, pwr_pin)
+        (period_us, pin_mask, records), = captures(data)
+        lines = trace_lines(period_us, pin_mask, records, key_pins, pwr_pin, [note + ', see gpio_trace.py'], chords)
+        with open(os.path.join(directory, name + '.trace'), 'w') as f:
+            f.write('\n'.join(lines) + '\n')
+
+
+def main(argv):
+    if len(argv) >= 1 and argv[0] == 'seed' and len(argv) <= 2:
+        seed(argv[1] if len(argv) == 2 else os.path.join(os.path.dirname(os.path.abspath(__file__)), 'corpus', 'gpio'))
+        return
+    if len(argv) >= 3 and argv[0] == 'convert':
+        board = 'pca10040'
+        if argv[1] == '--board' and len(argv) == 5:
+            board, argv = argv[2], argv[2:]
+        if len(argv) == 3:
+            convert(argv[1], argv[2], board)
+            return
+    sys.exit(__doc__)
+
+
+if __name__ == '__main__':
+    main(sys.argv[1:])
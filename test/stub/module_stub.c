@@ -0,0 +1,74 @@
+#include "module_stub.h"
+#include <string.h>
+
+#define MODULE_STUB_UPLOAD_MAX  4096                                /**< Upload bytes kept per blob, more are counted and dropped. */
+
+module_stub_blob_t module_stub_blobs[FLASH_BLOB_COUNT];
+uint32_t           module_stub_blob_uploaded[FLASH_BLOB_COUNT];
+
+static uint8_t m_upload[FLASH_BLOB_COUNT][MODULE_STUB_UPLOAD_MAX];
+
+static uint32_t upload_write(flash_blob_id_t id, uint32_t offset, uint8_t const * p_data, uint16_t len)
+{
+    if (len == 0)
+    {
+        module_stub_blob_uploaded[id] = 0;
+        return NRF_SUCCESS;
+    }
+    if (offset != module_stub_blob_uploaded[id])
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (offset + i < MODULE_STUB_UPLOAD_MAX)
+        {
+            m_upload[id][offset + i] = p_data[i];
+        }
+    }
+    module_stub_blob_uploaded[id] += len;
+    return NRF_SUCCESS;
+}
+
+static uint32_t text_dict_write(uint32_t offset, uint8_t const * p_data, uint16_t len)
+{
+    return upload_write(FLASH_BLOB_TEXT_DICT, offset, p_data, len);
+}
+
+static uint32_t phrase_model_write(uint32_t offset, uint8_t const * p_data, uint16_t len)
+{
+    return upload_write(FLASH_BLOB_PHRASE_MODEL, offset, p_data, len);
+}
+
+static void upload_done(bool success)
+{
+    (void)success;
+}
+
+static const ble_bulk_stream_t m_streams[FLASH_BLOB_COUNT] =
+{
+    [FLASH_BLOB_TEXT_DICT]    = {.write = text_dict_write,    .done = upload_done},
+    [FLASH_BLOB_PHRASE_MODEL] = {.write = phrase_model_write, .done = upload_done},
+};
+
+ret_code_t flash_blob_init(void)
+{
+    return NRF_SUCCESS;
+}
+
+void const * flash_blob_get(flash_blob_id_t id, uint16_t format, uint32_t * p_len)
+{
+    module_stub_blob_t const * p_blob = &module_stub_blobs[id];
+
+    if ((p_blob->p_data == NULL) || (p_blob->format != format))
+    {
+        return NULL;
+    }
+    *p_len = p_blob->len;
+    return p_blob->p_data;
+}
+
+ble_bulk_stream_t const * flash_blob_stream(flash_blob_id_t id)
+{
+    return &m_streams[id];
+}
@@ -0,0 +1,26 @@
+#ifndef MODULE_STUB_H__
+#define MODULE_STUB_H__
+
+/**@brief Host stand-ins for the firmware modules that only run on the chip, flash_blob.c for now.
+ *
+ * @details Blobs are whatever the test points module_stub_blobs at. The upload streams take
+ *          consecutive blocks into a RAM buffer and count them; the blob itself is not replaced.
+ */
+
+#include <stdint.h>
+#include "flash_blob.h"
+
+/**@brief Blob returned by flash_blob_get(), NULL for none. */
+typedef struct
+{
+    void const * p_data;
+    uint32_t     len;
+    uint16_t     format;
+} module_stub_blob_t;
+
+extern module_stub_blob_t module_stub_blobs[FLASH_BLOB_COUNT];
+
+/**@brief Bytes taken by the upload stream of each blob since its last start. */
+extern uint32_t module_stub_blob_uploaded[FLASH_BLOB_COUNT];
+
+#endif // MODULE_STUB_H__
@@ -0,0 +1,879 @@
+#include "sdk_stub.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+uint32_t (*sdk_stub_hvx_handler)(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params);
+uint32_t sdk_stub_link_result;
+void (*sdk_stub_disconnect_handler)(uint16_t conn_handle);
+void (*sdk_stub_system_off_handler)(void);
+uint16_t sdk_stub_conn_handles[NRF_SDH_BLE_TOTAL_LINK_COUNT];
+uint32_t sdk_stub_conn_count;
+uint32_t sdk_stub_gpio_in;
+uint32_t sdk_stub_gpio_out;
+uint32_t sdk_stub_gpio_latch;
+bool     sdk_stub_gpiote_port;
+uint32_t sdk_stub_resetreas;
+uint32_t sdk_stub_rtc;
+app_timer_timeout_handler_t sdk_stub_timer_handler;
+uint32_t                    sdk_stub_timer_ticks;
+uint32_t                    sdk_stub_timer_starts;
+app_usbd_state_t            sdk_stub_usbd_state;
+bool                        sdk_stub_usbd_enabled;
+bool                        sdk_stub_usbd_started;
+bool                        sdk_stub_usbd_suspended;
+sdk_stub_hid_report_t       sdk_stub_hid_report;
+bool                        sdk_stub_hid_busy;
+uint8_t const *             sdk_stub_cdc_data;
+size_t                      sdk_stub_cdc_len;
+uint32_t                    sdk_stub_fds_words_written;
+uint32_t                    sdk_stub_fds_page_erases;
+
+static uint16_t m_next_handle;
+static volatile uint8_t m_sink;
+
+/**@brief Function for reading a buffer the SoftDevice copies, so a sanitizer sees the access. */
+static void sd_stub_copy(uint8_t const * p_data, uint16_t len)
+{
+    uint8_t sum = 0;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        sum += p_data[i];
+    }
+    m_sink = sum;
+}
+static uint8_t  m_next_uuid_type;
+
+/**@brief RTT buffer, a ring of the target's memory that holds one byte less than its size. */
+typedef struct
+{
+    uint8_t * p_buf;                                                /**< NULL until configured. */
+    uint32_t  size;
+    uint32_t  wr;
+    uint32_t  rd;
+} rtt_ring_t;
+
+static rtt_ring_t m_rtt_up[SEGGER_RTT_MAX_NUM_UP_BUFFERS];
+static rtt_ring_t m_rtt_down[SEGGER_RTT_MAX_NUM_DOWN_BUFFERS];
+
+void sdk_stub_reset(void)
+{
+    sdk_stub_hvx_handler        = NULL;
+    sdk_stub_link_result        = NRF_SUCCESS;
+    sdk_stub_disconnect_handler = NULL;
+    sdk_stub_system_off_handler = NULL;
+    sdk_stub_conn_count         = 0;
+    sdk_stub_gpio_in            = 0xFFFFFFFF;
+    sdk_stub_gpio_out           = 0;
+    sdk_stub_gpio_latch         = 0;
+    sdk_stub_gpiote_port        = false;
+    sdk_stub_resetreas          = 0;
+    sdk_stub_rtc                = 0;
+    sdk_stub_timer_ticks        = 0;
+    sdk_stub_timer_starts       = 0;
+    memset(m_rtt_up, 0, sizeof(m_rtt_up));
+    memset(m_rtt_down, 0, sizeof(m_rtt_down));
+    m_next_handle               = 1;
+    m_next_uuid_type            = BLE_UUID_TYPE_VENDOR_BEGIN;
+    sdk_stub_usbd_state         = APP_USBD_STATE_Disabled;
+    sdk_stub_usbd_enabled       = false;
+    sdk_stub_usbd_started       = false;
+    sdk_stub_usbd_suspended     = false;
+    sdk_stub_hid_busy           = false;
+    sdk_stub_cdc_data           = NULL;
+    memset(&sdk_stub_hid_report, 0, sizeof(sdk_stub_hid_report));
+}
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
+{
+    fprintf(stderr, "%s:%u: APP_ERROR_CHECK failed: 0x%x\n", (char const *)p_file_name,
+            (unsigned)line_num, (unsigned)error_code);
+    abort();
+}
+
+// GPIO, pins on port 0 only, which is all the boards use.
+
+void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    (void)pin_number;
+}
+
+void nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config)
+{
+    (void)pin_number;
+    (void)pull_config;
+}
+
+void nrf_gpio_cfg_sense_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config, nrf_gpio_pin_sense_t sense_config)
+{
+    (void)pin_number;
+    (void)pull_config;
+    (void)sense_config;
+}
+
+uint32_t nrf_gpio_pin_read(uint32_t pin_number)
+{
+    return (sdk_stub_gpio_in >> (pin_number & 0x1F)) & 1;
+}
+
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value)
+{
+    if (value)
+    {
+        sdk_stub_gpio_out |= 1UL << (pin_number & 0x1F);
+    }
+    else
+    {
+        sdk_stub_gpio_out &= ~(1UL << (pin_number & 0x1F));
+    }
+}
+
+void nrf_gpio_pin_toggle(uint32_t pin_number)
+{
+    sdk_stub_gpio_out ^= 1UL << (pin_number & 0x1F);
+}
+
+uint32_t nrf_gpio_pin_latch_get(uint32_t pin_number)
+{
+    return (sdk_stub_gpio_latch >> (pin_number & 0x1F)) & 1;
+}
+
+void nrf_gpio_pin_latch_clear(uint32_t pin_number)
+{
+    sdk_stub_gpio_latch &= ~(1UL << (pin_number & 0x1F));
+}
+
+bool nrf_gpiote_event_is_set(nrf_gpiote_events_t event)
+{
+    (void)event;
+    return sdk_stub_gpiote_port;
+}
+
+void nrf_gpiote_event_clear(nrf_gpiote_events_t event)
+{
+    (void)event;
+    sdk_stub_gpiote_port = false;
+}
+
+uint32_t nrf_power_resetreas_get(void)
+{
+    return sdk_stub_resetreas;
+}
+
+// app_timer, one timer is all the firmware creates.
+
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler)
+{
+    (void)p_timer_id;
+    (void)mode;
+    sdk_stub_timer_handler = timeout_handler;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    (void)timer_id;
+    (void)p_context;
+    if (timeout_ticks < 5)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    sdk_stub_timer_ticks = timeout_ticks;
+    sdk_stub_timer_starts++;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id)
+{
+    (void)timer_id;
+    sdk_stub_timer_ticks = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(void)
+{
+    return sdk_stub_rtc & 0xFFFFFF;
+}
+
+// SEGGER RTT
+
+static uint32_t rtt_ring_put(rtt_ring_t * p_ring, void const * p_data, uint32_t len)
+{
+    uint32_t room = (p_ring->p_buf == NULL) ? 0 : (p_ring->rd + p_ring->size - p_ring->wr - 1) % p_ring->size;
+
+    len = MIN(len, room);
+    for (uint32_t i = 0; i < len; i++)
+    {
+        p_ring->p_buf[p_ring->wr] = ((uint8_t const *)p_data)[i];
+        p_ring->wr                = (p_ring->wr + 1) % p_ring->size;
+    }
+    return len;
+}
+
+static uint32_t rtt_ring_get(rtt_ring_t * p_ring, void * p_data, uint32_t max_len)
+{
+    uint32_t len = 0;
+
+    while ((p_ring->p_buf != NULL) && (p_ring->rd != p_ring->wr) && (len < max_len))
+    {
+        ((uint8_t *)p_data)[len++] = p_ring->p_buf[p_ring->rd];
+        p_ring->rd                 = (p_ring->rd + 1) % p_ring->size;
+    }
+    return len;
+}
+
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char * sName, void * pBuffer, unsigned BufferSize, unsigned Flags)
+{
+    (void)sName;
+    (void)Flags;
+    if ((BufferIndex >= SEGGER_RTT_MAX_NUM_UP_BUFFERS) || (BufferSize < 2))
+    {
+        return -1;
+    }
+    m_rtt_up[BufferIndex] = (rtt_ring_t){pBuffer, BufferSize, 0, 0};
+    return 0;
+}
+
+int SEGGER_RTT_ConfigDownBuffer(unsigned BufferIndex, const char * sName, void * pBuffer, unsigned BufferSize, unsigned Flags)
+{
+    (void)sName;
+    (void)Flags;
+    if ((BufferIndex >= SEGGER_RTT_MAX_NUM_DOWN_BUFFERS) || (BufferSize < 2))
+    {
+        return -1;
+    }
+    m_rtt_down[BufferIndex] = (rtt_ring_t){pBuffer, BufferSize, 0, 0};
+    return 0;
+}
+
+unsigned SEGGER_RTT_Write(unsigned BufferIndex, const void * pBuffer, unsigned NumBytes)
+{
+    rtt_ring_t * p_ring = &m_rtt_up[BufferIndex];
+
+    // skip mode: all or nothing
+    if ((p_ring->p_buf == NULL) || ((p_ring->rd + p_ring->size - p_ring->wr - 1) % p_ring->size < NumBytes))
+    {
+        return 0;
+    }
+    return rtt_ring_put(p_ring, pBuffer, NumBytes);
+}
+
+unsigned SEGGER_RTT_Read(unsigned BufferIndex, void * pBuffer, unsigned BufferSize)
+{
+    return rtt_ring_get(&m_rtt_down[BufferIndex], pBuffer, BufferSize);
+}
+
+uint32_t sdk_stub_rtt_read(uint8_t channel, void * p_data, uint32_t max_len)
+{
+    return (channel < SEGGER_RTT_MAX_NUM_UP_BUFFERS) ? rtt_ring_get(&m_rtt_up[channel], p_data, max_len) : 0;
+}
+
+uint32_t sdk_stub_rtt_write(uint8_t channel, void const * p_data, uint32_t len)
+{
+    return (channel < SEGGER_RTT_MAX_NUM_DOWN_BUFFERS) ? rtt_ring_put(&m_rtt_down[channel], p_data, len) : 0;
+}
+
+// SoftDevice
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * p_vs_uuid, uint8_t * p_uuid_type)
+{
+    (void)p_vs_uuid;
+    *p_uuid_type = m_next_uuid_type++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const * p_uuid, uint16_t * p_handle)
+{
+    (void)type;
+    (void)p_uuid;
+    *p_handle = m_next_handle++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const * p_char_md,
+                                         ble_gatts_attr_t const * p_attr_char_value,
+                                         ble_gatts_char_handles_t * p_handles)
+{
+    (void)service_handle;
+    if (p_attr_char_value->init_len > p_attr_char_value->max_len)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    memset(p_handles, 0, sizeof(*p_handles));
+    p_handles->value_handle = m_next_handle++;
+    if (p_char_md->char_props.notify || p_char_md->char_props.indicate)
+    {
+        p_handles->cccd_handle = m_next_handle++;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params)
+{
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if ((p_hvx_params->p_len == NULL) || (p_hvx_params->p_data == NULL))
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    sd_stub_copy(p_hvx_params->p_data, *p_hvx_params->p_len);
+    return (sdk_stub_hvx_handler != NULL) ? sdk_stub_hvx_handler(conn_handle, p_hvx_params) : NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t * p_value)
+{
+    (void)conn_handle;
+    (void)handle;
+    (void)p_value;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const * p_rw_authorize_reply_params)
+{
+    if (conn_handle == BLE_CONN_HANDLE_INVALID)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if (p_rw_authorize_reply_params == NULL)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (p_rw_authorize_reply_params->params.write.update && (p_rw_authorize_reply_params->params.write.p_data != NULL))
+    {
+        sd_stub_copy(p_rw_authorize_reply_params->params.write.p_data, p_rw_authorize_reply_params->params.write.len);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code)
+{
+    (void)hci_status_code;
+    if (sdk_stub_disconnect_handler != NULL)
+    {
+        sdk_stub_disconnect_handler(conn_handle);
+    }
+    return sdk_stub_link_result;
+}
+
+uint32_t sd_ble_gap_phy_update(uint16_t conn_handle, ble_gap_phys_t const * p_gap_phys)
+{
+    (void)conn_handle;
+    (void)p_gap_phys;
+    return sdk_stub_link_result;
+}
+
+uint32_t sd_ble_gap_adv_stop(uint8_t adv_handle)
+{
+    (void)adv_handle;
+    return NRF_ERROR_INVALID_STATE;
+}
+
+uint32_t sd_power_system_off(void)
+{
+    if (sdk_stub_system_off_handler == NULL)
+    {
+        fprintf(stderr, "unexpected system off\n");
+        abort();
+    }
+    sdk_stub_system_off_handler();
+    return NRF_SUCCESS;
+}
+
+// ble_conn_state
+
+uint32_t ble_conn_state_peripheral_conn_count(void)
+{
+    return sdk_stub_conn_count;
+}
+
+sdk_mapped_flags_key_list_t ble_conn_state_periph_handles(void)
+{
+    sdk_mapped_flags_key_list_t list;
+
+    list.len = sdk_stub_conn_count;
+    memcpy(list.flag_keys, sdk_stub_conn_handles, sizeof(list.flag_keys));
+    return list;
+}
+
+uint8_t ble_conn_state_status(uint16_t conn_handle)
+{
+    for (uint32_t i = 0; i < sdk_stub_conn_count; i++)
+    {
+        if (sdk_stub_conn_handles[i] == conn_handle)
+        {
+            return BLE_CONN_STATUS_CONNECTED;
+        }
+    }
+    return BLE_CONN_STATUS_DISCONNECTED;
+}
+
+uint16_t crc16_compute(uint8_t const * p_data, uint32_t size, uint16_t const * p_crc)
+{
+    uint16_t crc = (p_crc == NULL) ? 0xFFFF : *p_crc;
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        crc  = (uint8_t)(crc >> 8) | (crc << 8);
+        crc ^= p_data[i];
+        crc ^= (uint8_t)(crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
+
+// FDS, records in RAM. Data is copied when an operation completes, as the flash write would read
+// it then, so a caller that lets the source change while the write is queued is caught. Pages are
+// counted as FDS lays them out: a write reserves room on the first data page it fits when it is
+// queued, and GC erases each page holding garbage, so space and wear follow the device.
+
+#define FDS_STUB_RECORDS    256
+#define FDS_STUB_USERS      FDS_MAX_USERS
+#define FDS_STUB_PAGES      (FDS_VIRTUAL_PAGES - 1)                 /**< One page is kept for the swap. */
+#define FDS_STUB_PAGE_WORDS (FDS_VIRTUAL_PAGE_SIZE - 2)             /**< Less the page tag. */
+#define FDS_STUB_HEADER     3                                       /**< Record header, words. */
+
+typedef struct
+{
+    fds_header_t   header;
+    uint32_t     * p_data;                                          /**< NULL if the slot is free. */
+    uint8_t        page;
+} fds_stub_record_t;
+
+typedef struct
+{
+    fds_evt_id_t   id;
+    uint32_t       record_id;                                       /**< Record replaced or deleted. */
+    uint32_t       new_id;                                          /**< Record written. */
+    uint16_t       file_id;
+    uint16_t       key;
+    void const   * p_data;
+    uint32_t       length_words;
+    uint8_t        page;                                            /**< Page the write reserved. */
+} fds_stub_op_t;
+
+static fds_cb_t          m_fds_users[FDS_STUB_USERS];
+static uint32_t          m_fds_user_count;
+static fds_stub_record_t m_fds_records[FDS_STUB_RECORDS];
+static fds_stub_op_t     m_fds_ops[FDS_OP_QUEUE_SIZE];
+static uint32_t          m_fds_op_count;
+static uint32_t          m_fds_next_id = 1;
+static uint32_t          m_fds_page_used[FDS_STUB_PAGES];           /**< Words written or reserved. */
+static uint32_t          m_fds_page_dirty[FDS_STUB_PAGES];          /**< Words of deleted records. */
+
+static fds_stub_record_t * fds_stub_find(uint32_t record_id)
+{
+    for (uint32_t i = 0; i < FDS_STUB_RECORDS; i++)
+    {
+        if ((m_fds_records[i].p_data != NULL) && (m_fds_records[i].header.record_id == record_id))
+        {
+            return &m_fds_records[i];
+        }
+    }
+    return NULL;
+}
+
+/**@brief Function for queuing an operation. A write or update takes a new record id, which is
+ *        returned in p_desc as FDS does.
+ */
+static ret_code_t fds_stub_queue(fds_evt_id_t id, fds_record_desc_t * p_desc, fds_record_t const * p_record)
+{
+    fds_stub_op_t * p_op;
+
+    uint8_t         page = 0;
+
+    if (m_fds_op_count == FDS_OP_QUEUE_SIZE)
+    {
+        return FDS_ERR_NO_SPACE_IN_QUEUES;
+    }
+    if (p_record != NULL)
+    {
+        uint32_t words = p_record->data.length_words + FDS_STUB_HEADER;
+
+        while ((page < FDS_STUB_PAGES) && (m_fds_page_used[page] + words > FDS_STUB_PAGE_WORDS))
+        {
+            page++;
+        }
+        if (page == FDS_STUB_PAGES)
+        {
+            return FDS_ERR_NO_SPACE_IN_FLASH;
+        }
+        m_fds_page_used[page] += words;
+    }
+    p_op            = &m_fds_ops[m_fds_op_count++];
+    memset(p_op, 0, sizeof(*p_op));
+    p_op->id        = id;
+    p_op->record_id = ((p_desc != NULL) && (id != FDS_EVT_WRITE)) ? p_desc->record_id : 0;
+    if (p_record != NULL)
+    {
+        p_op->page         = page;
+        p_op->new_id       = m_fds_next_id++;
+        p_op->file_id      = p_record->file_id;
+        p_op->key          = p_record->key;
+        p_op->p_data       = p_record->data.p_data;
+        p_op->length_words = p_record->data.length_words;
+        if (p_desc != NULL)
+        {
+            p_desc->record_id = p_op->new_id;
+        }
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_register(fds_cb_t cb)
+{
+    if (m_fds_user_count == FDS_STUB_USERS)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_fds_users[m_fds_user_count++] = cb;
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_init(void)
+{
+    return fds_stub_queue(FDS_EVT_INIT, NULL, NULL);
+}
+
+ret_code_t fds_record_write(fds_record_desc_t * p_desc, fds_record_t const * p_record)
+{
+    return fds_stub_queue(FDS_EVT_WRITE, p_desc, p_record);
+}
+
+ret_code_t fds_record_update(fds_record_desc_t * p_desc, fds_record_t const * p_record)
+{
+    return fds_stub_queue(FDS_EVT_UPDATE, p_desc, p_record);
+}
+
+ret_code_t fds_record_delete(fds_record_desc_t * p_desc)
+{
+    return fds_stub_queue(FDS_EVT_DEL_RECORD, p_desc, NULL);
+}
+
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t * p_desc, fds_find_token_t * p_token)
+{
+    for (uint32_t i = p_token->index; i < FDS_STUB_RECORDS; i++)
+    {
+        fds_stub_record_t const * p_rec = &m_fds_records[i];
+
+        if ((p_rec->p_data != NULL) && (p_rec->header.file_id == file_id) && (p_rec->header.record_key == record_key))
+        {
+            p_desc->record_id = p_rec->header.record_id;
+            p_token->index    = i + 1;
+            return NRF_SUCCESS;
+        }
+    }
+    p_token->index = FDS_STUB_RECORDS;
+    return NRF_ERROR_NOT_FOUND;
+}
+
+ret_code_t fds_record_open(fds_record_desc_t * p_desc, fds_flash_record_t * p_flash_record)
+{
+    fds_stub_record_t const * p_rec = fds_stub_find(p_desc->record_id);
+
+    if (p_rec == NULL)
+    {
+        return NRF_ERROR_NOT_FOUND;
+    }
+    p_flash_record->p_header = &p_rec->header;
+    p_flash_record->p_data   = p_rec->p_data;
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_record_close(fds_record_desc_t * p_desc)
+{
+    (void)p_desc;
+    return NRF_SUCCESS;
+}
+
+ret_code_t fds_gc(void)
+{
+    return fds_stub_queue(FDS_EVT_GC, NULL, NULL);
+}
+
+ret_code_t fds_stat(fds_stat_t * p_stat)
+{
+    memset(p_stat, 0, sizeof(*p_stat));
+    for (uint32_t i = 0; i < FDS_STUB_RECORDS; i++)
+    {
+        if (m_fds_records[i].p_data != NULL)
+        {
+            p_stat->valid_records++;
+            p_stat->words_used += m_fds_records[i].header.length_words + FDS_STUB_HEADER;
+        }
+    }
+    for (uint32_t i = 0; i < FDS_STUB_PAGES; i++)
+    {
+        p_stat->freeable_words += (uint16_t)m_fds_page_dirty[i];
+    }
+    p_stat->pages_available = FDS_VIRTUAL_PAGES;
+    return NRF_SUCCESS;
+}
+
+/**@brief Function for freeing a record, its words are garbage until the next GC. */
+static void fds_stub_free(fds_stub_record_t * p_rec)
+{
+    m_fds_page_dirty[p_rec->page] += p_rec->header.length_words + FDS_STUB_HEADER;
+    free(p_rec->p_data);
+    p_rec->p_data = NULL;
+}
+
+/**@brief Function for storing a record, replacing the one with old_id.
+ *
+ * @return Id of the record, 0 if the store is full. Its room stays reserved, as FDS leaves it.
+ */
+static uint32_t fds_stub_store(fds_stub_op_t const * p_op, uint32_t old_id, uint32_t new_id)
+{
+    fds_stub_record_t * p_old = (old_id != 0) ? fds_stub_find(old_id) : NULL;
+    fds_stub_record_t * p_new = NULL;
+
+    for (uint32_t i = 0; (i < FDS_STUB_RECORDS) && (p_new == NULL); i++)
+    {
+        if (m_fds_records[i].p_data == NULL)
+        {
+            p_new = &m_fds_records[i];
+        }
+    }
+    if (p_new == NULL)
+    {
+        return 0;
+    }
+    p_new->p_data = malloc(p_op->length_words * sizeof(uint32_t) + 1);
+    memcpy(p_new->p_data, p_op->p_data, p_op->length_words * sizeof(uint32_t));
+    p_new->header.file_id      = p_op->file_id;
+    p_new->header.record_key   = p_op->key;
+    p_new->header.length_words = (uint16_t)p_op->length_words;
+    p_new->header.record_id    = new_id;
+    p_new->page                = p_op->page;
+    sdk_stub_fds_words_written += p_op->length_words + FDS_STUB_HEADER;
+
+    if (p_old != NULL)
+    {
+        fds_stub_free(p_old);
+    }
+    return new_id;
+}
+
+uint32_t sdk_stub_fds_process(void)
+{
+    uint32_t delivered = 0;
+
+    while (m_fds_op_count != 0)
+    {
+        fds_stub_op_t op = m_fds_ops[0];
+        fds_evt_t     evt;
+
+        memmove(&m_fds_ops[0], &m_fds_ops[1], (--m_fds_op_count) * sizeof(m_fds_ops[0]));
+        memset(&evt, 0, sizeof(evt));
+        evt.id     = op.id;
+        evt.result = NRF_SUCCESS;
+
+        switch (op.id)
+        {
+            case FDS_EVT_WRITE:
+            case FDS_EVT_UPDATE:
+            {
+                evt.write.record_id         = fds_stub_store(&op, op.record_id, op.new_id);
+                evt.write.file_id           = op.file_id;
+                evt.write.record_key        = op.key;
+                evt.write.is_record_updated = (op.id == FDS_EVT_UPDATE);
+                if (evt.write.record_id == 0)
+                {
+                    evt.result = FDS_ERR_NO_SPACE_IN_FLASH;
+                }
+            } break;
+
+            case FDS_EVT_DEL_RECORD:
+            {
+                fds_stub_record_t * p_rec = fds_stub_find(op.record_id);
+
+                evt.del.record_id = op.record_id;
+                if (p_rec == NULL)
+                {
+                    evt.result = NRF_ERROR_NOT_FOUND;
+                    break;
+                }
+                evt.del.file_id    = p_rec->header.file_id;
+                evt.del.record_key = p_rec->header.record_key;
+                fds_stub_free(p_rec);
+            } break;
+
+            case FDS_EVT_GC:
+                // each page with garbage is copied to the swap page, which takes its place
+                for (uint32_t i = 0; i < FDS_STUB_PAGES; i++)
+                {
+                    if (m_fds_page_dirty[i] != 0)
+                    {
+                        m_fds_page_used[i]  -= m_fds_page_dirty[i];
+                        m_fds_page_dirty[i]  = 0;
+                        sdk_stub_fds_page_erases++;
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        for (uint32_t i = 0; i < m_fds_user_count; i++)
+        {
+            m_fds_users[i](&evt);
+        }
+        delivered++;
+    }
+    return delivered;
+}
+
+uint32_t sdk_stub_fds_queued(void)
+{
+    return m_fds_op_count;
+}
+
+static app_usbd_config_t             m_usbd_config;
+static app_usbd_class_inst_t const * m_usbd_hid;
+static app_usbd_class_inst_t const * m_usbd_cdc;
+
+ret_code_t app_usbd_init(app_usbd_config_t const * p_config)
+{
+    m_usbd_config = *p_config;
+    m_usbd_hid    = NULL;
+    m_usbd_cdc    = NULL;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_usbd_class_append(app_usbd_class_inst_t const * p_inst)
+{
+    if (p_inst->hid_handler != NULL)
+    {
+        m_usbd_hid = p_inst;
+    }
+    if (p_inst->cdc_handler != NULL)
+    {
+        m_usbd_cdc = p_inst;
+    }
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_usbd_power_events_enable(void)
+{
+    return NRF_SUCCESS;
+}
+
+void app_usbd_enable(void)
+{
+    sdk_stub_usbd_enabled = true;
+}
+
+void app_usbd_disable(void)
+{
+    sdk_stub_usbd_enabled = false;
+}
+
+void app_usbd_start(void)
+{
+    sdk_stub_usbd_started = true;
+}
+
+void app_usbd_stop(void)
+{
+    sdk_stub_usbd_started = false;
+}
+
+bool nrf_drv_usbd_is_enabled(void)
+{
+    return sdk_stub_usbd_enabled;
+}
+
+app_usbd_state_t app_usbd_core_state_get(void)
+{
+    return sdk_stub_usbd_state;
+}
+
+/**@brief Function for checking a transfer can start now. */
+static ret_code_t usbd_transfer_check(bool busy)
+{
+    if (!sdk_stub_usbd_started || sdk_stub_usbd_suspended || (sdk_stub_usbd_state != APP_USBD_STATE_Configured))
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return busy ? NRF_ERROR_BUSY : NRF_SUCCESS;
+}
+
+ret_code_t app_usbd_hid_kbd_modifier_state_set(app_usbd_hid_kbd_t const * p_kbd, app_usbd_hid_kbd_modifier_t modifier, bool state)
+{
+    ret_code_t err_code = usbd_transfer_check(sdk_stub_hid_busy);
+
+    if ((p_kbd != m_usbd_hid) || (err_code != NRF_SUCCESS))
+    {
+        return (err_code != NRF_SUCCESS) ? err_code : NRF_ERROR_INVALID_PARAM;
+    }
+    sdk_stub_hid_report.modifier = state ? (sdk_stub_hid_report.modifier | modifier)
+                                         : (sdk_stub_hid_report.modifier & ~modifier);
+    sdk_stub_hid_busy = true;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_usbd_hid_kbd_key_control(app_usbd_hid_kbd_t const * p_kbd, uint8_t key, bool press)
+{
+    ret_code_t err_code = usbd_transfer_check(sdk_stub_hid_busy);
+    uint8_t  * p_slot   = NULL;
+
+    if ((p_kbd != m_usbd_hid) || (err_code != NRF_SUCCESS))
+    {
+        return (err_code != NRF_SUCCESS) ? err_code : NRF_ERROR_INVALID_PARAM;
+    }
+    for (uint32_t i = 0; i < ARRAY_SIZE(sdk_stub_hid_report.keys); i++)
+    {
+        if ((sdk_stub_hid_report.keys[i] == key) || ((p_slot == NULL) && (sdk_stub_hid_report.keys[i] == 0)))
+        {
+            p_slot = &sdk_stub_hid_report.keys[i];
+        }
+    }
+    if (p_slot != NULL)
+    {
+        *p_slot = press ? key : 0;
+    }
+    sdk_stub_hid_busy = true;
+    return NRF_SUCCESS;
+}
+
+ret_code_t app_usbd_cdc_acm_write(app_usbd_cdc_acm_t const * p_cdc, void const * p_buf, size_t length)
+{
+    ret_code_t err_code = usbd_transfer_check(sdk_stub_cdc_data != NULL);
+
+    if ((p_cdc != m_usbd_cdc) || (err_code != NRF_SUCCESS))
+    {
+        return (err_code != NRF_SUCCESS) ? err_code : NRF_ERROR_INVALID_PARAM;
+    }
+    sdk_stub_cdc_data = p_buf;
+    sdk_stub_cdc_len  = length;
+    return NRF_SUCCESS;
+}
+
+void sdk_stub_usbd_event(app_usbd_event_type_t event)
+{
+    m_usbd_config.ev_state_proc(event);
+}
+
+void sdk_stub_cdc_event(app_usbd_cdc_acm_user_event_t event)
+{
+    if (event == APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE)
+    {
+        sdk_stub_cdc_data = NULL;
+    }
+    m_usbd_cdc->cdc_handler(m_usbd_cdc, event);
+}
+
+void sdk_stub_hid_done(void)
+{
+    sdk_stub_hid_busy = false;
+    m_usbd_hid->hid_handler(m_usbd_hid, APP_USBD_HID_USER_EVT_IN_REPORT_DONE);
+}
+
+void sdk_stub_cdc_done(void)
+{
+    sdk_stub_cdc_data = NULL;
+    m_usbd_cdc->cdc_handler(m_usbd_cdc, APP_USBD_CDC_ACM_USER_EVT_TX_DONE);
+}
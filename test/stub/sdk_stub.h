@@ -0,0 +1,1387 @@
+#ifndef SDK_STUB_H__
+#define SDK_STUB_H__
+
+/**@brief Host stand-ins for the parts of the nRF5 SDK and SoftDevice the firmware modules use.
+ *
+ * @details Every SDK header the modules include is generated by the Makefile as a line that
+ *          includes this one, so the modules build unchanged. Types carry only the fields the
+ *          firmware touches, with the SDK names and values. Calls without an effect worth
+ *          checking succeed inline; the ones a test drives or observes are in sdk_stub.c, with
+ *          the controls at the end of this file. The configuration is the firmware's own.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "sdk_config.h"
+
+// sdk_errors.h, nrf_error.h, ble_err.h
+
+typedef uint32_t ret_code_t;
+
+#define NRF_SUCCESS                     0
+#define NRF_ERROR_INTERNAL              3
+#define NRF_ERROR_NO_MEM                4
+#define NRF_ERROR_NOT_FOUND             5
+#define NRF_ERROR_NOT_SUPPORTED         6
+#define NRF_ERROR_INVALID_PARAM         7
+#define NRF_ERROR_INVALID_STATE         8
+#define NRF_ERROR_INVALID_LENGTH        9
+#define NRF_ERROR_INVALID_FLAGS         10
+#define NRF_ERROR_INVALID_DATA          11
+#define NRF_ERROR_DATA_SIZE             12
+#define NRF_ERROR_TIMEOUT               13
+#define NRF_ERROR_NULL                  14
+#define NRF_ERROR_FORBIDDEN             15
+#define NRF_ERROR_INVALID_ADDR          16
+#define NRF_ERROR_BUSY                  17
+#define NRF_ERROR_RESOURCES             19
+#define NRF_ERROR_MODULE_ALREADY_INITIALIZED 0x8005
+
+#define BLE_ERROR_NOT_ENABLED           0x3001
+#define BLE_ERROR_INVALID_CONN_HANDLE   0x3002
+#define BLE_ERROR_INVALID_ATTR_HANDLE   0x3003
+#define BLE_ERROR_INVALID_ADV_HANDLE    0x3004
+
+// nordic_common.h, app_util.h, app_error.h
+
+#define STATIC_ASSERT(EXPR)             _Static_assert((EXPR), #EXPR)
+#define ARRAY_SIZE(arr)                 (sizeof(arr) / sizeof((arr)[0]))
+#ifndef MIN
+#define MIN(a, b)                       ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)                       ((a) < (b) ? (b) : (a))
+#endif
+#define UNUSED_VARIABLE(X)              ((void)(X))
+#define UNUSED_PARAMETER(X)             UNUSED_VARIABLE(X)
+#define UNUSED_RETURN_VALUE(X)          UNUSED_VARIABLE(X)
+#define CEIL_DIV(A, B)                  (((A) + (B) - 1) / (B))
+#define ALIGN_NUM(alignment, number)    (((number) - 1) + (alignment) - (((number) - 1) % (alignment)))
+
+#define VERIFY_SUCCESS(statement)                                                                  \
+    do {                                                                                           \
+        uint32_t _err_code = (uint32_t)(statement);                                                \
+        if (_err_code != NRF_SUCCESS) { return _err_code; }                                        \
+    } while (0)
+
+#define VERIFY_PARAM_NOT_NULL(param)                                                               \
+    do { if ((param) == NULL) { return NRF_ERROR_NULL; } } while (0)
+
+void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name);
+
+#define APP_ERROR_HANDLER(ERR_CODE)     app_error_handler((ERR_CODE), __LINE__, (uint8_t const *)__FILE__)
+#define APP_ERROR_CHECK(ERR_CODE)                                                                  \
+    do {                                                                                           \
+        uint32_t const _local_err = (ERR_CODE);                                                    \
+        if (_local_err != NRF_SUCCESS) { APP_ERROR_HANDLER(_local_err); }                          \
+    } while (0)
+
+static inline uint8_t uint16_encode(uint16_t value, uint8_t * p_encoded)
+{
+    p_encoded[0] = (uint8_t)value;
+    p_encoded[1] = (uint8_t)(value >> 8);
+    return sizeof(uint16_t);
+}
+
+static inline uint8_t uint32_encode(uint32_t value, uint8_t * p_encoded)
+{
+    p_encoded[0] = (uint8_t)value;
+    p_encoded[1] = (uint8_t)(value >> 8);
+    p_encoded[2] = (uint8_t)(value >> 16);
+    p_encoded[3] = (uint8_t)(value >> 24);
+    return sizeof(uint32_t);
+}
+
+static inline uint16_t uint16_decode(uint8_t const * p_encoded)
+{
+    return (uint16_t)(p_encoded[0] | (p_encoded[1] << 8));
+}
+
+static inline uint32_t uint32_decode(uint8_t const * p_encoded)
+{
+    return (uint32_t)p_encoded[0] | ((uint32_t)p_encoded[1] << 8)
+         | ((uint32_t)p_encoded[2] << 16) | ((uint32_t)p_encoded[3] << 24);
+}
+
+#define CRITICAL_REGION_ENTER()         {
+#define CRITICAL_REGION_EXIT()          }
+
+// nrf_log.h, nrf_log_ctrl.h, nrf_log_default_backends.h
+
+#define NRF_LOG_ERROR(...)              do { } while (0)
+#define NRF_LOG_WARNING(...)            do { } while (0)
+#define NRF_LOG_INFO(...)               do { } while (0)
+#define NRF_LOG_DEBUG(...)              do { } while (0)
+#define NRF_LOG_HEXDUMP_INFO(...)       do { } while (0)
+#define NRF_LOG_HEXDUMP_DEBUG(...)      do { } while (0)
+#define NRF_LOG_INIT(...)               NRF_SUCCESS
+#define NRF_LOG_DEFAULT_BACKENDS_INIT() do { } while (0)
+#define NRF_LOG_PROCESS()               false
+#define nrf_log_push(p_str)             (p_str)
+
+// nrf.h, nrf_gpio.h, nrf_gpiote.h, nrf_power.h
+
+#define NRF_GPIO_PIN_MAP(port, pin)     (((port) << 5) | ((pin) & 0x1F))
+
+typedef enum
+{
+    NRF_GPIO_PIN_NOPULL,
+    NRF_GPIO_PIN_PULLDOWN,
+    NRF_GPIO_PIN_PULLUP = 3
+} nrf_gpio_pin_pull_t;
+
+typedef enum
+{
+    NRF_GPIO_PIN_NOSENSE,
+    NRF_GPIO_PIN_SENSE_LOW = 3,
+    NRF_GPIO_PIN_SENSE_HIGH = 2
+} nrf_gpio_pin_sense_t;
+
+void     nrf_gpio_cfg_output(uint32_t pin_number);
+void     nrf_gpio_cfg_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config);
+void     nrf_gpio_cfg_sense_input(uint32_t pin_number, nrf_gpio_pin_pull_t pull_config, nrf_gpio_pin_sense_t sense_config);
+uint32_t nrf_gpio_pin_read(uint32_t pin_number);
+void     nrf_gpio_pin_write(uint32_t pin_number, uint32_t value);
+void     nrf_gpio_pin_toggle(uint32_t pin_number);
+uint32_t nrf_gpio_pin_latch_get(uint32_t pin_number);
+void     nrf_gpio_pin_latch_clear(uint32_t pin_number);
+
+typedef enum
+{
+    NRF_GPIOTE_EVENTS_PORT = 0x17C
+} nrf_gpiote_events_t;
+
+#define NRF_GPIOTE_INT_PORT_MASK        (1UL << 31)
+
+bool nrf_gpiote_event_is_set(nrf_gpiote_events_t event);
+void nrf_gpiote_event_clear(nrf_gpiote_events_t event);
+static inline void nrf_gpiote_int_enable(uint32_t mask) { (void)mask; }
+
+typedef enum
+{
+    GPIOTE_IRQn = 6,
+    USBD_IRQn   = 39
+} IRQn_Type;
+
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) { (void)irq; (void)priority; }
+static inline void NVIC_ClearPendingIRQ(IRQn_Type irq) { (void)irq; }
+static inline void NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+
+#define NRF_POWER_RESETREAS_OFF_MASK    (1UL << 16)
+
+uint32_t nrf_power_resetreas_get(void);
+static inline void nrf_power_resetreas_clear(uint32_t mask) { (void)mask; }
+
+// app_timer.h, RTC ticks of the firmware's configuration
+
+#define APP_TIMER_CLOCK_FREQ            32768
+#define APP_TIMER_TICKS(MS)             ((uint32_t)(((uint64_t)(MS) * APP_TIMER_CLOCK_FREQ) / (1000 * (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))))
+#define APP_TIMER_DEF(timer_id)         static app_timer_id_t timer_id
+
+typedef void * app_timer_id_t;
+typedef void (*app_timer_timeout_handler_t)(void * p_context);
+
+typedef enum
+{
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+} app_timer_mode_t;
+
+static inline ret_code_t app_timer_init(void) { return NRF_SUCCESS; }
+ret_code_t app_timer_create(app_timer_id_t const * p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler);
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context);
+ret_code_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t   app_timer_cnt_get(void);
+
+static inline uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from)
+{
+    return (ticks_to - ticks_from) & 0xFFFFFF;
+}
+
+// ble.h, ble_gap.h, ble_gatts.h, ble_gattc.h, ble_hci.h
+
+#define BLE_CONN_HANDLE_INVALID         0xFFFF
+#define BLE_GATT_HANDLE_INVALID         0x0000
+#define BLE_GATT_ATT_MTU_DEFAULT        23
+#define BLE_GATT_HVX_NOTIFICATION       0x01
+#define BLE_GATT_STATUS_ATTERR_UNLIKELY_ERROR 0x010E
+#define BLE_UUID_TYPE_VENDOR_BEGIN      0x02
+#define BLE_GATTS_SRVC_TYPE_PRIMARY     0x01
+#define BLE_GATTS_VLOC_STACK            0x01
+#define BLE_GATTS_VLOC_USER             0x02
+#define BLE_GATTS_OP_WRITE_REQ          0x01
+#define BLE_GATTS_OP_WRITE_CMD          0x02
+#define BLE_GATTS_OP_SIGN_WRITE_CMD     0x03
+#define BLE_GATTS_OP_PREP_WRITE_REQ     0x04
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_CANCEL 0x05
+#define BLE_GATTS_OP_EXEC_WRITE_REQ_NOW 0x06
+#define BLE_GAP_PHY_AUTO                0x00
+#define BLE_GAP_IO_CAPS_NONE            0x03
+#define BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE 0x06
+#define BLE_GAP_WHITELIST_ADDR_MAX_COUNT 8
+#define BLE_GAP_DATA_LENGTH_AUTO        0
+#define BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION 0x13
+#define BLE_HCI_CONN_INTERVAL_UNACCEPTABLE 0x3B
+
+enum
+{
+    BLE_GAP_EVT_CONNECTED                   = 0x10,
+    BLE_GAP_EVT_DISCONNECTED                = 0x11,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE           = 0x12,
+    BLE_GAP_EVT_SEC_PARAMS_REQUEST          = 0x13,
+    BLE_GAP_EVT_CONN_SEC_UPDATE             = 0x1A,
+    BLE_GAP_EVT_TIMEOUT                     = 0x1B,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST   = 0x1F,
+    BLE_GAP_EVT_PHY_UPDATE_REQUEST          = 0x21,
+    BLE_GAP_EVT_PHY_UPDATE                  = 0x22,
+    BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST  = 0x23,
+    BLE_GAP_EVT_DATA_LENGTH_UPDATE          = 0x24,
+    BLE_GAP_EVT_ADV_SET_TERMINATED          = 0x26,
+    BLE_GATTC_EVT_EXCHANGE_MTU_RSP          = 0x3A,
+    BLE_GATTC_EVT_TIMEOUT                   = 0x3B,
+    BLE_GATTS_EVT_WRITE                     = 0x50,
+    BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST      = 0x51,
+    BLE_GATTS_EVT_SYS_ATTR_MISSING          = 0x52,
+    BLE_GATTS_EVT_HVC                       = 0x53,
+    BLE_GATTS_EVT_EXCHANGE_MTU_REQUEST      = 0x55,
+    BLE_GATTS_EVT_TIMEOUT                   = 0x56,
+    BLE_GATTS_EVT_HVN_TX_COMPLETE           = 0x57,
+};
+
+typedef struct
+{
+    uint16_t uuid;
+    uint8_t  type;
+} ble_uuid_t;
+
+typedef struct
+{
+    uint8_t uuid128[16];
+} ble_uuid128_t;
+
+typedef struct
+{
+    uint8_t sm : 4;
+    uint8_t lv : 4;
+} ble_gap_conn_sec_mode_t;
+
+#define BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(ptr)    do { (ptr)->sm = 0; (ptr)->lv = 0; } while (0)
+#define BLE_GAP_CONN_SEC_MODE_SET_OPEN(ptr)         do { (ptr)->sm = 1; (ptr)->lv = 1; } while (0)
+#define BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(ptr)  do { (ptr)->sm = 1; (ptr)->lv = 2; } while (0)
+#define BLE_GAP_CONN_SEC_MODE_SET_ENC_WITH_MITM(ptr) do { (ptr)->sm = 1; (ptr)->lv = 3; } while (0)
+
+typedef struct
+{
+    uint16_t min_conn_interval;
+    uint16_t max_conn_interval;
+    uint16_t slave_latency;
+    uint16_t conn_sup_timeout;
+} ble_gap_conn_params_t;
+
+typedef struct
+{
+    uint8_t addr_id_peer : 1;
+    uint8_t addr_type    : 7;
+    uint8_t addr[6];
+} ble_gap_addr_t;
+
+typedef struct
+{
+    uint8_t irk[16];
+} ble_gap_irk_t;
+
+typedef struct
+{
+    uint8_t tx_phys;
+    uint8_t rx_phys;
+} ble_gap_phys_t;
+
+typedef struct
+{
+    uint8_t enc  : 1;
+    uint8_t id   : 1;
+    uint8_t sign : 1;
+    uint8_t link : 1;
+} ble_gap_sec_kdist_t;
+
+typedef struct
+{
+    uint8_t             bond     : 1;
+    uint8_t             mitm     : 1;
+    uint8_t             lesc     : 1;
+    uint8_t             keypress : 1;
+    uint8_t             io_caps  : 3;
+    uint8_t             oob      : 1;
+    uint8_t             min_key_size;
+    uint8_t             max_key_size;
+    ble_gap_sec_kdist_t kdist_own;
+    ble_gap_sec_kdist_t kdist_peer;
+} ble_gap_sec_params_t;
+
+typedef struct
+{
+    ble_gap_addr_t        peer_addr;
+    uint8_t               role;
+    ble_gap_conn_params_t conn_params;
+    uint8_t               adv_handle;
+} ble_gap_evt_connected_t;
+
+typedef struct
+{
+    uint8_t reason;
+} ble_gap_evt_disconnected_t;
+
+typedef struct
+{
+    ble_gap_conn_params_t conn_params;
+} ble_gap_evt_conn_param_update_t;
+
+typedef struct
+{
+    ble_gap_phys_t peer_preferred_phys;
+} ble_gap_evt_phy_update_request_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gap_evt_connected_t          connected;
+        ble_gap_evt_disconnected_t       disconnected;
+        ble_gap_evt_conn_param_update_t  conn_param_update;
+        ble_gap_evt_phy_update_request_t phy_update_request;
+    } params;
+} ble_gap_evt_t;
+
+typedef struct
+{
+    uint16_t   handle;
+    ble_uuid_t uuid;
+    uint8_t    op;
+    uint8_t    auth_required;
+    uint16_t   offset;
+    uint16_t   len;
+    uint8_t    data[1];                                             /**< Variable length, len bytes. */
+} ble_gatts_evt_write_t;
+
+typedef struct
+{
+    uint8_t count;
+} ble_gatts_evt_hvn_tx_complete_t;
+
+typedef struct
+{
+    uint8_t src;
+} ble_gatts_evt_timeout_t;
+
+typedef struct
+{
+    uint16_t   handle;
+    ble_uuid_t uuid;
+    uint16_t   offset;
+} ble_gatts_evt_read_t;
+
+typedef struct
+{
+    uint8_t type;
+    union
+    {
+        ble_gatts_evt_read_t  read;
+        ble_gatts_evt_write_t write;                                /**< Last, its data runs on. */
+    } request;
+} ble_gatts_evt_rw_authorize_request_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gatts_evt_write_t                write;
+        ble_gatts_evt_rw_authorize_request_t authorize_request;
+        ble_gatts_evt_timeout_t              timeout;
+        ble_gatts_evt_hvn_tx_complete_t      hvn_tx_complete;
+    } params;
+} ble_gatts_evt_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    uint16_t gatt_status;
+    uint16_t error_handle;
+} ble_gattc_evt_t;
+
+typedef struct
+{
+    uint16_t evt_id;
+    uint16_t evt_len;
+} ble_evt_hdr_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+} ble_common_evt_t;
+
+typedef struct
+{
+    ble_evt_hdr_t header;
+    union
+    {
+        ble_common_evt_t common_evt;
+        ble_gap_evt_t   gap_evt;
+        ble_gattc_evt_t gattc_evt;
+        ble_gatts_evt_t gatts_evt;
+    } evt;
+} ble_evt_t;
+
+typedef struct
+{
+    uint16_t value_handle;
+    uint16_t user_desc_handle;
+    uint16_t cccd_handle;
+    uint16_t sccd_handle;
+} ble_gatts_char_handles_t;
+
+typedef struct
+{
+    ble_gap_conn_sec_mode_t read_perm;
+    ble_gap_conn_sec_mode_t write_perm;
+    uint8_t                 vlen    : 1;
+    uint8_t                 vloc    : 2;
+    uint8_t                 rd_auth : 1;
+    uint8_t                 wr_auth : 1;
+} ble_gatts_attr_md_t;
+
+typedef struct
+{
+    ble_uuid_t const          * p_uuid;
+    ble_gatts_attr_md_t const * p_attr_md;
+    uint16_t                    init_len;
+    uint16_t                    init_offs;
+    uint16_t                    max_len;
+    uint8_t                   * p_value;
+} ble_gatts_attr_t;
+
+typedef struct
+{
+    uint8_t broadcast       : 1;
+    uint8_t read            : 1;
+    uint8_t write_wo_resp   : 1;
+    uint8_t write           : 1;
+    uint8_t notify          : 1;
+    uint8_t indicate        : 1;
+    uint8_t auth_signed_wr  : 1;
+} ble_gatt_char_props_t;
+
+typedef struct
+{
+    ble_gatt_char_props_t       char_props;
+    uint8_t const             * p_char_user_desc;
+    uint16_t                    char_user_desc_max_size;
+    uint16_t                    char_user_desc_size;
+    void const                * p_char_pf;
+    ble_gatts_attr_md_t const * p_user_desc_md;
+    ble_gatts_attr_md_t const * p_cccd_md;
+    ble_gatts_attr_md_t const * p_sccd_md;
+} ble_gatts_char_md_t;
+
+typedef struct
+{
+    uint16_t          handle;
+    uint8_t           type;
+    uint16_t          offset;
+    uint16_t        * p_len;
+    uint8_t const   * p_data;
+} ble_gatts_hvx_params_t;
+
+typedef struct
+{
+    uint16_t  len;
+    uint16_t  offset;
+    uint8_t * p_value;
+} ble_gatts_value_t;
+
+#define BLE_GATTS_AUTHORIZE_TYPE_READ   0x01
+#define BLE_GATTS_AUTHORIZE_TYPE_WRITE  0x02
+#define BLE_GATT_STATUS_SUCCESS         0x0000
+#define BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH 0x010D
+#define BLE_GATT_STATUS_ATTERR_CPS_OUT_OF_RANGE 0x01FF
+
+typedef struct
+{
+    uint16_t        gatt_status;
+    uint8_t         update : 1;
+    uint16_t        offset;
+    uint16_t        len;
+    uint8_t const * p_data;
+} ble_gatts_authorize_params_t;
+
+typedef struct
+{
+    uint8_t type;
+    union
+    {
+        ble_gatts_authorize_params_t read;
+        ble_gatts_authorize_params_t write;
+    } params;
+} ble_gatts_rw_authorize_reply_params_t;
+
+#define BLE_GAP_CP_MIN_CONN_INTVL_MIN   0x0006
+#define BLE_GAP_CP_MIN_CONN_INTVL_MAX   0x0C80
+#define BLE_GAP_CP_MAX_CONN_INTVL_MIN   0x0006
+#define BLE_GAP_CP_MAX_CONN_INTVL_MAX   0x0C80
+#define BLE_GAP_CP_SLAVE_LATENCY_MAX    0x01F3
+#define BLE_GAP_CP_CONN_SUP_TIMEOUT_MIN 0x000A
+#define BLE_GAP_CP_CONN_SUP_TIMEOUT_MAX 0x0C80
+#define BLE_GAP_ADV_INTERVAL_MIN        0x000020
+#define UNIT_1_25_MS                    1250
+#define UNIT_10_MS                      10000
+#define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const * p_vs_uuid, uint8_t * p_uuid_type);
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const * p_uuid, uint16_t * p_handle);
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle, ble_gatts_char_md_t const * p_char_md,
+                                         ble_gatts_attr_t const * p_attr_char_value,
+                                         ble_gatts_char_handles_t * p_handles);
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params);
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t * p_value);
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const * p_rw_authorize_reply_params);
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code);
+uint32_t sd_ble_gap_phy_update(uint16_t conn_handle, ble_gap_phys_t const * p_gap_phys);
+uint32_t sd_ble_gap_adv_stop(uint8_t adv_handle);
+uint32_t sd_power_system_off(void);
+
+static inline uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * p_write_perm, uint8_t const * p_dev_name, uint16_t len)
+{
+    (void)p_write_perm; (void)p_dev_name; (void)len;
+    return NRF_SUCCESS;
+}
+
+static inline uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const * p_conn_params)
+{
+    (void)p_conn_params;
+    return NRF_SUCCESS;
+}
+
+static inline uint32_t sd_ble_gap_appearance_set(uint16_t appearance)
+{
+    (void)appearance;
+    return NRF_SUCCESS;
+}
+
+// ble_srv_common.h
+
+typedef struct
+{
+    ble_gap_conn_sec_mode_t cccd_write_perm;
+    ble_gap_conn_sec_mode_t read_perm;
+    ble_gap_conn_sec_mode_t write_perm;
+} ble_srv_cccd_security_mode_t;
+
+typedef enum
+{
+    SEC_NO_ACCESS,
+    SEC_OPEN,
+    SEC_JUST_WORKS,
+    SEC_MITM,
+} security_req_t;
+
+static inline bool ble_srv_is_notification_enabled(uint8_t const * p_encoded_data)
+{
+    return (uint16_decode(p_encoded_data) & 0x0001) != 0;
+}
+
+// nrf_sdh.h, nrf_sdh_ble.h
+
+typedef void (*nrf_sdh_ble_evt_handler_t)(ble_evt_t const * p_ble_evt, void * p_context);
+
+typedef struct
+{
+    nrf_sdh_ble_evt_handler_t handler;
+    void                    * p_context;
+} nrf_sdh_ble_evt_observer_t;
+
+/**@brief Observers are plain statics here, the tests call the handlers themselves. */
+#define NRF_SDH_BLE_OBSERVER(_name, _prio, _handler, _context)                                     \
+    static nrf_sdh_ble_evt_observer_t const _name __attribute__((used)) = { _handler, _context }
+
+#define BLE_HRS_BLE_OBSERVER_PRIO       2
+
+static inline ret_code_t nrf_sdh_enable_request(void) { return NRF_SUCCESS; }
+static inline ret_code_t nrf_sdh_ble_default_cfg_set(uint8_t conn_cfg_tag, uint32_t * p_ram_start)
+{
+    (void)conn_cfg_tag; (void)p_ram_start;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t nrf_sdh_ble_enable(uint32_t * p_app_ram_start) { (void)p_app_ram_start; return NRF_SUCCESS; }
+
+// nrf_ble_gatt.h
+
+typedef enum
+{
+    NRF_BLE_GATT_EVT_ATT_MTU_UPDATED,
+    NRF_BLE_GATT_EVT_DATA_LENGTH_UPDATED
+} nrf_ble_gatt_evt_id_t;
+
+typedef struct
+{
+    nrf_ble_gatt_evt_id_t evt_id;
+    uint16_t              conn_handle;
+    union
+    {
+        uint16_t att_mtu_effective;
+        uint8_t  data_length;
+    } params;
+} nrf_ble_gatt_evt_t;
+
+typedef struct nrf_ble_gatt_s nrf_ble_gatt_t;
+typedef void (*nrf_ble_gatt_evt_handler_t)(nrf_ble_gatt_t * p_gatt, nrf_ble_gatt_evt_t const * p_evt);
+
+struct nrf_ble_gatt_s
+{
+    nrf_ble_gatt_evt_handler_t evt_handler;
+};
+
+#define NRF_BLE_GATT_DEF(_name)         static nrf_ble_gatt_t _name
+
+static inline ret_code_t nrf_ble_gatt_init(nrf_ble_gatt_t * p_gatt, nrf_ble_gatt_evt_handler_t evt_handler)
+{
+    p_gatt->evt_handler = evt_handler;
+    return NRF_SUCCESS;
+}
+
+// nrf_ble_qwr.h
+
+typedef enum
+{
+    NRF_BLE_QWR_EVT_EXECUTE_WRITE,
+    NRF_BLE_QWR_EVT_AUTH_REQUEST
+} nrf_ble_qwr_evt_type_t;
+
+typedef struct
+{
+    nrf_ble_qwr_evt_type_t evt_type;
+    uint16_t               attr_handle;
+} nrf_ble_qwr_evt_t;
+
+typedef struct nrf_ble_qwr_t nrf_ble_qwr_t;
+typedef uint16_t (*nrf_ble_qwr_evt_handler_t)(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_evt_t * p_evt);
+typedef void (*nrf_ble_qwr_error_handler_t)(uint32_t nrf_error);
+
+struct nrf_ble_qwr_t
+{
+    uint16_t conn_handle;
+};
+
+typedef struct
+{
+    struct
+    {
+        uint8_t * p_mem;
+        uint16_t  len;
+    } mem_buffer;
+    nrf_ble_qwr_evt_handler_t   callback;
+    nrf_ble_qwr_error_handler_t error_handler;
+} nrf_ble_qwr_init_t;
+
+#define NRF_BLE_QWRS_DEF(_name, _cnt)   static nrf_ble_qwr_t _name[_cnt]
+
+static inline ret_code_t nrf_ble_qwr_init(nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_init_t const * p_qwr_init)
+{
+    (void)p_qwr_init;
+    p_qwr->conn_handle = BLE_CONN_HANDLE_INVALID;
+    return NRF_SUCCESS;
+}
+
+static inline ret_code_t nrf_ble_qwr_attr_register(nrf_ble_qwr_t * p_qwr, uint16_t attr_handle)
+{
+    (void)p_qwr; (void)attr_handle;
+    return NRF_SUCCESS;
+}
+
+static inline ret_code_t nrf_ble_qwr_conn_handle_assign(nrf_ble_qwr_t * p_qwr, uint16_t conn_handle)
+{
+    p_qwr->conn_handle = conn_handle;
+    return NRF_SUCCESS;
+}
+
+// nrf_ble_bms.h
+
+typedef enum
+{
+    NRF_BLE_BMS_EVT_AUTH
+} nrf_ble_bms_evt_type_t;
+
+typedef struct
+{
+    uint8_t  code[128];
+    uint16_t len;
+} nrf_ble_bms_auth_code_t;
+
+typedef struct
+{
+    nrf_ble_bms_evt_type_t  evt_type;
+    nrf_ble_bms_auth_code_t auth_code;
+} nrf_ble_bms_evt_t;
+
+typedef struct nrf_ble_bms_s nrf_ble_bms_t;
+typedef void (*ble_bms_bond_handler_t)(nrf_ble_bms_t const * p_bms);
+typedef void (*nrf_ble_bms_evt_handler_t)(nrf_ble_bms_t * p_bms, nrf_ble_bms_evt_t * p_evt);
+typedef void (*ble_srv_error_handler_t)(uint32_t nrf_error);
+
+struct nrf_ble_bms_s
+{
+    uint16_t                 conn_handle;
+    ble_gatts_char_handles_t ctrlpt_handles;
+};
+
+typedef struct
+{
+    nrf_ble_bms_evt_handler_t evt_handler;
+    ble_srv_error_handler_t   error_handler;
+    struct
+    {
+        uint8_t delete_all_auth                : 1;
+        uint8_t delete_all                     : 1;
+        uint8_t delete_requesting_auth         : 1;
+        uint8_t delete_requesting              : 1;
+        uint8_t delete_all_but_requesting_auth : 1;
+        uint8_t delete_all_but_requesting      : 1;
+    } feature;
+    security_req_t  bms_feature_sec_req;
+    security_req_t  bms_ctrlpt_sec_req;
+    nrf_ble_qwr_t * p_qwr;
+    struct
+    {
+        ble_bms_bond_handler_t delete_requesting;
+        ble_bms_bond_handler_t delete_all;
+        ble_bms_bond_handler_t delete_all_except_requesting;
+    } bond_callbacks;
+} nrf_ble_bms_init_t;
+
+#define NRF_BLE_BMS_DEF(_name)          static nrf_ble_bms_t _name
+
+static inline ret_code_t nrf_ble_bms_init(nrf_ble_bms_t * p_bms, nrf_ble_bms_init_t * p_bms_init)
+{
+    (void)p_bms_init;
+    p_bms->conn_handle = BLE_CONN_HANDLE_INVALID;
+    return NRF_SUCCESS;
+}
+
+static inline ret_code_t nrf_ble_bms_set_conn_handle(nrf_ble_bms_t * p_bms, uint16_t conn_handle)
+{
+    p_bms->conn_handle = conn_handle;
+    return NRF_SUCCESS;
+}
+
+static inline ret_code_t nrf_ble_bms_auth_response(nrf_ble_bms_t * p_bms, bool authorize)
+{
+    (void)p_bms; (void)authorize;
+    return NRF_SUCCESS;
+}
+
+static inline uint16_t nrf_ble_bms_on_qwr_evt(nrf_ble_bms_t * p_bms, nrf_ble_qwr_t * p_qwr, nrf_ble_qwr_evt_t * p_evt)
+{
+    (void)p_bms; (void)p_qwr; (void)p_evt;
+    return 0;
+}
+
+// ble_conn_state.h
+
+typedef uint8_t ble_conn_state_user_flag_id_t;
+
+typedef struct
+{
+    uint32_t len;
+    uint16_t flag_keys[NRF_SDH_BLE_TOTAL_LINK_COUNT];
+} sdk_mapped_flags_key_list_t;
+
+typedef void (*ble_conn_state_user_function_t)(uint16_t conn_handle, void * p_context);
+
+#define BLE_CONN_STATUS_DISCONNECTED    1
+#define BLE_CONN_STATUS_CONNECTED       2
+
+uint32_t                    ble_conn_state_peripheral_conn_count(void);
+sdk_mapped_flags_key_list_t ble_conn_state_periph_handles(void);
+uint8_t                     ble_conn_state_status(uint16_t conn_handle);
+
+static inline uint8_t ble_conn_state_role(uint16_t conn_handle) { (void)conn_handle; return 1; }
+static inline ble_conn_state_user_flag_id_t ble_conn_state_user_flag_acquire(void) { return 0; }
+static inline void ble_conn_state_user_flag_set(uint16_t conn_handle, ble_conn_state_user_flag_id_t flag_id, bool value)
+{
+    (void)conn_handle; (void)flag_id; (void)value;
+}
+static inline uint32_t ble_conn_state_for_each_set_user_flag(ble_conn_state_user_flag_id_t flag_id,
+                                                             ble_conn_state_user_function_t user_function,
+                                                             void * p_context)
+{
+    (void)flag_id; (void)user_function; (void)p_context;
+    return 0;
+}
+
+// peer_manager.h, peer_manager_handler.h
+
+typedef uint16_t pm_peer_id_t;
+
+#define PM_PEER_ID_INVALID              0xFFFF
+
+typedef enum
+{
+    PM_EVT_BONDED_PEER_CONNECTED,
+    PM_EVT_CONN_SEC_START,
+    PM_EVT_CONN_SEC_SUCCEEDED,
+    PM_EVT_CONN_SEC_FAILED,
+    PM_EVT_CONN_SEC_CONFIG_REQ,
+    PM_EVT_CONN_SEC_PARAMS_REQ,
+    PM_EVT_STORAGE_FULL,
+    PM_EVT_ERROR_UNEXPECTED,
+    PM_EVT_PEER_DATA_UPDATE_SUCCEEDED,
+    PM_EVT_PEER_DATA_UPDATE_FAILED,
+    PM_EVT_PEER_DELETE_SUCCEEDED,
+    PM_EVT_PEER_DELETE_FAILED,
+    PM_EVT_PEERS_DELETE_SUCCEEDED,
+    PM_EVT_PEERS_DELETE_FAILED,
+    PM_EVT_LOCAL_DB_CACHE_APPLIED,
+    PM_EVT_LOCAL_DB_CACHE_APPLY_FAILED,
+    PM_EVT_SERVICE_CHANGED_IND_SENT,
+    PM_EVT_SERVICE_CHANGED_IND_CONFIRMED,
+} pm_evt_id_t;
+
+typedef enum
+{
+    PM_CONN_SEC_PROCEDURE_ENCRYPTION,
+    PM_CONN_SEC_PROCEDURE_BONDING,
+    PM_CONN_SEC_PROCEDURE_PAIRING,
+} pm_conn_sec_procedure_t;
+
+typedef struct
+{
+    pm_evt_id_t  evt_id;
+    pm_peer_id_t peer_id;
+    uint16_t     conn_handle;
+    union
+    {
+        struct { pm_conn_sec_procedure_t procedure; } conn_sec_succeeded;
+        struct { ret_code_t error; } peer_data_update_failed;
+        struct { ret_code_t error; } peer_delete_failed;
+        struct { ret_code_t error; } peers_delete_failed_evt;
+        struct { ret_code_t error; } error_unexpected;
+    } params;
+} pm_evt_t;
+
+typedef struct
+{
+    bool allow_repairing;
+} pm_conn_sec_config_t;
+
+typedef struct
+{
+    ble_gap_addr_t id_addr_info;
+} pm_peer_ble_id_t;
+
+typedef struct
+{
+    pm_peer_ble_id_t peer_ble_id;
+} pm_peer_data_bonding_t;
+
+typedef void (*pm_evt_handler_t)(pm_evt_t const * p_event);
+
+static inline ret_code_t pm_init(void) { return NRF_SUCCESS; }
+static inline ret_code_t pm_register(pm_evt_handler_t event_handler) { (void)event_handler; return NRF_SUCCESS; }
+static inline ret_code_t pm_sec_params_set(ble_gap_sec_params_t * p_sec_params) { (void)p_sec_params; return NRF_SUCCESS; }
+static inline void pm_conn_sec_config_reply(uint16_t conn_handle, pm_conn_sec_config_t * p_conn_sec_config)
+{
+    (void)conn_handle; (void)p_conn_sec_config;
+}
+static inline ret_code_t pm_whitelist_set(pm_peer_id_t const * p_peers, uint32_t peer_cnt)
+{
+    (void)p_peers; (void)peer_cnt;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t pm_whitelist_get(ble_gap_addr_t * p_addrs, uint32_t * p_addr_cnt,
+                                          ble_gap_irk_t * p_irks, uint32_t * p_irk_cnt)
+{
+    (void)p_addrs; (void)p_irks;
+    *p_addr_cnt = 0;
+    *p_irk_cnt  = 0;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t pm_device_identities_list_set(pm_peer_id_t const * p_peers, uint32_t peer_cnt)
+{
+    (void)p_peers; (void)peer_cnt;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t pm_conn_handle_get(pm_peer_id_t peer_id, uint16_t * p_conn_handle)
+{
+    (void)peer_id;
+    *p_conn_handle = BLE_CONN_HANDLE_INVALID;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t pm_peer_id_get(uint16_t conn_handle, pm_peer_id_t * p_peer_id)
+{
+    (void)conn_handle;
+    *p_peer_id = PM_PEER_ID_INVALID;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t pm_peer_delete(pm_peer_id_t peer_id) { (void)peer_id; return NRF_SUCCESS; }
+static inline pm_peer_id_t pm_next_peer_id_get(pm_peer_id_t prev_peer_id) { (void)prev_peer_id; return PM_PEER_ID_INVALID; }
+static inline ret_code_t pm_peer_data_bonding_load(pm_peer_id_t peer_id, pm_peer_data_bonding_t * p_data)
+{
+    (void)peer_id; (void)p_data;
+    return NRF_ERROR_NOT_FOUND;
+}
+static inline void pm_handler_secure_on_connection(ble_evt_t const * p_ble_evt) { (void)p_ble_evt; }
+
+// ble_advdata.h, ble_advertising.h
+
+typedef enum
+{
+    BLE_ADVDATA_NO_NAME,
+    BLE_ADVDATA_SHORT_NAME,
+    BLE_ADVDATA_FULL_NAME
+} ble_advdata_name_type_t;
+
+typedef struct
+{
+    uint16_t     uuid_cnt;
+    ble_uuid_t * p_uuids;
+} ble_advdata_uuid_list_t;
+
+typedef struct
+{
+    ble_advdata_name_type_t name_type;
+    bool                    include_appearance;
+    uint8_t                 flags;
+    ble_advdata_uuid_list_t uuids_complete;
+} ble_advdata_t;
+
+typedef enum
+{
+    BLE_ADV_MODE_IDLE,
+    BLE_ADV_MODE_DIRECTED_HIGH_DUTY,
+    BLE_ADV_MODE_DIRECTED,
+    BLE_ADV_MODE_FAST,
+    BLE_ADV_MODE_SLOW,
+} ble_adv_mode_t;
+
+typedef enum
+{
+    BLE_ADV_EVT_IDLE,
+    BLE_ADV_EVT_DIRECTED_HIGH_DUTY,
+    BLE_ADV_EVT_DIRECTED,
+    BLE_ADV_EVT_FAST,
+    BLE_ADV_EVT_SLOW,
+    BLE_ADV_EVT_FAST_WHITELIST,
+    BLE_ADV_EVT_SLOW_WHITELIST,
+    BLE_ADV_EVT_WHITELIST_REQUEST,
+    BLE_ADV_EVT_PEER_ADDR_REQUEST,
+} ble_adv_evt_t;
+
+typedef struct
+{
+    bool     ble_adv_on_disconnect_disabled;
+    bool     ble_adv_whitelist_enabled;
+    bool     ble_adv_directed_high_duty_enabled;
+    bool     ble_adv_fast_enabled;
+    uint32_t ble_adv_fast_interval;
+    uint32_t ble_adv_fast_timeout;
+} ble_adv_modes_config_t;
+
+typedef void (*ble_adv_evt_handler_t)(ble_adv_evt_t const adv_evt);
+
+typedef struct
+{
+    ble_advdata_t          advdata;
+    ble_adv_modes_config_t config;
+    ble_adv_evt_handler_t  evt_handler;
+    void                 (*error_handler)(uint32_t nrf_error);
+} ble_advertising_init_t;
+
+typedef struct
+{
+    uint8_t                adv_handle;
+    ble_adv_mode_t         adv_mode_current;
+    ble_adv_modes_config_t adv_modes_config;
+} ble_advertising_t;
+
+#define BLE_ADVERTISING_DEF(_name)      static ble_advertising_t _name
+
+static inline ret_code_t ble_advertising_init(ble_advertising_t * p_advertising, ble_advertising_init_t const * p_init)
+{
+    p_advertising->adv_modes_config = p_init->config;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t ble_advertising_start(ble_advertising_t * p_advertising, ble_adv_mode_t advertising_mode)
+{
+    p_advertising->adv_mode_current = advertising_mode;
+    return NRF_SUCCESS;
+}
+static inline void ble_advertising_conn_cfg_tag_set(ble_advertising_t * p_advertising, uint8_t ble_cfg_tag)
+{
+    (void)p_advertising; (void)ble_cfg_tag;
+}
+static inline void ble_advertising_modes_config_set(ble_advertising_t * p_advertising, ble_adv_modes_config_t const * p_config)
+{
+    p_advertising->adv_modes_config = *p_config;
+}
+static inline ret_code_t ble_advertising_peer_addr_reply(ble_advertising_t * p_advertising, ble_gap_addr_t * p_peer_addr)
+{
+    (void)p_advertising; (void)p_peer_addr;
+    return NRF_SUCCESS;
+}
+static inline ret_code_t ble_advertising_whitelist_reply(ble_advertising_t * p_advertising,
+                                                         ble_gap_addr_t const * p_gap_addrs, uint32_t addr_cnt,
+                                                         ble_gap_irk_t const * p_gap_irks, uint32_t irk_cnt)
+{
+    (void)p_advertising; (void)p_gap_addrs; (void)addr_cnt; (void)p_gap_irks; (void)irk_cnt;
+    return NRF_SUCCESS;
+}
+
+// ble_conn_params.h
+
+typedef enum
+{
+    BLE_CONN_PARAMS_EVT_FAILED,
+    BLE_CONN_PARAMS_EVT_SUCCEEDED
+} ble_conn_params_evt_type_t;
+
+typedef struct
+{
+    ble_conn_params_evt_type_t evt_type;
+    uint16_t                   conn_handle;
+} ble_conn_params_evt_t;
+
+typedef struct
+{
+    ble_gap_conn_params_t * p_conn_params;
+    uint32_t                first_conn_params_update_delay;
+    uint32_t                next_conn_params_update_delay;
+    uint8_t                 max_conn_params_update_count;
+    uint16_t                start_on_notify_cccd_handle;
+    bool                    disconnect_on_fail;
+    void                  (*evt_handler)(ble_conn_params_evt_t * p_evt);
+    void                  (*error_handler)(uint32_t nrf_error);
+} ble_conn_params_init_t;
+
+static inline ret_code_t ble_conn_params_init(ble_conn_params_init_t const * p_init) { (void)p_init; return NRF_SUCCESS; }
+static inline ret_code_t ble_conn_params_change_conn_params(uint16_t conn_handle, ble_gap_conn_params_t * p_new_params)
+{
+    (void)conn_handle; (void)p_new_params;
+    return NRF_SUCCESS;
+}
+
+// nrf_pwr_mgmt.h
+
+static inline ret_code_t nrf_pwr_mgmt_init(void) { return NRF_SUCCESS; }
+static inline void nrf_pwr_mgmt_run(void) { }
+
+// crc16.h
+
+uint16_t crc16_compute(uint8_t const * p_data, uint32_t size, uint16_t const * p_crc);
+
+// fds.h. Operations are queued, their events are delivered by sdk_stub_fds_process().
+
+#define BYTES_TO_WORDS(n_bytes)         (((n_bytes) + 3) >> 2)
+#define FDS_ERR_NO_SPACE_IN_FLASH       0x860A
+#define FDS_ERR_NO_SPACE_IN_QUEUES      0x860B
+
+typedef enum
+{
+    FDS_EVT_INIT,
+    FDS_EVT_WRITE,
+    FDS_EVT_UPDATE,
+    FDS_EVT_DEL_RECORD,
+    FDS_EVT_DEL_FILE,
+    FDS_EVT_GC
+} fds_evt_id_t;
+
+typedef struct
+{
+    uint16_t record_key;
+    uint16_t file_id;
+    uint16_t length_words;
+    uint32_t record_id;
+} fds_header_t;
+
+typedef struct
+{
+    uint32_t record_id;
+} fds_record_desc_t;
+
+typedef struct
+{
+    uint32_t index;
+} fds_find_token_t;
+
+typedef struct
+{
+    fds_header_t const * p_header;
+    void const         * p_data;
+} fds_flash_record_t;
+
+typedef struct
+{
+    uint16_t file_id;
+    uint16_t key;
+    struct
+    {
+        void const * p_data;
+        uint32_t     length_words;
+    } data;
+} fds_record_t;
+
+typedef struct
+{
+    fds_evt_id_t id;
+    ret_code_t   result;
+    union
+    {
+        struct
+        {
+            uint32_t record_id;
+            uint16_t file_id;
+            uint16_t record_key;
+            bool     is_record_updated;
+        } write;
+        struct
+        {
+            uint32_t record_id;
+            uint16_t file_id;
+            uint16_t record_key;
+        } del;
+    };
+} fds_evt_t;
+
+typedef struct
+{
+    uint16_t pages_available;
+    uint16_t open_records;
+    uint16_t valid_records;
+    uint16_t dirty_records;
+    uint16_t words_reserved;
+    uint16_t words_used;
+    uint16_t largest_contig;
+    uint16_t freeable_words;
+    bool     corruption;
+} fds_stat_t;
+
+typedef void (*fds_cb_t)(fds_evt_t const * p_evt);
+
+ret_code_t fds_register(fds_cb_t cb);
+ret_code_t fds_init(void);
+ret_code_t fds_record_write(fds_record_desc_t * p_desc, fds_record_t const * p_record);
+ret_code_t fds_record_update(fds_record_desc_t * p_desc, fds_record_t const * p_record);
+ret_code_t fds_record_delete(fds_record_desc_t * p_desc);
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t * p_desc, fds_find_token_t * p_token);
+ret_code_t fds_record_open(fds_record_desc_t * p_desc, fds_flash_record_t * p_flash_record);
+ret_code_t fds_record_close(fds_record_desc_t * p_desc);
+ret_code_t fds_gc(void);
+ret_code_t fds_stat(fds_stat_t * p_stat);
+
+// nrf_drv_clock.h, app_usbd.h, app_usbd_core.h, app_usbd_hid_kbd.h, app_usbd_cdc_acm.h. A class
+// instance is its user event handler. The keyboard and the port hold what the device sends until
+// the test completes the transfer with the controls below.
+
+static inline ret_code_t nrf_drv_clock_init(void) { return NRF_SUCCESS; }
+
+#define NRF_DRV_USBD_EPOUT1             0x01
+#define NRF_DRV_USBD_EPIN1              0x81
+#define NRF_DRV_USBD_EPIN2              0x82
+#define NRF_DRV_USBD_EPIN3              0x83
+
+typedef enum
+{
+    APP_USBD_EVT_DRV_SOF,
+    APP_USBD_EVT_DRV_RESET,
+    APP_USBD_EVT_DRV_SUSPEND,
+    APP_USBD_EVT_DRV_RESUME,
+    APP_USBD_EVT_POWER_DETECTED,
+    APP_USBD_EVT_POWER_REMOVED,
+    APP_USBD_EVT_POWER_READY,
+    APP_USBD_EVT_STARTED,
+    APP_USBD_EVT_STOPPED,
+} app_usbd_event_type_t;
+
+typedef enum
+{
+    APP_USBD_STATE_Disabled,
+    APP_USBD_STATE_Unattached,
+    APP_USBD_STATE_Powered,
+    APP_USBD_STATE_Default,
+    APP_USBD_STATE_Addressed,
+    APP_USBD_STATE_Configured,
+} app_usbd_state_t;
+
+typedef struct
+{
+    void (*ev_state_proc)(app_usbd_event_type_t event);
+} app_usbd_config_t;
+
+typedef enum
+{
+    APP_USBD_HID_USER_EVT_SET_BOOT_PROTO,
+    APP_USBD_HID_USER_EVT_SET_REPORT_PROTO,
+    APP_USBD_HID_USER_EVT_OUT_REPORT_READY,
+    APP_USBD_HID_USER_EVT_IN_REPORT_DONE,
+} app_usbd_hid_user_event_t;
+
+typedef enum
+{
+    APP_USBD_CDC_ACM_USER_EVT_RX_DONE,
+    APP_USBD_CDC_ACM_USER_EVT_TX_DONE,
+    APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN,
+    APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE,
+} app_usbd_cdc_acm_user_event_t;
+
+typedef struct app_usbd_class_inst_s app_usbd_class_inst_t;
+
+struct app_usbd_class_inst_s
+{
+    void (*hid_handler)(app_usbd_class_inst_t const * p_inst, app_usbd_hid_user_event_t event);
+    void (*cdc_handler)(app_usbd_class_inst_t const * p_inst, app_usbd_cdc_acm_user_event_t event);
+};
+
+typedef app_usbd_class_inst_t app_usbd_hid_kbd_t;
+typedef app_usbd_class_inst_t app_usbd_cdc_acm_t;
+
+#define APP_USBD_HID_SUBCLASS_BOOT      1
+#define APP_USBD_CDC_COMM_PROTOCOL_NONE 0
+
+#define APP_USBD_HID_KBD_GLOBAL_DEF(name, interface, endpoint, user_ev_handler, subclass_boot)  \
+    const app_usbd_hid_kbd_t name = {.hid_handler = user_ev_handler}
+
+#define APP_USBD_CDC_ACM_GLOBAL_DEF(name, user_ev_handler, comm_ifc, data_ifc, comm_ein, data_ein,  \
+                                    data_eout, cdc_protocol)                                      \
+    const app_usbd_cdc_acm_t name = {.cdc_handler = user_ev_handler}
+
+typedef enum
+{
+    APP_USBD_HID_KBD_MODIFIER_NONE       = 0x00,
+    APP_USBD_HID_KBD_MODIFIER_LEFT_CTRL  = 0x01,
+    APP_USBD_HID_KBD_MODIFIER_LEFT_SHIFT = 0x02,
+} app_usbd_hid_kbd_modifier_t;
+
+static inline app_usbd_class_inst_t const * app_usbd_hid_kbd_class_inst_get(app_usbd_hid_kbd_t const * p_kbd)
+{
+    return p_kbd;
+}
+
+static inline app_usbd_class_inst_t const * app_usbd_cdc_acm_class_inst_get(app_usbd_cdc_acm_t const * p_cdc)
+{
+    return p_cdc;
+}
+
+ret_code_t app_usbd_init(app_usbd_config_t const * p_config);
+ret_code_t app_usbd_class_append(app_usbd_class_inst_t const * p_inst);
+ret_code_t app_usbd_power_events_enable(void);
+void app_usbd_enable(void);
+void app_usbd_disable(void);
+void app_usbd_start(void);
+void app_usbd_stop(void);
+bool nrf_drv_usbd_is_enabled(void);
+app_usbd_state_t app_usbd_core_state_get(void);
+ret_code_t app_usbd_hid_kbd_modifier_state_set(app_usbd_hid_kbd_t const * p_kbd, app_usbd_hid_kbd_modifier_t modifier, bool state);
+ret_code_t app_usbd_hid_kbd_key_control(app_usbd_hid_kbd_t const * p_kbd, uint8_t key, bool press);
+ret_code_t app_usbd_cdc_acm_write(app_usbd_cdc_acm_t const * p_cdc, void const * p_buf, size_t length);
+
+// SEGGER_RTT.h. The buffers the target configures are rings as on the device, the test reads the
+// up buffers and writes the down buffers with the controls below, as the debugger does.
+
+#define SEGGER_RTT_MAX_NUM_UP_BUFFERS   3
+#define SEGGER_RTT_MAX_NUM_DOWN_BUFFERS 3
+#define SEGGER_RTT_MODE_NO_BLOCK_SKIP   0
+
+int      SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char * sName, void * pBuffer, unsigned BufferSize, unsigned Flags);
+int      SEGGER_RTT_ConfigDownBuffer(unsigned BufferIndex, const char * sName, void * pBuffer, unsigned BufferSize, unsigned Flags);
+unsigned SEGGER_RTT_Write(unsigned BufferIndex, const void * pBuffer, unsigned NumBytes);
+unsigned SEGGER_RTT_Read(unsigned BufferIndex, void * pBuffer, unsigned BufferSize);
+
+// Test controls, see sdk_stub.c. Handles are given out from 1 by sd_ble_gatts_service_add() and
+// sd_ble_gatts_characteristic_add() in this order: value, CCCD if the characteristic notifies.
+
+/**@brief Result of sd_ble_gatts_hvx(), NULL for NRF_SUCCESS. */
+extern uint32_t (*sdk_stub_hvx_handler)(uint16_t conn_handle, ble_gatts_hvx_params_t const * p_hvx_params);
+
+/**@brief Result of sd_ble_gap_disconnect() and sd_ble_gap_phy_update(), the peer may be gone. */
+extern uint32_t sdk_stub_link_result;
+
+/**@brief Called by sd_ble_gap_disconnect(), NULL for none. */
+extern void (*sdk_stub_disconnect_handler)(uint16_t conn_handle);
+
+/**@brief Called by sd_power_system_off(), which returns to the test. Without it system off
+ *        fails the test. */
+extern void (*sdk_stub_system_off_handler)(void);
+
+/**@brief Links connected, for ble_conn_state. */
+extern uint16_t sdk_stub_conn_handles[NRF_SDH_BLE_TOTAL_LINK_COUNT];
+extern uint32_t sdk_stub_conn_count;
+
+extern uint32_t sdk_stub_gpio_in;                                   /**< Input level of P0.00 to P0.31, a set bit is high. */
+extern uint32_t sdk_stub_gpio_out;                                  /**< Output level of P0.00 to P0.31. */
+extern uint32_t sdk_stub_gpio_latch;                                /**< LATCH of P0.00 to P0.31. */
+extern bool     sdk_stub_gpiote_port;                               /**< GPIOTE PORT event. */
+extern uint32_t sdk_stub_resetreas;
+extern uint32_t sdk_stub_rtc;                                       /**< RTC1 counter, 24 bit. */
+
+extern app_timer_timeout_handler_t sdk_stub_timer_handler;          /**< Handler of the last timer created. */
+extern uint32_t                    sdk_stub_timer_ticks;            /**< Interval it was last started at, 0 while stopped. */
+extern uint32_t                    sdk_stub_timer_starts;           /**< Calls of app_timer_start(), each restarts the interval. */
+
+/**@brief USB device, see app_usbd.h above. */
+typedef struct
+{
+    uint8_t modifier;
+    uint8_t keys[6];
+} sdk_stub_hid_report_t;
+
+extern app_usbd_state_t      sdk_stub_usbd_state;                   /**< Returned by app_usbd_core_state_get(). */
+extern bool                  sdk_stub_usbd_enabled;                 /**< Between app_usbd_enable() and app_usbd_disable(). */
+extern bool                  sdk_stub_usbd_started;                 /**< Between app_usbd_start() and app_usbd_stop(). */
+extern bool                  sdk_stub_usbd_suspended;               /**< Transfers fail while set. */
+extern sdk_stub_hid_report_t sdk_stub_hid_report;                   /**< Keyboard state, as the host last got it. */
+extern bool                  sdk_stub_hid_busy;                     /**< A report is on its way. */
+extern uint8_t const *       sdk_stub_cdc_data;                     /**< Port write on its way, NULL for none. */
+extern size_t                sdk_stub_cdc_len;
+
+extern uint32_t sdk_stub_fds_words_written;                         /**< FDS words written, record headers included. */
+extern uint32_t sdk_stub_fds_page_erases;                           /**< FDS pages erased by garbage collection. */
+
+/**@brief Function for raising an event of the USB device, to the handler of app_usbd_init(). */
+void sdk_stub_usbd_event(app_usbd_event_type_t event);
+
+/**@brief Function for raising an event of the port, to its class handler. */
+void sdk_stub_cdc_event(app_usbd_cdc_acm_user_event_t event);
+
+/**@brief Function for completing the keyboard report on its way, with APP_USBD_HID_USER_EVT_IN_REPORT_DONE. */
+void sdk_stub_hid_done(void);
+
+/**@brief Function for completing the port write on its way, with APP_USBD_CDC_ACM_USER_EVT_TX_DONE. */
+void sdk_stub_cdc_done(void);
+
+/**@brief Function for resetting the controls and the handle numbering. FDS keeps its records,
+ *        queued operations and registered handlers, as flash outlives a reset. */
+void sdk_stub_reset(void);
+
+/**@brief Function for completing the queued FDS operations, in order.
+ *
+ * @return Number of events delivered.
+ */
+uint32_t sdk_stub_fds_process(void);
+
+/**@brief Function for counting the FDS operations queued. */
+uint32_t sdk_stub_fds_queued(void);
+
+/**@brief Function for reading what the target wrote to an RTT up buffer.
+ *
+ * @return Bytes read, 0 if the buffer is empty or not configured.
+ */
+uint32_t sdk_stub_rtt_read(uint8_t channel, void * p_data, uint32_t max_len);
+
+/**@brief Function for writing to an RTT down buffer, for the target to read.
+ *
+ * @return Bytes written, fewer than len if the buffer is full or not configured.
+ */
+uint32_t sdk_stub_rtt_write(uint8_t channel, void const * p_data, uint32_t len);
+
+#endif // SDK_STUB_H__
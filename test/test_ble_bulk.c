@@ -0,0 +1,284 @@
+/**@brief Loopback test of the bulk service.
+ *
+ * @details A central uploads data into a RAM stream and reads it back, at the smallest, a middle
+ *          and the largest ATT MTU, with a corrupted block on the way up and a lost one on the way
+ *          down. Every block is checked as a peer would: sequence, length and CRC.
+ */
+
+#include <string.h>
+#include "ble_bulk.h"
+#include "ble_peer.h"
+#include "check.h"
+#include "crc16.h"
+
+#define CONN            3
+#define STREAM          0
+#define STORE_SIZE      8192
+#define DATA_LEN        5000
+#define NO_SEQ          0x100                                       /**< A sequence number no block has. */
+
+static ble_bulk_t m_bulk;
+static uint8_t    m_store[STORE_SIZE];
+static uint32_t   m_store_len;
+static int        m_done;                                           /**< 1 after success, -1 after failure, 0 before. */
+
+static uint16_t store_read(uint32_t offset, uint8_t * p_data, uint16_t max_len)
+{
+    uint16_t len = (offset < m_store_len) ? MIN(max_len, m_store_len - offset) : 0;
+
+    memcpy(p_data, &m_store[offset], len);
+    return len;
+}
+
+static uint32_t store_write(uint32_t offset, uint8_t const * p_data, uint16_t len)
+{
+    if (offset + len > STORE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    if (len > 0)
+    {
+        memcpy(&m_store[offset], p_data, len);
+    }
+    m_store_len = offset + len;
+    m_done      = 0;
+    return NRF_SUCCESS;
+}
+
+static void store_done(bool success)
+{
+    m_done = success ? 1 : -1;
+}
+
+static const ble_bulk_stream_t m_store_stream = {store_read, store_write, store_done};
+
+static uint16_t block_crc(uint8_t const * p_block, uint8_t len)
+{
+    uint16_t crc = crc16_compute(p_block, 2, NULL);
+
+    return crc16_compute(&p_block[BLE_BULK_HEADER_LEN], len, &crc);
+}
+
+static void setup(uint16_t att_mtu)
+{
+    ble_bulk_init_t init;
+
+    memset(&init, 0, sizeof(init));
+    init.uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN;
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&init.bulk_char_attr_md.cccd_write_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&init.bulk_char_attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&init.bulk_char_attr_md.write_perm);
+
+    ble_peer_init(3);
+    CHECK_EQ(ble_bulk_init(&m_bulk, &init), NRF_SUCCESS);
+    CHECK_EQ(ble_bulk_stream_register(&m_bulk, STREAM, &m_store_stream), NRF_SUCCESS);
+    ble_peer_observer_add(ble_bulk_on_ble_evt, &m_bulk);
+
+    ble_peer_connect(CONN);
+    ble_bulk_att_mtu_set(&m_bulk, att_mtu);
+    ble_peer_subscribe(CONN, m_bulk.tx_handles.cccd_handle);
+    ble_peer_subscribe(CONN, m_bulk.ctrl_handles.cccd_handle);
+    m_store_len = 0;
+    m_done      = 0;
+}
+
+/**@brief Function for taking the next notification off the air. */
+static bool air_next(ble_peer_notification_t * p_notification)
+{
+    return ble_peer_tx_complete(CONN, 1, p_notification) == 1;
+}
+
+static void ctrl_write(uint8_t const * p_data, uint16_t len)
+{
+    ble_peer_write(CONN, m_bulk.ctrl_handles.value_handle, BLE_GATTS_OP_WRITE_REQ, p_data, len);
+}
+
+/**@brief Function for checking the next notification is a control point one, with 2 or 3 bytes. */
+static void ctrl_expect(uint8_t b0, uint8_t b1, int b2)
+{
+    ble_peer_notification_t n;
+
+    CHECK(air_next(&n));
+    CHECK_EQ(n.handle, m_bulk.ctrl_handles.value_handle);
+    CHECK_EQ(n.len, (b2 < 0) ? 2 : 3);
+    CHECK_EQ(n.data[0], b0);
+    CHECK_EQ(n.data[1], b1);
+    if (b2 >= 0)
+    {
+        CHECK_EQ(n.data[2], b2);
+    }
+}
+
+static void upload(uint8_t const * p_data, uint32_t len, uint16_t att_mtu, uint32_t corrupt_seq)
+{
+    uint8_t  open[6] = {BLE_BULK_OP_OPEN_WRITE, STREAM};
+    uint8_t  block[BLE_BULK_MAX_BLOCK_LEN];
+    uint16_t payload = MIN(att_mtu - 3 - BLE_BULK_HEADER_LEN, UINT8_MAX);
+    uint32_t offset  = 0;
+    uint8_t  seq     = 0;
+
+    uint32_encode(len, &open[2]);
+    ctrl_write(open, sizeof(open));
+    ctrl_expect(BLE_BULK_OP_RESPONSE, BLE_BULK_OP_OPEN_WRITE, BLE_BULK_STATUS_SUCCESS);
+
+    while (offset < len)
+    {
+        uint8_t n = (uint8_t)MIN(payload, len - offset);
+
+        block[0] = seq;
+        block[1] = n;
+        memcpy(&block[BLE_BULK_HEADER_LEN], &p_data[offset], n);
+        uint16_encode(block_crc(block, n), &block[2]);
+
+        if (seq == corrupt_seq)
+        {
+            corrupt_seq = NO_SEQ;
+            block[BLE_BULK_HEADER_LEN] ^= 0x01;
+            ble_peer_write(CONN, m_bulk.rx_handles.value_handle, BLE_GATTS_OP_WRITE_CMD, block, BLE_BULK_HEADER_LEN + n);
+            ctrl_expect(BLE_BULK_OP_NAK, seq, -1);
+            continue;
+        }
+        ble_peer_write(CONN, m_bulk.rx_handles.value_handle, BLE_GATTS_OP_WRITE_CMD, block, BLE_BULK_HEADER_LEN + n);
+        offset += n;
+        seq++;
+
+        if ((offset == len) || ((seq % (BLE_BULK_WINDOW / 2)) == 0))
+        {
+            ctrl_expect(BLE_BULK_OP_ACK, seq, -1);
+        }
+        CHECK_EQ(ble_peer_queued(CONN), 0);
+    }
+}
+
+/**@brief Function for reading the stream back.
+ *
+ * @return Bytes read.
+ */
+static uint32_t download(uint8_t * p_out, uint16_t att_mtu, uint32_t drop_seq)
+{
+    uint8_t                 open[] = {BLE_BULK_OP_OPEN_READ, STREAM};
+    ble_peer_notification_t n;
+    uint8_t                 expected = 0;
+    uint32_t                len      = 0;
+
+    ctrl_write(open, sizeof(open));
+    ctrl_expect(BLE_BULK_OP_RESPONSE, BLE_BULK_OP_OPEN_READ, BLE_BULK_STATUS_SUCCESS);
+
+    while (air_next(&n))
+    {
+        uint8_t ack[2];
+
+        CHECK_EQ(n.handle, m_bulk.tx_handles.value_handle);
+        CHECK(n.len >= BLE_BULK_HEADER_LEN);
+        CHECK(n.len <= att_mtu - 3);
+        if (n.data[0] != expected)
+        {
+            // sent before the NAK was seen
+            continue;
+        }
+        CHECK_EQ(n.data[1], n.len - BLE_BULK_HEADER_LEN);
+        CHECK_EQ(uint16_decode(&n.data[2]), block_crc(n.data, n.data[1]));
+
+        ack[0] = BLE_BULK_OP_ACK;
+        ack[1] = expected + 1;
+        if (n.data[0] == drop_seq)
+        {
+            drop_seq = NO_SEQ;
+            ack[0]   = BLE_BULK_OP_NAK;
+            ack[1]   = expected;
+        }
+        else
+        {
+            memcpy(&p_out[len], &n.data[BLE_BULK_HEADER_LEN], n.data[1]);
+            len += n.data[1];
+            expected++;
+        }
+        ctrl_write(ack, sizeof(ack));
+        if ((ack[0] == BLE_BULK_OP_ACK) && (n.data[1] == 0))
+        {
+            break;
+        }
+    }
+    CHECK(m_bulk.p_active == NULL);
+    return len;
+}
+
+static void test_loopback(uint16_t att_mtu)
+{
+    static uint8_t data[DATA_LEN];
+    static uint8_t back[STORE_SIZE];
+    ble_peer_notification_t const * p_first;
+
+    for (uint32_t i = 0; i < DATA_LEN; i++)
+    {
+        data[i] = (uint8_t)(i * 7 + i / 251);
+    }
+    setup(att_mtu);
+
+    upload(data, DATA_LEN, att_mtu, 3);
+    CHECK_EQ(m_done, 1);
+    CHECK_EQ(m_store_len, DATA_LEN);
+    CHECK(memcmp(m_store, data, DATA_LEN) == 0);
+
+    // a block fills the notification
+    ctrl_write((uint8_t const []){BLE_BULK_OP_OPEN_READ, STREAM}, 2);
+    p_first = ble_peer_queued_get(CONN, 1);
+    CHECK(p_first != NULL);
+    CHECK_EQ(p_first->len, MIN(att_mtu - 3, BLE_BULK_HEADER_LEN + UINT8_MAX));
+    ctrl_write((uint8_t const []){BLE_BULK_OP_ABORT}, 1);
+    while (air_next(&(ble_peer_notification_t){0}))
+    {
+    }
+
+    CHECK_EQ(download(back, att_mtu, 2), DATA_LEN);
+    CHECK(memcmp(back, data, DATA_LEN) == 0);
+}
+
+static void test_busy_and_unknown_stream(void)
+{
+    setup(BLE_GATT_ATT_MTU_DEFAULT);
+    m_store_len = 10;
+
+    ctrl_write((uint8_t const []){BLE_BULK_OP_OPEN_READ, STREAM}, 2);
+    ctrl_expect(BLE_BULK_OP_RESPONSE, BLE_BULK_OP_OPEN_READ, BLE_BULK_STATUS_SUCCESS);
+    ctrl_write((uint8_t const []){BLE_BULK_OP_OPEN_READ, STREAM}, 2);
+
+    // the response comes after the blocks queued before it
+    for (ble_peer_notification_t n; ; )
+    {
+        CHECK(air_next(&n));
+        if (n.handle == m_bulk.ctrl_handles.value_handle)
+        {
+            CHECK_EQ(n.data[2], BLE_BULK_STATUS_BUSY);
+            break;
+        }
+    }
+    ctrl_write((uint8_t const []){BLE_BULK_OP_ABORT}, 1);
+    ctrl_expect(BLE_BULK_OP_RESPONSE, BLE_BULK_OP_ABORT, BLE_BULK_STATUS_SUCCESS);
+    ctrl_write((uint8_t const []){BLE_BULK_OP_OPEN_READ, 1}, 2);
+    ctrl_expect(BLE_BULK_OP_RESPONSE, BLE_BULK_OP_OPEN_READ, BLE_BULK_STATUS_NO_STREAM);
+}
+
+static void test_disconnect_aborts_upload(void)
+{
+    uint8_t open[6] = {BLE_BULK_OP_OPEN_WRITE, STREAM};
+
+    setup(NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+    uint32_encode(100, &open[2]);
+    ctrl_write(open, sizeof(open));
+    ble_peer_disconnect(CONN);
+    CHECK_EQ(m_done, -1);
+    CHECK(m_bulk.p_active == NULL);
+    CHECK_EQ(m_bulk.conn_handle, BLE_CONN_HANDLE_INVALID);
+}
+
+int main(void)
+{
+    test_loopback(BLE_GATT_ATT_MTU_DEFAULT);
+    test_loopback(100);
+    test_loopback(NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+    test_busy_and_unknown_stream();
+    test_disconnect_aborts_upload();
+    printf("test_ble_bulk: ok\n");
+    return 0;
+}
@@ -0,0 +1,139 @@
+/**@brief Test of chord service notifications through the transport, on two links whose
+ *        SoftDevice queues fill: every link gets every record once, in order, and a link that
+ *        does not take its notifications does not hold up the other.
+ *
+ * @details Builds main.c over the stand-ins in stub/, so the records go through the firmware's
+ *          own BLE backend and chord service event handler to the centrals of ble_peer.c.
+ */
+
+#include <string.h>
+#include "check.h"
+#include "ble_peer.h"
+#include "sdk_stub.h"
+
+#define main firmware_main
+#include "main.c"
+#undef main
+
+static void expect(uint16_t conn_handle, uint16_t value_handle, uint8_t b0)
+{
+    ble_peer_notification_t n;
+
+    CHECK_EQ(ble_peer_tx_complete(conn_handle, 1, &n), 1);
+    CHECK_EQ(n.handle, value_handle);
+    CHECK_EQ(n.data[0], b0);
+}
+
+/**@brief Function for starting the chord service and the BLE transport backend of the firmware
+ *        over the central stand-in, with centrals subscribed to the chord value and text.
+ *
+ * @param[in]   queue_size   Notifications the SoftDevice queues per link.
+ * @param[in]   links        Centrals, connection handles 0 to links - 1.
+ */
+static void ble_start(uint32_t queue_size, uint8_t links)
+{
+    ble_peer_init(queue_size);
+    device_connected = false;
+    transport_backend_set(NULL);
+    services_init();
+    ble_peer_observer_add(ble_chord_on_ble_evt, &m_chord);
+    transport_backend_set(&m_ble_transport);
+
+    for (uint16_t conn_handle = 0; conn_handle < links; conn_handle++)
+    {
+        ble_peer_connect(conn_handle);
+        ble_peer_subscribe(conn_handle, m_chord.chord_value_handles.cccd_handle);
+        ble_peer_subscribe(conn_handle, m_chord.text_handles.cccd_handle);
+    }
+    CHECK(transport_is_ready());
+}
+
+int main(void)
+{
+    ble_chord_t const * p_chord = &m_chord;
+    transport_stats_t   stats;
+
+    ble_start(1, 2);
+
+    CHECK_EQ(transport_chord_send(0x01), NRF_SUCCESS);
+    CHECK_EQ(ble_peer_queued(0), 1);
+    CHECK_EQ(ble_peer_queued(1), 1);
+
+    // both queues are full, the chord and text wait in the transport
+    CHECK_EQ(transport_chord_send(0x02), NRF_SUCCESS);
+    CHECK_EQ(transport_text_send(5, "ab", 2), NRF_SUCCESS);
+    transport_stats_get(&stats);
+    CHECK_EQ(stats.sent, 2);
+
+    // link 1 is full and has no connection event, link 0 goes on without it
+    expect(0, p_chord->chord_value_handles.value_handle, 0x01);
+    expect(0, p_chord->chord_value_handles.value_handle, 0x02);
+    expect(0, p_chord->text_handles.value_handle, 5);
+    CHECK_EQ(ble_peer_queued(0), 0);
+    CHECK_EQ(ble_peer_queued(1), 1);
+    for (uint8_t i = 0; i < TRANSPORT_QUEUE_SIZE - 2; i++)
+    {
+        CHECK_EQ(transport_chord_send(0x10 + i), NRF_SUCCESS);
+        expect(0, p_chord->chord_value_handles.value_handle, 0x10 + i);
+    }
+
+    // the records link 1 has not taken fill the transport queue, only then is a chord dropped
+    CHECK_EQ(transport_chord_send(0x30), NRF_SUCCESS);
+    transport_stats_get(&stats);
+    CHECK_EQ(stats.dropped, 1);
+    CHECK_EQ(ble_peer_queued(0), 0);
+
+    // link 1 catches up in order, and the queue is freed
+    expect(1, p_chord->chord_value_handles.value_handle, 0x01);
+    expect(1, p_chord->chord_value_handles.value_handle, 0x02);
+    expect(1, p_chord->text_handles.value_handle, 5);
+    for (uint8_t i = 0; i < TRANSPORT_QUEUE_SIZE - 2; i++)
+    {
+        expect(1, p_chord->chord_value_handles.value_handle, 0x10 + i);
+    }
+    CHECK_EQ(ble_peer_queued(1), 0);
+    CHECK_EQ(transport_chord_send(0x31), NRF_SUCCESS);
+    expect(0, p_chord->chord_value_handles.value_handle, 0x31);
+    expect(1, p_chord->chord_value_handles.value_handle, 0x31);
+    transport_stats_get(&stats);
+    CHECK_EQ(stats.dropped, 1);
+
+    // a link going away frees the records it held
+    CHECK_EQ(transport_chord_send(0x03), NRF_SUCCESS);
+    CHECK_EQ(transport_chord_send(0x04), NRF_SUCCESS);
+    expect(0, p_chord->chord_value_handles.value_handle, 0x03);
+    ble_peer_disconnect(1);
+    expect(0, p_chord->chord_value_handles.value_handle, 0x04);
+    for (uint8_t i = 0; i < TRANSPORT_QUEUE_SIZE + 1; i++)
+    {
+        CHECK_EQ(transport_chord_send(0x40 + i), NRF_SUCCESS);
+        expect(0, p_chord->chord_value_handles.value_handle, 0x40 + i);
+    }
+    transport_stats_get(&stats);
+    CHECK_EQ(stats.dropped, 1);
+
+    // a central that subscribes gets what is sent from then on
+    ble_peer_connect(1);
+    ble_peer_subscribe(1, p_chord->chord_value_handles.cccd_handle);
+    CHECK_EQ(transport_chord_send(0x05), NRF_SUCCESS);
+    CHECK_EQ(transport_chord_send(0x06), NRF_SUCCESS);
+    expect(1, p_chord->chord_value_handles.value_handle, 0x05);
+    expect(1, p_chord->chord_value_handles.value_handle, 0x06);
+
+    // records dropped on a backend switch are not sent afterwards, to the link that had taken
+    // some of them nor to the one that had not
+    CHECK_EQ(transport_chord_send(0x07), NRF_SUCCESS);
+    CHECK_EQ(transport_chord_send(0x08), NRF_SUCCESS);
+    transport_backend_set(NULL);
+    transport_backend_set(&m_ble_transport);
+    CHECK_EQ(transport_chord_send(0x09), NRF_SUCCESS);
+    expect(0, p_chord->chord_value_handles.value_handle, 0x05);
+    expect(0, p_chord->chord_value_handles.value_handle, 0x09);
+    expect(1, p_chord->chord_value_handles.value_handle, 0x07);
+    expect(1, p_chord->chord_value_handles.value_handle, 0x09);
+    CHECK_EQ(ble_peer_queued(0), 0);
+    CHECK_EQ(ble_peer_queued(1), 0);
+
+    printf("test_ble_chord: ok\n");
+    return 0;
+}
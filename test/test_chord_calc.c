@@ -0,0 +1,178 @@
+/**@brief Test of the cockpit calculator: evaluation, the aviation helpers, and the errors it
+ *        reports instead of a wrong result.
+ */
+
+#include <string.h>
+#include "check.h"
+#include "chord_calc.h"
+#include "sdk_stub.h"
+
+#define TEXT_SIZE       24
+
+typedef struct
+{
+    char const * p_expr;
+    char const * p_result;                                          /**< "ERR" for an invalid expression. */
+} calc_case_t;
+
+// units are written 'a' + chord_calc_unit_t, as chord_calc_input() stores them
+static const calc_case_t m_cases[] =
+{
+    // precedence and parentheses, results round to three decimals and input digits past them are ignored
+    {"1+2*3",               "7"},
+    {"(1+2)*3",             "9"},
+    {"10-4-3",              "3"},
+    {"24/4/2",              "3"},
+    {"10/4",                "2.5"},
+    {"2/3",                 "0.667"},
+    {"-2/3",                "-0.667"},
+    {"-5+2",                "-3"},
+    {"-(2+3)*2",            "-10"},
+    {"+4",                  "4"},
+    {"(1+2",                "3"},
+    {".5*3",                "1.5"},
+    {"0.0009",              "0"},
+    {"1.23456",             "1.234"},
+
+    // HDG wraps to 001-360
+    {"350+20H",             "010"},
+    {"90-120H",             "330"},
+    {"360H",                "360"},
+    {"0H",                  "360"},
+    {"-10H",                "350"},
+    {"725H",                "005"},
+    {"359.6H",              "360"},
+    {"0.4H",                "360"},
+    {"(180+200H)+5",        "25"},
+
+    // h:mm in and out
+    {"9.5*1:30",            "14.25"},
+    {"1:30+0:45",           "2:15"},
+    {"0:45-1:30",           "-0:45"},
+    {"120/95T",             "1:16"},
+    {"2.5T",                "2:30"},
+    {"1:5",                 "1:05"},
+    {"1:60",                "ERR"},
+    {"1:",                  "ERR"},
+    {"1:305",               "ERR"},
+
+    // conversions take the number before them, with a unary minus
+    {"100a",                "185.2"},
+    {"185.2b",              "100"},
+    {"1000c",               "304.8"},
+    {"100i",                "212"},
+    {"212j",                "100"},
+    {"-40i",                "-40"},
+    {"2*10g",               "9.072"},
+    {"2*10h",               "44.092"},
+    {"1+2a",                "4.704"},
+
+    // division by zero
+    {"1/0",                 "ERR"},
+    {"1/(2-2)",             "ERR"},
+    {"0/0",                 "ERR"},
+    {"1/0.0001",            "ERR"},
+
+    // overflow, of a number and of the arithmetic
+    {"9999999999999999",    "ERR"},
+    {"9223372036854770",    "ERR"},
+    {"9223372036854769.999", "9223372036854769.999"},
+    {"9223372036854769*10", "ERR"},
+    {"9223372036854769+9",  "ERR"},
+    {"-9223372036854769-9", "ERR"},
+    {"-(-9223372036854769-6.808)", "ERR"},
+    {"(-9223372036854769-6.808)/-1", "ERR"},
+    {"(-9223372036854769-6.808)j", "ERR"},
+    {"9223372036854769/0.1", "ERR"},
+    {"9223372036854769a",   "ERR"},
+    {"9223372036854769.5T", "9223372036854769:30"},
+    {"-9223372036854769H",  "311"},
+
+    // malformed
+    {"",                    "ERR"},
+    {"1+",                  "ERR"},
+    {"()",                  "ERR"},
+    {")",                   "ERR"},
+    {"1)",                  "ERR"},
+    {"*2",                  "ERR"},
+    {"1(2)",                "ERR"},
+    {"H",                   "ERR"},
+    {"1..2",                "ERR"},
+    {"1k",                  "ERR"},
+    {"123456789012345678901234567890123456789012345678+1", "ERR"},
+};
+
+/**@brief Function for typing a chord sequence, returns the last action. */
+static chord_calc_action_t type(char const * p_symbols, char * p_text)
+{
+    chord_calc_action_t action = CHORD_CALC_ACTION_NONE;
+
+    while (*p_symbols != '\0')
+    {
+        action = chord_calc_input(*p_symbols++, p_text, TEXT_SIZE);
+    }
+    return action;
+}
+
+int main(void)
+{
+    char text[TEXT_SIZE];
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_cases); i++)
+    {
+        bool ok = chord_calc_eval(m_cases[i].p_expr, text, sizeof(text));
+
+        if ((strcmp(text, m_cases[i].p_result) != 0) || (ok != (strcmp(m_cases[i].p_result, "ERR") != 0)))
+        {
+            fprintf(stderr, "test_chord_calc: %s is %s, expected %s\n", m_cases[i].p_expr, text,
+                    m_cases[i].p_result);
+            exit(1);
+        }
+    }
+
+    // a result too long for the buffer is an error, not a cut number
+    CHECK(!chord_calc_eval("1234", text, 4));
+    CHECK(strcmp(text, "ERR") == 0);
+    CHECK(!chord_calc_eval("1234", text, 3));
+    CHECK(strcmp(text, "ER") == 0);
+
+    // the calculator layer of the keymap
+    CHECK_EQ(chord_calc_symbol(1), '1');
+    CHECK_EQ(chord_calc_symbol(17), '0');
+    CHECK_EQ(chord_calc_symbol(15), CHORD_CALC_SYM_EQUALS);
+    CHECK_EQ(chord_calc_symbol(0), CHORD_CALC_SYM_NONE);
+    CHECK_EQ(chord_calc_symbol(32), CHORD_CALC_SYM_NONE);
+    CHECK_EQ(chord_calc_symbol(255), CHORD_CALC_SYM_NONE);
+
+    // typing, the result carries on into the next expression
+    chord_calc_reset();
+    CHECK_EQ(type("12+3", text), CHORD_CALC_ACTION_NONE);
+    CHECK_EQ(type("=", text), CHORD_CALC_ACTION_RESULT);
+    CHECK(strcmp(text, "15") == 0);
+    CHECK_EQ(type("*2=", text), CHORD_CALC_ACTION_RESULT);
+    CHECK(strcmp(text, "30") == 0);
+
+    // backspace, clear, and UNIT with a digit picks the conversion
+    CHECK_EQ(type("C17<0U0=", text), CHORD_CALC_ACTION_RESULT);
+    CHECK(strcmp(text, "18.52") == 0);
+    CHECK_EQ(type("CU", text), CHORD_CALC_ACTION_NONE);
+    CHECK_EQ(type("+=", text), CHORD_CALC_ACTION_RESULT);
+    CHECK(strcmp(text, "ERR") == 0);
+
+    // an error starts over, and input past the longest expression is ignored
+    for (uint32_t i = 0; i < CHORD_CALC_MAX_LEN + 10; i++)
+    {
+        CHECK_EQ(chord_calc_input('1', text, sizeof(text)), CHORD_CALC_ACTION_NONE);
+    }
+    CHECK_EQ(type("=", text), CHORD_CALC_ACTION_RESULT);
+    CHECK(strcmp(text, "ERR") == 0);
+    CHECK_EQ(type("2+2=", text), CHORD_CALC_ACTION_RESULT);
+    CHECK(strcmp(text, "4") == 0);
+
+    CHECK_EQ(type("X", text), CHORD_CALC_ACTION_EXIT);
+    CHECK_EQ(type("=", text), CHORD_CALC_ACTION_RESULT);
+    CHECK(strcmp(text, "ERR") == 0);
+
+    printf("test_chord_calc: ok\n");
+    return 0;
+}
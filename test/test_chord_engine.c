@@ -0,0 +1,144 @@
+/**@brief Test of the chord engine on key sequences recorded while typing, each a list of the
+ *        debounced key changes poll_buttons() passes it.
+ */
+
+#include "check.h"
+#include "chord_engine.h"
+#include "sdk_stub.h"
+
+#define CHORDS_MAX      8
+
+#define KEY_A           0x01
+#define KEY_B           0x02
+#define KEY_C           0x04
+#define KEY_D           0x08
+
+typedef struct
+{
+    uint32_t time;                                                  /**< ms */
+    uint8_t  keys;                                                  /**< Keys down from then on. */
+} step_t;
+
+typedef struct
+{
+    char const *   p_name;
+    uint32_t       rollover_ms;
+    uint8_t        seed;                                            /**< Keys latched on wake up. */
+    step_t const * p_steps;
+    uint32_t       step_count;
+    uint8_t        chords[CHORDS_MAX];                              /**< Chords expected, in order, 0 ends. */
+} sequence_t;
+
+// a single key tapped
+static const step_t m_tap[] =
+{
+    {0, KEY_A}, {85, 0},
+};
+
+// the keys of a chord pressed and released a little apart
+static const step_t m_staggered[] =
+{
+    {0, KEY_A}, {22, KEY_A | KEY_B}, {31, KEY_A | KEY_B | KEY_C}, {140, KEY_A | KEY_C}, {152, KEY_C},
+    {160, 0},
+};
+
+// the next chord pressed 22 ms before the last key of this one is up
+static const step_t m_rollover[] =
+{
+    {0, KEY_A | KEY_B}, {104, KEY_A}, {118, KEY_A | KEY_C}, {140, KEY_C}, {215, 0},
+};
+
+// the same with an overlap of 82 ms, one chord
+static const step_t m_long_overlap[] =
+{
+    {0, KEY_A | KEY_B}, {104, KEY_A}, {118, KEY_A | KEY_C}, {200, KEY_C}, {262, 0},
+};
+
+// a key tapped while the chord is released, both complete on the last release
+static const step_t m_tap_in_release[] =
+{
+    {0, KEY_A | KEY_B}, {96, KEY_A}, {108, KEY_A | KEY_C}, {121, KEY_A}, {133, 0},
+};
+
+// three chords rolled one into the next, the middle one of two keys
+static const step_t m_rollover_run[] =
+{
+    {0, KEY_A | KEY_B}, {90, KEY_A}, {101, KEY_A | KEY_C}, {107, KEY_A | KEY_C | KEY_D}, {119, KEY_C | KEY_D},
+    {198, KEY_C}, {206, KEY_A | KEY_C}, {231, KEY_A}, {300, 0},
+};
+
+// a key pressed before the chord starts to be released joins it, whatever the rollover time
+static const step_t m_late_key[] =
+{
+    {0, KEY_A}, {60, KEY_A | KEY_B}, {150, KEY_B}, {170, 0},
+};
+
+// the key that woke the board is up already
+static const step_t m_wake[] =
+{
+    {0, KEY_B}, {70, 0},
+};
+
+// the counter wraps during the overlap
+static const step_t m_wrap[] =
+{
+    {UINT32_MAX - 100, KEY_A | KEY_B}, {UINT32_MAX - 10, KEY_A}, {UINT32_MAX - 5, KEY_A | KEY_C}, {14, KEY_C},
+    {90, 0},
+};
+
+static const sequence_t m_sequences[] =
+{
+    {"tap",                    0, 0,     m_tap,            ARRAY_SIZE(m_tap),            {KEY_A}},
+    {"staggered",             50, 0,     m_staggered,      ARRAY_SIZE(m_staggered),      {KEY_A | KEY_B | KEY_C}},
+    {"rollover",              50, 0,     m_rollover,       ARRAY_SIZE(m_rollover),       {KEY_A | KEY_B, KEY_C}},
+    {"rollover off",           0, 0,     m_rollover,       ARRAY_SIZE(m_rollover),       {KEY_A | KEY_B | KEY_C}},
+    {"long overlap",          50, 0,     m_long_overlap,   ARRAY_SIZE(m_long_overlap),   {KEY_A | KEY_B | KEY_C}},
+    {"tap in release",        50, 0,     m_tap_in_release, ARRAY_SIZE(m_tap_in_release), {KEY_A | KEY_B, KEY_C}},
+    {"tap in release, off",    0, 0,     m_tap_in_release, ARRAY_SIZE(m_tap_in_release), {KEY_A | KEY_B | KEY_C}},
+    {"rollover run",          50, 0,     m_rollover_run,   ARRAY_SIZE(m_rollover_run),   {KEY_A | KEY_B, KEY_C | KEY_D, KEY_A}},
+    {"late key",              50, 0,     m_late_key,       ARRAY_SIZE(m_late_key),       {KEY_A | KEY_B}},
+    {"wake",                  50, KEY_A, m_wake,           ARRAY_SIZE(m_wake),           {KEY_A | KEY_B}},
+    {"wrap",                  50, 0,     m_wrap,           ARRAY_SIZE(m_wrap),           {KEY_A | KEY_B, KEY_C}},
+};
+
+static void run(sequence_t const * p_seq)
+{
+    uint8_t  chords[CHORDS_MAX];
+    uint32_t count = 0;
+
+    chord_engine_seed(p_seq->seed);
+    for (uint32_t i = 0; i < p_seq->step_count; i++)
+    {
+        uint8_t out[CHORD_ENGINE_MAX_CHORDS];
+        uint8_t n = chord_engine_update(p_seq->p_steps[i].keys, p_seq->p_steps[i].time, p_seq->rollover_ms, out);
+
+        CHECK(n <= CHORD_ENGINE_MAX_CHORDS);
+        for (uint8_t j = 0; j < n; j++)
+        {
+            CHECK(count < CHORDS_MAX);
+            chords[count++] = out[j];
+        }
+    }
+
+    for (uint32_t i = 0; i < CHORDS_MAX; i++)
+    {
+        if ((i < count) ? (chords[i] != p_seq->chords[i]) : (p_seq->chords[i] != 0))
+        {
+            fprintf(stderr, "test_chord_engine: %s: chord %u is 0x%02x, expected 0x%02x\n", p_seq->p_name, i,
+                    (i < count) ? chords[i] : 0, p_seq->chords[i]);
+            exit(1);
+        }
+    }
+}
+
+int main(void)
+{
+    // the sequences end with all keys up and follow each other, as the typing did
+    for (uint32_t i = 0; i < ARRAY_SIZE(m_sequences); i++)
+    {
+        run(&m_sequences[i]);
+    }
+
+    printf("test_chord_engine: ok\n");
+    return 0;
+}
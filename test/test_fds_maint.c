@@ -0,0 +1,119 @@
+/**@brief Test of going to sleep with flash storage maintenance.
+ *
+ * @details The sleep handler stands in for system off, so it checks the chord log and statistics
+ *          the flush queued are in flash by the time it runs.
+ */
+
+#include <string.h>
+#include "chord_log.h"
+#include "chord_stats.h"
+#include "check.h"
+#include "fds_maint.h"
+#include "sdk_stub.h"
+
+#define TEST_FILE_ID    0x1F00
+
+static uint32_t m_sleeps;
+
+/**@brief Function for counting the records of a file in flash. */
+static uint32_t records(uint16_t file_id, uint16_t key)
+{
+    fds_record_desc_t desc;
+    fds_find_token_t  token;
+    uint32_t          count = 0;
+
+    memset(&token, 0, sizeof(token));
+    while (fds_record_find(file_id, key, &desc, &token) == NRF_SUCCESS)
+    {
+        count++;
+    }
+    return count;
+}
+
+static void sleep_ready(void)
+{
+    CHECK_EQ(sdk_stub_fds_queued(), 0);
+    CHECK_EQ(records(CHORD_LOG_FILE_ID, CHORD_LOG_RECORD_KEY), 1);
+    CHECK_EQ(records(CHORD_STATS_FILE_ID, CHORD_STATS_RECORD_KEY), 1);
+    m_sleeps++;
+}
+
+/**@brief Function for the flush and sleep of inactive_timeout() in main.c. */
+static bool sleep_prepare(void)
+{
+    chord_log_flush();
+    chord_stats_flush();
+    return fds_maint_sleep_prepare();
+}
+
+int main(void)
+{
+    fds_record_desc_t desc;
+    fds_record_t      record;
+    fds_stat_t        stat;
+    uint32_t          word = 0;
+
+    sdk_stub_reset();
+    CHECK_EQ(chord_log_init(), NRF_SUCCESS);
+    CHECK_EQ(chord_stats_init(), NRF_SUCCESS);
+    CHECK_EQ(fds_maint_init(sleep_ready), NRF_SUCCESS);
+    CHECK_EQ(fds_init(), NRF_SUCCESS);
+    sdk_stub_fds_process();
+
+    // nothing to write or collect
+    CHECK(!sleep_prepare());
+
+    // the flush writes, and sleep waits for them even without garbage to collect
+    chord_log_add(0x03, 1000);
+    chord_stats_add(0x03);
+    CHECK(sleep_prepare());
+    CHECK_EQ(sdk_stub_fds_queued(), 2);
+    CHECK_EQ(m_sleeps, 0);
+    sdk_stub_fds_process();
+    CHECK_EQ(m_sleeps, 1);
+
+    // a few words of garbage are not worth erasing a page for
+    record.file_id           = TEST_FILE_ID;
+    record.key               = 0x0001;
+    record.data.p_data       = &word;
+    record.data.length_words = 1;
+    CHECK_EQ(fds_record_write(&desc, &record), NRF_SUCCESS);
+    sdk_stub_fds_process();
+    CHECK_EQ(fds_record_delete(&desc), NRF_SUCCESS);
+    sdk_stub_fds_process();
+    CHECK_EQ(fds_stat(&stat), NRF_SUCCESS);
+    CHECK(stat.freeable_words != 0);
+
+    // an update replaces the record, the old one is garbage collected after the next write
+    chord_stats_add(0x05);
+    CHECK(sleep_prepare());
+    CHECK_EQ(sdk_stub_fds_queued(), 1);
+    sdk_stub_fds_process();
+    CHECK_EQ(m_sleeps, 2);
+    CHECK_EQ(sdk_stub_fds_page_erases, 0);
+
+    chord_stats_add(0x05);
+    CHECK(sleep_prepare());
+    CHECK_EQ(sdk_stub_fds_queued(), 2);
+    sdk_stub_fds_process();
+    CHECK_EQ(m_sleeps, 3);
+    CHECK(sdk_stub_fds_page_erases != 0);
+
+    // a requested collection runs whatever the garbage
+    chord_stats_add(0x06);
+    fds_maint_gc_request();
+    CHECK(sleep_prepare());
+    CHECK_EQ(sdk_stub_fds_queued(), 2);
+    sdk_stub_fds_process();
+    CHECK_EQ(m_sleeps, 4);
+
+    // key activity cancels the wait
+    chord_stats_add(0x06);
+    CHECK(sleep_prepare());
+    fds_maint_activity(2000);
+    sdk_stub_fds_process();
+    CHECK_EQ(m_sleeps, 4);
+
+    printf("test_fds_maint: ok\n");
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**@brief Test of the transport queue and its delivery counters, over a backend that takes records
+ *        until it is told to be busy, with one lane and then with two.
+ */
+
+#include <string.h>
+#include "check.h"
+#include "sdk_stub.h"
+#include "transport.h"
+
+#define RECEIVED_MAX    64
+#define LANES           2
+
+static bool               m_ready;
+static bool               m_busy[LANES];
+static ret_code_t         m_fail;                                   /**< Error to return instead of taking the record. */
+static transport_record_t m_received[RECEIVED_MAX];                 /**< Records lane 0 took. */
+static uint32_t           m_received_count;
+static uint8_t            m_lane_received[RECEIVED_MAX];            /**< Chords lane 1 took. */
+static uint32_t           m_lane_received_count;
+static bool               m_lane_absent;                            /**< Lane 1 has no receiver. */
+
+static bool test_is_ready(void)
+{
+    return m_ready;
+}
+
+static ret_code_t test_send(uint8_t lane, transport_record_t const * p_record)
+{
+    CHECK(lane < LANES);
+    if (m_busy[lane])
+    {
+        return NRF_ERROR_BUSY;
+    }
+    if (lane == 1)
+    {
+        if (m_lane_absent)
+        {
+            return NRF_ERROR_NOT_FOUND;
+        }
+        CHECK(m_lane_received_count < RECEIVED_MAX);
+        m_lane_received[m_lane_received_count++] = p_record->data[0];
+        return NRF_SUCCESS;
+    }
+    if (m_fail != NRF_SUCCESS)
+    {
+        return m_fail;
+    }
+    CHECK(m_received_count < RECEIVED_MAX);
+    m_received[m_received_count++] = *p_record;
+    return NRF_SUCCESS;
+}
+
+static const transport_backend_t m_test_backend  = {"Test", test_is_ready, test_send, 1};
+static const transport_backend_t m_lanes_backend = {"Lanes", test_is_ready, test_send, LANES};
+
+static void stats_expect(uint32_t sent, uint32_t busy, uint32_t dropped, uint8_t max_queued)
+{
+    transport_stats_t stats;
+
+    transport_stats_get(&stats);
+    CHECK_EQ(stats.sent, sent);
+    CHECK_EQ(stats.busy, busy);
+    CHECK_EQ(stats.dropped, dropped);
+    CHECK_EQ(stats.max_queued, max_queued);
+}
+
+int main(void)
+{
+    static const char text[] = "a longer text than one record holds";
+
+    transport_backend_set(&m_test_backend);
+
+    // nothing is queued without a host
+    CHECK_EQ(transport_chord_send(0x01), NRF_ERROR_INVALID_STATE);
+    m_ready = true;
+
+    CHECK_EQ(transport_chord_send(0x01), NRF_SUCCESS);
+    CHECK_EQ(m_received_count, 1);
+    CHECK_EQ(m_received[0].type, TRANSPORT_RECORD_CHORD);
+    CHECK_EQ(m_received[0].len, 1);
+    CHECK_EQ(m_received[0].data[0], 0x01);
+    stats_expect(1, 0, 0, 1);
+
+    // split text, only the first part replaces
+    CHECK_EQ(transport_text_send(3, text, sizeof(text) - 1), NRF_SUCCESS);
+    CHECK_EQ(m_received_count, 3);
+    CHECK_EQ(m_received[1].type, TRANSPORT_RECORD_TEXT);
+    CHECK_EQ(m_received[1].len, TRANSPORT_RECORD_MAX_LEN);
+    CHECK_EQ(m_received[1].data[0], 3);
+    CHECK(memcmp(&m_received[1].data[1], text, TRANSPORT_TEXT_MAX_LEN) == 0);
+    CHECK_EQ(m_received[2].data[0], 0);
+    CHECK_EQ(m_received[2].len, sizeof(text) - 1 - TRANSPORT_TEXT_MAX_LEN + 1);
+    CHECK(memcmp(&m_received[2].data[1], &text[TRANSPORT_TEXT_MAX_LEN], m_received[2].len - 1) == 0);
+    stats_expect(3, 0, 0, 2);
+
+    // a busy backend keeps the records, in order, until the retry
+    m_busy[0] = true;
+    for (uint8_t i = 0; i < TRANSPORT_QUEUE_SIZE; i++)
+    {
+        CHECK_EQ(transport_chord_send(0x10 + i), NRF_SUCCESS);
+    }
+    stats_expect(3, TRANSPORT_QUEUE_SIZE, 0, TRANSPORT_QUEUE_SIZE);
+
+    // a full queue drops the chord, and text that does not fit whole
+    CHECK_EQ(transport_chord_send(0x02), NRF_SUCCESS);
+    CHECK_EQ(transport_text_send(0, "x", 1), NRF_SUCCESS);
+    stats_expect(3, TRANSPORT_QUEUE_SIZE, 2, TRANSPORT_QUEUE_SIZE);
+
+    m_busy[0] = false;
+    transport_retry();
+    CHECK_EQ(m_received_count, 3 + TRANSPORT_QUEUE_SIZE);
+    for (uint8_t i = 0; i < TRANSPORT_QUEUE_SIZE; i++)
+    {
+        CHECK_EQ(m_received[3 + i].data[0], 0x10 + i);
+    }
+    stats_expect(3 + TRANSPORT_QUEUE_SIZE, TRANSPORT_QUEUE_SIZE, 2, TRANSPORT_QUEUE_SIZE);
+
+    // a failed record is dropped, not retried
+    m_fail = NRF_ERROR_INVALID_STATE;
+    CHECK_EQ(transport_chord_send(0x03), NRF_SUCCESS);
+    m_fail = NRF_SUCCESS;
+    CHECK_EQ(transport_chord_send(0x04), NRF_SUCCESS);
+    CHECK_EQ(m_received[m_received_count - 1].data[0], 0x04);
+    stats_expect(4 + TRANSPORT_QUEUE_SIZE, TRANSPORT_QUEUE_SIZE, 3, TRANSPORT_QUEUE_SIZE);
+
+    // records queued for the previous host are dropped on a switch
+    m_busy[0] = true;
+    CHECK_EQ(transport_chord_send(0x05), NRF_SUCCESS);
+    CHECK_EQ(transport_chord_send(0x06), NRF_SUCCESS);
+    transport_backend_set(NULL);
+    CHECK(!transport_is_ready());
+    stats_expect(4 + TRANSPORT_QUEUE_SIZE, TRANSPORT_QUEUE_SIZE + 2, 5, TRANSPORT_QUEUE_SIZE);
+
+    // a busy lane keeps its records while the other lane takes every one as it comes
+    m_busy[0]        = false;
+    m_busy[1]        = true;
+    m_received_count = 0;
+    transport_backend_set(&m_lanes_backend);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        CHECK_EQ(transport_chord_send(0x20 + i), NRF_SUCCESS);
+        CHECK_EQ(m_received_count, i + 1);
+        CHECK_EQ(m_received[i].data[0], 0x20 + i);
+    }
+    CHECK_EQ(m_lane_received_count, 0);
+
+    // the records stay queued until the busy lane took them too, and are then freed
+    for (uint8_t i = 4; i < TRANSPORT_QUEUE_SIZE; i++)
+    {
+        CHECK_EQ(transport_chord_send(0x20 + i), NRF_SUCCESS);
+    }
+    CHECK_EQ(transport_chord_send(0x40), NRF_SUCCESS);
+    CHECK_EQ(m_received_count, TRANSPORT_QUEUE_SIZE);
+    m_busy[1] = false;
+    transport_lane_retry(1);
+    CHECK_EQ(m_lane_received_count, TRANSPORT_QUEUE_SIZE);
+    for (uint8_t i = 0; i < TRANSPORT_QUEUE_SIZE; i++)
+    {
+        CHECK_EQ(m_lane_received[i], 0x20 + i);
+    }
+    CHECK_EQ(transport_chord_send(0x41), NRF_SUCCESS);
+    CHECK_EQ(m_received[m_received_count - 1].data[0], 0x41);
+    CHECK_EQ(m_lane_received[m_lane_received_count - 1], 0x41);
+
+    // a lane without a receiver does not hold records, nor counts them as sent
+    m_lane_absent = true;
+    m_busy[0]     = true;
+    stats_expect(6 + 3 * TRANSPORT_QUEUE_SIZE, 2 * TRANSPORT_QUEUE_SIZE + 2, 6, TRANSPORT_QUEUE_SIZE);
+    CHECK_EQ(transport_chord_send(0x42), NRF_SUCCESS);
+    m_busy[0] = false;
+    transport_lane_retry(0);
+    CHECK_EQ(m_received[m_received_count - 1].data[0], 0x42);
+    for (uint8_t i = 0; i < TRANSPORT_QUEUE_SIZE; i++)
+    {
+        CHECK_EQ(transport_chord_send(0x50 + i), NRF_SUCCESS);
+    }
+    stats_expect(7 + 4 * TRANSPORT_QUEUE_SIZE, 2 * TRANSPORT_QUEUE_SIZE + 3, 6, TRANSPORT_QUEUE_SIZE);
+
+    printf("test_transport: ok\n");
+    return 0;
+}
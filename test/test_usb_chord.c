@@ -0,0 +1,277 @@
+/**@brief Loopback test of the USB transport: the test is the host, it takes the keyboard reports
+ *        and the port output of the stand-in USB stack and checks what was typed and received.
+ */
+
+#include <string.h>
+#include "check.h"
+#include "ble_chord.h"
+#include "sdk_stub.h"
+#include "transport.h"
+#include "usb_chord.h"
+
+#define TYPED_MAX       512
+#define PORT_MAX        1024
+
+#define CHORD_SHIFT     0x20
+
+static bool                  m_active;
+static sdk_stub_hid_report_t m_report;                              /**< Last report the host got. */
+static char                  m_typed[TYPED_MAX + 1];                /**< Text in the host's editor. */
+static uint32_t              m_typed_len;
+static uint32_t              m_reports;
+static uint8_t               m_port[PORT_MAX];                      /**< Bytes read from the port. */
+static uint32_t              m_port_len;
+static uint8_t               m_expected[PORT_MAX];                  /**< Records the port should carry. */
+static uint32_t              m_expected_len;
+
+static void usb_handler(bool active)
+{
+    m_active = active;
+    transport_backend_set(active ? &usb_chord_transport : NULL);
+}
+
+/**@brief Function for the character of a key, as a US layout host types it. */
+static char usage_char(uint8_t usage, bool shift)
+{
+    static const char digits[]        = "1234567890";
+    static const char shifted_digits[] = "!@#$%^&*()";
+    static const char punct[]         = "-=[]\\\0;'`,./";
+    static const char shifted_punct[] = "_+{}|\0:\"~<>?";
+
+    if ((usage >= 0x04) && (usage <= 0x1D))
+    {
+        return (shift ? 'A' : 'a') + (usage - 0x04);
+    }
+    if ((usage >= 0x1E) && (usage <= 0x27))
+    {
+        return (shift ? shifted_digits : digits)[usage - 0x1E];
+    }
+    if ((usage >= 0x2D) && (usage <= 0x38))
+    {
+        return (shift ? shifted_punct : punct)[usage - 0x2D];
+    }
+    switch (usage)
+    {
+        case 0x28: return '\n';
+        case 0x2A: return '\b';
+        case 0x2C: return ' ';
+        default:   return '\0';
+    }
+}
+
+/**@brief Function for taking a report, typing the keys that went down since the last one. */
+static void host_report(void)
+{
+    bool shift = (sdk_stub_hid_report.modifier & APP_USBD_HID_KBD_MODIFIER_LEFT_SHIFT) != 0;
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(sdk_stub_hid_report.keys); i++)
+    {
+        uint8_t usage = sdk_stub_hid_report.keys[i];
+        char    c;
+
+        if ((usage == 0) || (memchr(m_report.keys, usage, sizeof(m_report.keys)) != NULL))
+        {
+            continue;
+        }
+        c = usage_char(usage, shift);
+        CHECK(c != '\0');
+        if (c == '\b')
+        {
+            CHECK(m_typed_len > 0);
+            m_typed[--m_typed_len] = '\0';
+        }
+        else
+        {
+            CHECK(m_typed_len < TYPED_MAX);
+            m_typed[m_typed_len++] = c;
+            m_typed[m_typed_len]   = '\0';
+        }
+    }
+    m_report = sdk_stub_hid_report;
+    m_reports++;
+}
+
+/**@brief Function for completing the transfers on their way until the device has nothing left. */
+static void host_run(void)
+{
+    while (sdk_stub_hid_busy || (sdk_stub_cdc_data != NULL))
+    {
+        if (sdk_stub_hid_busy)
+        {
+            host_report();
+            sdk_stub_hid_done();
+        }
+        if (sdk_stub_cdc_data != NULL)
+        {
+            CHECK(m_port_len + sdk_stub_cdc_len <= PORT_MAX);
+            memcpy(&m_port[m_port_len], sdk_stub_cdc_data, sdk_stub_cdc_len);
+            m_port_len += sdk_stub_cdc_len;
+            sdk_stub_cdc_done();
+        }
+    }
+}
+
+static void expect_chord(uint8_t chord)
+{
+    m_expected[m_expected_len++] = TRANSPORT_RECORD_CHORD;
+    m_expected[m_expected_len++] = chord;
+}
+
+/**@brief Function for the records of a text, as transport_text_send() splits it. */
+static void expect_text(uint8_t replace, char const * p_text)
+{
+    size_t len = strlen(p_text);
+
+    do
+    {
+        uint8_t part = MIN(len, TRANSPORT_TEXT_MAX_LEN);
+
+        m_expected[m_expected_len++] = TRANSPORT_RECORD_TEXT;
+        m_expected[m_expected_len++] = replace;
+        m_expected[m_expected_len++] = part;
+        memcpy(&m_expected[m_expected_len], p_text, part);
+        m_expected_len += part;
+        p_text         += part;
+        len            -= part;
+        replace         = 0;
+    } while (len > 0);
+}
+
+/**@brief Function for the chord of a character of USB_CHORD_KEYMAP. */
+static uint8_t chord_of(char c)
+{
+    char const * p = memchr(USB_CHORD_KEYMAP, c, sizeof(USB_CHORD_KEYMAP) - 1);
+
+    CHECK((p != NULL) && (c != '\0'));
+    return (uint8_t)(p - USB_CHORD_KEYMAP);
+}
+
+static void typed_expect(char const * p_text)
+{
+    if (strcmp(m_typed, p_text) != 0)
+    {
+        fprintf(stderr, "test_usb_chord: typed \"%s\", expected \"%s\"\n", m_typed, p_text);
+        exit(1);
+    }
+}
+
+static void port_expect(void)
+{
+    CHECK_EQ(m_port_len, m_expected_len);
+    CHECK(memcmp(m_port, m_expected, m_port_len) == 0);
+}
+
+int main(void)
+{
+    static const char long_text[] = "the quick brown fox jumps over the lazy dog, twice: THE QUICK BROWN FOX "
+                                    "jumps over the lazy dog. 0123456789 ~!@#$%^&*()_+{}|:\"<>? -=[]\\;'`,./";
+    static const char hello[]     = "ello world";
+    transport_stats_t stats;
+    uint32_t          reports;
+
+    sdk_stub_reset();
+    CHECK_EQ(usb_chord_init(usb_handler), NRF_SUCCESS);
+    CHECK_EQ(usb_chord_start(), NRF_SUCCESS);
+
+    // plugged in, the device is enabled and started, and sends once the host configures it
+    sdk_stub_usbd_event(APP_USBD_EVT_POWER_DETECTED);
+    CHECK(sdk_stub_usbd_enabled);
+    sdk_stub_usbd_event(APP_USBD_EVT_POWER_READY);
+    CHECK(sdk_stub_usbd_started);
+    sdk_stub_usbd_event(APP_USBD_EVT_STARTED);
+    CHECK(m_active);
+    CHECK(transport_backend_get() == &usb_chord_transport);
+    CHECK(!transport_is_ready());
+    CHECK_EQ(transport_chord_send(chord_of('h')), NRF_ERROR_INVALID_STATE);
+    sdk_stub_usbd_state = APP_USBD_STATE_Configured;
+    CHECK(transport_is_ready());
+
+    // with the port closed only the keyboard types, one key change per report
+    CHECK_EQ(transport_chord_send(chord_of('h')), NRF_SUCCESS);
+    host_run();
+    typed_expect("h");
+    CHECK_EQ(m_reports, 2);
+    CHECK_EQ(m_port_len, 0);
+
+    // the companion app opens the port, chords queue while the keyboard is busy
+    sdk_stub_cdc_event(APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN);
+    for (uint32_t i = 0; i < sizeof(hello) - 1; i++)
+    {
+        uint8_t chord = chord_of(hello[i]) | ((hello[i] == 'w') ? CHORD_SHIFT : 0);
+
+        CHECK_EQ(transport_chord_send(chord), NRF_SUCCESS);
+        expect_chord(chord);
+    }
+    host_run();
+    typed_expect("hello World");
+    port_expect();
+
+    // a shifted key takes four reports: shift, key, key up, shift up
+    reports = m_reports;
+    CHECK_EQ(transport_chord_send(chord_of('\n') | CHORD_SHIFT), NRF_SUCCESS);
+    expect_chord(chord_of('\n') | CHORD_SHIFT);
+    host_run();
+    CHECK_EQ(m_reports - reports, 4);
+    CHECK_EQ(m_report.modifier, 0);
+    typed_expect("hello World\n");
+    port_expect();
+
+    // a text replaces what was typed with backspaces, a suggestion only reaches the port
+    CHECK_EQ(transport_text_send(6, "Earth!", 6), NRF_SUCCESS);
+    expect_text(6, "Earth!");
+    CHECK_EQ(transport_text_send(BLE_CHORD_TEXT_SUGGESTION, "ly", 2), NRF_SUCCESS);
+    expect_text(BLE_CHORD_TEXT_SUGGESTION, "ly");
+    host_run();
+    typed_expect("hello Earth!");
+    port_expect();
+
+    // a text longer than the keyboard queue waits for room, and arrives whole and in order
+    CHECK_EQ(transport_text_send(0, long_text, sizeof(long_text) - 1), NRF_SUCCESS);
+    expect_text(0, long_text);
+    host_run();
+    typed_expect("hello Earth!" "the quick brown fox jumps over the lazy dog, twice: THE QUICK BROWN FOX "
+                 "jumps over the lazy dog. 0123456789 ~!@#$%^&*()_+{}|:\"<>? -=[]\\;'`,./");
+    port_expect();
+    transport_stats_get(&stats);
+    CHECK(stats.busy > 0);
+    CHECK_EQ(stats.dropped, 0);
+
+    // the host suspends with keys queued, they are dropped and typing goes on after resume
+    m_typed_len = 0;
+    m_typed[0]  = '\0';
+    CHECK_EQ(transport_chord_send(chord_of('x')), NRF_SUCCESS);
+    CHECK_EQ(transport_chord_send(chord_of('y')), NRF_SUCCESS);
+    expect_chord(chord_of('x'));
+    expect_chord(chord_of('y'));
+    sdk_stub_usbd_suspended = true;
+    sdk_stub_usbd_event(APP_USBD_EVT_DRV_SUSPEND);
+    sdk_stub_hid_busy = false;
+    memset(&sdk_stub_hid_report, 0, sizeof(sdk_stub_hid_report));
+    sdk_stub_usbd_suspended = false;
+    sdk_stub_usbd_event(APP_USBD_EVT_DRV_RESUME);
+    CHECK_EQ(transport_chord_send(chord_of('z')), NRF_SUCCESS);
+    expect_chord(chord_of('z'));
+    memset(&m_report, 0, sizeof(m_report));
+    host_run();
+    typed_expect("z");
+    port_expect();
+
+    // the app closes the port, the keyboard still types
+    sdk_stub_cdc_event(APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE);
+    CHECK_EQ(transport_chord_send(chord_of('a')), NRF_SUCCESS);
+    host_run();
+    typed_expect("za");
+    port_expect();
+
+    // unplugged, the device stops and hands the transport back
+    sdk_stub_usbd_event(APP_USBD_EVT_POWER_REMOVED);
+    CHECK(!sdk_stub_usbd_started);
+    sdk_stub_usbd_event(APP_USBD_EVT_STOPPED);
+    CHECK(!sdk_stub_usbd_enabled);
+    CHECK(!m_active);
+    CHECK(transport_backend_get() == NULL);
+    CHECK(!transport_is_ready());
+
+    printf("test_usb_chord: ok\n");
+    return 0;
+}
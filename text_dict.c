@@ -0,0 +1,167 @@
+#include "sdk_common.h"
+#include "text_dict.h"
+#include "flash_blob.h"
+
+#define NODE_DEAD           0                                   /**< The word cannot be an abbreviation, wait for a separator. */
+#define CHILD_LEN           3
+
+/**@brief Node header, decoded from flash. */
+typedef struct
+{
+    uint8_t  children;
+    uint8_t  exp_len;
+    uint16_t exp_offset;
+    uint16_t child_offset;                              /**< Offset of the first child entry. */
+} dict_node_t;
+
+static uint16_t m_node = TEXT_DICT_ROOT_OFFSET;         /**< Node reached by the chords typed since the last separator. */
+static uint8_t  m_depth;
+
+/**@brief Function for decoding a node, checking that it lies within the payload.
+ */
+static bool node_get(uint8_t const * p_dict, uint32_t dict_len, uint16_t offset, dict_node_t * p_node)
+{
+    if ((uint32_t)offset + 2 > dict_len)
+    {
+        return false;
+    }
+    p_node->children     = p_dict[offset];
+    p_node->exp_len      = p_dict[offset + 1];
+    p_node->exp_offset   = 0;
+    p_node->child_offset = offset + 2;
+
+    if (p_node->exp_len != 0)
+    {
+        if ((uint32_t)offset + 4 > dict_len)
+        {
+            return false;
+        }
+        p_node->exp_offset    = uint16_decode(&p_dict[offset + 2]);
+        p_node->child_offset += 2;
+
+        if ((uint32_t)p_node->exp_offset + p_node->exp_len > dict_len)
+        {
+            return false;
+        }
+    }
+    return ((uint32_t)p_node->child_offset + p_node->children * CHILD_LEN <= dict_len);
+}
+
+/**@brief Function for finding the child of a node for a chord.
+ *
+ * @return Offset of the child node, NODE_DEAD if there is none.
+ */
+static uint16_t child_find(uint8_t const * p_dict, dict_node_t const * p_node, uint8_t chord)
+{
+    uint8_t lo = 0;
+    uint8_t hi = p_node->children;
+
+    while (lo < hi)
+    {
+        uint8_t         mid     = (uint8_t)((lo + hi) / 2);
+        uint8_t const * p_child = &p_dict[p_node->child_offset + mid * CHILD_LEN];
+
+        if (p_child[0] == chord)
+        {
+            return uint16_decode(&p_child[1]);
+        }
+        if (p_child[0] < chord)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return NODE_DEAD;
+}
+
+static bool is_separator(uint8_t const * p_dict, uint8_t chord)
+{
+    if (chord >= CHORD_SEPARATOR_WORDS * 32)
+    {
+        return false;
+    }
+    return (uint32_decode(&p_dict[(chord / 32) * sizeof(uint32_t)]) >> (chord % 32)) & 1;
+}
+
+static void expansion_get(uint8_t const * p_dict, dict_node_t const * p_node, text_dict_expansion_t * p_exp)
+{
+    p_exp->replace = m_depth;
+    p_exp->p_text  = (char const *)&p_dict[p_node->exp_offset];
+    p_exp->len     = p_node->exp_len;
+}
+
+bool text_dict_chord(uint8_t chord, text_dict_expansion_t * p_exp)
+{
+    uint32_t        dict_len;
+    uint8_t const * p_dict = flash_blob_get(FLASH_BLOB_TEXT_DICT, TEXT_DICT_FORMAT, &dict_len);
+    dict_node_t     node;
+
+    if ((p_dict == NULL) || (dict_len < TEXT_DICT_ROOT_OFFSET))
+    {
+        text_dict_reset();
+        return false;
+    }
+
+    bool separator = is_separator(p_dict, chord);
+
+    if (m_node == NODE_DEAD)
+    {
+        if (separator)
+        {
+            text_dict_reset();
+        }
+        return false;
+    }
+
+    if (!node_get(p_dict, dict_len, m_node, &node))
+    {
+        m_node = NODE_DEAD;
+        return false;
+    }
+
+    uint16_t child = separator ? NODE_DEAD : child_find(p_dict, &node, chord);
+
+    if (child != NODE_DEAD)
+    {
+        m_node = child;
+        m_depth++;
+
+        if (node_get(p_dict, dict_len, child, &node) && (node.exp_len != 0) && (node.children == 0))
+        {
+            // A complete abbreviation, expanded after the chord that completed it.
+            expansion_get(p_dict, &node, p_exp);
+            p_exp->before_chord = false;
+            m_node = NODE_DEAD;
+            return true;
+        }
+        return false;
+    }
+
+    // The walk ends here, an abbreviation that is a prefix of a longer one ends with a separator.
+    bool due = separator && (m_depth != 0) && (node.exp_len != 0);
+
+    if (due)
+    {
+        expansion_get(p_dict, &node, p_exp);
+        p_exp->before_chord = true;
+    }
+
+    if (separator)
+    {
+        text_dict_reset();
+    }
+    else
+    {
+        m_node = NODE_DEAD;
+    }
+    return due;
+}
+
+void text_dict_reset(void)
+{
+    m_node  = TEXT_DICT_ROOT_OFFSET;
+    m_depth = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef TEXT_DICT_H__
+#define TEXT_DICT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chord_keys.h"
+
+/**@brief Abbreviation expansion.
+ *
+ * @details Abbreviations are chord sequences, so the dictionary does not depend on how the host
+ *          maps chords to letters. The dictionary is an array-packed trie in the
+ *          FLASH_BLOB_TEXT_DICT blob, walked in place one node per chord, so a lookup costs
+ *          O(abbreviation length) and no RAM beyond the walker state.
+ *
+ *          An abbreviation only starts after a separator chord (or at power up), so abbreviations
+ *          inside words are not expanded. When a chord reaches a node with an expansion and no
+ *          children, the expansion is due right away. A node with both is expanded only when the
+ *          next chord is a separator, before it; any other chord that does not continue a longer
+ *          abbreviation ends the word without an expansion.
+ *
+ *          Blob payload, little endian, offsets in bytes from the start of the payload:
+ *          - separators:   CHORD_SEPARATOR_WORDS u32 bitmasks of separator chords, chords 0 to 31
+ *                          first.
+ *          - root node at TEXT_DICT_ROOT_OFFSET.
+ *          - node:         child count (u8), expansion length (u8), expansion offset (u16, only if
+ *                          the length is not 0), then per child, sorted by chord:
+ *                          chord (u8), node offset (u16).
+ *          - expansions:   text, anywhere in the payload.
+ */
+
+#define TEXT_DICT_FORMAT                (0x0001 + CHORD_BLOB_FORMAT_KEYS)   /**< flash_blob_header_t format of the dictionary. */
+#define TEXT_DICT_ROOT_OFFSET           CHORD_SEPARATOR_LEN
+
+/**@brief Expansion to send. */
+typedef struct
+{
+    uint8_t      replace;                                           /**< Chords the host must delete first. */
+    char const * p_text;                                            /**< Text in flash, not NUL terminated. */
+    uint8_t      len;
+    bool         before_chord;                                      /**< Send before the chord that triggered it, which starts a new word. */
+} text_dict_expansion_t;
+
+/**@brief Function for feeding a typed chord to the expander.
+ *
+ * @param[in]   chord    Chord value.
+ * @param[out]  p_exp    Expansion, valid if true is returned.
+ *
+ * @return true if an expansion is due.
+ */
+bool text_dict_chord(uint8_t chord, text_dict_expansion_t * p_exp);
+
+/**@brief Function for restarting the walk, for example when the host changes.
+ */
+void text_dict_reset(void);
+
+#endif // TEXT_DICT_H__
@@ -0,0 +1,200 @@
+#include "sdk_common.h"
+#include "transport.h"
+#include <string.h>
+#include "nrf_log.h"
+
+static transport_backend_t const * m_backend;
+static transport_record_t          m_queue[TRANSPORT_QUEUE_SIZE];
+static uint8_t                     m_head;                 /**< Oldest record. */
+static uint8_t                     m_count;
+static uint8_t                     m_taken[TRANSPORT_LANES_MAX]; /**< Records from the oldest a lane has taken. */
+static transport_stats_t           m_stats;
+
+/**@brief Function for reserving the next record, which is filled in place and then committed.
+ *
+ * @return NULL if the queue is full.
+ */
+static transport_record_t * record_alloc(uint8_t type)
+{
+    transport_record_t * p_record;
+
+    if (m_count == TRANSPORT_QUEUE_SIZE)
+    {
+        return NULL;
+    }
+    p_record       = &m_queue[(m_head + m_count) % TRANSPORT_QUEUE_SIZE];
+    p_record->type = type;
+    p_record->len  = 0;
+    return p_record;
+}
+
+static void record_commit(void)
+{
+    m_count++;
+    m_stats.max_queued = MAX(m_stats.max_queued, m_count);
+}
+
+/**@brief Function for passing the records a lane has not taken yet until it is busy.
+ */
+static void lane_drain(uint8_t lane)
+{
+    while (m_taken[lane] < m_count)
+    {
+        ret_code_t err_code = m_backend->send(lane, &m_queue[(m_head + m_taken[lane]) % TRANSPORT_QUEUE_SIZE]);
+
+        if (err_code == NRF_ERROR_BUSY)
+        {
+            m_stats.busy++;
+            return;
+        }
+        if (err_code == NRF_SUCCESS)
+        {
+            m_stats.sent++;
+        }
+        else if (err_code != NRF_ERROR_NOT_FOUND)
+        {
+            // A failed record is not retried, later ones would wait behind it forever.
+            NRF_LOG_WARNING("%s send failed: %x", m_backend->p_name, err_code);
+            m_stats.dropped++;
+        }
+        m_taken[lane]++;
+    }
+}
+
+/**@brief Function for freeing the records every lane has taken.
+ */
+static void queue_free(void)
+{
+    uint8_t done = m_count;
+
+    for (uint8_t lane = 0; lane < m_backend->lanes; lane++)
+    {
+        done = MIN(done, m_taken[lane]);
+    }
+    for (uint8_t lane = 0; lane < m_backend->lanes; lane++)
+    {
+        m_taken[lane] -= done;
+    }
+    m_head   = (m_head + done) % TRANSPORT_QUEUE_SIZE;
+    m_count -= done;
+}
+
+/**@brief Function for passing queued records to every lane of the backend until it is busy.
+ */
+static void queue_drain(void)
+{
+    if (m_backend == NULL)
+    {
+        return;
+    }
+    for (uint8_t lane = 0; lane < m_backend->lanes; lane++)
+    {
+        lane_drain(lane);
+    }
+    queue_free();
+}
+
+void transport_backend_set(transport_backend_t const * p_backend)
+{
+    if (p_backend == m_backend)
+    {
+        return;
+    }
+    m_stats.dropped += m_count;
+    m_head           = 0;
+    m_count          = 0;
+    m_backend        = p_backend;
+    memset(m_taken, 0, sizeof(m_taken));
+    NRF_LOG_INFO("Transport: %s", (p_backend != NULL) ? p_backend->p_name : "none");
+}
+
+transport_backend_t const * transport_backend_get(void)
+{
+    return m_backend;
+}
+
+bool transport_is_ready(void)
+{
+    return (m_backend != NULL) && m_backend->is_ready();
+}
+
+ret_code_t transport_chord_send(uint8_t chord)
+{
+    transport_record_t * p_record;
+
+    if (!transport_is_ready())
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    p_record = record_alloc(TRANSPORT_RECORD_CHORD);
+    if (p_record == NULL)
+    {
+        NRF_LOG_WARNING("Transport queue full, chord dropped");
+        m_stats.dropped++;
+        return NRF_SUCCESS;
+    }
+    p_record->data[0] = chord;
+    p_record->len     = 1;
+    record_commit();
+
+    queue_drain();
+    return NRF_SUCCESS;
+}
+
+ret_code_t transport_text_send(uint8_t replace, char const * p_text, uint16_t len)
+{
+    uint16_t parts = (len + TRANSPORT_TEXT_MAX_LEN - 1) / TRANSPORT_TEXT_MAX_LEN;
+
+    if (!transport_is_ready())
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // All parts or none, a partial text would leave the host with a broken word.
+    if (TRANSPORT_QUEUE_SIZE - m_count < MAX(parts, 1))
+    {
+        NRF_LOG_WARNING("Transport queue full, text dropped");
+        m_stats.dropped++;
+        return NRF_SUCCESS;
+    }
+
+    // Empty text still goes out, it clears a suggestion.
+    do
+    {
+        transport_record_t * p_record = record_alloc(TRANSPORT_RECORD_TEXT);
+        uint8_t              n        = (uint8_t)MIN(len, TRANSPORT_TEXT_MAX_LEN);
+
+        p_record->data[0] = replace;
+        memcpy(&p_record->data[1], p_text, n);
+        p_record->len = n + 1;
+        record_commit();
+
+        replace  = 0;
+        p_text  += n;
+        len     -= n;
+    } while (len != 0);
+
+    queue_drain();
+    return NRF_SUCCESS;
+}
+
+void transport_retry(void)
+{
+    queue_drain();
+}
+
+void transport_lane_retry(uint8_t lane)
+{
+    if ((m_backend == NULL) || (lane >= m_backend->lanes))
+    {
+        return;
+    }
+    lane_drain(lane);
+    queue_free();
+}
+
+void transport_stats_get(transport_stats_t * p_stats)
+{
+    *p_stats = m_stats;
+}
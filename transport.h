@@ -0,0 +1,96 @@
+#ifndef TRANSPORT_H__
+#define TRANSPORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+
+/**@brief Path from the chord engine to the host.
+ *
+ * @details Chords and text become records in one queue, written in place and handed to the
+ *          active backend in place. Queuing, retry and drop policy live here once, backends only
+ *          deliver a record or report that they are busy. Text is split into records of at most
+ *          TRANSPORT_TEXT_MAX_LEN characters, the first one carries the replace count. Replace is
+ *          the number of characters to delete first, BLE_CHORD_TEXT_SUGGESTION marks a
+ *          suggestion that is shown but not inserted.
+ *
+ *          Record data, which is also the chord service characteristic value:
+ *            TRANSPORT_RECORD_CHORD  chord (u8)
+ *            TRANSPORT_RECORD_TEXT   replace (u8), text
+ *
+ *          A backend with several receivers, the links of the chord service, declares a lane for
+ *          each. Every lane has its own read cursor into the queue, a busy lane waits for its own
+ *          retry while the others go on, and a record is freed once every lane has taken it.
+ *
+ *          Must be used from one interrupt priority, the application one.
+ */
+
+#define TRANSPORT_RECORD_CHORD          0x01
+#define TRANSPORT_RECORD_TEXT           0x02
+
+#define TRANSPORT_RECORD_MAX_LEN        20                                  /**< Longest record data, one notification at the default ATT MTU. */
+#define TRANSPORT_TEXT_MAX_LEN          (TRANSPORT_RECORD_MAX_LEN - 1)
+#define TRANSPORT_QUEUE_SIZE            16                                  /**< Records waiting for the backend. */
+#define TRANSPORT_LANES_MAX             4                                   /**< Receivers of one backend. */
+
+/**@brief Record, delivered in place from the queue. */
+typedef struct
+{
+    uint8_t                       type;
+    uint8_t                       len;                              /**< Length of data. */
+    uint8_t                       data[TRANSPORT_RECORD_MAX_LEN];
+} transport_record_t;
+
+/**@brief Backend, one per way of reaching a host. */
+typedef struct
+{
+    char const * p_name;
+    bool       (*is_ready)(void);                                   /**< A host receives what is sent. */
+    ret_code_t (*send)(uint8_t lane, transport_record_t const * p_record); /**< NRF_ERROR_BUSY leaves the record queued for the lane until it is retried, NRF_ERROR_NOT_FOUND skips a lane without a receiver. */
+    uint8_t      lanes;                                             /**< Receivers, each sent every record at its own pace, 1 to TRANSPORT_LANES_MAX. */
+} transport_backend_t;
+
+/**@brief Delivery counters, for comparing backends and queue sizes. */
+typedef struct
+{
+    uint32_t                      sent;                             /**< Records taken, once per lane. */
+    uint32_t                      busy;                             /**< Backend was busy, the record stayed queued. */
+    uint32_t                      dropped;                          /**< Queue full or delivery failed. */
+    uint8_t                       max_queued;
+} transport_stats_t;
+
+/**@brief Function for switching the backend. Records queued for the previous host are dropped.
+ */
+void transport_backend_set(transport_backend_t const * p_backend);
+
+/**@brief Function for getting the backend. */
+transport_backend_t const * transport_backend_get(void);
+
+/**@brief Function for checking whether a host receives what is sent. */
+bool transport_is_ready(void);
+
+/**@brief Function for sending a chord.
+ *
+ * @return NRF_ERROR_INVALID_STATE if no host receives it. A full queue drops the chord.
+ */
+ret_code_t transport_chord_send(uint8_t chord);
+
+/**@brief Function for sending text produced on the device.
+ *
+ * @return NRF_ERROR_INVALID_STATE if no host receives it. A full queue drops the text.
+ */
+ret_code_t transport_text_send(uint8_t replace, char const * p_text, uint16_t len);
+
+/**@brief Function for passing queued records to the backend again. Backends call it once they
+ *        have room after returning NRF_ERROR_BUSY.
+ */
+void transport_retry(void);
+
+/**@brief Function for passing queued records to one lane again, once that receiver has room.
+ */
+void transport_lane_retry(uint8_t lane);
+
+/**@brief Function for reading the delivery counters. */
+void transport_stats_get(transport_stats_t * p_stats);
+
+#endif // TRANSPORT_H__
@@ -0,0 +1,472 @@
+#include "sdk_common.h"
+#include "usb_chord.h"
+
+#if USB_CHORD_ENABLED
+
+#include <string.h>
+#include "app_usbd.h"
+#include "app_usbd_core.h"
+#include "app_usbd_hid_kbd.h"
+#include "app_usbd_cdc_acm.h"
+#include "nrf_drv_clock.h"
+#include "ble_chord.h"
+#include "chord_keys.h"
+#include "nrf_log.h"
+
+#define HID_KBD_INTERFACE       0
+#define CDC_ACM_COMM_INTERFACE  1
+#define CDC_ACM_DATA_INTERFACE  2
+
+#define HID_KBD_EPIN            NRF_DRV_USBD_EPIN1
+#define CDC_ACM_COMM_EPIN       NRF_DRV_USBD_EPIN2
+#define CDC_ACM_DATA_EPIN       NRF_DRV_USBD_EPIN3
+#define CDC_ACM_DATA_EPOUT      NRF_DRV_USBD_EPOUT1
+
+#define HID_USAGE_A             0x04
+#define HID_USAGE_1             0x1E
+#define HID_USAGE_0             0x27
+#define HID_USAGE_ENTER         0x28
+#define HID_USAGE_BACKSPACE     0x2A
+#define HID_USAGE_SPACE         0x2C
+
+#define CHORD_KEYMAP_KEYS       0x1F                    /**< Keys 1 to 5, the index of USB_CHORD_KEYMAP. */
+#if CHORD_KEY_COUNT >= 6
+#define CHORD_SHIFT             0x20                    /**< Key 6. */
+#else
+#define CHORD_SHIFT             0
+#endif
+#define CDC_MASK                (USB_CHORD_CDC_BUF_SIZE - 1)
+
+STATIC_ASSERT((USB_CHORD_CDC_BUF_SIZE & CDC_MASK) == 0);
+STATIC_ASSERT(sizeof(USB_CHORD_KEYMAP) == 33);
+
+/**@brief Keystroke waiting to be typed. */
+typedef struct
+{
+    uint8_t usage;
+    bool    shift;
+} hid_key_t;
+
+/**@brief Steps of one keystroke, each one keyboard report. */
+typedef enum
+{
+    HID_STATE_IDLE,
+    HID_STATE_SHIFT_DOWN,
+    HID_STATE_KEY_DOWN,
+    HID_STATE_KEY_UP,
+} hid_state_t;
+
+static void usbd_user_ev_handler(app_usbd_event_type_t event);
+static void hid_kbd_user_ev_handler(app_usbd_class_inst_t const * p_inst, app_usbd_hid_user_event_t event);
+static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const * p_inst, app_usbd_cdc_acm_user_event_t event);
+
+APP_USBD_HID_KBD_GLOBAL_DEF(m_kbd,
+                            HID_KBD_INTERFACE,
+                            HID_KBD_EPIN,
+                            hid_kbd_user_ev_handler,
+                            APP_USBD_HID_SUBCLASS_BOOT);
+
+APP_USBD_CDC_ACM_GLOBAL_DEF(m_cdc_acm,
+                            cdc_acm_user_ev_handler,
+                            CDC_ACM_COMM_INTERFACE,
+                            CDC_ACM_DATA_INTERFACE,
+                            CDC_ACM_COMM_EPIN,
+                            CDC_ACM_DATA_EPIN,
+                            CDC_ACM_DATA_EPOUT,
+                            APP_USBD_CDC_COMM_PROTOCOL_NONE);
+
+static usb_chord_handler_t m_handler;
+static bool                m_started;
+
+static hid_key_t           m_hid_queue[USB_CHORD_HID_QUEUE_SIZE];
+static uint8_t             m_hid_head;
+static uint8_t             m_hid_count;
+static hid_key_t           m_hid_key;                  /**< Keystroke being typed. */
+static hid_state_t         m_hid_state;
+static bool                m_hid_busy;                 /**< A report is on its way, the next step waits for it. */
+
+static uint8_t             m_cdc_buf[USB_CHORD_CDC_BUF_SIZE];
+static uint32_t            m_cdc_head;
+static uint32_t            m_cdc_tail;
+static uint32_t            m_cdc_tx_len;               /**< Bytes given to the port, 0 when idle. */
+static bool                m_cdc_open;
+
+/**@brief Function for finding the key of a character.
+ *
+ * @return false if the character cannot be typed.
+ */
+static bool hid_key_of(char c, hid_key_t * p_key)
+{
+    static const char shifted_digits[] = ")!@#$%^&*(";
+    static const char punct[]          = "-=[]\\\0;'`,./";
+    static const char shifted_punct[]  = "_+{}|\0:\"~<>?";
+    char const *      p;
+
+    p_key->shift = false;
+
+    if ((c >= 'a') && (c <= 'z'))
+    {
+        p_key->usage = HID_USAGE_A + (c - 'a');
+    }
+    else if ((c >= 'A') && (c <= 'Z'))
+    {
+        p_key->usage = HID_USAGE_A + (c - 'A');
+        p_key->shift = true;
+    }
+    else if ((c >= '1') && (c <= '9'))
+    {
+        p_key->usage = HID_USAGE_1 + (c - '1');
+    }
+    else if (c == '0')
+    {
+        p_key->usage = HID_USAGE_0;
+    }
+    else if (c == ' ')
+    {
+        p_key->usage = HID_USAGE_SPACE;
+    }
+    else if (c == '\n')
+    {
+        p_key->usage = HID_USAGE_ENTER;
+    }
+    else if (c == '\b')
+    {
+        p_key->usage = HID_USAGE_BACKSPACE;
+    }
+    else if ((c != '\0') && ((p = memchr(shifted_digits, c, sizeof(shifted_digits) - 1)) != NULL))
+    {
+        p_key->usage = (p == shifted_digits) ? HID_USAGE_0 : HID_USAGE_1 + (p - shifted_digits) - 1;
+        p_key->shift = true;
+    }
+    // Minus to slash are consecutive usages, 0x32 is the non-US hash key.
+    else if ((c != '\0') && ((p = memchr(punct, c, sizeof(punct) - 1)) != NULL))
+    {
+        p_key->usage = 0x2D + (p - punct);
+    }
+    else if ((c != '\0') && ((p = memchr(shifted_punct, c, sizeof(shifted_punct) - 1)) != NULL))
+    {
+        p_key->usage = 0x2D + (p - shifted_punct);
+        p_key->shift = true;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+/**@brief Function for taking the next step of typing, once the previous report has been sent.
+ *
+ * @details Each step changes one key, so every change reaches the host in a report of its own
+ *          and quick keystrokes are not merged.
+ */
+static void hid_step(void)
+{
+    ret_code_t err_code = NRF_SUCCESS;
+
+    if (m_hid_busy)
+    {
+        return;
+    }
+
+    switch (m_hid_state)
+    {
+        case HID_STATE_IDLE:
+            if (m_hid_count == 0)
+            {
+                return;
+            }
+            m_hid_key   = m_hid_queue[m_hid_head];
+            m_hid_head  = (m_hid_head + 1) % USB_CHORD_HID_QUEUE_SIZE;
+            m_hid_count--;
+
+            if (m_hid_key.shift)
+            {
+                m_hid_state = HID_STATE_SHIFT_DOWN;
+                err_code    = app_usbd_hid_kbd_modifier_state_set(&m_kbd, APP_USBD_HID_KBD_MODIFIER_LEFT_SHIFT, true);
+                break;
+            }
+            m_hid_state = HID_STATE_KEY_DOWN;
+            err_code    = app_usbd_hid_kbd_key_control(&m_kbd, m_hid_key.usage, true);
+            break;
+
+        case HID_STATE_SHIFT_DOWN:
+            m_hid_state = HID_STATE_KEY_DOWN;
+            err_code    = app_usbd_hid_kbd_key_control(&m_kbd, m_hid_key.usage, true);
+            break;
+
+        case HID_STATE_KEY_DOWN:
+            m_hid_state = m_hid_key.shift ? HID_STATE_KEY_UP : HID_STATE_IDLE;
+            err_code    = app_usbd_hid_kbd_key_control(&m_kbd, m_hid_key.usage, false);
+            break;
+
+        case HID_STATE_KEY_UP:
+            m_hid_state = HID_STATE_IDLE;
+            err_code    = app_usbd_hid_kbd_modifier_state_set(&m_kbd, APP_USBD_HID_KBD_MODIFIER_LEFT_SHIFT, false);
+            break;
+    }
+
+    // Without a transfer, for example while suspended, there is no report to wait for.
+    m_hid_busy = (err_code == NRF_SUCCESS);
+}
+
+static void hid_reset(void)
+{
+    m_hid_count = 0;
+    m_hid_state = HID_STATE_IDLE;
+    m_hid_busy  = false;
+}
+
+static void hid_key_put(hid_key_t const * p_key)
+{
+    m_hid_queue[(m_hid_head + m_hid_count) % USB_CHORD_HID_QUEUE_SIZE] = *p_key;
+    m_hid_count++;
+}
+
+/**@brief Function for passing buffered port output to the port, one contiguous part at a time.
+ */
+static void cdc_flush(void)
+{
+    uint32_t start = m_cdc_tail & CDC_MASK;
+    uint32_t len   = MIN(m_cdc_head - m_cdc_tail, USB_CHORD_CDC_BUF_SIZE - start);
+
+    if (!m_cdc_open || (m_cdc_tx_len != 0) || (len == 0))
+    {
+        return;
+    }
+    if (app_usbd_cdc_acm_write(&m_cdc_acm, &m_cdc_buf[start], len) == NRF_SUCCESS)
+    {
+        m_cdc_tx_len = len;
+    }
+}
+
+static void cdc_byte_put(uint8_t byte)
+{
+    m_cdc_buf[m_cdc_head++ & CDC_MASK] = byte;
+}
+
+static void hid_kbd_user_ev_handler(app_usbd_class_inst_t const * p_inst, app_usbd_hid_user_event_t event)
+{
+    UNUSED_PARAMETER(p_inst);
+
+    if (event == APP_USBD_HID_USER_EVT_IN_REPORT_DONE)
+    {
+        m_hid_busy = false;
+        hid_step();
+        transport_retry();
+    }
+}
+
+static void cdc_acm_user_ev_handler(app_usbd_class_inst_t const * p_inst, app_usbd_cdc_acm_user_event_t event)
+{
+    UNUSED_PARAMETER(p_inst);
+
+    switch (event)
+    {
+        case APP_USBD_CDC_ACM_USER_EVT_PORT_OPEN:
+            m_cdc_open   = true;
+            m_cdc_head   = 0;
+            m_cdc_tail   = 0;
+            m_cdc_tx_len = 0;
+            break;
+
+        case APP_USBD_CDC_ACM_USER_EVT_PORT_CLOSE:
+            m_cdc_open = false;
+            transport_retry();
+            break;
+
+        case APP_USBD_CDC_ACM_USER_EVT_TX_DONE:
+            m_cdc_tail  += m_cdc_tx_len;
+            m_cdc_tx_len = 0;
+            cdc_flush();
+            transport_retry();
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void usbd_user_ev_handler(app_usbd_event_type_t event)
+{
+    switch (event)
+    {
+        case APP_USBD_EVT_STARTED:
+            NRF_LOG_INFO("USB started");
+            m_started = true;
+            m_handler(true);
+            break;
+
+        case APP_USBD_EVT_STOPPED:
+            NRF_LOG_INFO("USB stopped");
+            app_usbd_disable();
+            m_started  = false;
+            m_cdc_open = false;
+            hid_reset();
+            m_handler(false);
+            break;
+
+        case APP_USBD_EVT_DRV_SUSPEND:
+            // Keys typed while suspended would be lost, the queue starts over on resume.
+            hid_reset();
+            transport_retry();
+            break;
+
+        case APP_USBD_EVT_POWER_DETECTED:
+            if (!nrf_drv_usbd_is_enabled())
+            {
+                app_usbd_enable();
+            }
+            break;
+
+        case APP_USBD_EVT_POWER_REMOVED:
+            app_usbd_stop();
+            break;
+
+        case APP_USBD_EVT_POWER_READY:
+            app_usbd_start();
+            break;
+
+        default:
+            break;
+    }
+}
+
+static bool usb_is_ready(void)
+{
+    return m_started && (app_usbd_core_state_get() == APP_USBD_STATE_Configured);
+}
+
+/**@brief Function for delivering a record to the port and the keyboard.
+ *
+ * @details The record goes out whole or waits, both for the port buffer and for the keyboard
+ *          queue, so the two never disagree about what was sent.
+ */
+static ret_code_t usb_send(uint8_t lane, transport_record_t const * p_record)
+{
+    bool      suggestion = false;
+    uint8_t   replace    = 0;
+    uint8_t   text_len   = 0;
+    uint32_t  cdc_len;
+    uint32_t  keys;
+    hid_key_t key;
+
+    UNUSED_PARAMETER(lane);
+
+    if (p_record->type == TRANSPORT_RECORD_TEXT)
+    {
+        replace    = p_record->data[0];
+        text_len   = p_record->len - 1;
+        suggestion = (replace == BLE_CHORD_TEXT_SUGGESTION);
+        cdc_len    = 3 + text_len;
+        keys       = suggestion ? 0 : replace + text_len;
+    }
+    else
+    {
+        cdc_len = 2;
+        keys    = 1;
+    }
+
+    if (keys > USB_CHORD_HID_QUEUE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+    if ((m_cdc_open && (USB_CHORD_CDC_BUF_SIZE - (m_cdc_head - m_cdc_tail) < cdc_len)) ||
+        (USB_CHORD_HID_QUEUE_SIZE - m_hid_count < keys))
+    {
+        return NRF_ERROR_BUSY;
+    }
+
+    if (m_cdc_open)
+    {
+        cdc_byte_put(p_record->type);
+        if (p_record->type == TRANSPORT_RECORD_TEXT)
+        {
+            cdc_byte_put(replace);
+            cdc_byte_put(text_len);
+            for (uint8_t i = 0; i < text_len; i++)
+            {
+                cdc_byte_put(p_record->data[1 + i]);
+            }
+        }
+        else
+        {
+            cdc_byte_put(p_record->data[0]);
+        }
+        cdc_flush();
+    }
+
+    if (p_record->type == TRANSPORT_RECORD_CHORD)
+    {
+        uint8_t chord = p_record->data[0];
+
+        // Chords with keys 7 and 8 have no key on the keyboard, they only reach the port.
+        if (((chord & ~(CHORD_KEYMAP_KEYS | CHORD_SHIFT)) == 0)
+            && hid_key_of(USB_CHORD_KEYMAP[chord & CHORD_KEYMAP_KEYS], &key))
+        {
+            key.shift = key.shift || ((chord & CHORD_SHIFT) != 0);
+            hid_key_put(&key);
+        }
+    }
+    else if (!suggestion)
+    {
+        key.usage = HID_USAGE_BACKSPACE;
+        key.shift = false;
+        for (uint8_t i = 0; i < replace; i++)
+        {
+            hid_key_put(&key);
+        }
+        for (uint8_t i = 0; i < text_len; i++)
+        {
+            if (hid_key_of((char)p_record->data[1 + i], &key))
+            {
+                hid_key_put(&key);
+            }
+        }
+    }
+    hid_step();
+
+    return NRF_SUCCESS;
+}
+
+const transport_backend_t usb_chord_transport =
+{
+    .p_name   = "USB",
+    .is_ready = usb_is_ready,
+    .send     = usb_send,
+    .lanes    = 1,
+};
+
+ret_code_t usb_chord_init(usb_chord_handler_t handler)
+{
+    static const app_usbd_config_t usbd_config =
+    {
+        .ev_state_proc = usbd_user_ev_handler
+    };
+    ret_code_t err_code;
+
+    VERIFY_PARAM_NOT_NULL(handler);
+    m_handler = handler;
+
+    // app_usbd requests the high frequency clock through the clock driver.
+    err_code = nrf_drv_clock_init();
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_MODULE_ALREADY_INITIALIZED))
+    {
+        return err_code;
+    }
+
+    err_code = app_usbd_init(&usbd_config);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = app_usbd_class_append(app_usbd_hid_kbd_class_inst_get(&m_kbd));
+    VERIFY_SUCCESS(err_code);
+
+    return app_usbd_class_append(app_usbd_cdc_acm_class_inst_get(&m_cdc_acm));
+}
+
+ret_code_t usb_chord_start(void)
+{
+    return app_usbd_power_events_enable();
+}
+
+#endif // USB_CHORD_ENABLED
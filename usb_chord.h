@@ -0,0 +1,44 @@
+#ifndef USB_CHORD_H__
+#define USB_CHORD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdk_errors.h"
+#include "transport.h"
+
+/**@brief USB device mode, on the nRF52840 only. Built with USB_CHORD_ENABLED.
+ *
+ * @details A composite device of a HID boot keyboard and a CDC ACM port. The keyboard types
+ *          chords through USB_CHORD_KEYMAP and text character by character, for hosts without the
+ *          companion app; suggestions are not typed. The port carries the transport records,
+ *          for the companion app:
+ *            TRANSPORT_RECORD_CHORD  chord (u8)
+ *            TRANSPORT_RECORD_TEXT   replace (u8), length (u8), text
+ *          The device starts when VBUS is detected and stops when it is removed, the handler
+ *          reports both so the application can switch transports. Events are handled in the
+ *          USBD interrupt, at the application priority.
+ */
+
+#define USB_CHORD_HID_QUEUE_SIZE        64                                  /**< Keystrokes waiting to be typed. */
+#define USB_CHORD_CDC_BUF_SIZE          256                                 /**< Port output waiting for the host, power of two. */
+
+/**@brief Keyboard layout of keys 1 to 5, indexed by chord. Key 6, if built, adds shift. */
+#define USB_CHORD_KEYMAP                "\0abcdefghijklmnopqrstuvwxyz .,\n\b"
+
+/**@brief Called when the USB device has started or stopped. */
+typedef void (*usb_chord_handler_t) (bool active);
+
+/**@brief Function for initializing the USB device. Must be called before the SoftDevice is enabled.
+ *
+ * @param[in]   handler  Handler of the device state.
+ */
+ret_code_t usb_chord_init(usb_chord_handler_t handler);
+
+/**@brief Function for starting VBUS detection. Must be called after the SoftDevice is enabled.
+ */
+ret_code_t usb_chord_start(void);
+
+/**@brief The USB transport backend. */
+extern const transport_backend_t usb_chord_transport;
+
+#endif // USB_CHORD_H__